@@ -0,0 +1,291 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Benchmarks for the LU decompositions
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "LUDoolittle.hpp"
+#include "Parallel.hpp"
+#include "Solver.hpp"
+
+BOOST_AUTO_TEST_SUITE( LU )
+
+/// Benchmark for the LU decompositions
+  template<typename T>
+  class benchLU {
+  protected:
+    /// Maximum allowed size for the square matrices
+    const size_t _maxSize;
+
+    /// A large matrix holding pseudo-random entries
+    anpi::Matrix<T> _data;
+
+    /// State of the benchmarked evaluation: a block of _data
+    typename anpi::Matrix<T>::const_view_type _a;
+    anpi::Matrix<T> _lu;
+    std::vector<size_t> _permut;
+  public:
+    /// Construct
+    benchLU(const size_t maxSize)
+        : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize) {
+
+      // Unlike periodic patterns, these entries yield regular matrices
+      unsigned int seed = 12345u;
+      for (size_t r=0;r<_maxSize;++r) {
+        for (size_t c=0;c<_maxSize;++c) {
+          seed = 1103515245u*seed + 12345u;
+          _data(r,c) = T(int((seed >> 16) % 2048u) - 1024)/T(1024);
+        }
+      }
+    }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      assert (size<=this->_maxSize);
+      this->_a = _data.block(0,0,size,size);
+    }
+  };
+
+/// Unblocked decomposition, one rank-1 update per column
+  template<typename T>
+  class benchLUDoolittle : public benchLU<T> {
+  public:
+    /// Constructor
+    benchLUDoolittle(const size_t n) : benchLU<T>(n) { }
+
+    // Evaluate decomposition
+    inline void eval() {
+      anpi::luDoolittle<T>(this->_a,this->_lu,this->_permut);
+    }
+  };
+
+/// Blocked decomposition, one gemm per panel
+  template<typename T>
+  class benchLUBlocked : public benchLU<T> {
+  public:
+    /// Constructor
+    benchLUBlocked(const size_t n) : benchLU<T>(n) { }
+
+    // Evaluate decomposition
+    inline void eval() {
+      anpi::luBlocked<T>(this->_a,this->_lu,this->_permut);
+    }
+  };
+
+/// Task-parallel tiled decomposition
+  template<typename T>
+  class benchLUTiled : public benchLU<T> {
+  public:
+    /// Constructor
+    benchLUTiled(const size_t n) : benchLU<T>(n) { }
+
+    // Evaluate decomposition
+    inline void eval() {
+      anpi::luTiled<T>(this->_a,this->_lu,this->_permut);
+    }
+  };
+
+/// Fixed size tiled decomposition, where prepare() selects the number of threads
+  template<typename T>
+  class benchLUThreads : public benchLUTiled<T> {
+  public:
+    /// Constructor
+    benchLUThreads(const size_t n) : benchLUTiled<T>(n) {
+      benchLU<T>::prepare(n);
+    }
+
+    /// The "size" is the number of threads
+    void prepare(const size_t threads) {
+      anpi::parallel::threads() = threads;
+    }
+  };
+
+/// Inversion with a single decomposition
+  template<typename T>
+  class benchInvert : public benchLU<T> {
+  protected:
+    /// Copy of the block of _data to invert
+    anpi::Matrix<T> _m;
+    anpi::Matrix<T> _mi;
+  public:
+    /// Constructor
+    benchInvert(const size_t n) : benchLU<T>(n) { }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      benchLU<T>::prepare(size);
+      _m = anpi::Matrix<T>(this->_a);
+    }
+
+    // Evaluate inversion
+    inline void eval() {
+      anpi::invert(_m,_mi);
+    }
+  };
+
+/// Former inversion, with one decomposition per column of the identity
+  template<typename T>
+  class benchInvertByColumns : public benchInvert<T> {
+  public:
+    /// Constructor
+    benchInvertByColumns(const size_t n) : benchInvert<T>(n) { }
+
+    // Evaluate inversion
+    inline void eval() {
+      const size_t n = this->_m.rows();
+      std::vector<T> e(n,T(0)),x;
+      this->_mi.allocate(n,n);
+      for (size_t j=0;j<n;++j) {
+        e[j] = T(1);
+        anpi::solveLU(this->_m,x,e);
+        for (size_t i=0;i<n;++i) {
+          this->_mi(i,j) = x[i];
+        }
+        e[j] = T(0);
+      }
+    }
+  };
+
+/**
+ * Compare the decompositions on growing sizes
+ */
+  BOOST_AUTO_TEST_CASE( Decomposition ) {
+
+    std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                   96, 128, 192, 256,
+                                  384, 512, 768,1024};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=5;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchLUDoolittle<double> bl(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_doolittle_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"Doolittle (double)","r");
+    }
+
+    {
+      benchLUBlocked<double> bl(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_blocked_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"Blocked (double)","g");
+    }
+
+    {
+      benchLUTiled<double> bl(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_tiled_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"Tiled (double)","b");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+/**
+ * Inversion with one decomposition, O(n^3), against one decomposition
+ * per column, O(n^4): doubling n multiplies the time of the former by
+ * about 8, and of the latter by about 16.
+ */
+  BOOST_AUTO_TEST_CASE( Invert ) {
+
+    std::vector<size_t> sizes = {  16,  24,  32,  48,
+                                   64,  96, 128, 192, 256};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=5;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchInvert<double> bi(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bi);
+
+      ::anpi::benchmark::write("invert_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"One decomposition (double)","g");
+    }
+
+    {
+      benchInvertByColumns<double> bi(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bi);
+
+      ::anpi::benchmark::write("invert_by_columns_double.txt",times);
+      ::anpi::benchmark::plotRange(times,
+                                   "One decomposition per column (double)",
+                                   "r");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+/**
+ * Scaling of the tiled decomposition with the number of threads, from
+ * one to all processors.  The run time of the serial panels bounds the
+ * speed-up of the smaller system sooner.
+ */
+  BOOST_AUTO_TEST_CASE( LUThreads ) {
+
+    std::vector<size_t> threads;
+    for (int t=1;t<=anpi::parallel::processors();++t) {
+      threads.push_back(size_t(t));
+    }
+
+    const size_t repetitions=2;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchLUThreads<double> bl(4096);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_tiled_4096_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"Tiled 4096 (double) vs threads","g");
+    }
+
+    {
+      benchLUThreads<double> bl(8192);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_tiled_8192_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"Tiled 8192 (double) vs threads","m");
+    }
+
+    {
+      benchLUThreads<float> bl(8192);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bl);
+
+      ::anpi::benchmark::write("lu_tiled_8192_float_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"Tiled 8192 (float) vs threads","k");
+    }
+
+    anpi::parallel::threads() = 0;
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
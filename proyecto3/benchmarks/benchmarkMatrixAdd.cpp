@@ -23,23 +23,24 @@
 #include "benchmarkFramework.hpp"
 #include "Matrix.hpp"
 #include "Allocator.hpp"
+#include "Parallel.hpp"
 
 BOOST_AUTO_TEST_SUITE( MatrixAdd )
 
 /// Benchmark for addition operations
-  template<typename T>
+  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
   class benchAdd {
   protected:
     /// Maximum allowed size for the square matrices
     const size_t _maxSize;
 
     /// A large matrix holding
-    anpi::Matrix<T> _data;
+    anpi::Matrix<T,Alloc> _data;
 
     /// State of the benchmarked evaluation
-    anpi::Matrix<T> _a;
-    anpi::Matrix<T> _b;
-    anpi::Matrix<T> _c;
+    anpi::Matrix<T,Alloc> _a;
+    anpi::Matrix<T,Alloc> _b;
+    anpi::Matrix<T,Alloc> _c;
   public:
     /// Construct
     benchAdd(const size_t maxSize)
@@ -56,7 +57,7 @@ BOOST_AUTO_TEST_SUITE( MatrixAdd )
     /// Prepare the evaluation of given size
     void prepare(const size_t size) {
       assert (size<=this->_maxSize);
-      this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+      this->_a=std::move(anpi::Matrix<T,Alloc>(size,size,_data.data()));
       this->_b=this->_a;
     }
   };
@@ -101,11 +102,11 @@ BOOST_AUTO_TEST_SUITE( MatrixAdd )
   };
 
 /// Provide the evaluation method for on-copy addition
-  template<typename T>
-  class benchAddOnCopySIMD : public benchAdd<T> {
+  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
+  class benchAddOnCopySIMD : public benchAdd<T,Alloc> {
   public:
     /// Constructor
-    benchAddOnCopySIMD(const size_t n) : benchAdd<T>(n) { }
+    benchAddOnCopySIMD(const size_t n) : benchAdd<T,Alloc>(n) { }
 
     // Evaluate add on-copy
     inline void eval() {
@@ -113,6 +114,34 @@ BOOST_AUTO_TEST_SUITE( MatrixAdd )
     }
   };
 
+/// Fixed size on-copy addition, where prepare() selects the number of threads
+  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
+  class benchAddThreads : public benchAddOnCopySIMD<T,Alloc> {
+  public:
+    /// Constructor
+    benchAddThreads(const size_t n) : benchAddOnCopySIMD<T,Alloc>(n) {
+      benchAdd<T,Alloc>::prepare(n);
+    }
+
+    /// The "size" is the number of threads
+    void prepare(const size_t threads) {
+      anpi::parallel::threads() = threads;
+    }
+  };
+
+/// Fixed size c = a + b through the operator, evaluated as an expression
+  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
+  class benchAddOperatorThreads : public benchAddThreads<T,Alloc> {
+  public:
+    /// Constructor
+    benchAddOperatorThreads(const size_t n) : benchAddThreads<T,Alloc>(n) { }
+
+    // Evaluate the expression
+    inline void eval() {
+      this->_c = this->_a + this->_b;
+    }
+  };
+
 /**
  * Instantiate and test the methods of the Matrix class
  */
@@ -147,6 +176,17 @@ BOOST_AUTO_TEST_SUITE( MatrixAdd )
       ::anpi::benchmark::plotRange(times,"On-copy (float) simd","g");
     }
 
+    {
+      // Unpadded rows: unaligned registers and masked tails
+      benchAddOnCopySIMD<float,std::allocator<float> >  baoc(n);
+
+      // Measure on-copy add
+      ANPI_BENCHMARK(sizes,repetitions,times,baoc);
+
+      ::anpi::benchmark::write("add_on_copy_float_simd_unaligned.txt",times);
+      ::anpi::benchmark::plotRange(times,"On-copy (float) simd unaligned","k");
+    }
+
     {
       benchAddInPlaceFallback<float> baip(n);
 
@@ -193,4 +233,80 @@ BOOST_AUTO_TEST_SUITE( MatrixAdd )
     ::anpi::benchmark::show();
   }
 
+/**
+ * Scaling of the addition with the number of threads.  The sum streams
+ * three matrices and does one operation per entry, so it stops scaling
+ * as soon as the memory bandwidth is saturated.
+ */
+  BOOST_AUTO_TEST_CASE( AddThreads ) {
+
+    std::vector<size_t> threads;
+    for (int t=1;t<=anpi::parallel::processors();++t) {
+      threads.push_back(size_t(t));
+    }
+
+    const size_t repetitions=20;
+    std::vector<anpi::benchmark::measurement> times;
+
+    const size_t oldThreshold = anpi::parallel::elementwiseThreshold();
+    anpi::parallel::elementwiseThreshold() = 0;
+
+    {
+      benchAddThreads<float> ba(4096);
+
+      ANPI_BENCHMARK(threads,repetitions,times,ba);
+
+      ::anpi::benchmark::write("add_on_copy_float_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"On-copy 4096 (float) vs threads","g");
+    }
+
+    {
+      benchAddThreads<float,std::allocator<float> > ba(4096);
+
+      ANPI_BENCHMARK(threads,repetitions,times,ba);
+
+      ::anpi::benchmark::write("add_on_copy_float_unaligned_threads.txt",
+                               times);
+      ::anpi::benchmark::plotRange(times,
+                                   "On-copy 4096 (float) unaligned vs threads",
+                                   "k");
+    }
+
+    {
+      benchAddOperatorThreads<float> ba(4096);
+
+      ANPI_BENCHMARK(threads,repetitions,times,ba);
+
+      ::anpi::benchmark::write("add_operator_float_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"c = a + b 4096 (float) vs threads",
+                                   "r");
+    }
+
+    {
+      benchAddOperatorThreads<float,std::allocator<float> > ba(4096);
+
+      ANPI_BENCHMARK(threads,repetitions,times,ba);
+
+      ::anpi::benchmark::write("add_operator_float_unaligned_threads.txt",
+                               times);
+      ::anpi::benchmark::plotRange(times,
+                                   "c = a + b 4096 (float) unaligned vs threads",
+                                   "c");
+    }
+
+    {
+      benchAddThreads<double> ba(2048);
+
+      ANPI_BENCHMARK(threads,repetitions,times,ba);
+
+      ::anpi::benchmark::write("add_on_copy_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"On-copy 2048 (double) vs threads","m");
+    }
+
+    anpi::parallel::threads() = 0;
+    anpi::parallel::elementwiseThreshold() = oldThreshold;
+
+    ::anpi::benchmark::show();
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <complex>
+
+/**
+ * Benchmarks for the level-1 operations (scale, axpy, element-wise
+ * product and quotient, multiply-add and dot product), also on 16 bit
+ * storage, which halves the memory traffic
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "Allocator.hpp"
+
+BOOST_AUTO_TEST_SUITE( MatrixBlas1 )
+
+/// Benchmark for the level-1 operations on square matrices
+  template<typename T>
+  class benchBlas1 {
+  protected:
+    /// Maximum allowed size for the square matrices
+    const size_t _maxSize;
+
+    /// A large matrix holding
+    anpi::Matrix<T> _data;
+
+    /// State of the benchmarked evaluation
+    anpi::Matrix<T> _a;
+    anpi::Matrix<T> _b;
+    anpi::Matrix<T> _c;
+    anpi::Matrix<T> _d;
+
+    /// Number of entries processed, padding included
+    size_t _n;
+  public:
+    /// Construct
+    benchBlas1(const size_t maxSize)
+        : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize),
+          _n(0) {
+
+      size_t idx=0;
+      for (size_t r=0;r<_maxSize;++r) {
+        for (size_t c=0;c<_maxSize;++c) {
+          _data(r,c)=T(1) + T(idx++ % 7);
+        }
+      }
+    }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      assert (size<=this->_maxSize);
+      this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+      this->_b=this->_a;
+      this->_c=this->_a;
+      this->_d.allocate(size,size);
+      this->_n=this->_a.rows()*this->_a.dcols();
+    }
+  };
+
+/// y = alpha*x + y with the scalar kernel
+  template<typename T>
+  class benchAxpyFallback : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchAxpyFallback(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate axpy
+    inline void eval() {
+      anpi::fallback::axpy(T(0.5),this->_a.data(),this->_b.data(),this->_n);
+    }
+  };
+
+/// y = alpha*x + y with the register kernels
+  template<typename T>
+  class benchAxpySIMD : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchAxpySIMD(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate axpy
+    inline void eval() {
+      anpi::simd::axpy(T(0.5),this->_a.data(),this->_b.data(),this->_n);
+    }
+  };
+
+/// x = alpha*x with the register kernels
+  template<typename T>
+  class benchScaleSIMD : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchScaleSIMD(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate scale
+    inline void eval() {
+      anpi::simd::scale(this->_a.data(),this->_n,T(1));
+    }
+  };
+
+/// c = a./b with the register kernels
+  template<typename T>
+  class benchDivideSIMD : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchDivideSIMD(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate divide
+    inline void eval() {
+      anpi::divide(this->_a,this->_b,this->_d);
+    }
+  };
+
+/// d = a.*b + c with the scalar kernel
+  template<typename T>
+  class benchFmaddFallback : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchFmaddFallback(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate fmadd
+    inline void eval() {
+      anpi::fallback::fmadd(this->_a.data(),this->_b.data(),this->_c.data(),
+                            this->_d.data(),this->_n);
+    }
+  };
+
+/// d = a.*b + c with the register kernels
+  template<typename T>
+  class benchFmaddSIMD : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchFmaddSIMD(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate fmadd
+    inline void eval() {
+      anpi::simd::fmadd(this->_a.data(),this->_b.data(),this->_c.data(),
+                        this->_d.data(),this->_n);
+    }
+  };
+
+/// Dot product with the scalar kernel
+  template<typename T>
+  class benchDotFallback : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchDotFallback(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate dot
+    inline void eval() {
+      T r;
+      anpi::fallback::dot(this->_a.data(),this->_b.data(),this->_n,r);
+      this->_d(0,0) = r;
+    }
+  };
+
+/// Dot product with the register kernels, in parallel for large sizes
+  template<typename T>
+  class benchDotSIMD : public benchBlas1<T> {
+  public:
+    /// Constructor
+    benchDotSIMD(const size_t n) : benchBlas1<T>(n) { }
+
+    // Evaluate dot
+    inline void eval() {
+      T r;
+      anpi::simd::dot(this->_a.data(),this->_b.data(),this->_n,r);
+      this->_d(0,0) = r;
+    }
+  };
+
+/**
+ * Compare the scalar and the register kernels
+ */
+  BOOST_AUTO_TEST_CASE( Blas1 ) {
+
+    std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                   96, 128, 192, 256,
+                                   384, 512, 768,1024,
+                                   1536,2048,3072,4096};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=100;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchAxpyFallback<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("axpy_float_fb.txt",times);
+      ::anpi::benchmark::plotRange(times,"axpy (float) fallback","r");
+    }
+
+    {
+      benchAxpySIMD<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("axpy_float_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"axpy (float) simd","g");
+    }
+
+    {
+      benchAxpySIMD<anpi::half> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("axpy_half_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"axpy (half) simd","g--");
+    }
+
+    {
+      benchScaleSIMD<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("scale_float_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"scale (float) simd","k");
+    }
+
+    {
+      benchDivideSIMD<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("divide_float_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"divide (float) simd","c");
+    }
+
+    {
+      benchFmaddFallback<double> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("fmadd_double_fb.txt",times);
+      ::anpi::benchmark::plotRange(times,"fmadd (double) fallback","b");
+    }
+
+    {
+      benchFmaddSIMD<double> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("fmadd_double_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"fmadd (double) simd","m");
+    }
+
+    {
+      benchDotFallback<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("dot_float_fb.txt",times);
+      ::anpi::benchmark::plotRange(times,"dot (float) fallback","y");
+    }
+
+    {
+      benchDotSIMD<float> bench(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bench);
+
+      ::anpi::benchmark::write("dot_float_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"dot (float) simd","k--");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <complex>
+
+/**
+ * Benchmarks for fused element-wise expressions
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "Allocator.hpp"
+
+BOOST_AUTO_TEST_SUITE( MatrixExpr )
+
+/// Benchmark for the evaluation of r = a + b - c + d
+  template<typename T>
+  class benchExpr {
+  protected:
+    /// Maximum allowed size for the square matrices
+    const size_t _maxSize;
+
+    /// A large matrix holding
+    anpi::Matrix<T> _data;
+
+    /// State of the benchmarked evaluation
+    anpi::Matrix<T> _a;
+    anpi::Matrix<T> _b;
+    anpi::Matrix<T> _c;
+    anpi::Matrix<T> _d;
+    anpi::Matrix<T> _r;
+  public:
+    /// Construct
+    benchExpr(const size_t maxSize)
+        : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize) {
+
+      size_t idx=0;
+      for (size_t r=0;r<_maxSize;++r) {
+        for (size_t c=0;c<_maxSize;++c) {
+          _data(r,c)=idx++;
+        }
+      }
+    }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      assert (size<=this->_maxSize);
+      this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+      this->_b=this->_a;
+      this->_c=this->_a;
+      this->_d=this->_a;
+    }
+  };
+
+/// Chain of SIMD kernels, each one producing a temporary
+  template<typename T>
+  class benchExprTemporaries : public benchExpr<T> {
+  public:
+    /// Constructor
+    benchExprTemporaries(const size_t n) : benchExpr<T>(n) { }
+
+    // Evaluate with one pass per operation
+    inline void eval() {
+      anpi::Matrix<T> t1,t2;
+      anpi::simd::add(this->_a,this->_b,t1);
+      anpi::simd::subtract(t1,this->_c,t2);
+      anpi::simd::add(t2,this->_d,this->_r);
+    }
+  };
+
+/// Fused expression, evaluated in one pass
+  template<typename T>
+  class benchExprFused : public benchExpr<T> {
+  public:
+    /// Constructor
+    benchExprFused(const size_t n) : benchExpr<T>(n) { }
+
+    // Evaluate the whole expression at once
+    inline void eval() {
+      this->_r = this->_a + this->_b - this->_c + this->_d;
+    }
+  };
+
+/**
+ * Compare the chained kernels against the fused expression
+ */
+  BOOST_AUTO_TEST_CASE( Expr ) {
+
+    std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                   96, 128, 192, 256,
+                                   384, 512, 768,1024,
+                                   1536,2048,3072,4096};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=20;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchExprTemporaries<float> bet(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bet);
+
+      ::anpi::benchmark::write("expr_float_temporaries.txt",times);
+      ::anpi::benchmark::plotRange(times,"a+b-c+d (float) temporaries","r");
+    }
+
+    {
+      benchExprFused<float> bef(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bef);
+
+      ::anpi::benchmark::write("expr_float_fused.txt",times);
+      ::anpi::benchmark::plotRange(times,"a+b-c+d (float) fused","g");
+    }
+
+    {
+      benchExprTemporaries<double> bet(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bet);
+
+      ::anpi::benchmark::write("expr_double_temporaries.txt",times);
+      ::anpi::benchmark::plotRange(times,"a+b-c+d (double) temporaries","b");
+    }
+
+    {
+      benchExprFused<double> bef(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bef);
+
+      ::anpi::benchmark::write("expr_double_fused.txt",times);
+      ::anpi::benchmark::plotRange(times,"a+b-c+d (double) fused","m");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <complex>
+
+/**
+ * Benchmarks for the matrix product
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "Allocator.hpp"
+#include "Parallel.hpp"
+
+BOOST_AUTO_TEST_SUITE( MatrixMul )
+
+/// Benchmark for multiplication operations
+  template<typename T>
+  class benchMul {
+  protected:
+    /// Maximum allowed size for the square matrices
+    const size_t _maxSize;
+
+    /// A large matrix holding
+    anpi::Matrix<T> _data;
+
+    /// State of the benchmarked evaluation
+    anpi::Matrix<T> _a;
+    anpi::Matrix<T> _b;
+    anpi::Matrix<T> _c;
+  public:
+    /// Construct
+    benchMul(const size_t maxSize)
+        : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize) {
+
+      for (size_t r=0;r<_maxSize;++r) {
+        for (size_t c=0;c<_maxSize;++c) {
+          _data(r,c)=T((r*7+c*3)%11)/T(11);
+        }
+      }
+    }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      assert (size<=this->_maxSize);
+      this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+      this->_b=this->_a;
+    }
+  };
+
+/// Provide the evaluation method for the fallback product
+  template<typename T>
+  class benchMulFallback : public benchMul<T> {
+  public:
+    /// Constructor
+    benchMulFallback(const size_t n) : benchMul<T>(n) { }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::fallback::multiply(this->_a,this->_b,this->_c);
+    }
+  };
+
+/// Provide the evaluation method for the packed SIMD product
+  template<typename T>
+  class benchMulSIMD : public benchMul<T> {
+  public:
+    /// Constructor
+    benchMulSIMD(const size_t n) : benchMul<T>(n) { }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::simd::multiply(this->_a,this->_b,this->_c);
+    }
+  };
+
+/// Fixed size product, where prepare() selects the number of threads
+  template<typename T>
+  class benchMulThreads : public benchMul<T> {
+  public:
+    /// Constructor
+    benchMulThreads(const size_t n) : benchMul<T>(n) {
+      benchMul<T>::prepare(n);
+    }
+
+    /// The "size" is the number of threads
+    void prepare(const size_t threads) {
+      anpi::parallel::threads() = threads;
+    }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::simd::multiply(this->_a,this->_b,this->_c);
+    }
+  };
+
+/**
+ * Instantiate and test the methods of the Matrix class
+ */
+  BOOST_AUTO_TEST_CASE( Mul ) {
+
+    std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                   96, 128, 192, 256,
+                                   384, 512, 768,1024};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=5;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchMulFallback<double>  bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_double_fb.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product (double) fallback","r");
+    }
+
+    {
+      benchMulSIMD<double>  bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_double_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product (double) simd","g");
+    }
+
+    {
+      benchMulFallback<float> bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_float_fb.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product (float) fallback","b");
+    }
+
+    {
+      benchMulSIMD<float> bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_float_simd.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product (float) simd","m");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+/**
+ * Scaling of a 2048x2048 product with the number of threads
+ */
+  BOOST_AUTO_TEST_CASE( MulThreads ) {
+
+    std::vector<size_t> threads;
+    for (int t=1;t<=anpi::parallel::processors();++t) {
+      threads.push_back(size_t(t));
+    }
+
+    const size_t repetitions=3;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchMulThreads<double> bm(2048);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product 2048 (double) vs threads","g");
+    }
+
+    {
+      benchMulThreads<float> bm(2048);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bm);
+
+      ::anpi::benchmark::write("mul_float_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"Product 2048 (float) vs threads","m");
+    }
+
+    anpi::parallel::threads() = 0;
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
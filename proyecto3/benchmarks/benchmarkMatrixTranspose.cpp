@@ -0,0 +1,199 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstring>
+#include <complex>
+
+/**
+ * Benchmarks for the matrix transposition
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "Allocator.hpp"
+
+BOOST_AUTO_TEST_SUITE( MatrixTranspose )
+
+/// Benchmark for the transposition of square matrices
+  template<typename T>
+  class benchTranspose {
+  protected:
+    /// Maximum allowed size for the square matrices
+    const size_t _maxSize;
+
+    /// A large matrix holding
+    anpi::Matrix<T> _data;
+
+    /// State of the benchmarked evaluation
+    anpi::Matrix<T> _a;
+    anpi::Matrix<T> _b;
+  public:
+    /// Construct
+    benchTranspose(const size_t maxSize)
+        : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize) {
+
+      size_t idx=0;
+      for (size_t r=0;r<_maxSize;++r) {
+        for (size_t c=0;c<_maxSize;++c) {
+          _data(r,c)=idx++;
+        }
+      }
+    }
+
+    /// Prepare the evaluation of given size
+    void prepare(const size_t size) {
+      assert (size<=this->_maxSize);
+      this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+      this->_b.allocate(size,size);
+    }
+  };
+
+/// Plain copy of the whole buffer: the bandwidth to aim at
+  template<typename T>
+  class benchMemcpy : public benchTranspose<T> {
+  public:
+    /// Constructor
+    benchMemcpy(const size_t n) : benchTranspose<T>(n) { }
+
+    // Copy a into b
+    inline void eval() {
+      std::memcpy(this->_b.data(),this->_a.data(),
+                  this->_a.rows()*this->_a.dcols()*sizeof(T));
+    }
+  };
+
+/// Element by element transposition
+  template<typename T>
+  class benchTransposeNaive : public benchTranspose<T> {
+  public:
+    /// Constructor
+    benchTransposeNaive(const size_t n) : benchTranspose<T>(n) { }
+
+    // Swap (i,j) and (j,i)
+    inline void eval() {
+      anpi::Matrix<T>& a = this->_a;
+      for (size_t i=0;i<a.rows();++i) {
+        for (size_t j=0;j<i;++j) {
+          std::swap(a(i,j),a(j,i));
+        }
+      }
+    }
+  };
+
+/// Recursive in-place transposition
+  template<typename T>
+  class benchTransposeInPlace : public benchTranspose<T> {
+  public:
+    /// Constructor
+    benchTransposeInPlace(const size_t n) : benchTranspose<T>(n) { }
+
+    // Transpose a in place
+    inline void eval() {
+      this->_a.transpose();
+    }
+  };
+
+/// Recursive out-of-place transposition
+  template<typename T>
+  class benchTransposeCopy : public benchTranspose<T> {
+  public:
+    /// Constructor
+    benchTransposeCopy(const size_t n) : benchTranspose<T>(n) { }
+
+    // b = a^T
+    inline void eval() {
+      this->_a.transposed(this->_b);
+    }
+  };
+
+/**
+ * Compare the transpositions against a memcpy of the same matrix
+ */
+  BOOST_AUTO_TEST_CASE( Transpose ) {
+
+    std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                   96, 128, 192, 256,
+                                   384, 512, 768,1024,
+                                   1536,2048,3072,4096};
+
+    const size_t n=sizes.back();
+    const size_t repetitions=20;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchMemcpy<float> bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("transpose_float_memcpy.txt",times);
+      ::anpi::benchmark::plotRange(times,"memcpy (float)","k");
+    }
+
+    {
+      benchTransposeNaive<float> btn(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,btn);
+
+      ::anpi::benchmark::write("transpose_float_naive.txt",times);
+      ::anpi::benchmark::plotRange(times,"element-wise (float)","r");
+    }
+
+    {
+      benchTransposeInPlace<float> bti(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bti);
+
+      ::anpi::benchmark::write("transpose_float_inplace.txt",times);
+      ::anpi::benchmark::plotRange(times,"in-place (float)","g");
+    }
+
+    {
+      benchTransposeCopy<float> btc(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,btc);
+
+      ::anpi::benchmark::write("transpose_float_copy.txt",times);
+      ::anpi::benchmark::plotRange(times,"out-of-place (float)","b");
+    }
+
+    {
+      benchMemcpy<double> bm(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bm);
+
+      ::anpi::benchmark::write("transpose_double_memcpy.txt",times);
+      ::anpi::benchmark::plotRange(times,"memcpy (double)","c");
+    }
+
+    {
+      benchTransposeInPlace<double> bti(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bti);
+
+      ::anpi::benchmark::write("transpose_double_inplace.txt",times);
+      ::anpi::benchmark::plotRange(times,"in-place (double)","m");
+    }
+
+    {
+      benchTransposeCopy<double> btc(n);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,btc);
+
+      ::anpi::benchmark::write("transpose_double_copy.txt",times);
+      ::anpi::benchmark::plotRange(times,"out-of-place (double)","y");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
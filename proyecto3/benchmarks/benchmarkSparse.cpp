@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Benchmarks for the sparse matrix-vector products against the dense
+ * ones, on the five-point stencil of a square grid like the thermal
+ * plate.  The sizes are the sides of the grid: a side of 64 yields a
+ * 4096x4096 system with less than 5 non-zeros per row.
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+#include "Parallel.hpp"
+
+BOOST_AUTO_TEST_SUITE( Sparse )
+
+/// Stencil system of a side x side grid
+  template<typename T,class Layout>
+  anpi::SparseMatrix<T,Layout> stencil(const size_t side) {
+    const size_t n = side*side;
+    anpi::SparseBuilder<T> b(n,n);
+    b.reserve(5*n);
+    for (size_t i=0;i<side;++i) {
+      for (size_t j=0;j<side;++j) {
+        const size_t r = i*side+j;
+        if (i>0)      b.add(r,r-side,T(-1));
+        if (j>0)      b.add(r,r-1   ,T(-1));
+        b.add(r,r,T(4));
+        if (j+1<side) b.add(r,r+1   ,T(-1));
+        if (i+1<side) b.add(r,r+side,T(-1));
+      }
+    }
+    return b.template build<Layout>();
+  }
+
+/// Benchmark for the sparse product y = a*x
+  template<typename T,class Layout=anpi::RowMajor>
+  class benchSpmv {
+  protected:
+    /// State of the benchmarked evaluation
+    anpi::SparseMatrix<T,Layout> _a;
+    std::vector<T> _x;
+    std::vector<T> _y;
+  public:
+    /// Construct
+    benchSpmv(const size_t) {}
+
+    /// Prepare the evaluation of given grid side
+    void prepare(const size_t side) {
+      _a = stencil<T,Layout>(side);
+      _x.assign(_a.cols(),T(1));
+      _y.assign(_a.rows(),T(0));
+    }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::gemv(_a,_x,_y);
+    }
+  };
+
+/// Benchmark for the sparse product with the transpose y = a^T*x
+  template<typename T,class Layout=anpi::RowMajor>
+  class benchSpmvTransposed : public benchSpmv<T,Layout> {
+  public:
+    /// Constructor
+    benchSpmvTransposed(const size_t n) : benchSpmv<T,Layout>(n) { }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::gemvTransposed(this->_a,this->_x,this->_y);
+    }
+  };
+
+/// Fixed grid side, where prepare() selects the number of threads
+  template<class Bench>
+  class benchSpmvThreads : public Bench {
+  public:
+    /// Constructor
+    benchSpmvThreads(const size_t side) : Bench(side) {
+      Bench::prepare(side);
+    }
+
+    /// The "size" is the number of threads
+    void prepare(const size_t threads) {
+      anpi::parallel::threads() = threads;
+    }
+  };
+
+/// Benchmark for the dense product of the same system
+  template<typename T>
+  class benchDenseGemv {
+  protected:
+    /// State of the benchmarked evaluation
+    anpi::Matrix<T> _a;
+    std::vector<T> _x;
+    std::vector<T> _y;
+  public:
+    /// Construct
+    benchDenseGemv(const size_t) {}
+
+    /// Prepare the evaluation of given grid side
+    void prepare(const size_t side) {
+      stencil<T,anpi::RowMajor>(side).toDense(_a);
+      _x.assign(_a.cols(),T(1));
+      _y.assign(_a.rows(),T(0));
+    }
+
+    // Evaluate the product
+    inline void eval() {
+      anpi::gemv(_a,_x,_y);
+    }
+  };
+
+/**
+ * Compare the sparse products with the dense one
+ */
+  BOOST_AUTO_TEST_CASE( Spmv ) {
+
+    // The dense matrices grow with the fourth power of the side
+    std::vector<size_t> dsizes = {  4,   6,   8,  12,
+                                   16,  24,  32,  48, 64};
+    std::vector<size_t> sizes  = {  4,   6,   8,  12,
+                                   16,  24,  32,  48,
+                                   64,  96, 128, 192,
+                                  256, 384, 512};
+
+    const size_t repetitions=20;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchDenseGemv<double> bd(0);
+
+      ANPI_BENCHMARK(dsizes,repetitions,times,bd);
+
+      ::anpi::benchmark::write("spmv_dense_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"Dense gemv (double)","r");
+    }
+
+    {
+      benchSpmv<double> bs(0);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csr_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSR (double)","g");
+    }
+
+    {
+      benchSpmv<double,anpi::ColMajor> bs(0);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csc_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSC (double)","b");
+    }
+
+    {
+      benchSpmvTransposed<double> bs(0);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csr_transposed_double.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSR transposed (double)","m");
+    }
+
+    {
+      benchSpmv<float> bs(0);
+
+      ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csr_float.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSR (float)","k");
+    }
+
+    ::anpi::benchmark::show();
+  }
+
+/**
+ * Scaling of the sparse products with the number of threads, on a grid
+ * of 1024x1024 cells.  The scattering products (CSC and the transposed
+ * CSR) accumulate into private windows of y, which must not grow with
+ * the number of threads.
+ */
+  BOOST_AUTO_TEST_CASE( SpmvThreads ) {
+
+    std::vector<size_t> threads;
+    for (int t=1;t<=anpi::parallel::processors();++t) {
+      threads.push_back(size_t(t));
+    }
+
+    const size_t side=1024;
+    const size_t repetitions=20;
+    std::vector<anpi::benchmark::measurement> times;
+
+    {
+      benchSpmvThreads<benchSpmv<double> > bs(side);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csr_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSR (double) vs threads","g");
+    }
+
+    {
+      benchSpmvThreads<benchSpmv<double,anpi::ColMajor> > bs(side);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csc_double_threads.txt",times);
+      ::anpi::benchmark::plotRange(times,"CSC (double) vs threads","b");
+    }
+
+    {
+      benchSpmvThreads<benchSpmvTransposed<double> > bs(side);
+
+      ANPI_BENCHMARK(threads,repetitions,times,bs);
+
+      ::anpi::benchmark::write("spmv_csr_transposed_double_threads.txt",
+                               times);
+      ::anpi::benchmark::plotRange(times,"CSR transposed (double) vs threads",
+                                   "m");
+    }
+
+    anpi::parallel::threads() = 0;
+
+    ::anpi::benchmark::show();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -19,7 +19,11 @@ if(MSVC)
   endif()
 elseif(CMAKE_COMPILER_IS_GNUCC OR CMAKE_COMPILER_IS_GNUCXX)
   # Update if necessary
-  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall -pedantic -mavx2")
+  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall -pedantic")
+  if(NOT ANPI_RUNTIME_DISPATCH)
+    # Kernels only for the given instruction set (see Intrinsics.hpp)
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx2 -mfma")
+  endif()
 endif()
 
 set(CMAKE_CXX_FLAGS_DEBUG "-g")
@@ -11,12 +11,24 @@
 #ifndef ANPI_ALLOCATOR_HPP
 #define ANPI_ALLOCATOR_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
 #include <boost/align/aligned_allocator.hpp>
+#include <boost/align/aligned_alloc.hpp>
 #include "HasType.hpp"
+#include "SimdConfig.hpp"
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#endif
 
 namespace anpi {
 
-# if defined __AVX512F__
+  // With runtime dispatch the AVX-512 kernels may be used
+# if defined __AVX512F__ || defined ANPI_SIMD_RUNTIME_DISPATCH
   static const size_t DefaultAlignment = 64;
 # elif defined __AVX2__
   static const size_t DefaultAlignment = 32;
@@ -128,7 +140,537 @@ namespace anpi {
     static constexpr bool   row_aligned =
       has_type_row_aligned<Alloc<T,Align> >::value;
   };
-  
+
+
+  /**
+   * Monotonic memory arena.
+   *
+   * The memory is taken from a list of chunks by just advancing a
+   * pointer, and it is given back all at once with rewind().  Only the
+   * most recent block can be released individually, which covers the
+   * typical "allocate, use, destroy" of a temporary.
+   *
+   * If the chunks run out, a new one of at least twice the size of the
+   * last one is reserved.  Rewinding an arena to empty merges all its
+   * chunks into one, so that after a first run (the warm-up) the same
+   * sequence of allocations does not touch the heap anymore.  Arenas
+   * grown beyond retainLimit() bytes are instead given back to the
+   * heap at that point, so that one large solve does not stay reserved
+   * for the lifetime of the thread.
+   *
+   * Arenas are not thread-safe.  They are normally used through
+   * ScopedArena and arena_allocator.
+   */
+  class Arena {
+  public:
+    /// Position in the arena, as returned by mark()
+    struct marker {
+      size_t chunk;
+      size_t used;
+    };
+
+  private:
+    /// A block of memory reserved from the heap
+    struct chunk {
+      char*  begin;
+      size_t size;
+      size_t used;
+    };
+
+    /// Alignment of the chunks
+    static constexpr size_t ChunkAlignment = 64;
+
+    /// Default for the bytes kept by rewinding to empty
+    static constexpr size_t DefaultRetain = size_t(16)<<20;
+
+    /// All reserved chunks; those after _current are empty
+    std::vector<chunk> _chunks;
+
+    /// Chunk being filled
+    size_t _current;
+
+    /// Size of the first chunk
+    size_t _initial;
+
+    /// Most bytes kept after rewinding to empty
+    size_t _retain;
+
+    /// Last allocated block, the only one that can be released
+    void* _last;
+
+    /// Reserve a chunk for at least the given number of bytes
+    void addChunk(const size_t bytes) {
+      const size_t prev = _chunks.empty() ? _initial/2 : _chunks.back().size;
+      const size_t size = std::max(2*prev,bytes);
+      void* ptr = boost::alignment::aligned_alloc(ChunkAlignment,size);
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      _chunks.push_back(chunk{static_cast<char*>(ptr),size,0});
+    }
+
+    /// Check if nothing is allocated
+    bool unused() const {
+      return _chunks.empty() || ((_current == 0) && (_chunks[0].used == 0));
+    }
+
+  public:
+    /**
+     * Arena whose first chunk will have the given size in bytes, and
+     * which keeps at most retainBytes after being rewound to empty
+     */
+    explicit Arena(const size_t initialBytes = 1<<20,
+                   const size_t retainBytes = DefaultRetain)
+      : _current(0),_initial(initialBytes > 64 ? initialBytes : 64),
+        _retain(retainBytes),_last(nullptr) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() { release(); }
+
+    /**
+     * Reserve the given number of bytes with the given alignment, which
+     * must be a power of two.
+     *
+     * @throws std::bad_alloc if the heap cannot provide a new chunk
+     */
+    void* allocate(const size_t bytes,const size_t align) {
+      while (_current < _chunks.size()) {
+        chunk& c = _chunks[_current];
+        const size_t base  = reinterpret_cast<size_t>(c.begin);
+        const size_t start = ((base + c.used + align - 1) & ~(align-1)) - base;
+        if (start + bytes <= c.size) {
+          c.used = start + bytes;
+          _last = c.begin + start;
+          return _last;
+        }
+        if (_current + 1 == _chunks.size()) {
+          break;
+        }
+        ++_current;
+      }
+
+      addChunk(bytes + align);
+      _current = _chunks.size()-1;
+      return allocate(bytes,align);
+    }
+
+    /**
+     * Release a block.  This only gives back the memory if the block
+     * is the last one allocated; otherwise it waits for rewind().
+     */
+    void deallocate(void* ptr) {
+      if ((ptr != nullptr) && (ptr == _last)) {
+        chunk& c = _chunks[_current];
+        c.used = static_cast<size_t>(static_cast<char*>(ptr) - c.begin);
+        _last = nullptr;
+      }
+    }
+
+    /// Check if a block was taken from this arena
+    bool owns(const void* ptr) const {
+      const char* p = static_cast<const char*>(ptr);
+      for (const chunk& c : _chunks) {
+        if ((p >= c.begin) && (p < c.begin + c.size)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * Return all chunks to the heap.
+     *
+     * Everything allocated from the arena becomes invalid, so this must
+     * not be called within a ScopedArena using it.
+     */
+    void release() {
+      for (chunk& c : _chunks) {
+        boost::alignment::aligned_free(c.begin);
+      }
+      _chunks.clear();
+      _current = 0;
+      _last = nullptr;
+    }
+
+    /**
+     * Return unused chunks to the heap, the last ones first, until at
+     * most the given number of bytes stays reserved.  Blocks still in
+     * use are never touched, so the capacity may remain larger.
+     */
+    void shrink_to(const size_t bytes) {
+      while ((_chunks.size() > _current+1) && (capacity() > bytes)) {
+        boost::alignment::aligned_free(_chunks.back().begin);
+        _chunks.pop_back();
+      }
+      if (unused() && (capacity() > bytes)) {
+        release();
+      }
+    }
+
+    /// Most bytes kept by rewinding to empty
+    size_t retainLimit() const { return _retain; }
+
+    /// Set the most bytes kept by rewinding to empty
+    void retainLimit(const size_t bytes) { _retain = bytes; }
+
+    /// Current position, to be passed later to rewind()
+    marker mark() const {
+      return marker{_current,_chunks.empty() ? 0 : _chunks[_current].used};
+    }
+
+    /**
+     * Release everything allocated after the given mark.
+     *
+     * Rewinding to the very beginning merges the chunks into a single
+     * one of their total size, or returns them all to the heap if they
+     * exceed retainLimit().
+     */
+    void rewind(const marker& m) {
+      if (_chunks.empty()) return;
+
+      if ((m.chunk == 0) && (m.used == 0)) {
+        const size_t total = capacity();
+        if (total > _retain) {
+          release();
+          return;
+        }
+        if (_chunks.size() > 1) {
+          release();
+          addChunk(total);
+          return;
+        }
+      }
+
+      for (size_t i=m.chunk+1;i<_chunks.size();++i) {
+        _chunks[i].used = 0;
+      }
+      _current = m.chunk;
+      _chunks[_current].used = m.used;
+      _last = nullptr;
+    }
+
+    /// Total bytes reserved from the heap
+    size_t capacity() const {
+      size_t total = 0;
+      for (const chunk& c : _chunks) {
+        total += c.size;
+      }
+      return total;
+    }
+
+    /// Number of chunks reserved from the heap
+    size_t chunks() const { return _chunks.size(); }
+
+    /// Default arena of this thread
+    static Arena& local() {
+      static thread_local Arena arena;
+      return arena;
+    }
+  };
+
+  /**
+   * Make an arena the current one of this thread while the scope lasts.
+   *
+   * All arena_allocator objects take their memory from the arena of
+   * the innermost scope.  At the end of the scope everything allocated
+   * within it is released at once.  Scopes can be nested, with the
+   * same arena or with different ones.
+   *
+   * Matrices using arena_allocator must not outlive the scope in which
+   * they were allocated:
+   *
+   * \code
+   * {
+   *   anpi::ScopedArena scope; // uses the arena of this thread
+   *   anpi::Matrix<float,anpi::arena_allocator<float> > tmp(n,n);
+   *   ...
+   * } // tmp's memory is available for the next scope
+   * \endcode
+   */
+  class ScopedArena {
+    /// Arena in use
+    Arena& _arena;
+    /// Enclosing scope, if any
+    ScopedArena* _outer;
+    /// Position of the arena when the scope started
+    Arena::marker _mark;
+
+  public:
+    /// Use the default arena of this thread
+    ScopedArena() : ScopedArena(Arena::local()) {}
+
+    /// Use the given arena
+    explicit ScopedArena(Arena& arena)
+      : _arena(arena),_outer(innermost()),_mark(arena.mark()) {
+      innermost() = this;
+    }
+
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+
+    ~ScopedArena() {
+      innermost() = _outer;
+      _arena.rewind(_mark);
+    }
+
+    /// The arena in use
+    Arena& arena() const { return _arena; }
+
+    /// Enclosing scope, or nullptr
+    ScopedArena* outer() const { return _outer; }
+
+    /// Innermost scope of this thread, or nullptr
+    static ScopedArena*& innermost() {
+      static thread_local ScopedArena* scope = nullptr;
+      return scope;
+    }
+  };
+
+  /**
+   * Allocator taking the memory from the arena of the innermost
+   * ScopedArena of the thread, with the given alignment for the rows.
+   *
+   * Outside of any ScopedArena it falls back to the aligned heap, so
+   * that it can be used anywhere.  Like aligned_row_allocator it pads
+   * each row of a Matrix, so that the SIMD kernels are used as well.
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class arena_allocator {
+  public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef arena_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a row-aligned allocator
+    typedef std::true_type row_aligned;
+
+    arena_allocator() noexcept {}
+
+    template<class U>
+    arena_allocator(const arena_allocator<U,Align>&) noexcept {}
+
+    /// Reserve n elements
+    pointer allocate(const size_type n) {
+      const size_t bytes = n*sizeof(T);
+      const size_t align = std::max(Align,alignof(T));
+      ScopedArena* scope = ScopedArena::innermost();
+      void* ptr = (scope != nullptr)
+        ? scope->arena().allocate(bytes,align)
+        : boost::alignment::aligned_alloc(align,bytes);
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(ptr);
+    }
+
+    /// Release the n elements at ptr
+    void deallocate(pointer ptr,size_type) noexcept {
+      // The block may come from an enclosing scope or from the heap
+      for (ScopedArena* scope = ScopedArena::innermost();
+           scope != nullptr;
+           scope = scope->outer()) {
+        if (scope->arena().owns(ptr)) {
+          scope->arena().deallocate(ptr);
+          return;
+        }
+      }
+      boost::alignment::aligned_free(ptr);
+    }
+  };
+
+  // All arena allocators share the arena of the thread
+  template<class T,class U,std::size_t A>
+  inline bool operator==(const arena_allocator<T,A>&,
+                         const arena_allocator<U,A>&) noexcept {
+    return true;
+  }
+
+  template<class T,class U,std::size_t A>
+  inline bool operator!=(const arena_allocator<T,A>&,
+                         const arena_allocator<U,A>&) noexcept {
+    return false;
+  }
+
+  // Specialization for the arena_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::arena_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+
+  /**
+   * Settings of the huge_page_allocator.
+   */
+  namespace hugepages {
+
+    /// Size of the huge pages (x86-64)
+    static const size_t PageSize = size_t(2)<<20;
+
+    /**
+     * Try first the pages reserved by the administrator in
+     * /proc/sys/vm/nr_hugepages (MAP_HUGETLB).  If there are not enough
+     * of them, or if this is false, transparent huge pages are used.
+     */
+    inline bool& explicitPages() {
+      static bool use = false;
+      return use;
+    }
+
+#ifdef __linux__
+    /// Map bytes (a multiple of PageSize) aligned to PageSize
+    inline void* map(const size_t bytes) {
+# ifdef MAP_HUGETLB
+      if (explicitPages()) {
+        void* ptr = mmap(nullptr,bytes,PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+        if (ptr != MAP_FAILED) {
+          return ptr;
+        }
+      }
+# endif
+
+      // Map one page more and trim the ends, so that the kernel can
+      // back the whole block with huge pages
+      char* raw = static_cast<char*>(mmap(nullptr,bytes+PageSize,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS,-1,0));
+      if (static_cast<void*>(raw) == MAP_FAILED) {
+        return nullptr;
+      }
+      const size_t addr = reinterpret_cast<size_t>(raw);
+      const size_t head = ((addr + PageSize - 1) & ~(PageSize-1)) - addr;
+      if (head > 0) {
+        munmap(raw,head);
+      }
+      if (head < PageSize) {
+        munmap(raw+head+bytes,PageSize-head);
+      }
+      char* ptr = raw + head;
+# ifdef MADV_HUGEPAGE
+      madvise(ptr,bytes,MADV_HUGEPAGE);
+# endif
+      return ptr;
+    }
+
+    /// Unmap a block given by map()
+    inline void unmap(void* ptr,const size_t bytes) {
+      munmap(ptr,bytes);
+    }
+#endif
+
+  } // namespace hugepages
+
+  /**
+   * Allocator for large matrices backed by huge pages.
+   *
+   * Blocks of at least hugepages::PageSize bytes are mapped directly
+   * with mmap, aligned to the huge page size and advised with
+   * MADV_HUGEPAGE (or taken from the explicit huge page pool, see
+   * hugepages::explicitPages()).  A 2 MiB page covers 512 normal ones,
+   * which removes most TLB misses when traversing large matrices.
+   * Smaller blocks, and all blocks on systems without mmap, come from
+   * the aligned heap.
+   *
+   * The pages are not touched here: the memory of a NUMA system is
+   * placed on the node of the thread writing it first.  Matrix::fill()
+   * and the constructors that initialize the entries do it in parallel
+   * for large matrices, with the same static row partition used by the
+   * parallel kernels (see anpi::parallel::firstTouchThreshold()).
+   *
+   * Like aligned_row_allocator it pads each row of a Matrix.
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class huge_page_allocator {
+  public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef huge_page_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a row-aligned allocator
+    typedef std::true_type row_aligned;
+
+    huge_page_allocator() noexcept {}
+
+    template<class U>
+    huge_page_allocator(const huge_page_allocator<U,Align>&) noexcept {}
+
+    /// Reserve n elements
+    pointer allocate(const size_type n) {
+      const size_t bytes = n*sizeof(T);
+#ifdef __linux__
+      void* ptr = (bytes >= hugepages::PageSize)
+        ? hugepages::map(mapped(bytes))
+        : boost::alignment::aligned_alloc(std::max(Align,alignof(T)),bytes);
+#else
+      void* ptr =
+        boost::alignment::aligned_alloc(std::max(Align,alignof(T)),bytes);
+#endif
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(ptr);
+    }
+
+    /// Release the n elements at ptr
+    void deallocate(pointer ptr,const size_type n) noexcept {
+#ifdef __linux__
+      const size_t bytes = n*sizeof(T);
+      if (bytes >= hugepages::PageSize) {
+        hugepages::unmap(ptr,mapped(bytes));
+        return;
+      }
+#endif
+      boost::alignment::aligned_free(ptr);
+    }
+
+  private:
+    /// Bytes mapped for a block: whole huge pages
+    static size_t mapped(const size_t bytes) {
+      return (bytes + hugepages::PageSize - 1) & ~(hugepages::PageSize-1);
+    }
+  };
+
+  // All huge page allocators are interchangeable
+  template<class T,class U,std::size_t A>
+  inline bool operator==(const huge_page_allocator<T,A>&,
+                         const huge_page_allocator<U,A>&) noexcept {
+    return true;
+  }
+
+  template<class T,class U,std::size_t A>
+  inline bool operator!=(const huge_page_allocator<T,A>&,
+                         const huge_page_allocator<U,A>&) noexcept {
+    return false;
+  }
+
+  // Specialization for the huge_page_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::huge_page_allocator<T,A> > {
+    static const bool value = true;
+  };
+
 }
 
 #endif
@@ -9,4 +9,5 @@
 
 #define ANPI_ENABLE_SIMD
 #define ANPI_ENABLE_OpenMP
+#define ANPI_RUNTIME_DISPATCH
 #define ANPI_DATA_PATH "/home/alexis/Documents/Analisis Numerico/ANPI/proyecto3/data"
@@ -0,0 +1,373 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_BAND_MATRIX_HPP
+#define ANPI_BAND_MATRIX_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  /**
+   * Square band matrix.
+   *
+   * Only the entries (i,j) with i-lower() <= j <= i+upper() are stored,
+   * row after row in one flat buffer of rows()*width() entries.  Hence,
+   * the band of each row is contiguous: operator[] returns for row i a
+   * pointer p such that p[j] is the entry (i,j), as for anpi::Matrix,
+   * but valid only for the columns j within the band.
+   *
+   * The factorizations luBand() and choleskyBand() keep the band (they
+   * do not pivot), and process each row with the level-1 kernels along
+   * the band.  They suit the diagonally dominant or positive definite
+   * tridiagonal and banded systems of splines and finite differences.
+   *
+   * \code
+   * anpi::BandMatrix<double> a(n,1,1);  // tridiagonal
+   * for (size_t i=0;i<n;++i) {
+   *   a(i,i) = 4;
+   *   if (i>0)   a(i,i-1) = -1;
+   *   if (i+1<n) a(i,i+1) = -1;
+   * }
+   * anpi::BandMatrix<double> lu;
+   * anpi::luBand(a,lu);
+   * anpi::solveLUBand(lu,x,b);
+   * \endcode
+   */
+  template<typename T>
+  class BandMatrix {
+  public:
+    /// Type of the entries
+    typedef T value_type;
+
+  private:
+    /// Number of rows and columns
+    size_t _rows;
+
+    /// Number of diagonals below the main one
+    size_t _lower;
+
+    /// Number of diagonals above the main one
+    size_t _upper;
+
+    /// The bands, row after row
+    std::vector<T> _data;
+
+  public:
+    /// Empty 0x0 matrix
+    BandMatrix() : _rows(0), _lower(0), _upper(0) {}
+
+    /**
+     * n x n matrix with the given number of diagonals below and above
+     * the main one, all of them initialized with initVal
+     */
+    BandMatrix(const size_t n,
+               const size_t lower,
+               const size_t upper,
+               const T initVal = T(0))
+      : _rows(n), _lower(lower), _upper(upper),
+        _data(n*(lower+upper+1),initVal) {}
+
+    /// Resize, with all entries set to initVal
+    void allocate(const size_t n,
+                  const size_t lower,
+                  const size_t upper,
+                  const T initVal = T(0)) {
+      _rows  = n;
+      _lower = lower;
+      _upper = upper;
+      _data.assign(n*(lower+upper+1),initVal);
+    }
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _rows; }
+
+    /// Number of diagonals below the main one
+    inline size_t lower() const { return _lower; }
+
+    /// Number of diagonals above the main one
+    inline size_t upper() const { return _upper; }
+
+    /// Number of stored entries per row
+    inline size_t width() const { return _lower+_upper+1; }
+
+    /// True if the entry (row,col) lies within the band
+    inline bool inBand(const size_t row,const size_t col) const {
+      return (col+_lower >= row) && (col <= row+_upper);
+    }
+
+    /// Row pointer p, where p[j] is the entry (row,j) within the band
+    inline T* operator[](const size_t row) {
+      return _data.data() + row*(_lower+_upper) + _lower;
+    }
+
+    /// Row pointer p, where p[j] is the entry (row,j) within the band
+    inline const T* operator[](const size_t row) const {
+      return _data.data() + row*(_lower+_upper) + _lower;
+    }
+
+    /// Entry within the band
+    inline T& operator()(const size_t row,const size_t col) {
+      assert( (row < _rows) && (col < _rows) && inBand(row,col) );
+      return (*this)[row][col];
+    }
+
+    /// Entry anywhere: outside the band it is zero
+    inline T operator()(const size_t row,const size_t col) const {
+      assert( (row < _rows) && (col < _rows) );
+      return inBand(row,col) ? (*this)[row][col] : T(0);
+    }
+
+    /// First column within the band of the given row
+    inline size_t firstCol(const size_t row) const {
+      return (row > _lower) ? row-_lower : 0;
+    }
+
+    /// Last column within the band of the given row
+    inline size_t lastCol(const size_t row) const {
+      return std::min(_rows-1,row+_upper);
+    }
+
+    /// The bands, row after row (rows()*width() entries)
+    inline T* data() { return _data.data(); }
+
+    /// The bands, row after row (rows()*width() entries)
+    inline const T* data() const { return _data.data(); }
+
+    /// Dense copy
+    template<class Alloc,class Layout>
+    void toDense(Matrix<T,Alloc,Layout>& dense) const {
+      dense.allocate(_rows,_rows);
+      dense.fill(T(0));
+      for (size_t i=0;i<_rows;++i) {
+        for (size_t j=firstCol(i);j<=lastCol(i);++j) {
+          dense(i,j) = (*this)[i][j];
+        }
+      }
+    }
+
+    /// Dense row-major copy
+    Matrix<T> toDense() const {
+      Matrix<T> dense;
+      toDense(dense);
+      return dense;
+    }
+  }; // class BandMatrix
+
+
+  namespace detail {
+    /**
+     * Bands narrower than this are processed with plain loops: for the
+     * one or two entries of a tridiagonal row, calling the SIMD kernels
+     * would cost more than the operations themselves.
+     */
+    constexpr size_t narrowBand = 8;
+
+    /// y = alpha*x + y on a segment of a band
+    template<typename T>
+    inline void bandAxpy(const T alpha,const T* x,T* y,const size_t n) {
+      if (n < narrowBand) {
+        for (size_t i=0;i<n;++i) {
+          y[i] += alpha*x[i];
+        }
+      } else {
+        ::anpi::aimpl::axpy(alpha,x,y,n);
+      }
+    }
+
+    /// Sum of x[i]*y[i] on a segment of a band
+    template<typename T>
+    inline T bandDot(const T* x,const T* y,const size_t n) {
+      T sum(0);
+      if (n < narrowBand) {
+        for (size_t i=0;i<n;++i) {
+          sum += x[i]*y[i];
+        }
+      } else {
+        ::anpi::aimpl::dot(x,y,n,sum);
+      }
+      return sum;
+    }
+  } // namespace detail
+
+
+  /**
+   * LU decomposition of a band matrix without pivoting: LU holds the
+   * unit lower triangular L below the diagonal, and U on and above it,
+   * within the same band as A.  LU may be A itself.
+   *
+   * Each elimination step updates the rows below the pivot with one
+   * axpy along the upper band.
+   *
+   * @throws anpi::Exception if a pivot is zero.  Diagonally dominant
+   *         and positive definite matrices have no zero pivots.
+   */
+  template<typename T>
+  void luBand(const BandMatrix<T>& A,BandMatrix<T>& LU) {
+    if (&A != &LU) {
+      LU = A;
+    }
+
+    const size_t n = LU.rows();
+    for (size_t k=0;k<n;++k) {
+      const T pivot = LU[k][k];
+      if (pivot == T(0)) {
+        throw anpi::Exception("Zero pivot in the band LU decomposition");
+      }
+
+      const size_t right = LU.lastCol(k)-k;
+      const size_t last  = std::min(n-1,k+LU.lower());
+      for (size_t i=k+1;i<=last;++i) {
+        const T l = LU[i][k]/pivot;
+        LU[i][k] = l;
+        detail::bandAxpy(-l,LU[k]+k+1,LU[i]+k+1,right);
+      }
+    }
+  }
+
+  /**
+   * Solve A x = b with the decomposition LU of luBand().  x may be b.
+   *
+   * @throws anpi::Exception if the size of b does not match.
+   */
+  template<typename T>
+  void solveLUBand(const BandMatrix<T>& LU,
+                   std::vector<T>& x,
+                   const std::vector<T>& b) {
+    const size_t n = LU.rows();
+    if (b.size() != n) {
+      throw anpi::Exception("Band matrix and b sizes don't match.");
+    }
+    x = b;
+
+    // L y = b, with unit diagonal
+    for (size_t i=0;i<n;++i) {
+      const size_t j0 = LU.firstCol(i);
+      x[i] -= detail::bandDot(LU[i]+j0,x.data()+j0,i-j0);
+    }
+
+    // U x = y
+    for (size_t i=n;i-- > 0;) {
+      const size_t j1 = LU.lastCol(i);
+      x[i] = (x[i] - detail::bandDot(LU[i]+i+1,x.data()+i+1,j1-i))/LU[i][i];
+    }
+  }
+
+  /**
+   * Cholesky decomposition A = L L^T of a symmetric positive definite
+   * band matrix.  Only the diagonal and the lower band of A are read,
+   * and L has the same lower band and no upper one.  L may be A itself.
+   *
+   * Each entry is one dot product of two rows of L along the band.
+   *
+   * @throws anpi::Exception if A is not positive definite.
+   */
+  template<typename T>
+  void choleskyBand(const BandMatrix<T>& A,BandMatrix<T>& L) {
+    const size_t n = A.rows();
+    const size_t lower = A.lower();
+
+    BandMatrix<T> tmp;
+    BandMatrix<T>& R = (&A == &L) ? tmp : L;
+    R.allocate(n,lower,0);
+
+    for (size_t i=0;i<n;++i) {
+      const size_t j0 = A.firstCol(i);
+      T* li = R[i];
+      for (size_t j=j0;j<=i;++j) {
+        const T s = A[i][j] - detail::bandDot(li+j0,R[j]+j0,j-j0);
+        if (j<i) {
+          li[j] = s/R[j][j];
+        } else if (s > T(0)) {
+          li[i] = std::sqrt(s);
+        } else {
+          throw anpi::Exception("Band matrix is not positive definite");
+        }
+      }
+    }
+
+    if (&A == &L) {
+      L = std::move(tmp);
+    }
+  }
+
+  /**
+   * Solve A x = b with the decomposition L of choleskyBand().  x may
+   * be b.
+   *
+   * @throws anpi::Exception if the size of b does not match.
+   */
+  template<typename T>
+  void solveCholeskyBand(const BandMatrix<T>& L,
+                         std::vector<T>& x,
+                         const std::vector<T>& b) {
+    const size_t n = L.rows();
+    if (b.size() != n) {
+      throw anpi::Exception("Band matrix and b sizes don't match.");
+    }
+    x = b;
+
+    // L y = b
+    for (size_t i=0;i<n;++i) {
+      const size_t j0 = L.firstCol(i);
+      x[i] = (x[i] - detail::bandDot(L[i]+j0,x.data()+j0,i-j0))/L[i][i];
+    }
+
+    // L^T x = y, column by column of L^T, which are the rows of L
+    for (size_t i=n;i-- > 0;) {
+      const size_t j0 = L.firstCol(i);
+      x[i] /= L[i][i];
+      detail::bandAxpy(-x[i],L[i]+j0,x.data()+j0,i-j0);
+    }
+  }
+
+  /**
+   * Band matrix-vector product y = alpha*a*x + beta*y, as the dense
+   * anpi::gemv().
+   *
+   * @throws anpi::Exception if the sizes of a, x and y do not match.
+   */
+  template<typename T>
+  void gemv(const BandMatrix<T>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const T alpha = T(1),
+            const T beta  = T(0)) {
+
+    if (a.cols() != x.size()) {
+      throw anpi::Exception("A number of columns and x size don't match.");
+    }
+
+    if (y.size() != a.rows()) {
+      if (beta != T(0)) {
+        throw anpi::Exception("A number of rows and y size don't match.");
+      }
+      y.resize(a.rows());
+    }
+
+    assert( (&x != &y) && "x and y must not alias" );
+
+    for (size_t i=0;i<a.rows();++i) {
+      const size_t j0 = a.firstCol(i);
+      const T sum = detail::bandDot(a[i]+j0,x.data()+j0,a.lastCol(i)-j0+1);
+      y[i] = (beta == T(0)) ? alpha*sum : alpha*sum + beta*y[i];
+    }
+  }
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_CPU_FEATURES_HPP
+#define ANPI_CPU_FEATURES_HPP
+
+#include <algorithm>
+#include <ostream>
+
+#include "Intrinsics.hpp"
+
+namespace anpi {
+
+  /**
+   * Selection of the SIMD kernels to be used.
+   *
+   * The instruction sets supported by the CPU are detected once, the
+   * first time a kernel is called, and the best variant compiled into
+   * the binary is used from then on (see Intrinsics.hpp).  The choice
+   * can be printed with
+   *
+   * \code
+   * anpi::cpu::report(std::cout);
+   * \endcode
+   *
+   * and lowered with anpi::cpu::select(), for instance to compare the
+   * variants in benchmarks.
+   */
+  namespace cpu {
+
+    /// Instruction sets with their own kernels, from worst to best
+    enum Isa {
+      Fallback = 0, ///< Plain C++
+      SSE2,         ///< 128 bit registers
+      AVX2,         ///< 256 bit registers with FMA and F16C
+      AVX512        ///< 512 bit registers (F, BW, DQ and VL)
+    };
+
+    /// Best instruction set supported by this CPU
+    inline Isa detect() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")  &&
+          __builtin_cpu_supports("avx512bw") &&
+          __builtin_cpu_supports("avx512dq") &&
+          __builtin_cpu_supports("avx512vl")) {
+        return AVX512;
+      }
+      if (__builtin_cpu_supports("avx2") &&
+          __builtin_cpu_supports("fma")  &&
+          __builtin_cpu_supports("f16c")) {
+        return AVX2;
+      }
+      if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+      }
+#endif
+      return Fallback;
+    }
+
+    /// Best instruction set for which kernels were compiled
+    inline Isa compiled() {
+#if defined ANPI_SIMD_HAS_AVX512
+      return AVX512;
+#elif defined ANPI_SIMD_HAS_AVX2
+      return AVX2;
+#elif defined ANPI_SIMD_HAS_SSE2
+      return SSE2;
+#else
+      return Fallback;
+#endif
+    }
+
+    namespace detail {
+      /// Storage of the selected instruction set
+      inline Isa& selected() {
+        static Isa isa = std::min(detect(),compiled());
+        return isa;
+      }
+    }
+
+    /// Instruction set of the kernels in use
+    inline Isa isa() {
+      return detail::selected();
+    }
+
+    /**
+     * Use the kernels of the given instruction set, if both the CPU and
+     * the binary support it, or the best available one otherwise.
+     *
+     * @return the instruction set actually selected
+     */
+    inline Isa select(const Isa wanted) {
+      detail::selected() = std::min(wanted,std::min(detect(),compiled()));
+      return detail::selected();
+    }
+
+    /// Human readable name of an instruction set
+    inline const char* name(const Isa isa) {
+      switch (isa) {
+      case SSE2:   return "SSE2";
+      case AVX2:   return "AVX2";
+      case AVX512: return "AVX-512";
+      default:     return "fallback";
+      }
+    }
+
+    /// Print which kernels are in use
+    inline void report(std::ostream& os) {
+      os << "SIMD kernels: " << name(isa())
+         << " (CPU supports " << name(detect())
+#ifdef ANPI_SIMD_RUNTIME_DISPATCH
+         << ", runtime dispatch)"
+#else
+         << ", compiled for " << name(compiled()) << ")"
+#endif
+         << std::endl;
+    }
+
+  } // namespace cpu
+} // namespace anpi
+
+
+/*
+ * Helpers for the kernel dispatchers.
+ *
+ * ANPI_SIMD_DISPATCH(kernel,args...) calls
+ * anpi::simd::<isa>::kernel(args...) for the best instruction set
+ * selected in anpi::cpu and returns from the calling function.  If no
+ * variant is available the execution continues after the macro,
+ * usually with the fallback implementation.
+ */
+#ifdef ANPI_SIMD_HAS_AVX512
+#  define ANPI_SIMD_CALL_AVX512(kernel,...)                     \
+  if (::anpi::cpu::isa() >= ::anpi::cpu::AVX512) {              \
+    ::anpi::simd::avx512::kernel(__VA_ARGS__);                  \
+    return;                                                     \
+  }
+#else
+#  define ANPI_SIMD_CALL_AVX512(kernel,...)
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+#  define ANPI_SIMD_CALL_AVX2(kernel,...)                       \
+  if (::anpi::cpu::isa() >= ::anpi::cpu::AVX2) {                \
+    ::anpi::simd::avx2::kernel(__VA_ARGS__);                    \
+    return;                                                     \
+  }
+#else
+#  define ANPI_SIMD_CALL_AVX2(kernel,...)
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
+#  define ANPI_SIMD_CALL_SSE2(kernel,...)                       \
+  if (::anpi::cpu::isa() >= ::anpi::cpu::SSE2) {                \
+    ::anpi::simd::sse2::kernel(__VA_ARGS__);                    \
+    return;                                                     \
+  }
+#else
+#  define ANPI_SIMD_CALL_SSE2(kernel,...)
+#endif
+
+#define ANPI_SIMD_DISPATCH(kernel,...)                          \
+  ANPI_SIMD_CALL_AVX512(kernel,__VA_ARGS__)                     \
+  ANPI_SIMD_CALL_AVX2(kernel,__VA_ARGS__)                       \
+  ANPI_SIMD_CALL_SSE2(kernel,__VA_ARGS__)
+
+#endif
@@ -0,0 +1,461 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_FIXED_MATRIX_HPP
+#define ANPI_FIXED_MATRIX_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "MatrixView.hpp"
+
+namespace anpi
+{
+  namespace fixed
+  {
+    /**
+     * Calls f(0), f(1), ..., f(N-1) without a loop, so that every call
+     * sees a constant index.
+     */
+    template<size_t N>
+    struct unroll {
+      template<class F>
+      static inline void apply(F&& f) {
+        unroll<N-1>::apply(f);
+        f(N-1);
+      }
+    };
+
+    template<>
+    struct unroll<0> {
+      template<class F>
+      static inline void apply(F&&) {}
+    };
+  } // namespace fixed
+
+  /**
+   * Small row-major matrix with its dimensions fixed at compile time.
+   *
+   * The R x C entries are stored in the object itself, without padding,
+   * so that a FixedMatrix on the stack never touches the heap.  All
+   * sizes are constant expressions and the element-wise operations are
+   * unrolled, which makes this class suitable for the 2x2 or 3x3
+   * helpers used inside hot loops.  For larger or run-time sizes use
+   * anpi::Matrix.
+   *
+   * Both classes interoperate through views: a FixedMatrix converts
+   * into a MatrixView, which anpi::Matrix can be constructed from or
+   * filled with, and a FixedMatrix can be constructed from or filled
+   * with any matrix or view:
+   *
+   * \code
+   * anpi::FixedMatrix<float,3,3> f = {{1,2,3},{4,5,6},{7,8,10}};
+   * anpi::Matrix<float> m(f.view());      // dynamic copy
+   * anpi::FixedMatrix<float,3,3> g(m);    // and back
+   * \endcode
+   */
+  template<typename T,size_t R,size_t C>
+  class FixedMatrix {
+    static_assert((R>0) && (C>0),"FixedMatrix cannot be empty");
+
+  public:
+    /**
+     * @name Standard types
+     */
+    //@{
+    typedef T        value_type;
+    typedef T*       pointer;
+    typedef const T* const_pointer;
+
+    typedef MatrixView<T>       view_type;
+    typedef MatrixView<const T> const_view_type;
+    //@}
+
+  private:
+    /// The entries, row after row
+    T _data[R*C];
+
+  public:
+    /**
+     * @name Constructors
+     */
+    //@{
+
+    /// All entries initialized with T()
+    FixedMatrix() : _data() {}
+
+    /// Leave the entries uninitialized
+    explicit FixedMatrix(const InitializationType) {}
+
+    /// All entries initialized with the given value
+    explicit FixedMatrix(const T initVal) { fill(initVal); }
+
+    /**
+     * Initialize from a nested list, one inner list per row:
+     *
+     * \code
+     * anpi::FixedMatrix<int,2,3> a = { {1,2,3},{4,5,6} };
+     * \endcode
+     *
+     * @throws anpi::Exception if the list has not R rows of C entries
+     */
+    FixedMatrix(std::initializer_list< std::initializer_list<T> > lst) {
+      if (lst.size() != R) {
+        throw anpi::Exception("Wrong number of rows for FixedMatrix");
+      }
+      T* ptr = _data;
+      for (const auto& row : lst) {
+        if (row.size() != C) {
+          throw anpi::Exception("Wrong number of columns for FixedMatrix");
+        }
+        for (const auto& val : row) {
+          *ptr++ = val;
+        }
+      }
+    }
+
+    /**
+     * Copy the entries of a view, or of a dynamic matrix, which
+     * converts implicitly to a read-only view
+     *
+     * @throws anpi::Exception if the sizes differ
+     */
+    explicit FixedMatrix(const const_view_type& other) {
+      if ((other.rows() != R) || (other.cols() != C)) {
+        throw anpi::Exception("Matrix size does not match FixedMatrix");
+      }
+      view().assign(other);
+    }
+    //@}
+
+    /**
+     * @name Sizes
+     */
+    //@{
+    /// Number of rows
+    static constexpr size_t rows() { return R; }
+
+    /// Number of columns
+    static constexpr size_t cols() { return C; }
+
+    /// Entries between the beginnings of two rows: there is no padding
+    static constexpr size_t dcols() { return C; }
+
+    /// Total number of entries
+    static constexpr size_t entries() { return R*C; }
+
+    /// A FixedMatrix is never empty
+    static constexpr bool empty() { return false; }
+    //@}
+
+    /**
+     * @name Access
+     */
+    //@{
+    /// Pointer to the first entry
+    inline T* data() { return _data; }
+
+    /// Read-only pointer to the first entry
+    inline const T* data() const { return _data; }
+
+    /// Pointer to a given row
+    inline T* operator[](const size_t row) {
+      return _data + row*C;
+    }
+
+    /// Read-only pointer to a given row
+    inline const T* operator[](const size_t row) const {
+      return _data + row*C;
+    }
+
+    /// Reference to the element at the given row and column
+    inline T& operator()(const size_t row,const size_t col) {
+      return _data[row*C + col];
+    }
+
+    /// Element at the given row and column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return _data[row*C + col];
+    }
+
+    /// View of the whole matrix
+    inline view_type view() {
+      return view_type(_data,R,C,C);
+    }
+
+    /// Read-only view of the whole matrix
+    inline const_view_type view() const {
+      return const_view_type(_data,R,C,C);
+    }
+
+    /// A FixedMatrix can be passed wherever a view is expected
+    inline operator view_type() { return view(); }
+
+    /// A FixedMatrix can be passed wherever a read-only view is expected
+    inline operator const_view_type() const { return view(); }
+    //@}
+
+    /**
+     * @name Filling
+     */
+    //@{
+    /// Set all entries to the given value
+    inline void fill(const T val) {
+      fixed::unroll<R*C>::apply([&](const size_t i){ _data[i] = val; });
+    }
+
+    /// Copy R x C entries, row after row, from the given memory block
+    inline void fill(const T* mem) {
+      std::memcpy(_data,mem,sizeof(T)*R*C);
+    }
+
+    /**
+     * Fill with the content of a view or of a dynamic matrix.  As
+     * with Matrix::fill(), only the overlapping entries are copied.
+     */
+    void fill(const const_view_type& other) {
+      const size_t r = (other.rows() < R) ? other.rows() : R;
+      const size_t c = (other.cols() < C) ? other.cols() : C;
+      for (size_t i=0;i<r;++i) {
+        std::memcpy((*this)[i],other[i],sizeof(T)*c);
+      }
+    }
+    //@}
+
+    /**
+     * @name Arithmetic
+     */
+    //@{
+    inline FixedMatrix& operator+=(const FixedMatrix& other) {
+      fixed::unroll<R*C>::apply([&](const size_t i){
+          _data[i] += other._data[i];
+        });
+      return *this;
+    }
+
+    inline FixedMatrix& operator-=(const FixedMatrix& other) {
+      fixed::unroll<R*C>::apply([&](const size_t i){
+          _data[i] -= other._data[i];
+        });
+      return *this;
+    }
+
+    inline FixedMatrix& operator*=(const T scalar) {
+      fixed::unroll<R*C>::apply([&](const size_t i){
+          _data[i] *= scalar;
+        });
+      return *this;
+    }
+
+    inline bool operator==(const FixedMatrix& other) const {
+      bool eq = true;
+      fixed::unroll<R*C>::apply([&](const size_t i){
+          eq = eq && (_data[i] == other._data[i]);
+        });
+      return eq;
+    }
+
+    inline bool operator!=(const FixedMatrix& other) const {
+      return !(*this == other);
+    }
+    //@}
+  }; // class FixedMatrix
+
+  /**
+   * @name FixedMatrix operators
+   */
+  //@{
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator+(const FixedMatrix<T,R,C>& a,
+                                      const FixedMatrix<T,R,C>& b) {
+    FixedMatrix<T,R,C> c(DoNotInitialize);
+    fixed::unroll<R*C>::apply([&](const size_t i){
+        c.data()[i] = a.data()[i] + b.data()[i];
+      });
+    return c;
+  }
+
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator-(const FixedMatrix<T,R,C>& a,
+                                      const FixedMatrix<T,R,C>& b) {
+    FixedMatrix<T,R,C> c(DoNotInitialize);
+    fixed::unroll<R*C>::apply([&](const size_t i){
+        c.data()[i] = a.data()[i] - b.data()[i];
+      });
+    return c;
+  }
+
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator-(const FixedMatrix<T,R,C>& a) {
+    FixedMatrix<T,R,C> c(DoNotInitialize);
+    fixed::unroll<R*C>::apply([&](const size_t i){
+        c.data()[i] = -a.data()[i];
+      });
+    return c;
+  }
+
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C>
+  operator*(const typename FixedMatrix<T,R,C>::value_type s,
+            const FixedMatrix<T,R,C>& a) {
+    FixedMatrix<T,R,C> c(a);
+    return c *= s;
+  }
+
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C>
+  operator*(const FixedMatrix<T,R,C>& a,
+            const typename FixedMatrix<T,R,C>::value_type s) {
+    FixedMatrix<T,R,C> c(a);
+    return c *= s;
+  }
+
+  /// Matrix product of a R x K and a K x C matrix
+  template<typename T,size_t R,size_t K,size_t C>
+  inline FixedMatrix<T,R,C> operator*(const FixedMatrix<T,R,K>& a,
+                                      const FixedMatrix<T,K,C>& b) {
+    FixedMatrix<T,R,C> c; // zeros
+    fixed::unroll<R>::apply([&](const size_t i){
+        fixed::unroll<K>::apply([&](const size_t k){
+            const T aik = a(i,k);
+            fixed::unroll<C>::apply([&](const size_t j){
+                c(i,j) += aik*b(k,j);
+              });
+          });
+      });
+    return c;
+  }
+
+  /// Product of a R x C matrix and a vector with C entries
+  template<typename T,size_t R,size_t C>
+  inline std::array<T,R> operator*(const FixedMatrix<T,R,C>& a,
+                                   const std::array<T,C>& x) {
+    std::array<T,R> y;
+    fixed::unroll<R>::apply([&](const size_t i){
+        T s = T(0);
+        fixed::unroll<C>::apply([&](const size_t j){
+            s += a(i,j)*x[j];
+          });
+        y[i] = s;
+      });
+    return y;
+  }
+  //@}
+
+  /**
+   * LU decomposition and solvers for FixedMatrix.
+   *
+   * They live in their own namespace so that the function templates
+   * anpi::lu and anpi::solveLU, which are passed around as
+   * std::function, do not become overloaded.
+   */
+  namespace fixed
+  {
+    /**
+     * Decompose the N x N matrix A with partial pivoting into the packed
+     * LU, where the strict lower part holds L (with an implicit unit
+     * diagonal) and the upper part holds U, so that PA = LU.  The i-th
+     * row of PA is the row permut[i] of A, as for anpi::lu.
+     *
+     * @throws anpi::Exception if A is singular
+     */
+    template<typename T,size_t N>
+    inline void lu(const FixedMatrix<T,N,N>& A,
+                   FixedMatrix<T,N,N>& LU,
+                   std::array<size_t,N>& permut) {
+      LU = A;
+      fixed::unroll<N>::apply([&](const size_t i){ permut[i] = i; });
+
+      for (size_t k=0;k<N;++k) {
+        // pivot: largest magnitude in column k, first one on ties
+        size_t p = k;
+        for (size_t i=k+1;i<N;++i) {
+          if (std::abs(LU(i,k)) > std::abs(LU(p,k))) {
+            p = i;
+          }
+        }
+        if (LU(p,k) == T(0)) {
+          throw anpi::Exception("Singular matrix, LU cannot be computed");
+        }
+        if (p != k) {
+          fixed::unroll<N>::apply([&](const size_t j){
+              std::swap(LU(p,j),LU(k,j));
+            });
+          std::swap(permut[p],permut[k]);
+        }
+
+        const T ukk = LU(k,k);
+        for (size_t i=k+1;i<N;++i) {
+          const T lik = LU(i,k)/ukk;
+          LU(i,k) = lik;
+          for (size_t j=k+1;j<N;++j) {
+            LU(i,j) -= lik*LU(k,j);
+          }
+        }
+      }
+    }
+
+    /**
+     * Solve Ax=b given the packed decomposition of A computed by lu().
+     * x may be b.
+     */
+    template<typename T,size_t N>
+    inline void solveLU(const FixedMatrix<T,N,N>& LU,
+                        const std::array<size_t,N>& permut,
+                        std::array<T,N>& x,
+                        const std::array<T,N>& b) {
+      // b is read in the order of the permutation while x is written
+      if (&x == &b) {
+        const std::array<T,N> tmp(b);
+        solveLU(LU,permut,x,tmp);
+        return;
+      }
+
+      // forward substitution with the unit lower triangle on Pb
+      for (size_t i=0;i<N;++i) {
+        T s = b[permut[i]];
+        for (size_t j=0;j<i;++j) {
+          s -= LU(i,j)*x[j];
+        }
+        x[i] = s;
+      }
+
+      // backward substitution with the upper triangle
+      for (size_t i=N;i-- > 0;) {
+        T s = x[i];
+        for (size_t j=i+1;j<N;++j) {
+          s -= LU(i,j)*x[j];
+        }
+        x[i] = s/LU(i,i);
+      }
+    }
+
+    /**
+     * Solve Ax=b by decomposing A, without any heap allocation
+     *
+     * @throws anpi::Exception if A is singular
+     */
+    template<typename T,size_t N>
+    inline void solveLU(const FixedMatrix<T,N,N>& A,
+                        std::array<T,N>& x,
+                        const std::array<T,N>& b) {
+      FixedMatrix<T,N,N> LU(DoNotInitialize);
+      std::array<size_t,N> permut;
+      lu(A,LU,permut);
+      solveLU(LU,permut,x,b);
+    }
+  } // namespace fixed
+} // namespace anpi
+
+#endif
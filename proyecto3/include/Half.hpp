@@ -0,0 +1,216 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_HALF_HPP
+#define ANPI_HALF_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <x86intrin.h>
+#endif
+
+namespace anpi
+{
+  /**
+   * @name Reduced precision storage
+   *
+   * 16 bit floating point types meant only to store large matrices
+   * that need about three significant digits, such as temperature or
+   * potential maps, with half of the memory and bandwidth of float.
+   *
+   * There is no 16 bit arithmetic: the entries are converted to float
+   * when read, the operations are done in float, and the results are
+   * rounded to the nearest even 16 bit value only when stored.  The
+   * kernels in bits/MatrixHalf.hpp do the same with whole registers,
+   * using the F16C or AVX-512 conversion instructions, and accumulate
+   * all reductions in float (see anpi::accumulator_type).
+   *
+   * \code
+   * anpi::Matrix<anpi::half> a(n,n,anpi::half(0.5f));
+   * anpi::axpy(anpi::half(2.f),b,a); // computed in float, rounded once
+   * float s = anpi::sum(a);          // accumulated in float
+   * \endcode
+   */
+  //@{
+
+  namespace detail {
+    /// Raw bits of a float
+    inline uint32_t floatBits(const float f) {
+      uint32_t u;
+      std::memcpy(&u,&f,sizeof(u));
+      return u;
+    }
+
+    /// Float with the given raw bits
+    inline float bitsFloat(const uint32_t u) {
+      float f;
+      std::memcpy(&f,&u,sizeof(f));
+      return f;
+    }
+
+    /// IEEE 754 binary16 bits of f, rounded to nearest even
+    inline uint16_t floatToHalf(const float f) {
+#ifdef __F16C__
+      return uint16_t(_cvtss_sh(f,_MM_FROUND_TO_NEAREST_INT));
+#else
+      uint32_t u = floatBits(f);
+      const uint32_t sign = (u >> 16) & 0x8000u;
+      u &= 0x7fffffffu;
+
+      uint32_t h;
+      if (u >= 0x47800000u) {                // 2^16: Inf, NaN or overflow
+        h = (u > 0x7f800000u) ? 0x7e00u : 0x7c00u;
+      } else if (u < 0x38800000u) {          // 2^-14: subnormal or zero
+        // The addition aligns the mantissa and rounds it in hardware
+        const float magic = bitsFloat(0x3f000000u);
+        h = floatBits(bitsFloat(u) + magic) - 0x3f000000u;
+      } else {
+        const uint32_t odd = (u >> 13) & 1u;
+        u += 0xc8000fffu + odd;              // rebias the exponent, round
+        h = u >> 13;
+      }
+      return uint16_t(h | sign);
+#endif
+    }
+
+    /// Float value of the IEEE 754 binary16 bits h (always exact)
+    inline float halfToFloat(const uint16_t h) {
+#ifdef __F16C__
+      return _cvtsh_ss(h);
+#else
+      uint32_t u = uint32_t(h & 0x7fffu) << 13;
+      const uint32_t exp = u & 0x0f800000u;
+      u += 0x38000000u;                      // rebias the exponent
+      if (exp == 0x0f800000u) {              // Inf or NaN
+        u += 0x38000000u;
+      } else if (exp == 0) {                 // subnormal or zero
+        u += 0x00800000u;
+        u = floatBits(bitsFloat(u) - bitsFloat(0x38800000u));
+      }
+      return bitsFloat(u | (uint32_t(h & 0x8000u) << 16));
+#endif
+    }
+
+    /// bfloat16 bits of f, rounded to nearest even
+    inline uint16_t floatToBfloat16(const float f) {
+      const uint32_t u = floatBits(f);
+      if ((u & 0x7fffffffu) > 0x7f800000u) { // keep NaNs quiet NaNs
+        return uint16_t((u >> 16) | 0x40u);
+      }
+      return uint16_t((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+    }
+
+    /// Float value of the bfloat16 bits h (always exact)
+    inline float bfloat16ToFloat(const uint16_t h) {
+      return bitsFloat(uint32_t(h) << 16);
+    }
+  } // namespace detail
+
+  /**
+   * IEEE 754 half precision: 11 significant bits, range up to 65504.
+   *
+   * Suited for values of moderate range, e.g. normalized maps.
+   */
+  class half {
+  public:
+    /// Zero
+    half() : _bits(0) { }
+
+    /// Round f to the nearest half
+    half(const float f) : _bits(detail::floatToHalf(f)) { }
+
+    /// Value as float
+    operator float() const { return detail::halfToFloat(_bits); }
+
+    /// Raw bits
+    uint16_t bits() const { return _bits; }
+
+    /// Half with the given raw bits
+    static half fromBits(const uint16_t b) {
+      half h;
+      h._bits = b;
+      return h;
+    }
+
+    /// Compound operators, computed in float and rounded once
+    //@{
+    half& operator+=(const float x) { return *this = float(*this) + x; }
+    half& operator-=(const float x) { return *this = float(*this) - x; }
+    half& operator*=(const float x) { return *this = float(*this) * x; }
+    half& operator/=(const float x) { return *this = float(*this) / x; }
+    //@}
+
+  private:
+    uint16_t _bits;
+  };
+
+  /**
+   * Brain floating point: the range of float with only 8 significant
+   * bits.
+   *
+   * Suited for values spanning many orders of magnitude.
+   */
+  class bfloat16 {
+  public:
+    /// Zero
+    bfloat16() : _bits(0) { }
+
+    /// Round f to the nearest bfloat16
+    bfloat16(const float f) : _bits(detail::floatToBfloat16(f)) { }
+
+    /// Value as float
+    operator float() const { return detail::bfloat16ToFloat(_bits); }
+
+    /// Raw bits
+    uint16_t bits() const { return _bits; }
+
+    /// bfloat16 with the given raw bits
+    static bfloat16 fromBits(const uint16_t b) {
+      bfloat16 h;
+      h._bits = b;
+      return h;
+    }
+
+    /// Compound operators, computed in float and rounded once
+    //@{
+    bfloat16& operator+=(const float x) { return *this = float(*this) + x; }
+    bfloat16& operator-=(const float x) { return *this = float(*this) - x; }
+    bfloat16& operator*=(const float x) { return *this = float(*this) * x; }
+    bfloat16& operator/=(const float x) { return *this = float(*this) / x; }
+    //@}
+
+  private:
+    uint16_t _bits;
+  };
+
+  static_assert(sizeof(half) == 2,"anpi::half must have 16 bits");
+  static_assert(sizeof(bfloat16) == 2,"anpi::bfloat16 must have 16 bits");
+
+  /// True for the 16 bit storage types
+  template<typename T>
+  struct is_half_type {
+    static constexpr bool value =
+      std::is_same<T,half>::value || std::is_same<T,bfloat16>::value;
+  };
+
+  /**
+   * Type in which sums of entries of type T are accumulated: float for
+   * the 16 bit storage types, T itself for all others.
+   */
+  template<typename T>
+  struct accumulator_type {
+    typedef typename std::conditional<is_half_type<T>::value,float,T>::type
+      type;
+  };
+  //@}
+
+} // namespace anpi
+
+#endif
@@ -12,6 +12,10 @@
 #define ANPI_INTRINSICS_HPP
 
 #include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "SimdConfig.hpp"
 
 /**
  * Include the proper intrinsics headers for the current architecture
@@ -55,7 +59,47 @@ struct is_simd_type {
 };
 
 
-#ifdef __AVX512F__
+/*
+ * Instruction sets for which the SIMD kernels are compiled.
+ *
+ * Usually the kernels are compiled only for the instruction sets
+ * enabled in the compiler flags (e.g. -mavx2).  If
+ * ANPI_SIMD_RUNTIME_DISPATCH is defined (see SimdConfig.hpp), variants
+ * for SSE2, AVX2 and AVX-512 are compiled into the same binary, each
+ * one with its own target options, and the best one supported by the
+ * CPU is selected at runtime (see CpuFeatures.hpp).
+ *
+ * The ANPI_SIMD_BEGIN_* / ANPI_SIMD_END pairs enclose code that must
+ * be compiled for the given instruction set.
+ */
+#ifdef ANPI_SIMD_RUNTIME_DISPATCH
+#  define ANPI_SIMD_HAS_SSE2
+#  define ANPI_SIMD_HAS_AVX2
+#  define ANPI_SIMD_HAS_AVX512
+#  define ANPI_SIMD_BEGIN_AVX2                                  \
+     _Pragma("GCC push_options")                                \
+     _Pragma("GCC target(\"avx2,fma,f16c\")")
+#  define ANPI_SIMD_BEGIN_AVX512                                \
+     _Pragma("GCC push_options")                                \
+     _Pragma("GCC target(\"avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c\")")
+#  define ANPI_SIMD_END _Pragma("GCC pop_options")
+#else
+#  ifdef __SSE2__
+#    define ANPI_SIMD_HAS_SSE2
+#  endif
+#  ifdef __AVX2__
+#    define ANPI_SIMD_HAS_AVX2
+#  endif
+#  if defined(__AVX512F__)  && defined(__AVX512BW__) && \
+      defined(__AVX512DQ__) && defined(__AVX512VL__)
+#    define ANPI_SIMD_HAS_AVX512
+#  endif
+#  define ANPI_SIMD_BEGIN_AVX2
+#  define ANPI_SIMD_BEGIN_AVX512
+#  define ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX512
 template<typename T> struct avx512_traits { };
 template<> struct avx512_traits<double> { typedef __m512d reg_type; };
 template<> struct avx512_traits<float> { typedef __m512 reg_type; };
@@ -69,7 +113,7 @@ template<> struct avx512_traits<int8_t> { typedef __m512i reg_type; };
 template<> struct avx512_traits<uint8_t> { typedef __m512i reg_type; };
 #endif
 
-#ifdef __AVX__
+#ifdef ANPI_SIMD_HAS_AVX2
 template<typename T> struct avx_traits { };
 template<> struct avx_traits<double> { typedef __m256d reg_type; };
 template<> struct avx_traits<float> { typedef __m256 reg_type; };
@@ -83,7 +127,7 @@ template<> struct avx_traits<int8_t> { typedef __m256i reg_type; };
 template<> struct avx_traits<uint8_t> { typedef __m256i reg_type; };
 #endif
 
-#ifdef __SSE2__
+#ifdef ANPI_SIMD_HAS_SSE2
 template<typename T> struct sse2_traits { };
 template<> struct sse2_traits<double> { typedef __m128d reg_type; };
 template<> struct sse2_traits<float> { typedef __m128 reg_type; };
@@ -96,6 +140,31 @@ template<> struct sse2_traits<uint16_t> { typedef __m128i reg_type; };
 template<> struct sse2_traits<int8_t> { typedef __m128i reg_type; };
 template<> struct sse2_traits<uint8_t> { typedef __m128i reg_type; };
 #endif
+
+/**
+ * Registers of the given size in bytes for the type T
+ */
+template<typename T,size_t Bytes> struct simd_traits { };
+#ifdef ANPI_SIMD_HAS_SSE2
+template<typename T> struct simd_traits<T,16> : sse2_traits<T> { };
+#endif
+#ifdef ANPI_SIMD_HAS_AVX2
+template<typename T> struct simd_traits<T,32> : avx_traits<T> { };
+#endif
+#ifdef ANPI_SIMD_HAS_AVX512
+template<typename T> struct simd_traits<T,64> : avx512_traits<T> { };
+#endif
+
+/**
+ * Widest register for the type T of at most Width bytes, that can be
+ * used with aligned loads on memory aligned to Align bytes.
+ */
+template<typename T,size_t Width,size_t Align>
+struct simd_reg {
+  typedef typename simd_traits<T,
+                               (Align>=Width) ? Width :
+                               (Align>=32)    ? 32    : 16>::reg_type type;
+};
   
   
 #endif
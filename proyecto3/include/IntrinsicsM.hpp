@@ -38,7 +38,53 @@ namespace anpi{
     template<typename T,class regType>
     regType mm_mul(regType, regType); 
 
-#ifdef __AVX__
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_mul<double>(__m512d a,__m512d b) {
+      return _mm512_mul_pd(a,b);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_mul<float>(__m512 a,__m512 b) {
+      return _mm512_mul_ps(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<uint64_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi64(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<int64_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi64(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<uint32_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi32(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<int32_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi32(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<uint16_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi16(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_mul<int16_t>(__m512i a,__m512i b) {
+      return _mm512_mullo_epi16(a,b);
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
     template<>
     inline __m256d __attribute__((__always_inline__))
     mm_mul<double>(__m256d a,__m256d b) {
@@ -89,6 +135,302 @@ namespace anpi{
     mm_mul<int8_t>(__m256i a,__m256i b) {
       return _mm256_mullo_epi16(a,b); 
 }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
+    template<>
+    inline __m128d __attribute__((__always_inline__))
+    mm_mul<double>(__m128d a,__m128d b) {
+      return _mm_mul_pd(a,b);
+    }
+    template<>
+    inline __m128 __attribute__((__always_inline__))
+    mm_mul<float>(__m128 a,__m128 b) {
+      return _mm_mul_ps(a,b);
+    }
+    template<>
+    inline __m128i __attribute__((__always_inline__))
+    mm_mul<uint16_t>(__m128i a,__m128i b) {
+      return _mm_mullo_epi16(a,b);
+    }
+    template<>
+    inline __m128i __attribute__((__always_inline__))
+    mm_mul<int16_t>(__m128i a,__m128i b) {
+      return _mm_mullo_epi16(a,b);
+    }
+#endif
+
+
+     /*
+     --------------------------------------------------------------------------------------------
+     * Fused multiply-add, broadcast and unaligned load/store
+     *
+     * Only the floating point types are wrapped, since these are the
+     * only ones used by the multiplication kernels.
+     --------------------------------------------------------------------------------------------
+     */
+
+    /// c + a*b
+    template<typename T,class regType>
+    regType mm_fmadd(regType,regType,regType);
+
+    /// Register with all lanes set to the given value
+    template<typename T,class regType>
+    regType mm_set1(T);
+
+    /// Unaligned load of one register
+    template<typename T,class regType>
+    regType mm_loadu(const T*);
+
+    /// Unaligned store of one register
+    template<typename T,class regType>
+    void mm_storeu(T*,regType);
+
+    /// Sum of all lanes of a register
+    template<typename T,class regType>
+    T mm_hsum(regType);
+
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_fmadd<double>(__m512d a,__m512d b,__m512d c) {
+      return _mm512_fmadd_pd(a,b,c);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_fmadd<float>(__m512 a,__m512 b,__m512 c) {
+      return _mm512_fmadd_ps(a,b,c);
+    }
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_set1<double,__m512d>(double a) {
+      return _mm512_set1_pd(a);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_set1<float,__m512>(float a) {
+      return _mm512_set1_ps(a);
+    }
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_loadu<double,__m512d>(const double* a) {
+      return _mm512_loadu_pd(a);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_loadu<float,__m512>(const float* a) {
+      return _mm512_loadu_ps(a);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<double,__m512d>(double* a,__m512d b) {
+      _mm512_storeu_pd(a,b);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<float,__m512>(float* a,__m512 b) {
+      _mm512_storeu_ps(a,b);
+    }
+    template<>
+    inline double __attribute__((__always_inline__))
+    mm_hsum<double,__m512d>(__m512d a) {
+      // The 512 bit shuffles and _mm512_reduce_add_* trip
+      // -Wmaybe-uninitialized with some GCC versions
+      alignas(64) double t[8];
+      _mm512_store_pd(t,a);
+      return ((t[0]+t[4]) + (t[1]+t[5])) + ((t[2]+t[6]) + (t[3]+t[7]));
+    }
+    template<>
+    inline float __attribute__((__always_inline__))
+    mm_hsum<float,__m512>(__m512 a) {
+      alignas(64) float t[16];
+      _mm512_store_ps(t,a);
+      float s = 0.0f;
+      for (int i=0;i<8;++i) {
+        s += t[i]+t[i+8];
+      }
+      return s;
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
+    template<>
+    inline __m256d __attribute__((__always_inline__))
+    mm_fmadd<double>(__m256d a,__m256d b,__m256d c) {
+#  if defined __FMA__ || defined ANPI_SIMD_RUNTIME_DISPATCH
+      return _mm256_fmadd_pd(a,b,c);
+#  else
+      return _mm256_add_pd(_mm256_mul_pd(a,b),c);
+#  endif
+    }
+    template<>
+    inline __m256 __attribute__((__always_inline__))
+    mm_fmadd<float>(__m256 a,__m256 b,__m256 c) {
+#  if defined __FMA__ || defined ANPI_SIMD_RUNTIME_DISPATCH
+      return _mm256_fmadd_ps(a,b,c);
+#  else
+      return _mm256_add_ps(_mm256_mul_ps(a,b),c);
+#  endif
+    }
+    template<>
+    inline __m256d __attribute__((__always_inline__))
+    mm_set1<double,__m256d>(double a) {
+      return _mm256_set1_pd(a);
+    }
+    template<>
+    inline __m256 __attribute__((__always_inline__))
+    mm_set1<float,__m256>(float a) {
+      return _mm256_set1_ps(a);
+    }
+    template<>
+    inline __m256d __attribute__((__always_inline__))
+    mm_loadu<double,__m256d>(const double* a) {
+      return _mm256_loadu_pd(a);
+    }
+    template<>
+    inline __m256 __attribute__((__always_inline__))
+    mm_loadu<float,__m256>(const float* a) {
+      return _mm256_loadu_ps(a);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<double,__m256d>(double* a,__m256d b) {
+      _mm256_storeu_pd(a,b);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<float,__m256>(float* a,__m256 b) {
+      _mm256_storeu_ps(a,b);
+    }
+    template<>
+    inline double __attribute__((__always_inline__))
+    mm_hsum<double,__m256d>(__m256d a) {
+      const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a),
+                                   _mm256_extractf128_pd(a,1));
+      return _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+    }
+    template<>
+    inline float __attribute__((__always_inline__))
+    mm_hsum<float,__m256>(__m256 a) {
+      __m128 s = _mm_add_ps(_mm256_castps256_ps128(a),
+                            _mm256_extractf128_ps(a,1));
+      s = _mm_add_ps(s,_mm_movehl_ps(s,s));
+      return _mm_cvtss_f32(_mm_add_ss(s,_mm_movehdup_ps(s)));
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
+    template<>
+    inline __m128d __attribute__((__always_inline__))
+    mm_fmadd<double>(__m128d a,__m128d b,__m128d c) {
+      return _mm_add_pd(_mm_mul_pd(a,b),c);
+    }
+    template<>
+    inline __m128 __attribute__((__always_inline__))
+    mm_fmadd<float>(__m128 a,__m128 b,__m128 c) {
+      return _mm_add_ps(_mm_mul_ps(a,b),c);
+    }
+    template<>
+    inline __m128d __attribute__((__always_inline__))
+    mm_set1<double,__m128d>(double a) {
+      return _mm_set1_pd(a);
+    }
+    template<>
+    inline __m128 __attribute__((__always_inline__))
+    mm_set1<float,__m128>(float a) {
+      return _mm_set1_ps(a);
+    }
+    template<>
+    inline __m128d __attribute__((__always_inline__))
+    mm_loadu<double,__m128d>(const double* a) {
+      return _mm_loadu_pd(a);
+    }
+    template<>
+    inline __m128 __attribute__((__always_inline__))
+    mm_loadu<float,__m128>(const float* a) {
+      return _mm_loadu_ps(a);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<double,__m128d>(double* a,__m128d b) {
+      _mm_storeu_pd(a,b);
+    }
+    template<>
+    inline void __attribute__((__always_inline__))
+    mm_storeu<float,__m128>(float* a,__m128 b) {
+      _mm_storeu_ps(a,b);
+    }
+    template<>
+    inline double __attribute__((__always_inline__))
+    mm_hsum<double,__m128d>(__m128d a) {
+      return _mm_cvtsd_f64(_mm_add_sd(a,_mm_unpackhi_pd(a,a)));
+    }
+    template<>
+    inline float __attribute__((__always_inline__))
+    mm_hsum<float,__m128>(__m128 a) {
+      const __m128 s = _mm_add_ps(a,_mm_movehl_ps(a,a));
+      return _mm_cvtss_f32(_mm_add_ss(s,_mm_shuffle_ps(s,s,1)));
+    }
+#endif
+
+     /*
+     --------------------------------------------------------------------------------------------
+     * Division
+     *
+     * There are no integer divisions in SSE or AVX: only the floating
+     * point types are wrapped.
+     --------------------------------------------------------------------------------------------
+     */
+
+    template<typename T,class regType>
+    regType mm_div(regType,regType);
+
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_div<double>(__m512d a,__m512d b) {
+      return _mm512_div_pd(a,b);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_div<float>(__m512 a,__m512 b) {
+      return _mm512_div_ps(a,b);
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
+    template<>
+    inline __m256d __attribute__((__always_inline__))
+    mm_div<double>(__m256d a,__m256d b) {
+      return _mm256_div_pd(a,b);
+    }
+    template<>
+    inline __m256 __attribute__((__always_inline__))
+    mm_div<float>(__m256 a,__m256 b) {
+      return _mm256_div_ps(a,b);
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
+    template<>
+    inline __m128d __attribute__((__always_inline__))
+    mm_div<double>(__m128d a,__m128d b) {
+      return _mm_div_pd(a,b);
+    }
+    template<>
+    inline __m128 __attribute__((__always_inline__))
+    mm_div<float>(__m128 a,__m128 b) {
+      return _mm_div_ps(a,b);
+    }
 #endif
 
 }//namespace simd
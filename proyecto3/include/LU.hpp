@@ -16,26 +16,29 @@
 namespace anpi{
 
     /**
-     * Using to choose between LU decomposition with SIMD xor LU decomposition without SIMD.
+     * LU decomposition with partial pivoting, computed by the blocked
+     * luBlocked(), which runs on the SIMD kernels if they are enabled.
+     * Systems with at least parallel::luThreshold() rows are decomposed
+     * by the task-parallel luTiled() if several threads are available.
+     *
+     * A may be any matrix or view; LU can use any allocator, such as
+     * the arena_allocator for temporaries within a ScopedArena.
      * @tparam T template.
      * @param A A matrix.
      * @param LU LU matrix.
      * @param permut permut vector.
      */
-    template <typename T>
-    inline void lu(const Matrix<T>& A,
-                   Matrix<T>& LU,
+    template <typename T,class Alloc=typename Matrix<T>::allocator_type>
+    inline void lu(const typename const_view<T>::type& A,
+                   Matrix<T,Alloc>& LU,
                    std::vector<size_t>& permut){
 
-        #ifdef ANPI_ENABLE_SIMD
-          #ifdef __AVX__
-            anpi::simd::luDoolittleSIMD<T,  typename avx_traits<T>::reg_type>(A, LU, permut);
-          #else
-            luDoolittle(A, LU, permut);
-          #endif
-        #else
-            luDoolittle(A, LU, permut);
-        #endif
+        if (A.rows() >= parallel::luThreshold() &&
+            parallel::numThreads() > 1) {
+            luTiled(A, LU, permut);
+        } else {
+            luBlocked(A, LU, permut);
+        }
     }
 
     /**
@@ -45,10 +48,10 @@ namespace anpi{
      * @param L L matrix.
      * @param U U matrix.
      */
-    template <typename T>
-    inline void unpack(const Matrix<T>& LU,
-                       Matrix<T>& L,
-                       Matrix<T>& U){
+    template <typename T,class Alloc=typename Matrix<T>::allocator_type>
+    inline void unpack(const Matrix<T,Alloc>& LU,
+                       Matrix<T,Alloc>& L,
+                       Matrix<T,Alloc>& U){
         anpi::unpackDoolittle(LU, L, U);
     }
 }
@@ -13,12 +13,14 @@
 #include <limits>
 #include <functional>
 #include <algorithm>
+#include <atomic>
 #include "Utilities.hpp"
 #include "Exception.hpp"
 #include "Matrix.hpp"
 #include <iostream>
 #include "Intrinsics.hpp"
 #include "IntrinsicsM.hpp"
+#include "Parallel.hpp"
 
 #ifndef ANPI_LU_DOOLITTLE_HPP
 #define ANPI_LU_DOOLITTLE_HPP
@@ -37,17 +39,17 @@ namespace anpi {
    * @param L L matrix.
    * @param U U matrix.
    */
-  template<typename T>
-  void unpackDoolittle(const Matrix<T>& LU,
-                       Matrix<T>& L,
-                       Matrix<T>& U) {
-
-      L = LU;
-      U = LU;
-      size_t n = LU.cols();                        ///Columns number;
+  template<typename T,class Alloc>
+  void unpackDoolittle(const Matrix<T,Alloc>& LU,
+                       Matrix<T,Alloc>& L,
+                       Matrix<T,Alloc>& U) {
 
       if (LU.rows() != LU.cols()) throw anpi::Exception("Matrix is not a square!");
 
+      size_t n = LU.cols();                        ///Columns number;
+      L.allocate(n,n);                             ///Every entry is written below
+      U.allocate(n,n);
+
       for (size_t i = 0; i < n; ++i) {             ///Rows Iterator;
 
           for (size_t j = 0; j < n; ++j) {         ///Columns Iterator;
@@ -77,7 +79,7 @@ namespace anpi {
    * The L matrix will have in the Doolittle's LU decomposition a
    * diagonal of 1'sc
    *
-   * @param[in] A a square matrix 
+   * @param[in] A a square matrix, or a view of one
    * @param[out] LU matrix encoding the L and U matrices
    * @param[out] permut permutation vector, holding the indices of the
    *             original matrix falling into the corresponding element.
@@ -90,9 +92,9 @@ namespace anpi {
    */
 
 
-  template<typename T>
-  void luDoolittle(const Matrix<T>& A,
-                   Matrix<T>& LU,
+  template<typename T,class Alloc>
+  void luDoolittle(const typename const_view<T>::type& A,
+                   Matrix<T,Alloc>& LU,
                    std::vector<size_t>& permut) {
 
     if (A.rows() != A.cols()) throw anpi::Exception("Matrix is not a square!");
@@ -101,18 +103,11 @@ namespace anpi {
         permut[i] = i;
     }
 
-    LU = A;
-    size_t n = LU.rows();                         ///Rows number and Columns number, counter
-    T f;                                          ///f = factors for the lower triangular matrix
+    LU.allocate(A.rows(),A.cols());
+    LU.view().assign(A);
 
     pivot(LU,0,0,0,permut);                       ///Pivoting
     for (size_t col = 0; col < A.cols(); col++) {
-      ///ax value of the current column
-      T max = T(0);
-      ///index of the max value at current column
-      size_t max_index = col;
-
-
       
       ///We can swap the current row and the row which we have found the max value of the
       ///current col. Remember, the current col is also the current row.
@@ -139,11 +134,267 @@ namespace anpi {
       }
     }
   }
-  
+
+  /// Width of the panels of luBlocked()
+  static const size_t LUBlockSize = 64;
+
+  /**
+   * Blocked right-looking variant of luDoolittle(), with the same
+   * arguments and the same LU and permut output.
+   *
+   * The columns are processed in panels of LUBlockSize.  Each panel is
+   * factored with partial pivoting, swapping complete rows as pivot()
+   * does; the U block to its right is solved with the unit lower
+   * triangle of the panel, and the trailing matrix receives all the
+   * updates of the panel at once with a single gemm.  Thus, most of
+   * the O(n^3) work runs in the packed (and threaded) product, instead
+   * of one pass over the trailing matrix per column.
+   *
+   * @throws anpi::Exception if matrix cannot be decomposed, or input
+   *         matrix is not square.
+   */
+  template<typename T,class Alloc=typename Matrix<T>::allocator_type>
+  void luBlocked(const typename const_view<T>::type& A,
+                 Matrix<T,Alloc>& LU,
+                 std::vector<size_t>& permut) {
+
+    if (A.rows() != A.cols()) throw anpi::Exception("Matrix is not a square!");
+
+    const size_t n = A.rows();
+    permut.resize(n);
+    for (size_t i=0;i<n;++i) {
+      permut[i] = i;
+    }
+
+    LU.allocate(n,n);
+    LU.view().assign(A);
+
+    for (size_t k=0;k<n;k+=LUBlockSize) {
+      const size_t kend = std::min(n,k+LUBlockSize);
+
+      // Panel: unblocked elimination restricted to the columns [k,kend)
+      for (size_t col=k;col<kend;++col) {
+        pivot(LU,col,0,col,permut);
+
+        if (col+1 < n && LU[col][col] == T(0)) {
+          throw anpi::Exception("Division by zero detected, LU matrix couldn't be created");
+        }
+
+        const T* urow = LU[col]+col+1;
+        for (size_t row=col+1;row<n;++row) {
+          const T factor = LU[row][col]/LU[col][col];
+          LU[row][col] = factor;
+          ::anpi::aimpl::axpy(-factor,urow,LU[row]+col+1,kend-col-1);
+        }
+      }
+
+      if (kend == n) {
+        break;
+      }
+
+      // U12 = L11^-1 A12, with the unit diagonal of L11
+      const size_t right = n-kend;
+      for (size_t row=k+1;row<kend;++row) {
+        for (size_t j=k;j<row;++j) {
+          ::anpi::aimpl::axpy(-LU[row][j],LU[j]+kend,LU[row]+kend,right);
+        }
+      }
+
+      // A22 -= L21 U12
+      typedef typename Matrix<T,Alloc>::const_view_type const_view_type;
+      const const_view_type L21 = LU.block(kend,k,right,kend-k);
+      const const_view_type U12 = LU.block(k,kend,kend-k,right);
+      ::anpi::aimpl::gemm<T>(L21,U12,LU.block(kend,kend,right,right),
+                             T(-1),T(1));
+    }
+  }
+
+  /// Width of the column tiles of luTiled()
+  static const size_t LUTileSize = 128;
+
+  namespace detail {
+    /**
+     * Unblocked LU with partial pivoting of the panel formed by the
+     * columns [k,kend) and the rows [k,n) of LU.  The rows are swapped
+     * only within the panel, and ipiv[r] receives the row exchanged
+     * with row r, for the other columns to follow later (see luSwap()).
+     *
+     * @return false if a pivot is zero
+     */
+    template<typename T,class Alloc>
+    bool luPanel(Matrix<T,Alloc>& LU,
+                 const size_t k,
+                 const size_t kend,
+                 size_t* ipiv) {
+      const size_t n = LU.rows();
+      for (size_t col=k;col<kend;++col) {
+        size_t maxI;
+        ::anpi::aimpl::iamax(LU[col]+col,n-col,LU.dcols(),maxI);
+        maxI += col;
+        ipiv[col] = maxI;
+        if (maxI != col) {
+          std::swap_ranges(LU[col]+k,LU[col]+kend,LU[maxI]+k);
+        }
+
+        if (col+1 < n && LU[col][col] == T(0)) {
+          return false;
+        }
+
+        const T* urow = LU[col]+col+1;
+        for (size_t row=col+1;row<n;++row) {
+          const T factor = LU[row][col]/LU[col][col];
+          LU[row][col] = factor;
+          ::anpi::aimpl::axpy(-factor,urow,LU[row]+col+1,kend-col-1);
+        }
+      }
+      return true;
+    }
+
+    /// Apply the row swaps ipiv of the panel [k,kend) to the columns [j0,j1)
+    template<typename T,class Alloc>
+    void luSwap(Matrix<T,Alloc>& LU,
+                const size_t k,
+                const size_t kend,
+                const size_t* ipiv,
+                const size_t j0,
+                const size_t j1) {
+      for (size_t row=k;row<kend;++row) {
+        if (ipiv[row] != row) {
+          std::swap_ranges(LU[row]+j0,LU[row]+j1,LU[ipiv[row]]+j0);
+        }
+      }
+    }
+
+    /**
+     * Update of the columns [j0,j1), right of the factored panel
+     * [k,kend): row swaps, U block solved with the unit lower triangle
+     * of the panel, and gemm on the rows below the panel
+     */
+    template<typename T,class Alloc>
+    void luUpdate(Matrix<T,Alloc>& LU,
+                  const size_t k,
+                  const size_t kend,
+                  const size_t* ipiv,
+                  const size_t j0,
+                  const size_t j1) {
+      luSwap(LU,k,kend,ipiv,j0,j1);
+
+      for (size_t row=k+1;row<kend;++row) {
+        for (size_t j=k;j<row;++j) {
+          ::anpi::aimpl::axpy(-LU[row][j],LU[j]+j0,LU[row]+j0,j1-j0);
+        }
+      }
+
+      const size_t below = LU.rows()-kend;
+      if (below > 0) {
+        typedef typename Matrix<T,Alloc>::const_view_type const_view_type;
+        const const_view_type L21 = LU.block(kend,k,below,kend-k);
+        const const_view_type U12 = LU.block(k,j0,kend-k,j1-j0);
+        ::anpi::aimpl::gemm<T>(L21,U12,LU.block(kend,j0,below,j1-j0),
+                               T(-1),T(1));
+      }
+    }
+  } // namespace detail
+
+  /**
+   * Task-parallel variant of luBlocked(), with the same arguments and
+   * the same LU and permut output.
+   *
+   * The matrix is split into column tiles of LUTileSize.  Factoring the
+   * panel of tile k is one OpenMP task, and so is the update of each
+   * tile j > k with that panel (row swaps, triangular solve and gemm).
+   * The tasks depend only on the tiles they read and write, so that the
+   * panel of tile k+1 starts as soon as tile k+1 received its update,
+   * while the updates of the other tiles with panel k, and with earlier
+   * panels, are still running on the remaining threads.
+   *
+   * The kernels inside the tasks run serially; parallel::threads()
+   * sets the number of threads running the tasks.
+   *
+   * @throws anpi::Exception if matrix cannot be decomposed, or input
+   *         matrix is not square.
+   */
+  template<typename T,class Alloc=typename Matrix<T>::allocator_type>
+  void luTiled(const typename const_view<T>::type& A,
+               Matrix<T,Alloc>& LU,
+               std::vector<size_t>& permut) {
+
+    if (A.rows() != A.cols()) throw anpi::Exception("Matrix is not a square!");
+
+    const size_t n = A.rows();
+    const size_t tiles = (n+LUTileSize-1)/LUTileSize;
+
+    LU.allocate(n,n);
+    LU.view().assign(A);
+
+    std::vector<size_t> ipiv(n);
+    size_t* const piv = ipiv.data();
+
+    // One dependency token per column tile
+    std::vector<char> tokens(tiles);
+    char* const tile = tokens.data();
+
+    std::atomic<bool> singular(false);
+    const int threads = parallel::numThreads();
+
+    // Only read by the pragmas: unused without OpenMP
+    (void)tile;
+    (void)threads;
+
+#pragma omp parallel num_threads(threads) if(threads>1)
+#pragma omp single
+    {
+      for (size_t t=0;t<tiles;++t) {
+        const size_t k    = t*LUTileSize;
+        const size_t kend = std::min(n,k+LUTileSize);
+
+#pragma omp task depend(inout: tile[t])
+        {
+          if (!singular && !detail::luPanel(LU,k,kend,piv)) {
+            singular = true;
+          }
+        }
+
+        for (size_t u=t+1;u<tiles;++u) {
+          const size_t j0 = u*LUTileSize;
+          const size_t j1 = std::min(n,j0+LUTileSize);
+
+#pragma omp task depend(in: tile[t]) depend(inout: tile[u])
+          {
+            if (!singular) {
+              detail::luUpdate(LU,k,kend,piv,j0,j1);
+            }
+          }
+        }
+      }
+    } // all tasks are done at the end of the region
+
+    if (singular) {
+      throw anpi::Exception("Division by zero detected, LU matrix couldn't be created");
+    }
+
+    // The swaps of the later panels on the columns of L
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+    for (size_t t=0;t<tiles;++t) {
+      const size_t j0 = t*LUTileSize;
+      const size_t j1 = std::min(n,j0+LUTileSize);
+      for (size_t k=j1;k<n;k+=LUTileSize) {
+        detail::luSwap(LU,k,std::min(n,k+LUTileSize),piv,j0,j1);
+      }
+    }
+
+    permut.resize(n);
+    for (size_t i=0;i<n;++i) {
+      permut[i] = i;
+    }
+    for (size_t i=0;i<n;++i) {
+      std::swap(permut[i],permut[piv[i]]);
+    }
+  }
+
 
   namespace simd{
-    #ifdef ANPI_ENABLE_SIMD
-    #ifdef __AVX__
+  #ifdef ANPI_ENABLE_SIMD
 
 
     /**
@@ -157,10 +408,10 @@ namespace anpi {
       * @param L L matrix.
       * @param U U matrix.
       */
-    template<typename T>
-    void unpackDoolittleSIMD(const Matrix<T>& LU,
-                         Matrix<T>& L,
-                         Matrix<T>& U) {
+    template<typename T,class Alloc>
+    void unpackDoolittleSIMD(const Matrix<T,Alloc>& LU,
+                         Matrix<T,Alloc>& L,
+                         Matrix<T,Alloc>& U) {
 
         if (LU.rows() != LU.cols()) throw anpi::Exception("Matrix is not a square!");
         
@@ -191,110 +442,11 @@ namespace anpi {
       
     }///unpackDoolittleSIMD
 
-    // ludolittle for simd
-
-/**
-  * Decompose the matrix A into a lower triangular matrix L and an
-  * upper triangular matrix U.  The matrices L and U are packed into
-  * a single matrix LU, using SIMD instructions.
-  *
-  * The L matrix will have in the Doolittle's LU decomposition a
-  * diagonal of 1'sc
-  *
-  * @param[in] A a square matrix
-  * @param[out] LU matrix encoding the L and U matrices
-  * @param[out] permut permutation vector, holding the indices of the
-  *             original matrix falling into the corresponding element.
-  *             For example if permut[5]==3 holds, then the fifth row
-  *             of the LU decomposition in fact is dealing with the third
-  *             row of the original matrix.
-  *
-  * @throws anpi::Exception if matrix cannot be decomposed, or input
-  *         matrix is not square.
-  */
-    template<typename T,typename regType>
-    inline void luDoolittleSIMD(const Matrix<T>& A,
-                                 Matrix<T>& LU,
-                               std::vector<size_t>& permut) {
-
-      if(A.rows() != A.cols()) throw anpi::Exception("Matrix is not square"); 
-      
-      LU = Matrix<T>(A); 
-
-      const size_t tentries = A.rows()*A.dcols();         /// amount of values in matrix
-      const size_t blocks = (tentries*sizeof(T) + (sizeof(regType)-1) )/sizeof(regType);      ///amount of blocks in matrix
-
-
-      const size_t blocks_in_row = blocks/A.rows();       ///amount off blocks in a row
-      const size_t cols_in_block = A.dcols()/blocks_in_row;       ///amount of values in a block
-
-      Matrix<T> factor_vector;                        ///a matrix is used to store the factor as many times as values in a block
-      factor_vector.allocate(1, cols_in_block);       ///this is due to alignment of data
-      regType* factor_reg  = reinterpret_cast<regType*>(factor_vector.data());   ///casts to a register
-
-      permut = std::vector<size_t>(A.rows(), 0); 
-      for(size_t x = 0; x < permut.size(); ++x){ 
-          permut[x] = x;
-      }
-
-
-      regType* LU_start  = reinterpret_cast<regType*>(LU.data());     ///saves the begining of the matrix
-      regType* LU_end  = LU_start + blocks;                           ///saves the end of the matrix
-
-
-      for(size_t col = 0; col < LU.rows() - 1; ++col){                      ///calculates factors of column col
-          pivot(LU, col, 0, col, permut);                                   ///pivoting
-          regType* block_col_actual = LU_start + col * blocks_in_row;       ///saves the actual row
-          regType* actual_col_backup = block_col_actual;                    ///makes a backup of the row
-          regType* block_row_actual = block_col_actual + blocks_in_row;     ///saves the actual row to iterate
-          regType* end_next_row = block_row_actual + blocks_in_row;         ///saves the end of the row to iterate
-
-          T factor;
-          for(size_t row = col + 1; block_row_actual != LU_end;++row){       ///calculates factors of column col and row row
-
-              if(std::abs(LU(col, col)) < std::numeric_limits<T>::epsilon()){ 
-                  throw anpi::Exception("Division by zero! Matrix cannot be decomposed by luDoolittle");
-              }
-              factor = LU(row, col)/LU(col, col);         ///factor that multiplies every value
-              LU[row][col] = factor;                      ///stores the factor
-              
-              for(size_t k = 1;block_row_actual!=end_next_row;++block_row_actual){ 
-                                                      ///iterates on the row, updates it by the formula:
-                                                                  /// row = row - factor*row2
-                                                                  /// where row2 is the LU[col] row
-                  
-                  if(cols_in_block * k - 1 >= col){       ///checks if the values overlap into the U matrix
-                      factor_vector.fill(factor); 
-                      
-                      
-                      int over = (int)(col - cols_in_block * (k - 1)); ///checks to prevent destroying past factors
-                      for(int count = 0; count <= over; ++count){ 
-                          factor_vector[0][count] = T(0);             ///to prevent it, fills the factor vector with 0
-                      }
-                      ///NON SIMD: LU[row][k] -= LU[col][k]*factor;                        
-                      *block_row_actual = mm_sub<T>(*block_row_actual, mm_mul<T,regType>(*factor_reg, *block_col_actual)); 
-                                                                                                                
-                  }
-                  ++k;
-                  ++block_col_actual;
-                  
-              }
-              
-              end_next_row += blocks_in_row;
-              block_col_actual = actual_col_backup;
-              
-          }///END row iterarion
-        }///END col iteration
-      }///END DoolittleSimd
-      
-      #endif
-    #endif
-
+  #endif
 
   }//namespace simd
 
-
 }//namespace anpi
-  
+
 #endif
 
@@ -0,0 +1,333 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_LU_FACTORIZATION_HPP
+#define ANPI_LU_FACTORIZATION_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "LU.hpp"
+#include "Parallel.hpp"
+#include "Utilities.hpp"
+
+namespace anpi
+{
+  namespace detail {
+    // Columns [begin,end) of X = L^-1 X, with the unit lower triangle L
+    // of the packed LU.  Each block of LUBlockSize rows first receives
+    // the contribution of all the rows above it with one gemm, and then
+    // is solved with the triangle on the diagonal.
+    template<typename T,class Alloc,class BAlloc>
+    void trsmLower(const Matrix<T,Alloc>& LU,
+                   Matrix<T,BAlloc>& X,
+                   const size_t begin,
+                   const size_t end) {
+      typedef typename Matrix<T,BAlloc>::const_view_type const_view_type;
+      const size_t n = LU.rows();
+      const size_t m = end-begin;
+
+      for (size_t k=0;k<n;k+=LUBlockSize) {
+        const size_t kend = std::min(n,k+LUBlockSize);
+        if (k > 0) {
+          ::anpi::aimpl::gemm<T>(LU.block(k,0,kend-k,k),
+                                 const_view_type(X.block(0,begin,k,m)),
+                                 X.block(k,begin,kend-k,m),
+                                 T(-1),T(1));
+        }
+        for (size_t i=k+1;i<kend;++i) {
+          const T* li = LU[i];
+          for (size_t j=k;j<i;++j) {
+            ::anpi::aimpl::axpy(-li[j],X[j]+begin,X[i]+begin,m);
+          }
+        }
+      }
+    }
+
+    // Columns [begin,end) of X = U^-1 X, with the upper triangle U of
+    // the packed LU, by blocks from the bottom up as trsmLower()
+    template<typename T,class Alloc,class BAlloc>
+    void trsmUpper(const Matrix<T,Alloc>& LU,
+                   Matrix<T,BAlloc>& X,
+                   const size_t begin,
+                   const size_t end) {
+      typedef typename Matrix<T,BAlloc>::const_view_type const_view_type;
+      const size_t n = LU.rows();
+      const size_t m = end-begin;
+
+      for (size_t kend=n;kend>0;) {
+        const size_t k = (kend > LUBlockSize) ? kend-LUBlockSize : 0;
+        if (kend < n) {
+          ::anpi::aimpl::gemm<T>(LU.block(k,kend,kend-k,n-kend),
+                                 const_view_type(X.block(kend,begin,
+                                                         n-kend,m)),
+                                 X.block(k,begin,kend-k,m),
+                                 T(-1),T(1));
+        }
+        for (size_t i=kend;i-- > k;) {
+          const T* ui = LU[i];
+          for (size_t j=i+1;j<kend;++j) {
+            ::anpi::aimpl::axpy(-ui[j],X[j]+begin,X[i]+begin,m);
+          }
+          T* xi = X[i]+begin;
+          for (size_t c=0;c<m;++c) {
+            xi[c] /= ui[i];
+          }
+        }
+        kend = k;
+      }
+    }
+
+    // X = U^-1 L^-1 X in place, with the columns of large systems split
+    // into one chunk per thread (see parallel::gemmThreshold())
+    template<typename T,class Alloc,class XAlloc>
+    void trsmLU(const Matrix<T,Alloc>& LU,Matrix<T,XAlloc>& X) {
+      const size_t n = LU.rows();
+      const size_t m = X.cols();
+      const int threads = (n*n*m >= parallel::gemmThreshold())
+                        ? parallel::numThreads() : 1;
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+      for (int t=0;t<threads;++t) {
+        size_t begin,end;
+        ::anpi::parallel::chunkRange<T>(m,threads,t,begin,end);
+        if (begin < end) {
+          trsmLower(LU,X,begin,end);
+          trsmUpper(LU,X,begin,end);
+        }
+      }
+    }
+  } // namespace detail
+
+  /**
+   * Solve A x = b with the packed LU matrix and the permutation vector
+   * of anpi::lu(), without unpacking them: the unit diagonal of L is
+   * implicit and b is permuted while substituting.  Each row is one
+   * dot product with the SIMD kernels.  x may be b.
+   *
+   * @throws anpi::Exception if the sizes do not match.
+   */
+  template<typename T,class Alloc>
+  void solvePackedLU(const Matrix<T,Alloc>& LU,
+                     const std::vector<size_t>& permut,
+                     std::vector<T>& x,
+                     const std::vector<T>& b) {
+    const size_t n = LU.rows();
+    if ((b.size() != n) || (permut.size() != n)) {
+      throw anpi::Exception("LU factorization and b sizes don't match.");
+    }
+
+    if (&x == &b) {
+      const std::vector<T> tmp(b);
+      solvePackedLU(LU,permut,x,tmp);
+      return;
+    }
+    x.resize(n);
+
+    // L y = P b, with unit diagonal
+    for (size_t i=0;i<n;++i) {
+      T sum(0);
+      ::anpi::aimpl::dot(LU[i],x.data(),i,sum);
+      x[i] = b[permut[i]] - sum;
+    }
+
+    // U x = y
+    for (size_t i=n;i-- > 0;) {
+      T sum(0);
+      ::anpi::aimpl::dot(LU[i]+i+1,x.data()+i+1,n-i-1,sum);
+      x[i] = (x[i] - sum)/LU[i][i];
+    }
+  }
+
+  /**
+   * Solve A X = B for all the columns of B at once, with the packed LU
+   * matrix and the permutation vector of anpi::lu().  X and B may use
+   * different allocators.
+   *
+   * No temporary matrix is needed: the permuted rows of B are copied
+   * into X, which keeps its memory if it already has the size of B, and
+   * the solves run on X.  If X is B its rows are permuted in place,
+   * following the cycles of the permutation.
+   *
+   * The triangular solves are blocked: most of the work is one gemm
+   * per block of LUBlockSize rows.  Large systems split the columns of
+   * X into one chunk per thread (see parallel::gemmThreshold()).
+   *
+   * @throws anpi::Exception if the sizes do not match.
+   */
+  template<typename T,class Alloc,class XAlloc,class BAlloc>
+  void solvePackedLU(const Matrix<T,Alloc>& LU,
+                     const std::vector<size_t>& permut,
+                     Matrix<T,XAlloc>& X,
+                     const Matrix<T,BAlloc>& B) {
+    const size_t n = LU.rows();
+    const size_t m = B.cols();
+    if ((B.rows() != n) || (permut.size() != n)) {
+      throw anpi::Exception("LU factorization and B sizes don't match.");
+    }
+
+    if (static_cast<const void*>(&X) == static_cast<const void*>(&B)) {
+      // X[i] = B[permut[i]]: each swap puts one row in its place
+      std::vector<char> done(n,0);
+      for (size_t s=0;s<n;++s) {
+        if (done[s]) continue;
+        size_t i=s;
+        for (;permut[i] != s;i=permut[i]) {
+          swapRows(X,i,permut[i],0);
+          done[i] = 1;
+        }
+        done[i] = 1;
+      }
+    } else {
+      X.allocate(n,m);
+      for (size_t i=0;i<n;++i) {
+        std::copy(B[permut[i]],B[permut[i]]+m,X[i]);
+      }
+    }
+
+    detail::trsmLU(LU,X);
+  }
+
+  /**
+   * LU decomposition of a square matrix, computed once and reused for
+   * any number of right-hand sides.
+   *
+   * It keeps the packed LU matrix and the permutation vector produced
+   * by anpi::lu(), so that each solve costs O(n^2) per right-hand side
+   * instead of the O(n^3) of a new decomposition.  Several right-hand
+   * sides can be given as the columns of a matrix, which are then
+   * processed together (see solvePackedLU()).
+   *
+   * The solve methods are const and use only local temporaries, so
+   * that several threads may solve concurrently with one factorization.
+   *
+   * \code
+   * anpi::LUFactorization<double> f(A);
+   * std::vector<double> x = f.solve(b);
+   * anpi::Matrix<double> X = f.solve(B);   // A X = B
+   * f.solveInPlace(c);                     // c = A^-1 c
+   * \endcode
+   */
+  template<typename T,class Alloc=typename Matrix<T>::allocator_type>
+  class LUFactorization {
+  public:
+    /// Type of the entries
+    typedef T value_type;
+
+    /// Type of the packed LU matrix
+    typedef Matrix<T,Alloc> matrix_type;
+
+  private:
+    /// Packed L (unit diagonal not stored) and U
+    matrix_type _lu;
+
+    /// Row permut[i] of the original matrix is row i of LU
+    std::vector<size_t> _permut;
+
+  public:
+    /// Empty factorization, to be computed later with factor()
+    LUFactorization() {}
+
+    /**
+     * Decompose the square matrix A
+     *
+     * @throws anpi::Exception if A is not square or singular
+     */
+    explicit LUFactorization(const typename const_view<T>::type& A) {
+      factor(A);
+    }
+
+    /**
+     * Decompose the square matrix A, replacing any previous
+     * decomposition
+     *
+     * @throws anpi::Exception if A is not square or singular
+     */
+    void factor(const typename const_view<T>::type& A) {
+      lu(A,_lu,_permut);
+    }
+
+    /// Number of rows (and columns) of the decomposed matrix
+    inline size_t rows() const { return _lu.rows(); }
+
+    /// True if nothing has been decomposed yet
+    inline bool empty() const { return _lu.rows() == 0; }
+
+    /// The packed LU matrix, as returned by anpi::lu()
+    inline const matrix_type& packed() const { return _lu; }
+
+    /// The permutation vector, as returned by anpi::lu()
+    inline const std::vector<size_t>& permutation() const { return _permut; }
+
+    /**
+     * Solve A x = b.  x may be b.
+     *
+     * @throws anpi::Exception if the size of b does not match.
+     */
+    void solve(const std::vector<T>& b,std::vector<T>& x) const {
+      solvePackedLU(_lu,_permut,x,b);
+    }
+
+    /**
+     * Solution x of A x = b
+     *
+     * @throws anpi::Exception if the size of b does not match.
+     */
+    std::vector<T> solve(const std::vector<T>& b) const {
+      std::vector<T> x;
+      solve(b,x);
+      return x;
+    }
+
+    /**
+     * Replace b with the solution of A x = b
+     *
+     * @throws anpi::Exception if the size of b does not match.
+     */
+    void solveInPlace(std::vector<T>& b) const {
+      solve(b,b);
+    }
+
+    /**
+     * Solve A X = B for all the columns of B at once.  X may be B.
+     *
+     * @throws anpi::Exception if the number of rows of B does not match.
+     */
+    template<class BAlloc,class XAlloc>
+    void solve(const Matrix<T,BAlloc>& B,Matrix<T,XAlloc>& X) const {
+      solvePackedLU(_lu,_permut,X,B);
+    }
+
+    /**
+     * Solution X of A X = B
+     *
+     * @throws anpi::Exception if the number of rows of B does not match.
+     */
+    template<class BAlloc>
+    Matrix<T,BAlloc> solve(const Matrix<T,BAlloc>& B) const {
+      Matrix<T,BAlloc> X;
+      solve(B,X);
+      return X;
+    }
+
+    /**
+     * Replace each column b of B with the solution of A x = b
+     *
+     * @throws anpi::Exception if the number of rows of B does not match.
+     */
+    template<class BAlloc>
+    void solveInPlace(Matrix<T,BAlloc>& B) const {
+      solve(B,B);
+    }
+  }; // class LUFactorization
+
+} // namespace anpi
+
+#endif
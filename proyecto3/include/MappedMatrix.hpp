@@ -0,0 +1,371 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MAPPED_MATRIX_HPP
+#define ANPI_MAPPED_MATRIX_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <boost/align/aligned_alloc.hpp>
+
+#include "Allocator.hpp"
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "MatrixFile.hpp"
+
+#if defined __unix__ || defined __APPLE__
+#  define ANPI_HAS_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace anpi
+{
+  /**
+   * Matrices whose buffer is a memory-mapped file.
+   *
+   * The file holds the matrix in the format of MatrixFile.hpp, with
+   * the entries in the same layout as in memory, so opening a file
+   * just maps it: nothing is read or parsed, and the operating system
+   * loads the pages as they are used.  Matrices larger than the
+   * physical memory can be processed this way, and several processes
+   * can share the same file.
+   *
+   * \code
+   * typedef anpi::mapped_matrix<float>::type mmatrix;
+   *
+   * mmatrix a = anpi::mapped::createFile<float>("plate.bin",4000,4000);
+   * a.fill(0.f);                       // written to plate.bin
+   * ...
+   * mmatrix b = anpi::mapped::openFile<float>("plate.bin",
+   *                                           anpi::mapped::ReadOnly);
+   * \endcode
+   */
+  namespace mapped {
+
+    /// How a file is mapped
+    enum Mode {
+      /// New file (truncating an existing one); changes are written back
+      Create,
+      /// The file is never modified.  The matrix may still be changed,
+      /// but the changes are private copies of the pages.
+      ReadOnly,
+      /// Existing file; changes are written back
+      ReadWrite
+    };
+
+    /// What the next allocation of a mapped_file_allocator maps
+    struct request {
+      std::string filename;
+      Mode        mode;
+      size_t      rows;
+      size_t      cols;
+      bool        done;
+    };
+
+    namespace detail {
+      /// A mapping: whole file, header included
+      struct region {
+        void*  base;
+        size_t bytes;
+      };
+
+      inline std::mutex& mutex() {
+        static std::mutex m;
+        return m;
+      }
+
+      /// All active mappings, by the address of their first entry
+      inline std::map<const void*,region>& regions() {
+        static std::map<const void*,region> r;
+        return r;
+      }
+    } // namespace detail
+
+#ifdef ANPI_HAS_MMAP
+    /**
+     * Map the file of a request as the buffer for n entries.
+     *
+     * @throws anpi::Exception if the file cannot be mapped, or if its
+     *         row padding does not match the one of the allocator
+     */
+    template<typename T>
+    T* map(const request& req,const size_t n) {
+      const size_t dcols = (req.rows > 0) ? n/req.rows : 0;
+      const file::header h = file::makeHeader<T>(req.rows,req.cols,dcols);
+      const size_t bytes = file::fileSize(h);
+
+      const int flags = (req.mode == ReadOnly) ? O_RDONLY :
+                        (req.mode == Create) ? (O_RDWR | O_CREAT | O_TRUNC) :
+                        O_RDWR;
+      const int fd = ::open(req.filename.c_str(),flags,0644);
+      if (fd < 0) {
+        throw anpi::Exception("Cannot open " + req.filename);
+      }
+
+      if (req.mode == Create) {
+        if (::ftruncate(fd,off_t(bytes)) != 0) {
+          ::close(fd);
+          throw anpi::Exception("Cannot resize " + req.filename);
+        }
+      } else {
+        struct stat st;
+        if ((::fstat(fd,&st) != 0) || (size_t(st.st_size) != bytes)) {
+          ::close(fd);
+          throw anpi::Exception(req.filename + " does not have the size "
+                                "of the matrix with this row padding");
+        }
+      }
+
+      // Read-only files are mapped copy-on-write
+      void* base = ::mmap(nullptr,bytes,PROT_READ | PROT_WRITE,
+                          (req.mode == ReadOnly) ? MAP_PRIVATE : MAP_SHARED,
+                          fd,0);
+      ::close(fd);
+      if (base == MAP_FAILED) {
+        throw anpi::Exception("Cannot map " + req.filename);
+      }
+
+      char* cbase = static_cast<char*>(base);
+      if (req.mode == Create) {
+        std::memcpy(cbase,&h,sizeof(file::header));
+      } else {
+        file::header fh;
+        std::memcpy(&fh,cbase,sizeof(file::header));
+        if ((fh.rows != h.rows) || (fh.cols != h.cols) ||
+            (fh.dcols != h.dcols)) {
+          ::munmap(base,bytes);
+          throw anpi::Exception(req.filename + " does not have the row "
+                                "padding of this allocator");
+        }
+      }
+
+      T* data = reinterpret_cast<T*>(cbase + file::DataOffset);
+      std::lock_guard<std::mutex> lock(detail::mutex());
+      detail::regions()[data] = detail::region{base,bytes};
+      return data;
+    }
+
+    /// Unmap the file whose first entry is at data, if any
+    inline bool unmap(const void* data) {
+      detail::region r;
+      {
+        std::lock_guard<std::mutex> lock(detail::mutex());
+        auto it = detail::regions().find(data);
+        if (it == detail::regions().end()) {
+          return false;
+        }
+        r = it->second;
+        detail::regions().erase(it);
+      }
+      ::munmap(r.base,r.bytes);
+      return true;
+    }
+
+    /**
+     * Write the changes of a mapped matrix to its file now, instead of
+     * whenever the operating system does it.
+     *
+     * @throws anpi::Exception if the matrix is not mapped
+     */
+    template<typename T,class Alloc>
+    void flush(const Matrix<T,Alloc>& m) {
+      detail::region r;
+      {
+        std::lock_guard<std::mutex> lock(detail::mutex());
+        auto it = detail::regions().find(m.data());
+        if (it == detail::regions().end()) {
+          throw anpi::Exception("Matrix is not mapped to a file");
+        }
+        r = it->second;
+      }
+      ::msync(r.base,r.bytes,MS_SYNC);
+    }
+#else
+    template<typename T>
+    T* map(const request& req,const size_t) {
+      throw anpi::Exception("Cannot map " + req.filename +
+                            ": memory mapping not supported");
+    }
+
+    inline bool unmap(const void*) {
+      return false;
+    }
+
+    template<typename T,class Alloc>
+    void flush(const Matrix<T,Alloc>&) {
+      throw anpi::Exception("Memory mapping not supported");
+    }
+#endif
+
+  } // namespace mapped
+
+  /**
+   * Allocator whose first allocation maps a file.
+   *
+   * Each allocator may carry a mapped::request; the first block it
+   * allocates is then the mapped file, and all others come from the
+   * aligned heap (e.g. copies of the matrix).  The matrices are
+   * created with mapped::createFile() and mapped::openFile().
+   *
+   * Like aligned_row_allocator it pads each row of a Matrix, and the
+   * padding is stored in the file as well.
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class mapped_file_allocator {
+  public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef mapped_file_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a row-aligned allocator
+    typedef std::true_type row_aligned;
+
+    /// Allocator using just the heap
+    mapped_file_allocator() noexcept {}
+
+    /// Allocator mapping the file of the given request
+    explicit mapped_file_allocator(const mapped::request& req)
+      : _request(std::make_shared<mapped::request>(req)) {}
+
+    template<class U>
+    mapped_file_allocator(const mapped_file_allocator<U,Align>& other)
+      noexcept : _request(other.fileRequest()) {}
+
+    /// Reserve n elements
+    pointer allocate(const size_type n) {
+      if (_request && !_request->done) {
+        _request->done = true;
+        return mapped::map<T>(*_request,n);
+      }
+
+      void* ptr =
+        boost::alignment::aligned_alloc(std::max(Align,alignof(T)),n*sizeof(T));
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(ptr);
+    }
+
+    /// Release the n elements at ptr
+    void deallocate(pointer ptr,size_type) noexcept {
+      if (!mapped::unmap(ptr)) {
+        boost::alignment::aligned_free(ptr);
+      }
+    }
+
+    /// Pending request, if any
+    const std::shared_ptr<mapped::request>& fileRequest() const {
+      return _request;
+    }
+
+  private:
+    std::shared_ptr<mapped::request> _request;
+  };
+
+  // Any of these allocators can release the blocks of the others
+  template<class T,class U,std::size_t A>
+  inline bool operator==(const mapped_file_allocator<T,A>&,
+                         const mapped_file_allocator<U,A>&) noexcept {
+    return true;
+  }
+
+  template<class T,class U,std::size_t A>
+  inline bool operator!=(const mapped_file_allocator<T,A>&,
+                         const mapped_file_allocator<U,A>&) noexcept {
+    return false;
+  }
+
+  // Specialization for the mapped_file_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::mapped_file_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+  /**
+   * Type of the matrices mapped to files, with entries of type T
+   */
+  template<typename T>
+  struct mapped_matrix {
+    typedef Matrix<T,mapped_file_allocator<T> > type;
+  };
+
+  namespace mapped {
+
+    /**
+     * Create (or truncate) a file holding a rows x cols matrix and map
+     * it.  The entries are not initialized: a new file reads as zeros.
+     * Empty matrices do not create any file.
+     *
+     * @throws anpi::Exception if the file cannot be created
+     */
+    template<typename T>
+    typename mapped_matrix<T>::type createFile(const std::string& filename,
+                                               const size_t rows,
+                                               const size_t cols) {
+      typedef typename mapped_matrix<T>::type matrix_type;
+      const mapped::request req{filename,Create,rows,cols,false};
+      return matrix_type(rows,cols,DoNotInitialize,
+                         typename matrix_type::allocator_type(req));
+    }
+
+    /**
+     * Map an existing matrix file, read-only or read-write.
+     *
+     * @throws anpi::Exception if the file cannot be opened, or holds
+     *         another type or another row padding
+     */
+    template<typename T>
+    typename mapped_matrix<T>::type openFile(const std::string& filename,
+                                             const Mode mode = ReadOnly) {
+      typedef typename mapped_matrix<T>::type matrix_type;
+
+      if (mode == Create) {
+        throw anpi::Exception("Use createFile() to create " + filename);
+      }
+
+      file::header h;
+#ifdef ANPI_HAS_MMAP
+      const int fd = ::open(filename.c_str(),O_RDONLY);
+      if (fd < 0) {
+        throw anpi::Exception("Cannot open " + filename);
+      }
+      const ssize_t got = ::read(fd,&h,sizeof(file::header));
+      ::close(fd);
+      if (got != ssize_t(sizeof(file::header))) {
+        throw anpi::Exception(filename + " is not a matrix file");
+      }
+#else
+      throw anpi::Exception("Memory mapping not supported");
+#endif
+      file::checkHeader<T>(h,filename);
+
+      const mapped::request req{filename,mode,size_t(h.rows),size_t(h.cols),
+                                false};
+      return matrix_type(size_t(h.rows),size_t(h.cols),DoNotInitialize,
+                         typename matrix_type::allocator_type(req));
+    }
+
+  } // namespace mapped
+} // namespace anpi
+
+#endif
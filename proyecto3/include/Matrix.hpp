@@ -11,10 +11,15 @@
 #ifndef ANPI_MATRIX_HPP
 #define ANPI_MATRIX_HPP
 
+#include <cmath>
+#include <complex>
 #include <cstddef>
 #include <cstring>
 #include <cassert>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <initializer_list>
@@ -22,6 +27,9 @@
 #include <AnpiConfig.hpp>
 #include <Allocator.hpp>
 #include "Exception.hpp"
+#include "Half.hpp"
+#include "MatrixLayout.hpp"
+#include "MatrixView.hpp"
 #include <typeinfo>
 
 namespace anpi
@@ -32,9 +40,14 @@ namespace anpi
   enum InitializationType {
     DoNotInitialize
   };
+
+  namespace expr {
+    // Lazy element-wise expressions (see bits/MatrixExpression.hpp)
+    template<class E> class MatrixExpression;
+  }
   
   /**
-   * Row-major matrix class.
+   * Matrix class, row-major by default.
    *
    * The allocator is used to reserve the memory.  If the allocator
    * has a static const attribute named Alignment, then each row is
@@ -47,14 +60,25 @@ namespace anpi
    * use anpi::aligned_allocator and for forcing the alignment of each
    * row you can use anpi::aligned_row_allocator, both defined in
    * <Allocator.hpp>.
+   *
+   * With the Layout anpi::ColMajor the columns are stored contiguously
+   * instead, and they are the ones padded: dcols() is then the leading
+   * dimension of the columns, and operator[] returns a column.  The
+   * element-wise operations, reductions, products and transpositions
+   * accept both layouts; the decompositions and solvers are written
+   * for the default anpi::RowMajor.
    */
-  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
+  template<typename T,
+           class Alloc=anpi::aligned_row_allocator<T>,
+           class Layout=RowMajor>
   class Matrix {
   public:   
     /**
      * @name Standard types
      */
     //@{
+    typedef Layout layout_type;
+
     typedef typename std::allocator_traits<Alloc>::template
       rebind_alloc<T> allocator_type;
 
@@ -85,11 +109,13 @@ namespace anpi
       /// Effective number of columns
       size_t _cols;
       
-      /// Dominant (real) number of columns
+      /// Dominant (real) number of columns, or of rows for ColMajor
       size_t _dcols;
 
       /// Return the total number of entries (i.e. real buffer size)
-      inline size_t tentries() const {return _rows*_dcols;}
+      inline size_t tentries() const {
+        return Layout::lines(_rows,_cols)*_dcols;
+      }
 
       /// Alignment in use for the rows
       static constexpr size_t alignment =
@@ -144,15 +170,15 @@ namespace anpi
                     const size_t _cols,
                     const const_pointer _initMem,
                     const allocator_type& _a);
-    Matrix(const Matrix<T,Alloc>& _other);
-    Matrix(const Matrix<T,Alloc>& _other,const allocator_type& _a);
-    template<class OAlloc>
-    Matrix(const Matrix<T,OAlloc>& _other);
-    template<class OAlloc>
-    Matrix(const Matrix<T,OAlloc>& _other,const allocator_type& _a);
+    Matrix(const Matrix& _other);
+    Matrix(const Matrix& _other,const allocator_type& _a);
+    template<class OAlloc,class OLayout>
+    Matrix(const Matrix<T,OAlloc,OLayout>& _other);
+    template<class OAlloc,class OLayout>
+    Matrix(const Matrix<T,OAlloc,OLayout>& _other,const allocator_type& _a);
     Matrix(allocator_type&& _a) noexcept;
-    Matrix(Matrix<T,Alloc>&& _other);
-    Matrix(Matrix<T,Alloc>&& _other,const allocator_type& _a);
+    Matrix(Matrix&& _other);
+    Matrix(Matrix&& _other,const allocator_type& _a);
     ~Matrix() noexcept;
     
     /**
@@ -167,65 +193,92 @@ namespace anpi
     Matrix(std::initializer_list< std::initializer_list<value_type> > _lst);
     Matrix(std::initializer_list< std::initializer_list<value_type> > _lst,
            const allocator_type& _a);
+
+    /**
+     * Constructs a matrix evaluating an element-wise expression
+     *
+     * This allows to evaluate sums and differences of several matrices
+     * in just one pass, without temporaries:
+     *
+     * \code
+     * anpi::Matrix<float> r = a + b - c;
+     * \endcode
+     */
+    template<class E>
+    Matrix(const expr::MatrixExpression<E>& _expr);
+
+    /**
+     * Constructs a matrix with a copy of the entries of a view
+     */
+    template<typename U,class OLayout>
+    explicit Matrix(const MatrixView<U,OLayout>& _view);
     
     //@}
     
     /**
      * Deep copy another matrix of exactly the same type
      */
-    Matrix<T,Alloc>& operator=(const Matrix<T,Alloc>& other);
+    Matrix& operator=(const Matrix& other);
 
     /**
      * Deep copy another matrix with a different allocator
      */
-    template<class OAlloc>
-    Matrix<T,Alloc>& operator=(const Matrix<T,OAlloc>& other);
+    template<class OAlloc,class OLayout>
+    Matrix& operator=(const Matrix<T,OAlloc,OLayout>& other);
 
     /**
      * Move assignment operator
      */
-    Matrix<T,Alloc>& operator=(Matrix<T,Alloc>&& other);
+    Matrix& operator=(Matrix&& other);
+
+    /**
+     * Evaluate an element-wise expression into this matrix
+     *
+     * The expression may refer to this matrix as well.
+     */
+    template<class E>
+    Matrix& operator=(const expr::MatrixExpression<E>& _expr);
 
     /**
      * Compare two matrices for equality
      *
      * This is slow, as all componentes are elementwise compared
      */
-    bool operator==(const Matrix<T,Alloc>& other) const;
+    bool operator==(const Matrix& other) const;
 
     /**
      * Compare two matrices for equality
      *
      * This is slow, as all componentes are elementwise compared
      */
-    bool operator!=(const Matrix<T,Alloc>& other) const;
+    bool operator!=(const Matrix& other) const;
     
-    /// Return pointer to a given row
-    inline T* operator[](const size_t row) {
-      return this->_impl._data + row * this->_impl._dcols;
+    /// Return pointer to a given row (to a given column for ColMajor)
+    inline T* operator[](const size_t line) {
+      return this->_impl._data + line * this->_impl._dcols;
     }
 
-    /// Return read-only pointer to a given row
-    const T* operator[](const size_t row) const {
-      return this->_impl._data + row * this->_impl._dcols;
+    /// Return read-only pointer to a given row (column for ColMajor)
+    const T* operator[](const size_t line) const {
+      return this->_impl._data + line * this->_impl._dcols;
     }
 
     /// Return reference to the element at the r row and c column
     T& operator()(const size_t row,const size_t col) {
       return *(this->_impl._data +
-               (row*this->_impl._dcols + col));
+               Layout::offset(row,col,this->_impl._dcols));
     }
 
     /// Return const reference to the element at the r row and c column
     const T& operator()(const size_t row,const size_t col) const {
       return *(this->_impl._data +
-               (row*this->_impl._dcols + col));
+               Layout::offset(row,col,this->_impl._dcols));
     }
 
     /**
      * Swap the contents of the other matrix with this one
      */
-    void swap(Matrix<T,Alloc>& other);
+    void swap(Matrix& other);
     
     /**
      * Allocate memory for the given number of rows and cols
@@ -239,6 +292,9 @@ namespace anpi
     
     /**
      * Fill all elements of the matrix with the given value
+     *
+     * Large matrices are filled in parallel (see
+     * anpi::parallel::firstTouchThreshold()).
      */
     void fill(const T val);
 
@@ -253,11 +309,18 @@ namespace anpi
 
     /**
      * Fill this matrix with the content of the other matrix.  Even if
-     * the padding of both matrices differ, the content will be
-     * appropriately copied.
+     * the padding or the layout of both matrices differ, the content
+     * will be appropriately copied.
+     */
+    template<class OAlloc,class OLayout>
+    void fill(const Matrix<T,OAlloc,OLayout>& _other);
+
+    /**
+     * Fill this matrix with the content of a view, or of anything that
+     * converts to one, like anpi::FixedMatrix.  As above, only the
+     * overlapping entries are copied.
      */
-    template<class OAlloc>
-    void fill(const Matrix<T,OAlloc>& _other);
+    void fill(const MatrixView<const T>& _view);
 
     /**
      * Check if the matrix is empty (zero rows or columns)
@@ -282,12 +345,28 @@ namespace anpi
     }
 
     /**
-     * Number of number of columns including padding
+     * Number of number of columns including padding.  For ColMajor,
+     * number of rows including padding.
      */
     inline size_t dcols() const {
       return this->_impl._dcols;
     }
 
+    /**
+     * Number of rows, or of columns for ColMajor.  The buffer holds
+     * lines()*dcols() entries.
+     */
+    inline size_t lines() const {
+      return Layout::lines(this->_impl._rows,this->_impl._cols);
+    }
+
+    /**
+     * Number of columns, or of rows for ColMajor (without padding)
+     */
+    inline size_t lineLength() const {
+      return Layout::lineLength(this->_impl._rows,this->_impl._cols);
+    }
+
     
     /**
      * Total number of entries (rows x cols)
@@ -310,8 +389,73 @@ namespace anpi
      * Extract one particular column
      *
      * This method has to copy the column, and hence it is relatively slow
+     * (except for ColMajor, where the column is contiguous)
      */
     inline std::vector<value_type> column(const size_t col) const;
+
+    /**
+     * @name Views
+     *
+     * Non-owning views of the whole matrix or of a block of it, which
+     * do not copy any entry (see anpi::MatrixView).  They are
+     * invalidated if the matrix is reallocated.
+     */
+    //@{
+    typedef MatrixView<T,Layout>       view_type;
+    typedef MatrixView<const T,Layout> const_view_type;
+
+    /// View of the whole matrix
+    inline view_type view() {
+      return view_type(data(),rows(),cols(),dcols());
+    }
+
+    /// Read-only view of the whole matrix
+    inline const_view_type view() const {
+      return const_view_type(data(),rows(),cols(),dcols());
+    }
+
+    /// A matrix can be passed wherever a view is expected
+    inline operator view_type() {
+      return view();
+    }
+
+    /// A matrix can be passed wherever a read-only view is expected
+    inline operator const_view_type() const {
+      return view();
+    }
+
+    /// View of the rows x cols block starting at (row,col)
+    inline view_type block(const size_t row,const size_t col,
+                           const size_t rows,const size_t cols) {
+      return view().block(row,col,rows,cols);
+    }
+
+    /// Read-only view of the rows x cols block starting at (row,col)
+    inline const_view_type block(const size_t row,const size_t col,
+                                 const size_t rows,const size_t cols) const {
+      return view().block(row,col,rows,cols);
+    }
+
+    /// View of n rows starting at the given one
+    inline view_type rowRange(const size_t row,const size_t n) {
+      return view().rowRange(row,n);
+    }
+
+    /// Read-only view of n rows starting at the given one
+    inline const_view_type rowRange(const size_t row,const size_t n) const {
+      return view().rowRange(row,n);
+    }
+
+    /// View of n columns starting at the given one
+    inline view_type colRange(const size_t col,const size_t n) {
+      return view().colRange(col,n);
+    }
+
+    /// Read-only view of n columns starting at the given one
+    inline const_view_type colRange(const size_t col,const size_t n) const {
+      return view().colRange(col,n);
+    }
+    //@}
     
     /**
      * @name Arithmetic operators
@@ -323,19 +467,57 @@ namespace anpi
 
     /// Subtract another matrix to this one, and leave the result in here
     Matrix& operator-=(const Matrix& other);
+
+    /// Sum an expression to this matrix, in one pass
+    template<class E>
+    Matrix& operator+=(const expr::MatrixExpression<E>& _expr);
+
+    /// Subtract an expression to this matrix, in one pass
+    template<class E>
+    Matrix& operator-=(const expr::MatrixExpression<E>& _expr);
     
     //@}
 
     /////////////////////////////////////////// Methods used in the QR implementation
 
-    void compute_minor(const Matrix<T,Alloc>& a, unsigned int d);
+    void compute_minor(const Matrix& a, unsigned int d);
 
     // take c-th column of m, put in v
     //template<typename T>
     //void extract_column(std::vector<T>& v, int c);
 
+    /**
+     * Transpose this matrix.
+     *
+     * Square matrices are transposed in place.  Rectangular ones are
+     * transposed into a new buffer, which then replaces the current one.
+     */
     void transpose();
 
+    /**
+     * Write the transpose of this matrix into dst, which is resized if
+     * necessary.
+     */
+    void transposed(Matrix& dst) const;
+
+    /**
+     * Save the matrix in the binary format of MatrixFile.hpp, padding
+     * included, so that it can be loaded or mapped without parsing.
+     * The files are row-major: ColMajor matrices are converted.
+     *
+     * @throws anpi::Exception if the file cannot be written
+     */
+    void save(const std::string& filename) const;
+
+    /**
+     * Load a matrix saved with save().  The file may come from a
+     * matrix with another row padding.
+     *
+     * @throws anpi::Exception if the file cannot be read or holds
+     *         entries of another type
+     */
+    void load(const std::string& filename);
+
   private:
 
     // Call the memory deallocation 
@@ -351,6 +533,9 @@ namespace anpi
     /// Read-only reference to the allocator in use
     const allocator_type& _get_allocator() const noexcept;    
 
+    /// Number of threads used by fill() for this matrix
+    int _fillThreads() const;
+
     /**
      * Fill with an initializer list
      */
@@ -360,24 +545,259 @@ namespace anpi
 
   /// @name External arithmetic operators for matrices
   //@{
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b);
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator-(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b);
+  // The operators + and - return lazy expressions, evaluated when
+  // assigned to a matrix.  They are defined in bits/MatrixExpression.hpp
 
   // Tarea 4
   template<typename T,class Alloc>
   Matrix<T,Alloc> operator*(const Matrix<T,Alloc>& a,
                             const Matrix<T,Alloc>& b);
 
-  // Tarea 4
+  /**
+   * Product of column-major matrices, computed by the row-major
+   * kernels as c^T = b^T a^T on the same memory
+   */
   template<typename T,class Alloc>
-  std::vector<T> operator*(const Matrix<T,Alloc>& a,
+  Matrix<T,Alloc,ColMajor> operator*(const Matrix<T,Alloc,ColMajor>& a,
+                                     const Matrix<T,Alloc,ColMajor>& b);
+
+  // Tarea 4
+  template<typename T,class Alloc,class Layout>
+  std::vector<T> operator*(const Matrix<T,Alloc,Layout>& a,
 			   const std::vector<T>& b);
   //@}
+
+  /**
+   * Matrix-vector product y = alpha*a*x + beta*y
+   *
+   * The result is written into the given vector y, which is resized
+   * only if beta is zero and its size does not match a.rows().  Hence,
+   * repeated products in iterative loops do not allocate any memory.
+   * If beta is zero the previous content of y is ignored.
+   *
+   * @throws anpi::Exception if the sizes of a, x and y do not match.
+   */
+  template<typename T,class Alloc>
+  void gemv(const Matrix<T,Alloc>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const typename Matrix<T,Alloc>::value_type alpha = T(1),
+            const typename Matrix<T,Alloc>::value_type beta  = T(0));
+
+  /**
+   * Matrix-vector product y = alpha*a*x + beta*y for a column-major a,
+   * which is streamed one column after the other with axpy.  As above.
+   */
+  template<typename T,class Alloc>
+  void gemv(const Matrix<T,Alloc,ColMajor>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const typename Matrix<T,Alloc>::value_type alpha = T(1),
+            const typename Matrix<T,Alloc>::value_type beta  = T(0));
+
+  /**
+   * @name Level-1 operations
+   *
+   * Element-wise operations on matrices and on vectors, computed with
+   * the SIMD kernels of bits/MatrixBlas1.hpp for float and double, and
+   * in float registers with those of bits/MatrixHalf.hpp for the 16
+   * bit storage types anpi::half and anpi::bfloat16.  The results may
+   * be written into any of the operands.
+   */
+  //@{
+
+  /// Scale all entries: a = alpha*a
+  template<typename T,class Alloc,class Layout>
+  void scale(Matrix<T,Alloc,Layout>& a,
+             const typename Matrix<T,Alloc,Layout>::value_type alpha);
+
+  /// Scale all entries: x = alpha*x
+  template<typename T>
+  void scale(std::vector<T>& x,
+             const typename std::vector<T>::value_type alpha);
+
+  /**
+   * y = alpha*x + y
+   *
+   * @throws anpi::Exception if the sizes of x and y differ.
+   */
+  template<typename T,class Alloc,class Layout>
+  void axpy(const typename Matrix<T,Alloc,Layout>::value_type alpha,
+            const Matrix<T,Alloc,Layout>& x,
+            Matrix<T,Alloc,Layout>& y);
+
+  /**
+   * y = alpha*x + y
+   *
+   * @throws anpi::Exception if the sizes of x and y differ.
+   */
+  template<typename T>
+  void axpy(const typename std::vector<T>::value_type alpha,
+            const std::vector<T>& x,
+            std::vector<T>& y);
+
+  /**
+   * Element-wise product c = a.*b.  The result c is resized if needed.
+   *
+   * @throws anpi::Exception if the sizes of a and b differ.
+   */
+  template<typename T,class Alloc,class Layout>
+  void hadamard(const Matrix<T,Alloc,Layout>& a,
+                const Matrix<T,Alloc,Layout>& b,
+                Matrix<T,Alloc,Layout>& c);
+
+  /// Element-wise product c = a.*b of vectors, see above
+  template<typename T>
+  void hadamard(const std::vector<T>& a,
+                const std::vector<T>& b,
+                std::vector<T>& c);
+
+  /**
+   * Element-wise quotient c = a./b.  The result c is resized if needed.
+   *
+   * @throws anpi::Exception if the sizes of a and b differ.
+   */
+  template<typename T,class Alloc,class Layout>
+  void divide(const Matrix<T,Alloc,Layout>& a,
+              const Matrix<T,Alloc,Layout>& b,
+              Matrix<T,Alloc,Layout>& c);
+
+  /// Element-wise quotient c = a./b of vectors, see above
+  template<typename T>
+  void divide(const std::vector<T>& a,
+              const std::vector<T>& b,
+              std::vector<T>& c);
+
+  /**
+   * Element-wise multiply-add d = a.*b + c, rounded once per entry
+   * where the processor has FMA instructions.  The result d is resized
+   * if needed.
+   *
+   * @throws anpi::Exception if the sizes of a, b and c differ.
+   */
+  template<typename T,class Alloc,class Layout>
+  void fmadd(const Matrix<T,Alloc,Layout>& a,
+             const Matrix<T,Alloc,Layout>& b,
+             const Matrix<T,Alloc,Layout>& c,
+             Matrix<T,Alloc,Layout>& d);
+
+  /// Element-wise multiply-add d = a.*b + c of vectors, see above
+  template<typename T>
+  void fmadd(const std::vector<T>& a,
+             const std::vector<T>& b,
+             const std::vector<T>& c,
+             std::vector<T>& d);
+
+  /**
+   * Element-wise conversion b = a to another entry type, e.g. to store
+   * a float matrix as anpi::half or to widen it back.  b is resized if
+   * necessary.
+   */
+  template<typename S,typename T,class AllocS,class AllocT,class Layout>
+  void convert(const Matrix<S,AllocS,Layout>& a,
+               Matrix<T,AllocT,Layout>& b);
+  //@}
+
+  /// Type of the magnitude |x| of an entry of type T (double for
+  /// std::complex<double>, T for the real types)
+  template<typename T>
+  struct norm_type {
+    typedef typename std::decay<decltype(std::abs(std::declval<T>()))>::type
+      type;
+  };
+
+  /**
+   * @name Reductions
+   *
+   * Computed with the SIMD kernels of bits/MatrixReduce.hpp for float
+   * and double, split among the threads for large inputs (see
+   * anpi::parallel::reduceThreshold()).  The order of the additions
+   * differs from a plain loop, and so may the rounding.
+   *
+   * The sums are accumulated and returned in the accumulator_type of
+   * the entries: float for anpi::half and anpi::bfloat16.
+   */
+  //@{
+
+  /**
+   * Dot product x^T y (without conjugation for complex entries)
+   *
+   * @throws anpi::Exception if the sizes of x and y differ.
+   */
+  template<typename T>
+  typename accumulator_type<T>::type dot(const std::vector<T>& x,
+                                         const std::vector<T>& y);
+
+  /// Sum of all entries
+  template<typename T>
+  typename accumulator_type<T>::type sum(const std::vector<T>& x);
+
+  /// Sum of all entries
+  template<typename T,class Alloc,class Layout>
+  typename accumulator_type<T>::type sum(const Matrix<T,Alloc,Layout>& a);
+
+  /// Squared Euclidean norm, i.e. the sum of |x_i|^2
+  template<typename T>
+  typename norm_type<T>::type squaredNorm(const std::vector<T>& x);
+
+  /// Squared Frobenius norm, i.e. the sum of |a_ij|^2
+  template<typename T,class Alloc,class Layout>
+  typename norm_type<T>::type squaredNorm(const Matrix<T,Alloc,Layout>& a);
+
+  /**
+   * Index of the entry with the largest magnitude, the first one if
+   * several are equal.  Zero for empty vectors.
+   */
+  template<typename T>
+  size_t iamax(const std::vector<T>& x);
+  //@}
+
+  /**
+   * @name Operations on views
+   *
+   * The results are written into the given view c, which must already
+   * have the right size.  Both operands may be read-only or mutable
+   * views of the same element type.
+   */
+  //@{
+
+  /**
+   * Element-wise sum c = a + b, where c may be a or b
+   *
+   * @throws anpi::Exception if the sizes of a, b and c differ.
+   */
+  template<typename TA,typename TB,typename T>
+  void add(const MatrixView<TA>& a,
+           const MatrixView<TB>& b,
+           const MatrixView<T>& c);
+
+  /**
+   * Element-wise difference c = a - b, where c may be a or b
+   *
+   * @throws anpi::Exception if the sizes of a, b and c differ.
+   */
+  template<typename TA,typename TB,typename T>
+  void subtract(const MatrixView<TA>& a,
+                const MatrixView<TB>& b,
+                const MatrixView<T>& c);
+
+  /**
+   * Matrix product c = alpha*a*b + beta*c
+   *
+   * The view c must not overlap a or b.  If beta is zero the previous
+   * content of c is ignored.  With alpha=-1 and beta=1 this is the
+   * Schur complement update of the blocked factorizations.
+   *
+   * @throws anpi::Exception if the sizes of a, b and c do not match.
+   */
+  template<typename TA,typename TB,typename T>
+  void gemm(const MatrixView<TA>& a,
+            const MatrixView<TB>& b,
+            const MatrixView<T>& c,
+            const typename MatrixView<T>::value_type alpha = T(1),
+            const typename MatrixView<T>::value_type beta  = T(0));
+  //@}
   
 } // namespace ANPI
 
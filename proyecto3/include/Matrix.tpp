@@ -8,7 +8,17 @@
  * @Date:   28.12.2017
  */
 
+#include <algorithm>
+
+#include "MatrixFile.hpp"
+#include "Parallel.hpp"
 #include "bits/MatrixArithmetic.hpp"
+#include "bits/MatrixMultiply.hpp"
+#include "bits/MatrixExpression.hpp"
+#include "bits/MatrixTranspose.hpp"
+#include "bits/MatrixBlas1.hpp"
+#include "bits/MatrixReduce.hpp"
+#include "bits/MatrixHalf.hpp"
 
 namespace anpi
 {
@@ -17,23 +27,23 @@ namespace anpi
   // Implementation of Matrix::_Matrix_impl
   // -------------------------------------------
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::_Matrix_impl::_Matrix_impl()
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::_Matrix_impl::_Matrix_impl()
     : allocator_type(), _data(), _rows(), _cols(), _dcols() { }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::_Matrix_impl::
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::_Matrix_impl::
   _Matrix_impl(allocator_type const& _a) noexcept
     : allocator_type(_a), _data(), _rows(), _cols(), _dcols() { }
       
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::_Matrix_impl::
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::_Matrix_impl::
   _Matrix_impl(allocator_type&& _a) noexcept
     : allocator_type(std::move(_a)),
       _data(), _rows(), _cols(), _dcols() { }
   
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::_Matrix_impl::
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::_Matrix_impl::
   _swap_data(_Matrix_impl& _x) noexcept {
     std::swap(_data,  _x._data);
     std::swap(_rows,  _x._rows);
@@ -45,23 +55,23 @@ namespace anpi
   // Implementation of Matrix
   // ------------------------
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix() : _impl() {}
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix() : _impl() {}
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const allocator_type& _a) noexcept
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const allocator_type& _a) noexcept
     : _impl(_a) { }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const value_type _initVal)
     : Matrix(_rows,_cols,DoNotInitialize) {
     fill(_initVal);
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const value_type _initVal,
                           const allocator_type& _a)
@@ -70,16 +80,16 @@ namespace anpi
   }
 
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const InitializationType)
     : _impl() {
     _create_storage(_rows,_cols);
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const InitializationType,
                           const allocator_type& _a)
@@ -91,16 +101,16 @@ namespace anpi
    * Construct a matrix rows x cols and initialize all
    * elements with the memory content at the given pointer
    */
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const const_pointer _initMem)
     : Matrix(_rows,_cols,DoNotInitialize) {
     fill(_initMem);
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const size_t _rows,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const size_t _rows,
                           const size_t _cols,
                           const const_pointer _initMem,
                           const allocator_type& _a)
@@ -108,8 +118,8 @@ namespace anpi
     fill(_initMem);
   }
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::
   Matrix(std::initializer_list< std::initializer_list<value_type> > _lst)
     : Matrix(_lst.size(),
              (_lst.size()>0) ? _lst.begin()->size() : 0,
@@ -117,8 +127,8 @@ namespace anpi
     fill(_lst);
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::
   Matrix(std::initializer_list< std::initializer_list<value_type> > _lst,
          const allocator_type& _a)
     : Matrix(_lst.size(),
@@ -128,46 +138,61 @@ namespace anpi
   }
   
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const Matrix<T,Alloc>& _other)
+  template<typename T,class Alloc,class Layout>
+  template<class E>
+  Matrix<T,Alloc,Layout>::Matrix(const expr::MatrixExpression<E>& _expr)
+    : _impl() {
+    ::anpi::aimpl::evaluate(*this,_expr);
+  }
+
+  template<typename T,class Alloc,class Layout>
+  template<typename U,class OLayout>
+  Matrix<T,Alloc,Layout>::Matrix(const MatrixView<U,OLayout>& _view)
+    : Matrix(_view.rows(),_view.cols(),DoNotInitialize) {
+
+    view().assign(_view);
+  }
+
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const Matrix<T,Alloc,Layout>& _other)
     : Matrix(_other.rows(),_other.cols(),DoNotInitialize) {
     
     fill(_other.data());
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(const Matrix<T,Alloc>& _other,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(const Matrix<T,Alloc,Layout>& _other,
                           const allocator_type& _a)
     : Matrix(_other.rows(),_other.cols(),DoNotInitialize,_a) {
     
     fill(_other.data());
   }
 
-  template<typename T,class Alloc>
-  template<class OAlloc>
-  Matrix<T,Alloc>::Matrix(const Matrix<T,OAlloc>& _other)
+  template<typename T,class Alloc,class Layout>
+  template<class OAlloc,class OLayout>
+  Matrix<T,Alloc,Layout>::Matrix(const Matrix<T,OAlloc,OLayout>& _other)
     : Matrix(_other.rows(),_other.cols(),DoNotInitialize) {
     
     fill(_other);
   }
 
-  template<typename T,class Alloc>
-  template<class OAlloc>
-  Matrix<T,Alloc>::Matrix(const Matrix<T,OAlloc>& _other,
+  template<typename T,class Alloc,class Layout>
+  template<class OAlloc,class OLayout>
+  Matrix<T,Alloc,Layout>::Matrix(const Matrix<T,OAlloc,OLayout>& _other,
                           const allocator_type& _a)
     : Matrix(_other.rows(),_other.cols(),DoNotInitialize,_a) {
     
     fill(_other);
   }
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(Matrix<T,Alloc>&& _other)
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(Matrix<T,Alloc,Layout>&& _other)
     : _impl(std::move(_other._get_allocator())) {
     this->_impl._swap_data(_other._impl);
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(Matrix<T,Alloc>&& _other,
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(Matrix<T,Alloc,Layout>&& _other,
                           const allocator_type& _a)
     : _impl(_a) {
 
@@ -178,35 +203,38 @@ namespace anpi
     }
   }
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::Matrix(allocator_type&& _a) noexcept
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::Matrix(allocator_type&& _a) noexcept
     : _impl(std::move(_a)) { }
 
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>::~Matrix() noexcept {
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::~Matrix() noexcept {
     _deallocate();
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>& Matrix<T,Alloc>::operator=(const Matrix<T,Alloc>& other) {
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator=(const Matrix<T,Alloc,Layout>& other) {
     allocate(other._impl._rows, other._impl._cols);
     fill(other.data());
 
     return *this;
   }
 
-  template<typename T,class Alloc>
-  template<class OAlloc>
-  Matrix<T,Alloc>& Matrix<T,Alloc>::operator=(const Matrix<T,OAlloc>& other) {
+  template<typename T,class Alloc,class Layout>
+  template<class OAlloc,class OLayout>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator=(const Matrix<T,OAlloc,OLayout>& other) {
     allocate(other.rows(), other.cols());
     fill(other);
 
     return *this;
   }
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>& Matrix<T,Alloc>::operator=(Matrix<T,Alloc>&& other) {
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator=(Matrix<T,Alloc,Layout>&& other) {
     if (this->data() != other.data() ) { // alias detection first
       this->_impl._swap_data(other._impl);
     }
@@ -214,8 +242,17 @@ namespace anpi
     return *this;
   }
   
-  template<typename T,class Alloc>
-  bool Matrix<T,Alloc>::operator==(const Matrix<T,Alloc>& other) const {
+  template<typename T,class Alloc,class Layout>
+  template<class E>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator=(const expr::MatrixExpression<E>& _expr) {
+    ::anpi::aimpl::evaluate(*this,_expr);
+    return *this;
+  }
+
+  template<typename T,class Alloc,class Layout>
+  bool
+  Matrix<T,Alloc,Layout>::operator==(const Matrix<T,Alloc,Layout>& other) const {
     if (&other==this) return true; // alias detection
 
     // same size of matrices?
@@ -223,36 +260,37 @@ namespace anpi
         (other.cols() != this->cols())) return false;
 
     // check the content with pointers
-    if (this->_impl._dcols == this->_impl._cols)
+    if (this->_impl._dcols == lineLength())
       return (memcmp(this->_impl._data,
                      other._impl._data,
                      this->_impl.tentries()*sizeof(T))==0);
 
     // we have to compare row by row, becase the padding may differ
-    for (size_t i=0;i<this->_impl._rows;++i) {
+    for (size_t i=0;i<lines();++i) {
       if (memcmp(this->operator[](i),
                  other[i],
-                 this->_impl._cols*sizeof(T))!=0) {
+                 lineLength()*sizeof(T))!=0) {
         return false;
       }
     }
     return true;
   }
 
-  template<typename T,class Alloc>
-  bool Matrix<T,Alloc>::operator!=(const Matrix<T,Alloc>& other) const {
+  template<typename T,class Alloc,class Layout>
+  bool
+  Matrix<T,Alloc,Layout>::operator!=(const Matrix<T,Alloc,Layout>& other) const {
     if (&other==this) return false; // alias detection
     
     return !operator==(other);
   }
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::swap(Matrix<T,Alloc>& other) {
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::swap(Matrix<T,Alloc,Layout>& other) {
     this->_impl._swap_data(other._impl);
   }
     
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::allocate(const size_t r,
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::allocate(const size_t r,
                                  const size_t c) {
     // only reserve iff the desired size is different to the current one
     if ( (r!=rows()) || (c!=cols()) ) {
@@ -261,14 +299,14 @@ namespace anpi
     }
   }
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::clear() {
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::clear() {
     _deallocate();
   }
 
   
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::_create_storage(size_t __rows,size_t __cols) {
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::_create_storage(size_t __rows,size_t __cols) {
 
     // ensure that the type T fits into the alignment
     static_assert( ( (_Matrix_impl::alignment <= sizeof(T) )
@@ -282,23 +320,27 @@ namespace anpi
 
     size_t n,dcols;
 
+    // rows and columns, or the other way around for ColMajor
+    const size_t __lines = Layout::lines(__rows,__cols);
+    const size_t __len   = Layout::lineLength(__rows,__cols);
+
     if (_Matrix_impl::rowAlign) {
-      // how many aligned "blocks" are required to hold __cols
-      const size_t blocks = (__cols*sizeof(T) + (_Matrix_impl::alignment-1) ) /
+      // how many aligned "blocks" are required to hold __len
+      const size_t blocks = (__len*sizeof(T) + (_Matrix_impl::alignment-1) ) /
                             _Matrix_impl::alignment;
       // dominant columns are determined by the # blocks per row
       dcols               = blocks*_Matrix_impl::alignment/sizeof(T);
       // total number of entries already padded
-      n                   = __rows*dcols;
+      n                   = __lines*dcols;
       
     } else { // do not align the rows, just the complete memory block
 
       // total number of blocks
       const size_t blocks
-        = (__cols*__rows*sizeof(T)+(_Matrix_impl::alignment-1) ) /
+        = (__len*__lines*sizeof(T)+(_Matrix_impl::alignment-1) ) /
           _Matrix_impl::alignment;
       // dominant columns is the same as columns in this case
-      dcols = __cols;
+      dcols = __len;
       // the total number of entries of type T to be allocated 
       n     = blocks*_Matrix_impl::alignment/sizeof(T);
     } 
@@ -315,8 +357,8 @@ namespace anpi
     this->_impl._dcols = dcols;
   }
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::_deallocate() {
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::_deallocate() {
     if (this->_impl._data) {
       std::allocator_traits<allocator_type>::deallocate(this->_impl,
                                                         this->_impl._data,
@@ -329,36 +371,69 @@ namespace anpi
     this->_impl._dcols = 0;
   }
 
-  template<typename T,class Alloc>
-  typename Matrix<T,Alloc>::allocator_type&
-  Matrix<T,Alloc>::_get_allocator() noexcept {
+  template<typename T,class Alloc,class Layout>
+  typename Matrix<T,Alloc,Layout>::allocator_type&
+  Matrix<T,Alloc,Layout>::_get_allocator() noexcept {
     return *static_cast<allocator_type*>(&this->_impl);
   }
     
-  template<typename T,class Alloc>
-  const typename Matrix<T,Alloc>::allocator_type&
-  Matrix<T,Alloc>::_get_allocator() const noexcept {
+  template<typename T,class Alloc,class Layout>
+  const typename Matrix<T,Alloc,Layout>::allocator_type&
+  Matrix<T,Alloc,Layout>::_get_allocator() const noexcept {
     return *static_cast<const allocator_type*>(&this->_impl);
   }
   
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::fill(const T val) {
-    T* end = this->_impl._data + ( this->_impl._rows * this->_impl._dcols );
-    for (T* ptr = this->_impl._data;ptr!=end;++ptr) {
-      *ptr = val;
+  /*
+   * The fill methods write large matrices in parallel, each thread a
+   * block of rows with the static schedule of the parallel kernels.
+   * Since they are normally the first to touch the memory of a new
+   * matrix, this places its pages on the NUMA nodes of those threads.
+   */
+  template<typename T,class Alloc,class Layout>
+  int Matrix<T,Alloc,Layout>::_fillThreads() const {
+    return (this->_impl.tentries() >= parallel::firstTouchThreshold())
+      ? parallel::numThreads() : 1;
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::fill(const T val) {
+    const size_t rows  = lines();
+    const size_t dcols = this->_impl._dcols;
+    const pointer data = this->_impl._data;
+    const int threads  = _fillThreads();
+
+    if (threads == 1) {
+      std::fill(data,data + this->_impl.tentries(),val);
+      return;
     }
 
-    // ACCELERATE ME!
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for (size_t i=0u;i<rows;++i) {
+      std::fill(data + i*dcols,data + (i+1)*dcols,val);
+    }
   }
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::fill(const T* mem) {
-    std::memcpy(this->_impl._data,mem,sizeof(T)*this->_impl.tentries());
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::fill(const T* mem) {
+    const size_t rows  = lines();
+    const size_t dcols = this->_impl._dcols;
+    const pointer data = this->_impl._data;
+    const int threads  = _fillThreads();
+
+    if (threads == 1) {
+      std::memcpy(data,mem,sizeof(T)*this->_impl.tentries());
+      return;
+    }
+
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for (size_t i=0u;i<rows;++i) {
+      std::memcpy(data + i*dcols,mem + i*dcols,sizeof(T)*dcols);
+    }
   }
 
-  template<typename T,class Alloc>
-  template<class OAlloc>
-  void Matrix<T,Alloc>::fill(const Matrix<T,OAlloc>& _other) {
+  template<typename T,class Alloc,class Layout>
+  template<class OAlloc,class OLayout>
+  void Matrix<T,Alloc,Layout>::fill(const Matrix<T,OAlloc,OLayout>& _other) {
 
     // we can only copy this number of rows
     const size_t r=std::min(_other.rows(),this->rows());
@@ -366,15 +441,37 @@ namespace anpi
     // we can only copy this number of columns
     const size_t c=std::min(_other.cols(),this->cols());
 
+    if (!std::is_same<Layout,OLayout>::value) {
+      // the lines of one layout are the columns of the other one
+      ::anpi::fallback::transposeCopy<T,::anpi::fallback::transpose_leaf<T> >
+        (_other.data(),_other.dcols(),data(),dcols(),
+         OLayout::lines(r,c),OLayout::lineLength(r,c));
+      return;
+    }
+
+    const size_t lines = Layout::lines(r,c);
+    const size_t len   = Layout::lineLength(r,c);
+    const int threads  = _fillThreads();
+    (void)threads; // only read by OpenMP
+
     // copy each row separately, ignoring the differences of sizes
-    for (size_t i=0u;i<r;++i) {
-      std::memcpy(this->operator[](i),_other[i],sizeof(value_type)*c);
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+    for (size_t i=0u;i<lines;++i) {
+      std::memcpy(this->operator[](i),_other[i],sizeof(value_type)*len);
     }
   }
 
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::fill(const MatrixView<const T>& _view) {
+    const size_t r=std::min(_view.rows(),this->rows());
+    const size_t c=std::min(_view.cols(),this->cols());
+
+    view().block(0,0,r,c).assign(_view.block(0,0,r,c));
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::
   fill(const std::initializer_list< std::initializer_list<value_type> >& lst) {
 
     const size_t r = lst.size();
@@ -383,67 +480,70 @@ namespace anpi
     assert(r==rows() && "Check number of rows");
     assert(c==cols() && "Check number of cols");
 
-    pointer rowPtr = this->_impl._data;
+    size_t i=0u;
     for (const auto& r : lst) {
-      pointer ptr=rowPtr;
-      
+      size_t j=0u;
       for (const auto& c : r) {
-        *ptr++ = c;
+        (*this)(i,j++) = c;
       }
-      rowPtr += this->_impl._dcols;
+      ++i;
     }
   }
 
-  template<typename T,class Alloc>
-  std::vector< typename Matrix<T,Alloc>::value_type >
-  Matrix<T,Alloc>::column(const size_t col) const {
+  template<typename T,class Alloc,class Layout>
+  std::vector< typename Matrix<T,Alloc,Layout>::value_type >
+  Matrix<T,Alloc,Layout>::column(const size_t col) const {
     
-    std::vector< typename Matrix<T,Alloc>::value_type > vct(this->_impl._rows);
+    std::vector<value_type> vct(this->_impl._rows);
 
-    const_pointer ptr = this->_impl._data + col;    
-    for (auto it=vct.begin(); it!=vct.end(); ++it, ptr+=this->_impl._dcols) {
+    const size_t dcols = this->_impl._dcols;
+    const size_t step  = Layout::offset(1,0,dcols);
+    const_pointer ptr  = this->_impl._data + Layout::offset(0,col,dcols);
+    for (auto it=vct.begin(); it!=vct.end(); ++it, ptr+=step) {
       *it = *ptr;
     }
 
     return vct;
   }
   
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>& Matrix<T,Alloc>::operator+=(const Matrix<T,Alloc>& other) {
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator+=(const Matrix<T,Alloc,Layout>& other) {
 
     ::anpi::aimpl::add(*this,other);
     
     return *this;
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc>& Matrix<T,Alloc>::operator-=(const Matrix<T,Alloc>& other) {
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator-=(const Matrix<T,Alloc,Layout>& other) {
 
     ::anpi::aimpl::subtract(*this,other);
       
     return *this;
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b) {
+  template<typename T,class Alloc,class Layout>
+  template<class E>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator+=(const expr::MatrixExpression<E>& _expr) {
 
-    assert( (a.rows()==b.rows()) && (a.cols()==b.cols()) );    
+    typedef expr::Terminal<T,Alloc,Layout> term;
+    ::anpi::aimpl::evaluate(*this,term(*this) + _expr);
 
-    Matrix<T,Alloc> c(a.rows(),a.cols(),anpi::DoNotInitialize);
-    ::anpi::aimpl::add(a,b,c);
-    return c;
+    return *this;
   }
 
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator-(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b) {
-    
-    assert( (a.rows()==b.rows()) && (a.cols()==b.cols()) );
-    
-    Matrix<T,Alloc> c(a.rows(),a.cols(),anpi::DoNotInitialize);
-    ::anpi::aimpl::subtract(a,b,c);
-    return c;
+  template<typename T,class Alloc,class Layout>
+  template<class E>
+  Matrix<T,Alloc,Layout>&
+  Matrix<T,Alloc,Layout>::operator-=(const expr::MatrixExpression<E>& _expr) {
+
+    typedef expr::Terminal<T,Alloc,Layout> term;
+    ::anpi::aimpl::evaluate(*this,term(*this) - _expr);
+
+    return *this;
   }
 
   template<typename T,class Alloc>
@@ -455,21 +555,25 @@ namespace anpi
     }
 
     Matrix<T,Alloc> c(a.rows(),b.cols(),anpi::DoNotInitialize);
-    c.fill(T(0));
+    ::anpi::aimpl::multiply(a,b,c);
+    return c;
+  }
 
-    for (unsigned int i = 0;     i< a.rows();  ++i)    {
-      for(unsigned int j = 0;    j< b.cols();  ++j)  {
-        for(unsigned int k = 0;  k<a.cols();   ++k){
-          c(i,j) += a(i,k) * b(k,j);
-        }
-      }
+  template<typename T,class Alloc>
+  Matrix<T,Alloc,ColMajor> operator*(const Matrix<T,Alloc,ColMajor>& a,
+                                     const Matrix<T,Alloc,ColMajor>& b) {
+
+    if (a.cols() != b.rows()) {
+      throw Exception("A number of columns and B number of rows don't match.");
     }
-    return c;
 
+    Matrix<T,Alloc,ColMajor> c(a.rows(),b.cols(),anpi::DoNotInitialize);
+    gemm(b.view().transpose(),a.view().transpose(),c.view().transpose());
+    return c;
   }
 
-  template<typename T,class Alloc>
-  std::vector<T> operator*(const Matrix<T,Alloc>& a,
+  template<typename T,class Alloc,class Layout>
+  std::vector<T> operator*(const Matrix<T,Alloc,Layout>& a,
                            const std::vector<T>& b) {
 
     if (a.cols() != b.size()) {
@@ -477,19 +581,345 @@ namespace anpi
     }
 
     std::vector<T> Result(a.rows());
+    gemv(a,b,Result);
+    return Result;
+  }
+
+  template<typename T,class Alloc>
+  void gemv(const Matrix<T,Alloc>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const typename Matrix<T,Alloc>::value_type alpha,
+            const typename Matrix<T,Alloc>::value_type beta) {
 
-    for (unsigned int i = 0;     i< a.rows();  ++i)  {
-      for(unsigned int k = 0;  k<a.cols();   ++k){
-        Result[i] += a[i][k]*b[k];
+    if (a.cols() != x.size()) {
+      throw anpi::Exception("A number of columns and x size don't match.");
+    }
+
+    if (y.size() != a.rows()) {
+      if (beta != T(0)) {
+        throw anpi::Exception("A number of rows and y size don't match.");
       }
+      y.resize(a.rows());
     }
-    return Result;
+
+    assert( (&x != &y) && "x and y must not alias" );
+
+    ::anpi::aimpl::gemv(a,x.data(),y.data(),alpha,beta);
+  }
+
+  template<typename T,class Alloc>
+  void gemv(const Matrix<T,Alloc,ColMajor>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const typename Matrix<T,Alloc>::value_type alpha,
+            const typename Matrix<T,Alloc>::value_type beta) {
+
+    if (a.cols() != x.size()) {
+      throw anpi::Exception("A number of columns and x size don't match.");
+    }
+
+    if (y.size() != a.rows()) {
+      if (beta != T(0)) {
+        throw anpi::Exception("A number of rows and y size don't match.");
+      }
+      y.resize(a.rows());
+    }
+
+    assert( (&x != &y) && "x and y must not alias" );
+
+    if (beta == T(0)) {
+      std::fill(y.begin(),y.end(),T(0));
+    } else if (beta != T(1)) {
+      ::anpi::aimpl::scale(y.data(),y.size(),beta);
+    }
+
+    // y += (alpha*x_j)*a_j, one contiguous column after the other
+    for (size_t j=0u;j<a.cols();++j) {
+      ::anpi::aimpl::axpy(T(alpha*x[j]),a[j],y.data(),a.rows());
+    }
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void scale(Matrix<T,Alloc,Layout>& a,
+             const typename Matrix<T,Alloc,Layout>::value_type alpha) {
+    ::anpi::aimpl::scale(a.data(),a.lines()*a.dcols(),alpha);
+  }
+
+  template<typename T>
+  void scale(std::vector<T>& x,
+             const typename std::vector<T>::value_type alpha) {
+    ::anpi::aimpl::scale(x.data(),x.size(),alpha);
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void axpy(const typename Matrix<T,Alloc,Layout>::value_type alpha,
+            const Matrix<T,Alloc,Layout>& x,
+            Matrix<T,Alloc,Layout>& y) {
+
+    if ( (x.rows() != y.rows()) || (x.cols() != y.cols()) ) {
+      throw anpi::Exception("Matrices in axpy must have the same size");
+    }
+
+    ::anpi::aimpl::axpy(alpha,x.data(),y.data(),y.lines()*y.dcols());
+  }
+
+  template<typename T>
+  void axpy(const typename std::vector<T>::value_type alpha,
+            const std::vector<T>& x,
+            std::vector<T>& y) {
+
+    if (x.size() != y.size()) {
+      throw anpi::Exception("Vectors in axpy must have the same size");
+    }
+
+    ::anpi::aimpl::axpy(alpha,x.data(),y.data(),y.size());
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void hadamard(const Matrix<T,Alloc,Layout>& a,
+                const Matrix<T,Alloc,Layout>& b,
+                Matrix<T,Alloc,Layout>& c) {
+
+    if ( (a.rows() != b.rows()) || (a.cols() != b.cols()) ) {
+      throw anpi::Exception("Matrices to be multiplied element-wise "
+                            "must have the same size");
+    }
+
+    c.allocate(a.rows(),a.cols());
+    ::anpi::aimpl::hadamard(a.data(),b.data(),c.data(),a.lines()*a.dcols());
+  }
+
+  template<typename T>
+  void hadamard(const std::vector<T>& a,
+                const std::vector<T>& b,
+                std::vector<T>& c) {
+
+    if (a.size() != b.size()) {
+      throw anpi::Exception("Vectors to be multiplied element-wise "
+                            "must have the same size");
+    }
+
+    c.resize(a.size());
+    ::anpi::aimpl::hadamard(a.data(),b.data(),c.data(),a.size());
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void divide(const Matrix<T,Alloc,Layout>& a,
+              const Matrix<T,Alloc,Layout>& b,
+              Matrix<T,Alloc,Layout>& c) {
+
+    if ( (a.rows() != b.rows()) || (a.cols() != b.cols()) ) {
+      throw anpi::Exception("Matrices to be divided element-wise "
+                            "must have the same size");
+    }
+
+    c.allocate(a.rows(),a.cols());
+
+    // The padding is skipped: it may hold integer zeros
+    if (a.dcols() == a.lineLength()) {
+      ::anpi::aimpl::divide(a.data(),b.data(),c.data(),a.entries());
+    } else {
+      for (size_t r=0;r<a.lines();++r) {
+        ::anpi::aimpl::divide(a[r],b[r],c[r],a.lineLength());
+      }
+    }
+  }
+
+  template<typename T>
+  void divide(const std::vector<T>& a,
+              const std::vector<T>& b,
+              std::vector<T>& c) {
+
+    if (a.size() != b.size()) {
+      throw anpi::Exception("Vectors to be divided element-wise "
+                            "must have the same size");
+    }
+
+    c.resize(a.size());
+    ::anpi::aimpl::divide(a.data(),b.data(),c.data(),a.size());
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void fmadd(const Matrix<T,Alloc,Layout>& a,
+             const Matrix<T,Alloc,Layout>& b,
+             const Matrix<T,Alloc,Layout>& c,
+             Matrix<T,Alloc,Layout>& d) {
+
+    if ( (a.rows() != b.rows()) || (a.cols() != b.cols()) ||
+         (a.rows() != c.rows()) || (a.cols() != c.cols()) ) {
+      throw anpi::Exception("Matrices in fmadd must have the same size");
+    }
+
+    d.allocate(a.rows(),a.cols());
+    ::anpi::aimpl::fmadd(a.data(),b.data(),c.data(),d.data(),
+                         a.lines()*a.dcols());
+  }
+
+  template<typename T>
+  void fmadd(const std::vector<T>& a,
+             const std::vector<T>& b,
+             const std::vector<T>& c,
+             std::vector<T>& d) {
+
+    if ( (a.size() != b.size()) || (a.size() != c.size()) ) {
+      throw anpi::Exception("Vectors in fmadd must have the same size");
+    }
+
+    d.resize(a.size());
+    ::anpi::aimpl::fmadd(a.data(),b.data(),c.data(),d.data(),a.size());
+  }
+
+  template<typename S,typename T,class AllocS,class AllocT,class Layout>
+  void convert(const Matrix<S,AllocS,Layout>& a,
+               Matrix<T,AllocT,Layout>& b) {
+    if ( (b.rows() != a.rows()) || (b.cols() != a.cols()) ) {
+      b.allocate(a.rows(),a.cols());
+    }
+
+    // The paddings depend on the entry sizes: convert line by line
+    for (size_t i=0u;i<a.lines();++i) {
+      ::anpi::aimpl::convert(a[i],b[i],a.lineLength());
+    }
+  }
+
+  template<typename T>
+  typename accumulator_type<T>::type dot(const std::vector<T>& x,
+                                         const std::vector<T>& y) {
+    if (x.size() != y.size()) {
+      throw anpi::Exception("Vectors in dot must have the same size");
+    }
+
+    typename accumulator_type<T>::type result;
+    ::anpi::aimpl::dot(x.data(),y.data(),x.size(),result);
+    return result;
+  }
+
+  template<typename T>
+  typename accumulator_type<T>::type sum(const std::vector<T>& x) {
+    typename accumulator_type<T>::type result;
+    ::anpi::aimpl::sum(x.data(),x.size(),result);
+    return result;
+  }
+
+  template<typename T,class Alloc,class Layout>
+  typename accumulator_type<T>::type sum(const Matrix<T,Alloc,Layout>& a) {
+    typedef typename accumulator_type<T>::type A;
+    A result;
+    if (a.dcols() == a.lineLength()) {
+      ::anpi::aimpl::sum(a.data(),a.entries(),result);
+      return result;
+    }
+
+    // The padding is not part of the matrix: one partial sum per line
+    const size_t rows = a.lines();
+    const int threads = (a.entries() >= parallel::reduceThreshold())
+                      ? parallel::numThreads() : 1;
+    (void)threads; // only read by OpenMP
+    std::vector<A> part(rows);
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+    for (size_t i=0u;i<rows;++i) {
+      ::anpi::aimpl::sum(a[i],a.lineLength(),part[i]);
+    }
+    ::anpi::aimpl::sum(part.data(),rows,result);
+    return result;
+  }
+
+  template<typename T>
+  typename norm_type<T>::type squaredNorm(const std::vector<T>& x) {
+    typename norm_type<T>::type result;
+    ::anpi::aimpl::squaredNorm(x.data(),x.size(),result);
+    return result;
+  }
+
+  template<typename T,class Alloc,class Layout>
+  typename norm_type<T>::type squaredNorm(const Matrix<T,Alloc,Layout>& a) {
+    typedef typename norm_type<T>::type R;
+    R result;
+    if (a.dcols() == a.lineLength()) {
+      ::anpi::aimpl::squaredNorm(a.data(),a.entries(),result);
+      return result;
+    }
+
+    const size_t rows = a.lines();
+    const int threads = (a.entries() >= parallel::reduceThreshold())
+                      ? parallel::numThreads() : 1;
+    (void)threads; // only read by OpenMP
+    std::vector<R> part(rows);
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+    for (size_t i=0u;i<rows;++i) {
+      ::anpi::aimpl::squaredNorm(a[i],a.lineLength(),part[i]);
+    }
+    ::anpi::aimpl::sum(part.data(),rows,result);
+    return result;
+  }
+
+  template<typename T>
+  size_t iamax(const std::vector<T>& x) {
+    size_t index;
+    ::anpi::aimpl::iamax(x.data(),x.size(),1,index);
+    return index;
+  }
+
+  template<typename TA,typename TB,typename T>
+  void add(const MatrixView<TA>& a,
+           const MatrixView<TB>& b,
+           const MatrixView<T>& c) {
+
+    typedef typename MatrixView<T>::value_type value_type;
+    static_assert(!std::is_const<T>::value,"c must be a mutable view");
+
+    if ( (a.rows() != b.rows()) || (a.cols() != b.cols()) ||
+         (a.rows() != c.rows()) || (a.cols() != c.cols()) ) {
+      throw anpi::Exception("Views to be added must have the same size");
+    }
+
+    ::anpi::aimpl::add(MatrixView<const value_type>(a),
+                       MatrixView<const value_type>(b),c);
+  }
+
+  template<typename TA,typename TB,typename T>
+  void subtract(const MatrixView<TA>& a,
+                const MatrixView<TB>& b,
+                const MatrixView<T>& c) {
+
+    typedef typename MatrixView<T>::value_type value_type;
+    static_assert(!std::is_const<T>::value,"c must be a mutable view");
+
+    if ( (a.rows() != b.rows()) || (a.cols() != b.cols()) ||
+         (a.rows() != c.rows()) || (a.cols() != c.cols()) ) {
+      throw anpi::Exception("Views to be subtracted must have the same size");
+    }
+
+    ::anpi::aimpl::subtract(MatrixView<const value_type>(a),
+                            MatrixView<const value_type>(b),c);
+  }
+
+  template<typename TA,typename TB,typename T>
+  void gemm(const MatrixView<TA>& a,
+            const MatrixView<TB>& b,
+            const MatrixView<T>& c,
+            const typename MatrixView<T>::value_type alpha,
+            const typename MatrixView<T>::value_type beta) {
+
+    typedef typename MatrixView<T>::value_type value_type;
+    static_assert(!std::is_const<T>::value,"c must be a mutable view");
+
+    if ( (a.cols() != b.rows()) ||
+         (a.rows() != c.rows()) || (b.cols() != c.cols()) ) {
+      throw anpi::Exception("Sizes of the views in gemm don't match.");
+    }
+
+    ::anpi::aimpl::gemm(MatrixView<const value_type>(a),
+                        MatrixView<const value_type>(b),
+                        c,alpha,beta);
   }
 
   /////////////////////////////////////////// Methods used in the QR implementation
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::compute_minor(const Matrix<T,Alloc>& a, unsigned int d) {
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::compute_minor(const Matrix<T,Alloc,Layout>& a,
+                                             unsigned int d) {
 
     allocate(a.rows(), a.cols());
     (*this).fill(T(0));
@@ -504,14 +934,47 @@ namespace anpi
 
   }
 
-  template<typename T,class Alloc>
-  void Matrix<T,Alloc>::transpose() {
-    for (unsigned int i = 0; i < (*this).rows(); ++i) {
-      for (unsigned int j = 0; j < i; ++j) {
-        T t = (*this)(i,j);
-        (*this)(i,j) = (*this)(j,i);
-        (*this)(j,i) = t;
-      }
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::transpose() {
+    if (rows() == cols()) {
+      ::anpi::aimpl::transpose(*this);
+    } else {
+      Matrix<T,Alloc,Layout> tmp;
+      ::anpi::aimpl::transpose(*this,tmp);
+      *this = std::move(tmp);
     }
   }
+
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::transposed(Matrix<T,Alloc,Layout>& dst) const {
+    if (&dst == this) {
+      dst.transpose();
+    } else {
+      ::anpi::aimpl::transpose(*this,dst);
+    }
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::save(const std::string& filename) const {
+    if (!std::is_same<Layout,RowMajor>::value) { // the files are row-major
+      Matrix<T>(*this).save(filename);
+      return;
+    }
+    file::write(filename,data(),rows(),cols(),dcols());
+  }
+
+  template<typename T,class Alloc,class Layout>
+  void Matrix<T,Alloc,Layout>::load(const std::string& filename) {
+    if (!std::is_same<Layout,RowMajor>::value) {
+      Matrix<T> tmp;
+      tmp.load(filename);
+      *this = tmp;
+      return;
+    }
+
+    std::ifstream in;
+    const file::header h = file::open<T>(filename,in);
+    allocate(size_t(h.rows),size_t(h.cols));
+    file::read(in,h,filename,data(),dcols());
+  }
 } // namespace ANPI
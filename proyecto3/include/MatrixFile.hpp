@@ -0,0 +1,224 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_FILE_HPP
+#define ANPI_MATRIX_FILE_HPP
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Half.hpp"
+
+namespace anpi
+{
+  /**
+   * Binary file format of the matrices.
+   *
+   * A file starts with a header of DataOffset bytes, followed by the
+   * rows x dcols entries in the same layout as in memory, row padding
+   * included.  Since the data starts at a page boundary, a file can be
+   * mapped directly as the buffer of a Matrix (see MappedMatrix.hpp),
+   * or loaded with a single read (see Matrix::save and Matrix::load).
+   *
+   * All fields are stored in the byte order of the machine writing the
+   * file; the magic number is used to detect a different one.
+   */
+  namespace file {
+
+    /// Bytes before the first entry
+    static const size_t DataOffset = 4096;
+
+    /// Version of the format
+    static const uint32_t Version = 1;
+
+    /// Header at the beginning of each file
+    struct header {
+      /// "ANPIMAT" and a zero
+      char     magic[8];
+      /// Written as 1, to detect the byte order
+      uint32_t endian;
+      /// Version of the format
+      uint32_t version;
+      /// Type of the entries, see type_code
+      uint32_t type;
+      /// Size of each entry in bytes
+      uint32_t entrySize;
+      /// Number of rows
+      uint64_t rows;
+      /// Number of columns
+      uint64_t cols;
+      /// Entries between the beginnings of two consecutive rows
+      uint64_t dcols;
+    };
+
+    /**
+     * Code of the entry type in the header.  Types without a code have
+     * the code 0 and are only told apart by their size.
+     */
+    template<typename T> struct type_code {
+      static const uint32_t value = 0;
+    };
+
+    template<> struct type_code<float>  { static const uint32_t value = 1; };
+    template<> struct type_code<double> { static const uint32_t value = 2; };
+    template<> struct type_code<std::complex<float> > {
+      static const uint32_t value = 3;
+    };
+    template<> struct type_code<std::complex<double> > {
+      static const uint32_t value = 4;
+    };
+    template<> struct type_code<half>     { static const uint32_t value = 5; };
+    template<> struct type_code<bfloat16> { static const uint32_t value = 6; };
+
+    /// Header for a matrix of entries of type T
+    template<typename T>
+    header makeHeader(const size_t rows,
+                      const size_t cols,
+                      const size_t dcols) {
+      header h;
+      std::memset(&h,0,sizeof(header));
+      std::memcpy(h.magic,"ANPIMAT",8);
+      h.endian    = 1;
+      h.version   = Version;
+      h.type      = type_code<T>::value;
+      h.entrySize = sizeof(T);
+      h.rows      = rows;
+      h.cols      = cols;
+      h.dcols     = dcols;
+      return h;
+    }
+
+    /**
+     * Check that a header describes a matrix with entries of type T
+     *
+     * @throws anpi::Exception naming the file if it does not
+     */
+    template<typename T>
+    void checkHeader(const header& h,const std::string& filename) {
+      if (std::memcmp(h.magic,"ANPIMAT",8) != 0) {
+        throw anpi::Exception(filename + " is not a matrix file");
+      }
+      if (h.endian != 1) {
+        throw anpi::Exception(filename + " has a different byte order");
+      }
+      if (h.version != Version) {
+        throw anpi::Exception(filename + " has an unknown version");
+      }
+      if ((h.entrySize != sizeof(T)) || (h.type != type_code<T>::value)) {
+        throw anpi::Exception(filename + " holds entries of another type");
+      }
+      if ((h.rows > 1) && (h.dcols < h.cols)) {
+        throw anpi::Exception(filename + " has an invalid size");
+      }
+    }
+
+    /// Total bytes of a file with the given header
+    inline size_t fileSize(const header& h) {
+      return DataOffset + size_t(h.rows*h.dcols*h.entrySize);
+    }
+
+    /**
+     * Write a matrix of rows x cols entries, with dcols entries between
+     * the beginnings of two consecutive rows, as stored at data.
+     *
+     * The header and the whole buffer, padding included, go out in two
+     * large writes without formatting.
+     *
+     * @throws anpi::Exception if the file cannot be written
+     */
+    template<typename T>
+    void write(const std::string& filename,
+               const T* data,
+               const size_t rows,
+               const size_t cols,
+               const size_t dcols) {
+      std::ofstream out(filename,std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw anpi::Exception("Cannot create " + filename);
+      }
+
+      std::vector<char> head(DataOffset,0);
+      const header h = makeHeader<T>(rows,cols,dcols);
+      std::memcpy(head.data(),&h,sizeof(header));
+      out.write(head.data(),DataOffset);
+
+      if (rows*dcols > 0) {
+        out.write(reinterpret_cast<const char*>(data),
+                  std::streamsize(rows*dcols*sizeof(T)));
+      }
+
+      if (!out) {
+        throw anpi::Exception("Cannot write " + filename);
+      }
+    }
+
+    /**
+     * Open a matrix file for reading, positioned at the first entry
+     *
+     * @throws anpi::Exception if the file cannot be opened or does not
+     *         hold entries of type T
+     */
+    template<typename T>
+    header open(const std::string& filename,std::ifstream& in) {
+      in.open(filename,std::ios::binary);
+      if (!in) {
+        throw anpi::Exception("Cannot open " + filename);
+      }
+
+      header h;
+      if (!in.read(reinterpret_cast<char*>(&h),sizeof(header))) {
+        throw anpi::Exception(filename + " is not a matrix file");
+      }
+      checkHeader<T>(h,filename);
+      in.seekg(DataOffset);
+      return h;
+    }
+
+    /**
+     * Read the entries of a file opened with open() into data, which
+     * has dcols entries between the beginnings of two consecutive rows.
+     *
+     * If the padding of the file is the same, a single read is done;
+     * otherwise the rows are read one at a time.
+     *
+     * @throws anpi::Exception if the file is too short
+     */
+    template<typename T>
+    void read(std::ifstream& in,
+              const header& h,
+              const std::string& filename,
+              T* data,
+              const size_t dcols) {
+      const size_t rows = size_t(h.rows);
+      const size_t cols = size_t(h.cols);
+
+      if (dcols == h.dcols) {
+        in.read(reinterpret_cast<char*>(data),
+                std::streamsize(rows*dcols*sizeof(T)));
+      } else {
+        const std::streamoff skip = std::streamoff((h.dcols-cols)*sizeof(T));
+        for (size_t r=0;(r<rows) && in;++r) {
+          in.read(reinterpret_cast<char*>(data + r*dcols),
+                  std::streamsize(cols*sizeof(T)));
+          in.seekg(skip,std::ios::cur);
+        }
+      }
+
+      if (!in) {
+        throw anpi::Exception(filename + " is truncated");
+      }
+    }
+
+  } // namespace file
+} // namespace anpi
+
+#endif
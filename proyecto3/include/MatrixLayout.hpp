@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_LAYOUT_HPP
+#define ANPI_MATRIX_LAYOUT_HPP
+
+#include <cstddef>
+
+namespace anpi
+{
+  /**
+   * @name Memory layouts
+   *
+   * Policies for the order in which anpi::Matrix and anpi::MatrixView
+   * store the entries.  The entries are kept in contiguous "lines",
+   * which are the rows for RowMajor and the columns for ColMajor.  The
+   * leading dimension (dcols()) is the number of entries between the
+   * beginnings of two consecutive lines, padding included.
+   *
+   * A matrix stored in one layout has exactly the memory of its
+   * transpose stored in the other one, so that a kernel written for
+   * one layout serves the other through MatrixView::transpose().
+   */
+  //@{
+  struct ColMajor;
+
+  /// Rows are contiguous in memory (the default)
+  struct RowMajor {
+    /// Layout of the transposed matrix with the same memory
+    typedef ColMajor transposed;
+
+    /// Number of lines of a rows x cols matrix
+    static constexpr size_t lines(const size_t rows,const size_t) {
+      return rows;
+    }
+
+    /// Number of entries of each line, without padding
+    static constexpr size_t lineLength(const size_t,const size_t cols) {
+      return cols;
+    }
+
+    /// Position of the entry (row,col) with the leading dimension ld
+    static constexpr size_t offset(const size_t row,
+                                   const size_t col,
+                                   const size_t ld) {
+      return row*ld + col;
+    }
+  };
+
+  /// Columns are contiguous in memory
+  struct ColMajor {
+    /// Layout of the transposed matrix with the same memory
+    typedef RowMajor transposed;
+
+    /// Number of lines of a rows x cols matrix
+    static constexpr size_t lines(const size_t,const size_t cols) {
+      return cols;
+    }
+
+    /// Number of entries of each line, without padding
+    static constexpr size_t lineLength(const size_t rows,const size_t) {
+      return rows;
+    }
+
+    /// Position of the entry (row,col) with the leading dimension ld
+    static constexpr size_t offset(const size_t row,
+                                   const size_t col,
+                                   const size_t ld) {
+      return col*ld + row;
+    }
+  };
+  //@}
+
+} // namespace anpi
+
+#endif
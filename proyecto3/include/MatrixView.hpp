@@ -0,0 +1,229 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_VIEW_HPP
+#define ANPI_MATRIX_VIEW_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <type_traits>
+
+#include "Exception.hpp"
+#include "MatrixLayout.hpp"
+
+namespace anpi
+{
+  /**
+   * Non-owning view of a block of a matrix.
+   *
+   * A view just holds a pointer to its first entry, its number of rows
+   * and columns, and the stride, i.e. the number of entries between the
+   * beginnings of two consecutive rows, or of two consecutive columns
+   * if the Layout is ColMajor (see MatrixLayout.hpp).  It never
+   * allocates or releases memory, so it must not outlive the matrix it
+   * refers to, and it is invalidated if that matrix is reallocated.
+   *
+   * With a const element type, as in MatrixView<const float>, the
+   * entries are read-only.  A mutable view converts implicitly into a
+   * read-only one.  As with pointers, the constness of the view itself
+   * does not propagate to the entries.
+   *
+   * Views are obtained with Matrix::view(), Matrix::block(),
+   * Matrix::rowRange() or Matrix::colRange(), and the same methods
+   * give sub-views of a view:
+   *
+   * \code
+   * anpi::Matrix<float> a(100,100);
+   * auto top = a.rowRange(0,50);        // first 50 rows, no copy
+   * auto blk = top.block(10,10,20,20);  // 20x20 block at (10,10)
+   * blk.fill(0.f);                      // writes into a
+   * \endcode
+   *
+   * Most kernels on views assume the RowMajor layout.  A ColMajor view
+   * is passed to them through transpose(), which reinterprets the same
+   * memory as the transposed RowMajor block.
+   */
+  template<typename T,class Layout=RowMajor>
+  class MatrixView {
+  public:
+    /// Type of the entries, without const
+    typedef typename std::remove_const<T>::type value_type;
+
+    /// Pointer to the entries, read-only for const views
+    typedef T* pointer;
+
+    /// Memory layout of the entries
+    typedef Layout layout_type;
+
+  private:
+    /// First entry of the view
+    T* _data;
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+    /// Entries between the beginnings of two consecutive lines
+    size_t _dcols;
+
+  public:
+    /// Empty view
+    MatrixView() : _data(nullptr),_rows(0),_cols(0),_dcols(0) {}
+
+    /**
+     * View of rows x cols entries starting at data, with dcols entries
+     * between the beginnings of two consecutive lines.
+     */
+    MatrixView(T* data,
+               const size_t rows,
+               const size_t cols,
+               const size_t dcols)
+      : _data(data),_rows(rows),_cols(cols),_dcols(dcols) {
+      assert( (Layout::lines(rows,cols)<=1) ||
+              (dcols>=Layout::lineLength(rows,cols)) );
+    }
+
+    /// A mutable view is also a read-only one
+    template<typename U,
+             typename std::enable_if<std::is_same<const U,T>::value &&
+                                     !std::is_same<U,T>::value,int>::type=0>
+    MatrixView(const MatrixView<U,Layout>& other)
+      : _data(other.data()),
+        _rows(other.rows()),
+        _cols(other.cols()),
+        _dcols(other.dcols()) {}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Stride: entries between the beginnings of two consecutive lines
+    inline size_t dcols() const { return _dcols; }
+
+    /// Number of lines: rows for RowMajor, columns for ColMajor
+    inline size_t lines() const { return Layout::lines(_rows,_cols); }
+
+    /// Entries of each line: cols() for RowMajor, rows() for ColMajor
+    inline size_t lineLength() const {
+      return Layout::lineLength(_rows,_cols);
+    }
+
+    /// Total number of entries (rows x cols)
+    inline size_t entries() const { return _rows*_cols; }
+
+    /// Check if the view is empty (zero rows or columns)
+    inline bool empty() const { return (_rows==0) || (_cols==0); }
+
+    /// Pointer to the first entry
+    inline T* data() const { return _data; }
+
+    /// Pointer to a given line: a row for RowMajor, a column for ColMajor
+    inline T* operator[](const size_t line) const {
+      return _data + line*_dcols;
+    }
+
+    /// Reference to the element at the given row and column
+    inline T& operator()(const size_t row,const size_t col) const {
+      return _data[Layout::offset(row,col,_dcols)];
+    }
+
+    /// View of the rows x cols block starting at (row,col)
+    inline MatrixView block(const size_t row,
+                            const size_t col,
+                            const size_t rows,
+                            const size_t cols) const {
+      assert( (row+rows <= _rows) && (col+cols <= _cols) );
+      return MatrixView(_data + Layout::offset(row,col,_dcols),
+                        rows,cols,_dcols);
+    }
+
+    /// View of n rows starting at the given one
+    inline MatrixView rowRange(const size_t row,const size_t n) const {
+      return block(row,0,n,_cols);
+    }
+
+    /// View of n columns starting at the given one
+    inline MatrixView colRange(const size_t col,const size_t n) const {
+      return block(0,col,_rows,n);
+    }
+
+    /**
+     * The transposed cols x rows block, with the same memory read in
+     * the other layout.  No entry is copied.
+     */
+    inline MatrixView<T,typename Layout::transposed> transpose() const {
+      return MatrixView<T,typename Layout::transposed>(_data,_cols,_rows,
+                                                       _dcols);
+    }
+
+    /// Set all entries of the view to the given value
+    void fill(const value_type val) const {
+      static_assert(!std::is_const<T>::value,"Read-only view");
+      const size_t n = lineLength();
+      for (size_t l=0;l<lines();++l) {
+        T* ptr = (*this)[l];
+        for (size_t c=0;c<n;++c) {
+          ptr[c] = val;
+        }
+      }
+    }
+
+    /**
+     * Copy the entries of another view of the same size into this one.
+     * The layouts may differ.  Both views must not overlap.
+     *
+     * @throws anpi::Exception if the sizes differ
+     */
+    template<typename U,class OLayout>
+    void assign(const MatrixView<U,OLayout>& other) const {
+      static_assert(!std::is_const<T>::value,"Read-only view");
+      static_assert(std::is_same<value_type,
+                    typename MatrixView<U,OLayout>::value_type>::value,
+                    "Views must have the same element type");
+
+      if ((other.rows() != _rows) || (other.cols() != _cols)) {
+        throw anpi::Exception("Views of different sizes cannot be assigned");
+      }
+
+      if (std::is_same<Layout,OLayout>::value) {
+        const size_t n = lineLength();
+        for (size_t l=0;l<lines();++l) {
+          std::memcpy((*this)[l],other[l],sizeof(value_type)*n);
+        }
+      } else {
+        for (size_t r=0;r<_rows;++r) {
+          for (size_t c=0;c<_cols;++c) {
+            (*this)(r,c) = other(r,c);
+          }
+        }
+      }
+    }
+  }; // class MatrixView
+
+  /**
+   * Read-only view of entries of type T.
+   *
+   * Used for parameters of function templates where T is deduced from
+   * other arguments, so that matrices and mutable views convert
+   * implicitly to the read-only view:
+   *
+   * \code
+   * template<typename T>
+   * void f(const typename const_view<T>::type& a,std::vector<T>& x);
+   * \endcode
+   */
+  template<typename T>
+  struct const_view {
+    typedef MatrixView<const T> type;
+  };
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_PARALLEL_HPP
+#define ANPI_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+namespace anpi {
+
+  /**
+   * Runtime parameters of the multithreaded kernels.
+   *
+   * Each parallel kernel has a size threshold below which it runs
+   * serially, since the cost of waking up the thread team would
+   * dominate.  All values can be modified by the application, e.g.
+   *
+   * \code
+   * anpi::parallel::threads() = 8;
+   * anpi::parallel::gemmThreshold() = 256*256*256;
+   * \endcode
+   *
+   * If the code is compiled without OpenMP everything runs serially.
+   */
+  namespace parallel {
+
+    /// Number of threads to be used.  Zero means the OpenMP default.
+    inline size_t& threads() {
+      static size_t n = 0;
+      return n;
+    }
+
+    /**
+     * Number of threads a kernel should run with.  Kernels called from
+     * within a parallel region, such as the tasks of luTiled(), run
+     * on the calling thread alone.
+     */
+    inline int numThreads() {
+#ifdef _OPENMP
+      if (omp_in_parallel()) {
+        return 1;
+      }
+      return (threads() == 0) ? omp_get_max_threads() : int(threads());
+#else
+      return 1;
+#endif
+    }
+
+    /// Number of processors available
+    inline int processors() {
+#ifdef _OPENMP
+      return omp_get_num_procs();
+#else
+      return 1;
+#endif
+    }
+
+    /// Matrix products with fewer multiply-adds run serially
+    inline size_t& gemmThreshold() {
+      static size_t ops = 128*128*128;
+      return ops;
+    }
+
+    /// Matrix-vector products on matrices with fewer entries run serially
+    inline size_t& gemvThreshold() {
+      static size_t entries = 512*512;
+      return entries;
+    }
+
+    /// Reductions (dot products, norms, ...) of fewer entries run serially
+    inline size_t& reduceThreshold() {
+      static size_t entries = 256*1024;
+      return entries;
+    }
+
+    /**
+     * Element-wise operations (sums and differences of matrices) on
+     * fewer entries run serially.  Larger ones are split into one
+     * contiguous chunk per thread (see chunkRange()), since a single
+     * core cannot saturate the memory bandwidth.
+     */
+    inline size_t& elementwiseThreshold() {
+      static size_t entries = 256*1024;
+      return entries;
+    }
+
+    /// Number of threads for an element-wise operation on n entries
+    inline int elementwiseThreads(const size_t n) {
+      return (n >= elementwiseThreshold()) ? numThreads() : 1;
+    }
+
+    /**
+     * Range [begin,end) of the n entries of type T processed by thread t
+     * of the given number of threads.  The chunks are whole cache lines
+     * of 64 bytes, so that no two threads write into the same line and
+     * chunks of aligned buffers remain aligned for any register.
+     */
+    template<typename T>
+    inline void chunkRange(const size_t n,const int threads,const int t,
+                           size_t& begin,size_t& end) {
+      constexpr size_t line = (sizeof(T) < 64) ? 64/sizeof(T) : 1;
+      const size_t chunk = ((n/size_t(threads) + line-1)/line)*line;
+      begin = std::min(n,size_t(t)*chunk);
+      end   = (t+1 == threads) ? n : std::min(n,begin+chunk);
+    }
+
+    /**
+     * Matrices with fewer entries are initialized serially.  Larger ones
+     * are written by the threads that will later process each block of
+     * rows, so that the pages land on their NUMA nodes (first touch).
+     */
+    inline size_t& firstTouchThreshold() {
+      static size_t entries = 1024*1024;
+      return entries;
+    }
+
+    /// Sparse matrix-vector products with fewer non-zeros run serially
+    inline size_t& spmvThreshold() {
+      static size_t nonZeros = 128*1024;
+      return nonZeros;
+    }
+
+    /**
+     * Range [begin,end) of the lines processed by thread t, for lines
+     * of different cost.  offsets holds lines+1 prefix sums of the
+     * costs (e.g. the non-zeros of a sparse matrix), and each thread
+     * receives about the same share of the total.
+     */
+    inline void balancedRange(const size_t* offsets,const size_t lines,
+                              const int threads,const int t,
+                              size_t& begin,size_t& end) {
+      const size_t total = offsets[lines];
+      const auto first = [&](const int k) -> size_t {
+        if (k >= threads) {
+          return lines;
+        }
+        const size_t target = (total/size_t(threads))*size_t(k) +
+                              (total%size_t(threads))*size_t(k)/size_t(threads);
+        return size_t(std::lower_bound(offsets,offsets+lines,target) -
+                      offsets);
+      };
+      begin = first(t);
+      end   = first(t+1);
+    }
+
+    /**
+     * Square systems with fewer rows are decomposed by anpi::lu() with
+     * the sequential luBlocked(), larger ones with the task-parallel
+     * luTiled()
+     */
+    inline size_t& luThreshold() {
+      static size_t rows = 1024;
+      return rows;
+    }
+
+  } // namespace parallel
+} // namespace anpi
+
+#endif
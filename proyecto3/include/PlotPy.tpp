@@ -164,15 +164,37 @@ namespace anpi {
 
 
 
-    PyRun_SimpleString("ThermalMatrix = np.loadtxt('matrix.txt')");
+    // Reader of the binary files of Matrix::save (see MatrixFile.hpp):
+    // the entries start at byte 4096, with dcols entries per row
+    PyRun_SimpleString(
+      "def anpi_load(name):\n"
+      "    h32 = np.fromfile(name, dtype=np.uint32, count=6)\n"
+      "    h64 = np.fromfile(name, dtype=np.uint64, count=6)\n"
+      "    code = int(h32[4])\n"
+      "    dt = {1: np.float32, 2: np.float64,\n"
+      "          3: np.complex64, 4: np.complex128,\n"
+      "          5: np.float16, 6: np.uint16}[code]\n"
+      "    rows, cols, dcols = int(h64[3]), int(h64[4]), int(h64[5])\n"
+      "    if rows*dcols == 0:\n"
+      "        return np.zeros((rows, cols),\n"
+      "                        dtype=np.float32 if code == 6 else dt)\n"
+      "    m = np.memmap(name, dtype=dt, mode='r', offset=4096,\n"
+      "                  shape=(rows, dcols))\n"
+      "    m = np.array(m[:, :cols])\n"
+      "    if code == 6:\n"
+      "        # numpy has no bfloat16: it is the upper half of a float32\n"
+      "        m = (m.astype(np.uint32) << 16).view(np.float32)\n"
+      "    return m\n");
+
+    PyRun_SimpleString("ThermalMatrix = anpi_load('matrix.bin')");
     PyRun_SimpleString("fig, ax = plt.subplots()");
     PyRun_SimpleString("im = ax.imshow(ThermalMatrix)");
     PyRun_SimpleString("ax.set_title('Temperature Distribution')");
     PyRun_SimpleString("fig.tight_layout()");
 
 
-    PyRun_SimpleString("ThermalChangeU = np.loadtxt('Umatrix.txt')");
-    PyRun_SimpleString("ThermalChangeV = np.loadtxt('Vmatrix.txt')");
+    PyRun_SimpleString("ThermalChangeU = anpi_load('Umatrix.bin')");
+    PyRun_SimpleString("ThermalChangeV = anpi_load('Vmatrix.bin')");
 
     PyRun_SimpleString("q = ax.quiver(ThermalChangeU,ThermalChangeV)");
 
@@ -0,0 +1,30 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_SIMD_CONFIG_HPP
+#define ANPI_SIMD_CONFIG_HPP
+
+#include <AnpiConfig.hpp>
+
+/*
+ * ANPI_SIMD_RUNTIME_DISPATCH is defined if the SIMD kernels are compiled
+ * for several instruction sets and selected at runtime.  The CMake
+ * option ANPI_RUNTIME_DISPATCH asks for it, but only GCC on x86 can
+ * compile the variants, so other compilers follow their flags.
+ *
+ * All headers depending on the dispatch (Intrinsics.hpp for the
+ * kernels, Allocator.hpp for the default alignment) read this macro,
+ * so that every translation unit sees the same setting whatever the
+ * order of its includes.
+ */
+#if defined(ANPI_RUNTIME_DISPATCH) &&                           \
+    defined(__GNUC__) && !defined(__clang__) &&                 \
+    (defined(__x86_64__) || defined(__i386__))
+#  define ANPI_SIMD_RUNTIME_DISPATCH
+#endif
+
+#endif
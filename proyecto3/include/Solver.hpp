@@ -3,9 +3,11 @@
 #include <functional>
 #include <vector>
 
+#include "Allocator.hpp"
 #include "Exception.hpp"
 #include "Matrix.hpp"
 #include "LU.hpp"
+#include "LUFactorization.hpp"
 #include "Utilities.hpp"
 
 #ifndef ANPI_SOLVER_HPP
@@ -17,11 +19,11 @@ namespace anpi {
 	/**
 	 * @brief used to solve a superior triangular matrix by backward substitution.
 	 * @tparam T template value.
-	 * @param A matrix that contains the superior triangular matrix.
+	 * @param A view of the superior triangular matrix.
 	 * @param x unknowns vector.
 	 * @param b result vector.
 	 */
-	void backwardSubs (anpi::Matrix<T>& A,
+	void backwardSubs (const typename anpi::const_view<T>::type& A,
 	                    std::vector <T>& x,
 						std::vector <T>& b){
 	  size_t i,j;
@@ -52,12 +54,12 @@ namespace anpi {
 	/**
 	 * @brief used to solve a lower triangular matrix by forward substitution.
 	 * @tparam T template value.
-	 * @param A matrix that contains the superior triangular matrix.
+	 * @param A view of the inferior triangular matrix.
 	 * @param x unknowns vector.
 	 * @param b result vector.
 	 */
 	template<typename T>
-	void forwardSubs( anpi::Matrix<T>& A,
+	void forwardSubs( const typename anpi::const_view<T>::type& A,
 										std::vector <T>& x,
 										std::vector <T>&b){
 
@@ -78,8 +80,13 @@ namespace anpi {
 
 	/**
 	 * @brief LU solver.
+	 *
+	 * Decomposes A on every call: to solve several systems with the same
+	 * matrix, keep an anpi::LUFactorization instead.  The LU temporary is
+	 * taken from the arena of the thread, so that repeated solves reuse
+	 * its memory; systems beyond Arena::retainLimit() give it back.
 	 * @tparam T template value.
-	 * @param A matrix that contains the superior triangular matrix.
+	 * @param A matrix of the system.
 	 * @param x unknowns vector.
 	 * @param b result vector.
 	 */
@@ -88,64 +95,41 @@ namespace anpi {
 				std::vector <T>& x,
 				const std::vector <T>&b){
 
-			Matrix<T> LU;
-			size_t size = A.rows();
-			
-			std::vector<size_t> permut;
+			ScopedArena scope;
+			const LUFactorization<T,arena_allocator<T> > factorization(A);
+			factorization.solve(b, x);
 
-			lu(A, LU, permut);
-			//matrix_show(LU);
-
-			Matrix<T> L, U;
-			
-			unpack(LU, L, U);
-
-			std::vector<T> Y (size,0);
-
-			std::vector<T> Bperm (size,0);
-			for(size_t i = 0; i<size; ++i){
-				Bperm[i] = b[permut[i]];
-			}
-
-			forwardSubs(L, Y, Bperm);
-			backwardSubs(U, x, Y);
-
-			
 	}//solveLU
 
 
 	/**
 	 * @brief invert matrix
+	 *
+	 * A is decomposed once, and the columns of the identity are solved
+	 * together with the same decomposition, split among the threads for
+	 * large matrices: O(n^3) in total.  The permuted identity is written
+	 * straight into Ai and solved in place, so that only LU and Ai take
+	 * n x n entries.
 	 * @tparam T template value.
 	 * @param A matrix to invert.
 	 * @param Ai inverted matrix.
+	 * @throws anpi::Exception if A is not square or singular.
 	 */
 	template<typename T>
 	void invert(const anpi::Matrix<T>& A,
               anpi::Matrix<T>& Ai) {
 
-		size_t size =  A.cols();
-		
-
-		std::vector<T> I_j (size,T(0));
-		std::vector<T> AiT_j (size,T(0));
-		
+		const LUFactorization<T> factorization(A);
+		const std::vector<size_t>& permut = factorization.permutation();
 
-		size_t i,j;
+		const size_t size = A.rows();
 		Ai.allocate(size,size);
-
-		for( i = 0; i< size; ++i){
-			I_j[i] = T(1);
-			solveLU(A, AiT_j, I_j);
-
-			
-
-			for( j = 0; j<size; ++j){
-				Ai[j][i] = AiT_j[j];
-			}
-			I_j[i] = T(0);			
-
+		Ai.fill(T(0));
+		for (size_t i = 0; i < size; ++i) {
+			Ai[i][permut[i]] = T(1);
 		}
+
+		detail::trsmLU(factorization.packed(),Ai);
 	}
 
 	
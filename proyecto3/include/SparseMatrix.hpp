@@ -0,0 +1,281 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_SPARSE_MATRIX_HPP
+#define ANPI_SPARSE_MATRIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "MatrixLayout.hpp"
+
+namespace anpi
+{
+  /**
+   * Compressed sparse matrix.
+   *
+   * Only the non-zero entries are stored, line after line, where the
+   * lines are the rows for RowMajor (CSR, compressed sparse rows) and
+   * the columns for ColMajor (CSC, compressed sparse columns), as for
+   * anpi::Matrix.  Three arrays hold the matrix:
+   *
+   * - offsets(): lines()+1 entries; the non-zeros of line l are those
+   *   in [offsets()[l],offsets()[l+1])
+   * - indices(): column (CSR) or row (CSC) of each non-zero, sorted
+   *   increasingly within each line
+   * - values(): value of each non-zero
+   *
+   * Systems like the Kirchhoff equations of a resistor grid or the
+   * stencil of the thermal plate have at most five non-zeros per row,
+   * so that the products cost O(non-zeros) instead of O(rows*cols).
+   *
+   * The matrices are assembled with a SparseBuilder from triplets in
+   * any order, or converted from a dense anpi::Matrix:
+   *
+   * \code
+   * anpi::SparseBuilder<double> b(n,n);
+   * for (size_t i=0;i<n;++i) {
+   *   b.add(i,i,2.0);
+   *   if (i>0) b.add(i,i-1,-1.0);
+   * }
+   * anpi::SparseMatrix<double> a = b.build();
+   * std::vector<double> y = a*x;
+   * \endcode
+   *
+   * The indices have 32 bits, which halves their memory traffic in the
+   * products, and permits the SIMD gathers of bits/SparseMultiply.hpp.
+   * Hence, both dimensions must be smaller than 2^31.
+   */
+  template<typename T,class Layout=RowMajor>
+  class SparseMatrix {
+  public:
+    /**
+     * @name Standard types
+     */
+    //@{
+    typedef T             value_type;
+    typedef Layout        layout_type;
+    typedef std::uint32_t index_type;
+    //@}
+
+  private:
+    /// The other format, for the conversions and transpose()
+    template<typename,class> friend class SparseMatrix;
+
+    /// Number of rows
+    size_t _rows;
+
+    /// Number of columns
+    size_t _cols;
+
+    /// Start of each line in _indices and _values, plus the end
+    std::vector<size_t> _offsets;
+
+    /// Column (CSR) or row (CSC) of each non-zero
+    std::vector<index_type> _indices;
+
+    /// Value of each non-zero
+    std::vector<T> _values;
+
+  public:
+    /**
+     * @name Constructors
+     */
+    //@{
+
+    /// Empty 0x0 matrix
+    SparseMatrix();
+
+    /**
+     * All-zero matrix of the given size
+     *
+     * @throws anpi::Exception if a dimension does not fit the indices
+     */
+    SparseMatrix(const size_t rows,const size_t cols);
+
+    /**
+     * Take over the compressed arrays, in the format described above.
+     *
+     * @throws anpi::Exception if the arrays are inconsistent, or if an
+     *         index is out of range or not sorted within its line.
+     */
+    SparseMatrix(const size_t rows,
+                 const size_t cols,
+                 std::vector<size_t>&& offsets,
+                 std::vector<index_type>&& indices,
+                 std::vector<T>&& values);
+
+    /**
+     * Non-zero entries of a dense matrix.  Entries equal to T(0) are
+     * not stored.
+     */
+    template<class Alloc,class DLayout>
+    explicit SparseMatrix(const Matrix<T,Alloc,DLayout>& dense);
+
+    /// The same matrix in the other compressed format (CSR <-> CSC)
+    explicit
+    SparseMatrix(const SparseMatrix<T,typename Layout::transposed>& other);
+    //@}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Number of lines: rows for CSR, columns for CSC
+    inline size_t lines() const { return Layout::lines(_rows,_cols); }
+
+    /// Number of stored entries
+    inline size_t nonZeros() const { return _values.size(); }
+
+    /// Start of each line, plus the end (lines()+1 entries)
+    inline const size_t* offsets() const { return _offsets.data(); }
+
+    /// Column (CSR) or row (CSC) of each stored entry
+    inline const index_type* indices() const { return _indices.data(); }
+
+    /// Value of each stored entry
+    inline const T* values() const { return _values.data(); }
+
+    /// Value of each stored entry, which may be modified in place
+    inline T* values() { return _values.data(); }
+
+    /**
+     * Entry at the given position, found by binary search within its
+     * line.  Entries not stored are zero.
+     */
+    T operator()(const size_t row,const size_t col) const;
+
+    /**
+     * The transposed matrix, in the other compressed format.  It has
+     * exactly the same arrays, so that only a copy is done.
+     */
+    SparseMatrix<T,typename Layout::transposed> transpose() const;
+
+    /// Dense copy with the given allocator and layout
+    template<class Alloc,class DLayout>
+    void toDense(Matrix<T,Alloc,DLayout>& dense) const;
+
+    /// Dense row-major copy
+    Matrix<T> toDense() const;
+  }; // class SparseMatrix
+
+
+  /**
+   * Assembly of sparse matrices from (row,column,value) triplets.
+   *
+   * The triplets can be added in any order, and repeated positions are
+   * summed in the order they were added, as the contributions of each
+   * resistor or each cell to the equations are usually assembled.
+   * build() sorts them into a compressed matrix with two counting sorts,
+   * in O(non-zeros + rows + columns).
+   */
+  template<typename T>
+  class SparseBuilder {
+  public:
+    typedef std::uint32_t index_type;
+
+  private:
+    /// Number of rows
+    size_t _rows;
+
+    /// Number of columns
+    size_t _cols;
+
+    /// Row of each triplet
+    std::vector<index_type> _r;
+
+    /// Column of each triplet
+    std::vector<index_type> _c;
+
+    /// Value of each triplet
+    std::vector<T> _v;
+
+  public:
+    /**
+     * Builder of a rows x cols matrix
+     *
+     * @throws anpi::Exception if a dimension does not fit the indices
+     */
+    SparseBuilder(const size_t rows,const size_t cols);
+
+    /// Reserve memory for the given number of triplets
+    void reserve(const size_t triplets);
+
+    /**
+     * Add value to the entry (row,col)
+     *
+     * @throws anpi::Exception if the position is out of range
+     */
+    void add(const size_t row,const size_t col,const T value);
+
+    /// Number of triplets added
+    inline size_t size() const { return _v.size(); }
+
+    /// Remove all triplets
+    void clear();
+
+    /// Compressed matrix with the sums of the triplets
+    template<class Layout=RowMajor>
+    SparseMatrix<T,Layout> build() const;
+  }; // class SparseBuilder
+
+
+  /**
+   * @name Sparse matrix-vector products
+   *
+   * Computed in O(non-zeros).  Matrices with at least
+   * parallel::spmvThreshold() non-zeros are split among the threads,
+   * each one with about the same number of non-zeros.
+   */
+  //@{
+
+  /**
+   * Product y = alpha*a*x + beta*y, as the dense anpi::gemv().
+   *
+   * CSR matrices compute one dot product per row, with the SIMD gathers
+   * for float and double.  CSC matrices add up the scaled columns.
+   *
+   * @throws anpi::Exception if the sizes of a, x and y do not match.
+   */
+  template<typename T,class Layout>
+  void gemv(const SparseMatrix<T,Layout>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const T alpha = T(1),
+            const T beta  = T(0));
+
+  /**
+   * Product with the transposed matrix y = alpha*a^T*x + beta*y, which
+   * reads the same arrays as gemv() in the other order: it adds up the
+   * scaled rows of a CSR matrix, and computes one dot product per
+   * column of a CSC one.
+   *
+   * @throws anpi::Exception if the sizes of a, x and y do not match.
+   */
+  template<typename T,class Layout>
+  void gemvTransposed(const SparseMatrix<T,Layout>& a,
+                      const std::vector<T>& x,
+                      std::vector<T>& y,
+                      const T alpha = T(1),
+                      const T beta  = T(0));
+
+  /// Product a*x
+  template<typename T,class Layout>
+  std::vector<T> operator*(const SparseMatrix<T,Layout>& a,
+                           const std::vector<T>& x);
+  //@}
+
+} // namespace anpi
+
+#include "SparseMatrix.tpp"
+
+#endif
@@ -0,0 +1,372 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "bits/SparseMultiply.hpp"
+
+namespace anpi
+{
+  namespace detail {
+    /// Largest dimension the 32 bit indices (and the gathers) support
+    constexpr size_t maxSparseDim = size_t(1) << 31;
+
+    /// Check that both dimensions fit the indices
+    inline void checkSparseSize(const size_t rows,const size_t cols) {
+      if ((rows >= maxSparseDim) || (cols >= maxSparseDim)) {
+        throw anpi::Exception("Sparse matrix dimensions must be below 2^31");
+      }
+    }
+
+    // y = alpha*op(a)*x + beta*y with one dot product per line
+    template<typename T,class Layout>
+    inline void sparseMultiply(const SparseMatrix<T,Layout>& a,
+                               const T* x,
+                               T* y,
+                               const size_t,
+                               const T alpha,
+                               const T beta,
+                               std::true_type /*gather*/) {
+      ::anpi::aimpl::csrmv(a.lines(),a.offsets(),a.indices(),a.values(),
+                           x,y,alpha,beta);
+    }
+
+    // y = alpha*op(a)*x + beta*y adding up the scaled lines, where y has
+    // n entries
+    template<typename T,class Layout>
+    inline void sparseMultiply(const SparseMatrix<T,Layout>& a,
+                               const T* x,
+                               T* y,
+                               const size_t n,
+                               const T alpha,
+                               const T beta,
+                               std::false_type /*gather*/) {
+      ::anpi::aimpl::cscmv(a.lines(),n,a.offsets(),a.indices(),a.values(),
+                           x,y,alpha,beta);
+    }
+  } // namespace detail
+
+  // ------------------------------
+  // Implementation of SparseMatrix
+  // ------------------------------
+
+  template<typename T,class Layout>
+  SparseMatrix<T,Layout>::SparseMatrix()
+    : _rows(0), _cols(0), _offsets(1,0) { }
+
+  template<typename T,class Layout>
+  SparseMatrix<T,Layout>::SparseMatrix(const size_t rows,const size_t cols)
+    : _rows(rows), _cols(cols) {
+    detail::checkSparseSize(rows,cols);
+    _offsets.assign(lines()+1,0);
+  }
+
+  template<typename T,class Layout>
+  SparseMatrix<T,Layout>::SparseMatrix(const size_t rows,
+                                       const size_t cols,
+                                       std::vector<size_t>&& offsets,
+                                       std::vector<index_type>&& indices,
+                                       std::vector<T>&& values)
+    : _rows(rows), _cols(cols),
+      _offsets(std::move(offsets)),
+      _indices(std::move(indices)),
+      _values(std::move(values)) {
+
+    detail::checkSparseSize(rows,cols);
+
+    if ( (_offsets.size() != lines()+1) || (_offsets.front() != 0) ||
+         (_offsets.back() != _indices.size()) ||
+         (_indices.size() != _values.size()) ) {
+      throw anpi::Exception("Inconsistent sizes of the sparse arrays");
+    }
+
+    const size_t length = Layout::lineLength(_rows,_cols);
+    for (size_t l=0;l<lines();++l) {
+      if (_offsets[l] > _offsets[l+1]) {
+        throw anpi::Exception("Sparse offsets must not decrease");
+      }
+      for (size_t k=_offsets[l];k<_offsets[l+1];++k) {
+        if ( (_indices[k] >= length) ||
+             ((k > _offsets[l]) && (_indices[k] <= _indices[k-1])) ) {
+          throw anpi::Exception("Sparse index out of range or unsorted");
+        }
+      }
+    }
+  }
+
+  template<typename T,class Layout>
+  template<class Alloc,class DLayout>
+  SparseMatrix<T,Layout>::SparseMatrix(const Matrix<T,Alloc,DLayout>& dense)
+    : _rows(dense.rows()), _cols(dense.cols()) {
+
+    detail::checkSparseSize(_rows,_cols);
+
+    constexpr bool csr = std::is_same<Layout,RowMajor>::value;
+    const size_t length = Layout::lineLength(_rows,_cols);
+
+    _offsets.reserve(lines()+1);
+    _offsets.push_back(0);
+    for (size_t l=0;l<lines();++l) {
+      for (size_t i=0;i<length;++i) {
+        const T& v = csr ? dense(l,i) : dense(i,l);
+        if (v != T(0)) {
+          _indices.push_back(index_type(i));
+          _values.push_back(v);
+        }
+      }
+      _offsets.push_back(_values.size());
+    }
+  }
+
+  template<typename T,class Layout>
+  SparseMatrix<T,Layout>::
+  SparseMatrix(const SparseMatrix<T,typename Layout::transposed>& other)
+    : _rows(other._rows), _cols(other._cols),
+      _offsets(lines()+1,0),
+      _indices(other.nonZeros()),
+      _values(other.nonZeros()) {
+
+    // Counting sort of the non-zeros by their index in the other
+    // format, which is the line here.  The old lines are visited in
+    // order, so that the new indices end up sorted.
+    for (size_t k=0;k<other.nonZeros();++k) {
+      ++_offsets[other._indices[k]+1];
+    }
+    for (size_t l=0;l<lines();++l) {
+      _offsets[l+1] += _offsets[l];
+    }
+
+    std::vector<size_t> next(_offsets.begin(),_offsets.end()-1);
+    for (size_t ol=0;ol<other.lines();++ol) {
+      for (size_t k=other._offsets[ol];k<other._offsets[ol+1];++k) {
+        const size_t pos = next[other._indices[k]]++;
+        _indices[pos] = index_type(ol);
+        _values[pos]  = other._values[k];
+      }
+    }
+  }
+
+  template<typename T,class Layout>
+  T SparseMatrix<T,Layout>::operator()(const size_t row,
+                                       const size_t col) const {
+    assert( (row < _rows) && (col < _cols) );
+
+    constexpr bool csr = std::is_same<Layout,RowMajor>::value;
+    const size_t line  = csr ? row : col;
+    const index_type i = index_type(csr ? col : row);
+
+    const index_type* first = _indices.data() + _offsets[line];
+    const index_type* last  = _indices.data() + _offsets[line+1];
+    const index_type* pos   = std::lower_bound(first,last,i);
+
+    return ((pos != last) && (*pos == i))
+      ? _values[size_t(pos - _indices.data())] : T(0);
+  }
+
+  template<typename T,class Layout>
+  SparseMatrix<T,typename Layout::transposed>
+  SparseMatrix<T,Layout>::transpose() const {
+    SparseMatrix<T,typename Layout::transposed> t;
+    t._rows    = _cols;
+    t._cols    = _rows;
+    t._offsets = _offsets;
+    t._indices = _indices;
+    t._values  = _values;
+    return t;
+  }
+
+  template<typename T,class Layout>
+  template<class Alloc,class DLayout>
+  void SparseMatrix<T,Layout>::toDense(Matrix<T,Alloc,DLayout>& dense) const {
+    constexpr bool csr = std::is_same<Layout,RowMajor>::value;
+
+    dense.allocate(_rows,_cols);
+    dense.fill(T(0));
+    for (size_t l=0;l<lines();++l) {
+      for (size_t k=_offsets[l];k<_offsets[l+1];++k) {
+        if (csr) {
+          dense(l,_indices[k]) = _values[k];
+        } else {
+          dense(_indices[k],l) = _values[k];
+        }
+      }
+    }
+  }
+
+  template<typename T,class Layout>
+  Matrix<T> SparseMatrix<T,Layout>::toDense() const {
+    Matrix<T> dense;
+    toDense(dense);
+    return dense;
+  }
+
+  // -------------------------------
+  // Implementation of SparseBuilder
+  // -------------------------------
+
+  template<typename T>
+  SparseBuilder<T>::SparseBuilder(const size_t rows,const size_t cols)
+    : _rows(rows), _cols(cols) {
+    detail::checkSparseSize(rows,cols);
+  }
+
+  template<typename T>
+  void SparseBuilder<T>::reserve(const size_t triplets) {
+    _r.reserve(triplets);
+    _c.reserve(triplets);
+    _v.reserve(triplets);
+  }
+
+  template<typename T>
+  void SparseBuilder<T>::add(const size_t row,const size_t col,const T value) {
+    if ((row >= _rows) || (col >= _cols)) {
+      throw anpi::Exception("Sparse entry out of range");
+    }
+    _r.push_back(index_type(row));
+    _c.push_back(index_type(col));
+    _v.push_back(value);
+  }
+
+  template<typename T>
+  void SparseBuilder<T>::clear() {
+    _r.clear();
+    _c.clear();
+    _v.clear();
+  }
+
+  template<typename T>
+  template<class Layout>
+  SparseMatrix<T,Layout> SparseBuilder<T>::build() const {
+    constexpr bool csr = std::is_same<Layout,RowMajor>::value;
+    const std::vector<index_type>& line  = csr ? _r : _c;
+    const std::vector<index_type>& index = csr ? _c : _r;
+
+    const size_t lines  = Layout::lines(_rows,_cols);
+    const size_t length = Layout::lineLength(_rows,_cols);
+    const size_t n      = _v.size();
+
+    // Two stable counting sorts: by index, then by line, so that the
+    // triplets end up sorted by line and by index within each line,
+    // with repeated positions in the order they were added
+    std::vector<size_t> byIndex(n);
+    {
+      std::vector<size_t> next(length+1,0);
+      for (size_t k=0;k<n;++k) {
+        ++next[index[k]+1];
+      }
+      for (size_t i=0;i<length;++i) {
+        next[i+1] += next[i];
+      }
+      for (size_t k=0;k<n;++k) {
+        byIndex[next[index[k]]++] = k;
+      }
+    }
+
+    std::vector<size_t> sorted(n);
+    std::vector<size_t> first(lines+1,0);
+    {
+      for (size_t k=0;k<n;++k) {
+        ++first[line[k]+1];
+      }
+      for (size_t l=0;l<lines;++l) {
+        first[l+1] += first[l];
+      }
+      std::vector<size_t> next(first.begin(),first.end()-1);
+      for (const size_t k : byIndex) {
+        sorted[next[line[k]]++] = k;
+      }
+    }
+
+    // Sum the repeated positions
+    std::vector<size_t> offsets(lines+1,0);
+    std::vector<index_type> indices;
+    std::vector<T> values;
+    indices.reserve(n);
+    values.reserve(n);
+
+    for (size_t l=0;l<lines;++l) {
+      for (size_t s=first[l];s<first[l+1];++s) {
+        const size_t k = sorted[s];
+        if ((indices.size() > offsets[l]) && (indices.back() == index[k])) {
+          values.back() += _v[k];
+        } else {
+          indices.push_back(index[k]);
+          values.push_back(_v[k]);
+        }
+      }
+      offsets[l+1] = indices.size();
+    }
+
+    return SparseMatrix<T,Layout>(_rows,_cols,std::move(offsets),
+                                  std::move(indices),std::move(values));
+  }
+
+  // ---------------------------------
+  // Sparse matrix-vector products
+  // ---------------------------------
+
+  template<typename T,class Layout>
+  void gemv(const SparseMatrix<T,Layout>& a,
+            const std::vector<T>& x,
+            std::vector<T>& y,
+            const T alpha,
+            const T beta) {
+
+    if (a.cols() != x.size()) {
+      throw anpi::Exception("A number of columns and x size don't match.");
+    }
+
+    if (y.size() != a.rows()) {
+      if (beta != T(0)) {
+        throw anpi::Exception("A number of rows and y size don't match.");
+      }
+      y.resize(a.rows());
+    }
+
+    assert( (&x != &y) && "x and y must not alias" );
+
+    typedef std::integral_constant<bool,std::is_same<Layout,RowMajor>::value>
+      gather;
+    detail::sparseMultiply(a,x.data(),y.data(),y.size(),alpha,beta,gather());
+  }
+
+  template<typename T,class Layout>
+  void gemvTransposed(const SparseMatrix<T,Layout>& a,
+                      const std::vector<T>& x,
+                      std::vector<T>& y,
+                      const T alpha,
+                      const T beta) {
+
+    if (a.rows() != x.size()) {
+      throw anpi::Exception("A number of rows and x size don't match.");
+    }
+
+    if (y.size() != a.cols()) {
+      if (beta != T(0)) {
+        throw anpi::Exception("A number of columns and y size don't match.");
+      }
+      y.resize(a.cols());
+    }
+
+    assert( (&x != &y) && "x and y must not alias" );
+
+    typedef std::integral_constant<bool,std::is_same<Layout,ColMajor>::value>
+      gather;
+    detail::sparseMultiply(a,x.data(),y.data(),y.size(),alpha,beta,gather());
+  }
+
+  template<typename T,class Layout>
+  std::vector<T> operator*(const SparseMatrix<T,Layout>& a,
+                           const std::vector<T>& x) {
+    std::vector<T> y;
+    gemv(a,x,y);
+    return y;
+  }
+
+} // namespace anpi
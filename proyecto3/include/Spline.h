@@ -32,6 +32,8 @@
 #include <vector>
 #include <algorithm>
 
+#include "BandMatrix.hpp"
+
 
 // unnamed namespace only because the implementation is in this
 // header file and we don't want to export symbols to the obj files
@@ -41,46 +43,6 @@ namespace
 namespace tk
 {
 
-// band matrix solver
-/**
- * class band_matrix
- * @brief band matrix resolver.
- */
-class Band_matrix
-{
-private:
-
-    std::vector< std::vector<float> > m_upper;  /// upper band
-    std::vector< std::vector<float> > m_lower;  /// lower band
-public:
-    Band_matrix() {};                             /// constructor
-    Band_matrix(int dim, int n_u, int n_l);       /// constructor
-    ~Band_matrix() {};                            /// destructor
-    void resize(int dim, int n_u, int n_l);      /// init with dim,n_u,n_l
-    int dim() const;                             /// matrix dimension
-    int num_upper() const
-    {
-        return m_upper.size()-1;
-    }
-    int num_lower() const
-    {
-        return m_lower.size()-1;
-    }
-    // access operator
-    float & operator () (int i, int j);            /// write
-    float   operator () (int i, int j) const;      /// read
-    /// we can store an additional diogonal (in m_lower)
-    float& saved_diag(int i);
-    float  saved_diag(int i) const;
-    void lu_decompose();
-    std::vector<float> r_solve(const std::vector<float>& b) const;
-    std::vector<float> l_solve(const std::vector<float>& b) const;
-    std::vector<float> lu_solve(const std::vector<float>& b,
-                                 bool is_lu_decomposed=false);
-
-};
-
-
 // spline interpolation
 /**
  * class spline
@@ -149,223 +111,6 @@ public:
 /// ---------------------------------------------------------------------
 
 
-/// Band_matrix implementation
-/// -------------------------
-
-/**
- * @brief class's constructor
- * @param dim dimension of the matrix.
- * @param n_u numbers to fill L section of the matrix.
- * @param n_l numbers to fill U section of the matrix.
- */
-Band_matrix::Band_matrix(int dim, int n_u, int n_l)
-{
-    resize(dim, n_u, n_l);
-}
-
-/**
- * @brief used to resize a matrix.
- * @param dim dimension of the matrix.
- * @param n_u numbers to fill L section of the matrix.
- * @param n_l numbers to fill U section of the matrix.
- */
-void Band_matrix::resize(int dim, int n_u, int n_l)
-{
-    assert(dim>0);
-    assert(n_u>=0);
-    assert(n_l>=0);
-    m_upper.resize(n_u+1);
-    m_lower.resize(n_l+1);
-    for(size_t i=0; i<m_upper.size(); i++) {
-        m_upper[i].resize(dim);
-    }
-    for(size_t i=0; i<m_lower.size(); i++) {
-        m_lower[i].resize(dim);
-    }
-}
-
-/**
- * @brief used to know the upper matrix size.
- * @return size of the upper matrix.
- */
-int Band_matrix::dim() const
-{
-    if(m_upper.size()>0) {
-        return m_upper[0].size();
-    } else {
-        return 0;
-    }
-}
-
-
-// defines the new operator (), so that we can access the elements
-// by A(i,j), index going from i=0,...,dim()-1
-
-/**
- * @brief operator () overload.
- * @details defines the new operator (), so that we can access the elements
- * by A(i,j), index going from i=0,...,dim()-1.
- * @param i rows index.
- * @param j columns index
- * @return matrix's element.
- */
-float & Band_matrix::operator () (int i, int j)
-{
-    int k=j-i;       /// what band is the entry
-    assert( (i>=0) && (i<dim()) && (j>=0) && (j<dim()) );
-    assert( (-num_lower()<=k) && (k<=num_upper()) );
-    /// k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if(k>=0)   return m_upper[k][i];
-    else	    return m_lower[-k][i];
-}
-
-/**
- * @brief operator () overload.
- * @details defines the new operator (), so that we can access the elements
- * by A(i,j), index going from i=0,...,dim()-1.
- * @param i rows index.
- * @param j columns index
- * @return matrix's element.
- */
-float Band_matrix::operator () (int i, int j) const
-{
-    int k=j-i;       /// what band is the entry
-    assert( (i>=0) && (i<dim()) && (j>=0) && (j<dim()) );
-    assert( (-num_lower()<=k) && (k<=num_upper()) );
-    /// k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if(k>=0)   return m_upper[k][i];
-    else	    return m_lower[-k][i];
-}
-
-// second diag (used in LU decomposition), saved in m_lower
-/**
- * @brief second diag (used in LU decomposition), saved in m_lower
- * @param i column index
- * @return matrix's element
- */
-float Band_matrix::saved_diag(int i) const
-{
-    assert( (i>=0) && (i<dim()) );
-    return m_lower[0][i];
-}
-
-/**
- * @brief second diag (used in LU decomposition), saved in m_lower
- * @param i column index
- * @return matrix's element
- */
-float & Band_matrix::saved_diag(int i)
-{
-    assert( (i>=0) && (i<dim()) );
-    return m_lower[0][i];
-}
-
-// LR-Decomposition of a band matrix
-
-
-/**
- * @brief LR-Decomposition of a band matrix.
- */
-void Band_matrix::lu_decompose()
-{
-    int  i_max,j_max;
-    int  j_min;
-    float x;
-
-    // preconditioning
-    // normalize column i so that a_ii=1
-    for(int i=0; i<this->dim(); i++) {
-        assert(this->operator()(i,i)!=0.0);
-        this->saved_diag(i)=1.0/this->operator()(i,i);
-        j_min=std::max(0,i-this->num_lower());
-        j_max=std::min(this->dim()-1,i+this->num_upper());
-        for(int j=j_min; j<=j_max; j++) {
-            this->operator()(i,j) *= this->saved_diag(i);
-        }
-        this->operator()(i,i)=1.0;          // prevents rounding errors
-    }
-
-    // Gauss LR-Decomposition
-    for(int k=0; k<this->dim(); k++) {
-        i_max=std::min(this->dim()-1,k+this->num_lower());  // num_lower not a mistake!
-        for(int i=k+1; i<=i_max; i++) {
-            assert(this->operator()(k,k)!=0.0);
-            x=-this->operator()(i,k)/this->operator()(k,k);
-            this->operator()(i,k)=-x;                         // assembly part of L
-            j_max=std::min(this->dim()-1,k+this->num_upper());
-            for(int j=k+1; j<=j_max; j++) {
-                // assembly part of R
-                this->operator()(i,j)=this->operator()(i,j)+x*this->operator()(k,j);
-            }
-        }
-    }
-}
-// solves Ly=b
-
-/**
- * @brief solves Ly=b.
- * @param b vector b of solutions.
- * @return return x vector of unknowns.
- */
-std::vector<float> Band_matrix::l_solve(const std::vector<float>& b) const
-{
-    assert( this->dim()==(int)b.size() );
-    std::vector<float> x(this->dim());
-    int j_start;
-    float sum;
-    for(int i=0; i<this->dim(); i++) {
-        sum=0;
-        j_start=std::max(0,i-this->num_lower());
-        for(int j=j_start; j<i; j++) sum += this->operator()(i,j)*x[j];
-        x[i]=(b[i]*this->saved_diag(i)) - sum;
-    }
-    return x;
-}
-// solves Rx=y
-
-/**
- * @brief solves Rx=y.
- * @param b vector b of solutions.
- * @return return x vector of unknowns.
- */
-std::vector<float> Band_matrix::r_solve(const std::vector<float>& b) const
-{
-    assert( this->dim()==(int)b.size() );
-    std::vector<float> x(this->dim());
-    int j_stop;
-    float sum;
-    for(int i=this->dim()-1; i>=0; i--) {
-        sum=0;
-        j_stop=std::min(this->dim()-1,i+this->num_upper());
-        for(int j=i+1; j<=j_stop; j++) sum += this->operator()(i,j)*x[j];
-        x[i]=( b[i] - sum ) / this->operator()(i,i);
-    }
-    return x;
-}
-
-/**
- * @brief lu solver.
- * @param b vector b of solutions.
- * @param is_lu_decomposed indicates that the matrix was already decomposed by LU.
- * @return return x vector of unknowns.
- */
-
-std::vector<float> Band_matrix::lu_solve(const std::vector<float>& b,
-        bool is_lu_decomposed)
-{
-    assert( this->dim()==(int)b.size() );
-    std::vector<float>  x,y;
-    if(is_lu_decomposed==false) {
-        this->lu_decompose();
-    }
-    y=this->l_solve(b);
-    x=this->r_solve(y);
-    return x;
-}
-
-
-
-
 // spline implementation
 // -----------------------
 
@@ -411,7 +156,7 @@ void spline::set_points(const std::vector<float>& x,
     if(cubic_spline==true) { // cubic spline interpolation
         // setting up the matrix and right hand side of the equation system
         // for the parameters b[]
-        Band_matrix A(n,1,1);
+        anpi::BandMatrix<float> A(n,1,1);
         std::vector<float>  rhs(n);
         for(int i=1; i<n-1; i++) {
             A(i,i-1)=1.0/3.0*(x[i]-x[i-1]);
@@ -451,7 +196,8 @@ void spline::set_points(const std::vector<float>& x,
         }
 
         // solve the equation system to obtain the parameters b[]
-        m_b=A.lu_solve(rhs);
+        anpi::luBand(A,A);
+        anpi::solveLUBand(A,m_b,rhs);
 
         // calculate parameters a[] and c[] based on b[]
         m_a.resize(n);
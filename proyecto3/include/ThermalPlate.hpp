@@ -518,9 +518,9 @@ namespace anpi{
       A[1][1] = ( A[0][1] + A[1][0] + A[1][2] + A[2][1] )/4;
       Y = A;
       for (size_t k = 0; k < maxIterations; ++k){
-        A.clear();
-        A = Y;
-        Y.clear();
+        // The last level becomes the input of the next one without a
+        // copy; only the new, larger level is allocated
+        A = std::move(Y);
         scale_matrix(A,Y);        
         std::cout << "iteration: "<< k+1 << "\tnumber of rows = "<< A.rows() << std::endl;          
       }
@@ -567,34 +567,31 @@ namespace anpi{
       size_t cols = Y.cols();
       
       /// creates the U and V matrix
-      std::ofstream Umatrix;
-      std::ofstream Vmatrix;
-
-      Umatrix.open ("Umatrix.txt");
-      Vmatrix.open ("Vmatrix.txt");
+      Matrix<T> U;
+      Matrix<T> V;
 
       if (showThermalFlow){
 
-        float valueX  = 0.0f, valueY = 0.0f;
-        //generating U matrix (X changes)
+        U.allocate(rows-2,cols-2);
+        V.allocate(rows-2,cols-2);
+
+        //generating U matrix (X changes) and V matrix (Y changes)
+        #pragma omp parallel for
         for(size_t i = 1; i< rows-1 ; ++i){
           for(size_t j = 1; j<cols-1; ++j){
-            valueX = ( Y[i][j-1] - Y[i][j+1] )/(max);
-            Umatrix << valueX << ' ';
-            valueY = ( Y[i+1][j] - Y[i-1][j] )/(max);
-            Vmatrix << valueY << ' ';
+            U[i-1][j-1] = ( Y[i][j-1] - Y[i][j+1] )/(max);
+            V[i-1][j-1] = ( Y[i+1][j] - Y[i-1][j] )/(max);
           }
-          Umatrix << '\n';
-          Vmatrix << '\n';
         }
+      }
+
+      /// binary files, empty if the flow is not shown
+      U.save("Umatrix.bin");
+      V.save("Vmatrix.bin");
 
+      if (showThermalFlow){
         std::cout << "Saved matix U and V !\n";
       }
-      Umatrix << '\n';
-      Vmatrix << '\n';
-      
-      Umatrix.close();
-      Vmatrix.close();
 
     }
 
@@ -606,7 +603,10 @@ namespace anpi{
       calculatePlate(A,Y,eps, maxIterations);
 
       
-      matrix_show_file(Y, noVisuals);      
+      if (!noVisuals){
+        Y.save("matrix.bin");
+        std::cout << "Saved matix to file: matrix.bin\n";
+      }
       A.clear();      
       getUV(Y);        
       Y.clear();
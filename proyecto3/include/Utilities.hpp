@@ -11,6 +11,7 @@
 
 #include "Exception.hpp"
 #include "Matrix.hpp"
+#include "CpuFeatures.hpp"
 
 #ifndef ANPI_UTILITIES_HPP
 #define ANPI_UTILITIES_HPP
@@ -33,8 +34,8 @@ namespace anpi {
   * @param row2Index Index of the row 2
   * @param start value where we want to start.
   */
-  template<typename T>
-  void swapRows(Matrix<T>& A, size_t row1Index, size_t row2Index, size_t start){
+  template<typename T,class Alloc>
+  void swapRows(Matrix<T,Alloc>& A, size_t row1Index, size_t row2Index, size_t start){
     if(row1Index != row2Index){
       for(size_t i = start; i <  A.cols(); ++i){
         T temp = A[row1Index][i];
@@ -45,47 +46,42 @@ namespace anpi {
   }
 
 
-  #ifdef ANPI_ENABLE_SIMD
-    #ifdef __AVX__
+} // namespace anpi
+
+// The row swapping kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/UtilitiesSIMD.tpp"
+#include "bits/SimdTargets.hpp"
+
+namespace anpi {
+
+  namespace simd {
 
     /**
-      * @brief Used to swap the rows of any matrix using simd instructions.
+      * @brief Used to swap the complete rows of a matrix using the
+      * best SIMD instructions available.
       *
       * @tparam T template value
-      * @tparam regType template value of the register.
-      * @param LU Matrix to we want to swap his rows.
-      * @param r1 size of row 1.
-      * @param r2 size of row 2.
+      * @param A Matrix to we want to swap his rows.
+      * @param r1 Index of the row 1.
+      * @param r2 Index of the row 2.
       */
-    template<typename T,typename regType>
-    void swapRowsSIMD(Matrix<T>& LU,size_t r1,size_t r2){
-
-      //std::cout << "-\n-\n-\n" << "sizeof T: "<< sizeof(T)
-      //    <<"\nsize of regType: "<< sizeof(regType) <<"-\n-\n-\n"<< std::endl;
-      
-      unsigned long int regSize = sizeof(regType);
-
-
-      //temporary element        
-      regType element;
-      regType* r1ptr = reinterpret_cast<regType*>(LU[r1]);
-      regType* r2ptr = reinterpret_cast<regType*>(LU[r2]);
-
-
-      ///total size in bytes of a row
-      long unsigned int colsXsize = (long unsigned int) (LU.cols()) * (long unsigned int)(sizeof(T));
+    template<typename T,
+             class Alloc,
+             typename std::enable_if<is_simd_type<T>::value,int>::type=0>
+    inline void swapRows(Matrix<T,Alloc>& A,size_t r1,size_t r2){
+      ANPI_SIMD_DISPATCH(swapRows,A,r1,r2);
+      ::anpi::swapRows(A,r1,r2,0);
+    }
 
-      //size_t limit = LU.cols();
-      for(unsigned long int i = 0; i < colsXsize; i+=regSize ){
-        //swaping the current element block at index i, between the rows.
-        element = *r1ptr;
-        *r1ptr++ = *r2ptr;
-        *r2ptr++ = element;
-      }    
-      
+    // Non-SIMD types such as complex
+    template<typename T,
+             class Alloc,
+             typename std::enable_if<!is_simd_type<T>::value,int>::type=0>
+    inline void swapRows(Matrix<T,Alloc>& A,size_t r1,size_t r2){
+      ::anpi::swapRows(A,r1,r2,0);
     }
-    #endif
-  #endif
+
+  } // namespace simd
 
 
  /**
@@ -97,26 +93,18 @@ namespace anpi {
   * @param rowStart row where to start the pivoting process.
   * @param permut permutation vector.
   */
-  template<typename T>
-  void pivot(Matrix<T>& A, size_t columnIndex, size_t columnStart, size_t rowStart, std::vector<size_t>& permut){
+  template<typename T,class Alloc>
+  void pivot(Matrix<T,Alloc>& A, size_t columnIndex, size_t columnStart, size_t rowStart, std::vector<size_t>& permut){
     //Finds the maximun element in the first column to do the pivot
-    T max = A[rowStart][columnIndex];
-    size_t maxI = rowStart;
-    for(size_t p = rowStart + 1; p < A.rows(); ++p){
-      if(std::abs(A[p][columnIndex]) > std::abs(max)){
-        maxI = p;
-        max = A[p][columnIndex];
-      }
-    }
+    size_t maxI;
+    ::anpi::aimpl::iamax(A[rowStart] + columnIndex, A.rows() - rowStart,
+                         A.dcols(), maxI);
+    maxI += rowStart;
     //Swaps the row in the A matrix and in the vector
     if(maxI != rowStart){
 
       #ifdef ANPI_ENABLE_SIMD
-        #ifdef __AVX__
-          swapRowsSIMD<T, typename avx_traits<T>::reg_type >(A, rowStart, maxI );
-        #else
-          swapRows(A, rowStart, maxI, columnStart);
-        #endif
+          simd::swapRows(A, rowStart, maxI);
       #else
           swapRows(A, rowStart, maxI, columnStart);
       #endif
@@ -161,34 +149,6 @@ namespace anpi {
       printf("\n");
   }
 
-  //this function saves a matrix casting the values to integer of default size 3 (max number 999)
-  // saves the matrix in a file called matrix.txt
-  template<typename T>
-  static void matrix_show_file(const Matrix<T>&  m,  bool novisuals) {
-      
-      //std::stringstream ss;
-
-      std::ofstream myfile;
-      myfile.open ("matrix.txt");
-
-      if (!novisuals){
-        for(size_t i = 0; i < m.rows(); i++) {
-            for (size_t j = 0; j < m.cols(); j++) {              
-                //ss.str("");
-                //ss << std::setw(maxsize) << std::setfill (' ') << (int)(m(i,j));
-                //myfile << ss.str() << ' ';              
-                myfile << m(i,j) << ' ';
-            }
-            myfile << "\n";
-        }
-        std::cout << "Saved matix to file: matrix.txt\n";
-      }
-
-      myfile << "\n";
-
-      myfile.close();
-  }
-
   //this function prints a matrix
   template<typename T>
   std::string pymat_row(const Matrix<T>&  m, size_t i) {      
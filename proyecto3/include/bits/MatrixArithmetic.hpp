@@ -11,12 +11,31 @@
 #ifndef ANPI_MATRIX_ARITHMETIC_HPP
 #define ANPI_MATRIX_ARITHMETIC_HPP
 
+#include "Half.hpp"
 #include "Intrinsics.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
 #include <type_traits>
 
 namespace anpi
 {
   namespace fallback {
+    // c[i] = op(a[i],b[i]) for i<n, where c may be a or b, split among
+    // the threads in chunks of whole cache lines
+    template<typename T,class Op>
+    inline void binary(const T* a,const T* b,T* c,const size_t n,Op op) {
+      const int threads = parallel::elementwiseThreads(n);
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+      for (int t=0;t<threads;++t) {
+        size_t begin,end;
+        parallel::chunkRange<T>(n,threads,t,begin,end);
+        for (size_t i=begin;i<end;++i) {
+          c[i] = op(a[i],b[i]);
+        }
+      }
+    }
+
     /*
      * Sum
      */
@@ -24,45 +43,33 @@ namespace anpi
     // Fallback implementation
     
     // In-copy implementation c=a+b
-    template<typename T,class Alloc>
-    inline void add(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
+    template<typename T,class Alloc,class Layout>
+    inline void add(const Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b,
+                    Matrix<T,Alloc,Layout>& c) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
 
-      const size_t tentries = a.rows()*a.dcols();
+      const size_t tentries = a.lines()*a.dcols();
       c.allocate(a.rows(),a.cols());
-      
-      T* here        = c.data();
-      T *const end   = here + tentries;
-      const T* aptr = a.data();
-      const T* bptr = b.data();
 
-      for (;here!=end;) {
-        *here++ = *aptr++ + *bptr++;
-      }
+      binary(a.data(),b.data(),c.data(),tentries,
+             [](const T& x,const T& y) { return x + y; });
     }
 
     // In-place implementation a = a+b
-    template<typename T,class Alloc>
-    inline void add(Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b) {
+    template<typename T,class Alloc,class Layout>
+    inline void add(Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
 
-      const size_t tentries = a.rows()*a.dcols();
-      
-      T* here        = a.data();
-      T *const end   = here + tentries;
-      
-      const T* bptr = b.data();
+      const size_t tentries = a.lines()*a.dcols();
 
-      for (;here!=end;) {
-        *here++ += *bptr++;
-      }
+      binary(a.data(),b.data(),a.data(),tentries,
+             [](const T& x,const T& y) { return x + y; });
     }
 
 
@@ -73,44 +80,71 @@ namespace anpi
     // Fall back implementations
 
     // In-copy implementation c=a-b
-    template<typename T,class Alloc>
-    inline void subtract(const Matrix<T,Alloc>& a,
-                         const Matrix<T,Alloc>& b,
-                         Matrix<T,Alloc>& c) {
+    template<typename T,class Alloc,class Layout>
+    inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                         const Matrix<T,Alloc,Layout>& b,
+                         Matrix<T,Alloc,Layout>& c) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
 
-      const size_t tentries = a.rows()*a.dcols();
+      const size_t tentries = a.lines()*a.dcols();
       c.allocate(a.rows(),a.cols());
-      
-      T* here        = c.data();
-      T *const end   = here + tentries;
-      const T* aptr = a.data();
-      const T* bptr = b.data();
 
-      for (;here!=end;) {
-        *here++ = *aptr++ - *bptr++;
-      }
+      binary(a.data(),b.data(),c.data(),tentries,
+             [](const T& x,const T& y) { return x - y; });
     }
 
     // In-place implementation a = a-b
-    template<typename T,class Alloc>
-    inline void subtract(Matrix<T,Alloc>& a,
-                         const Matrix<T,Alloc>& b) {
+    template<typename T,class Alloc,class Layout>
+    inline void subtract(Matrix<T,Alloc,Layout>& a,
+                         const Matrix<T,Alloc,Layout>& b) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
       
-      const size_t tentries = a.rows()*a.dcols();
-      
-      T* here        = a.data();
-      T *const end   = here + tentries;
-      
-      const T* bptr = b.data();
+      const size_t tentries = a.lines()*a.dcols();
+
+      binary(a.data(),b.data(),a.data(),tentries,
+             [](const T& x,const T& y) { return x - y; });
+    }
 
-      for (;here!=end;) {
-        *here++ -= *bptr++;
+
+    /*
+     * Views
+     */
+
+    // Views have arbitrary strides: they are processed row by row
+
+    // In-copy implementation c=a+b
+    template<typename T>
+    inline void add(const MatrixView<const T>& a,
+                    const MatrixView<const T>& b,
+                    const MatrixView<T>& c) {
+
+      for (size_t r=0;r<c.rows();++r) {
+        const T* aptr = a[r];
+        const T* bptr = b[r];
+        T* here = c[r];
+        for (size_t j=0;j<c.cols();++j) {
+          here[j] = aptr[j] + bptr[j];
+        }
+      }
+    }
+
+    // In-copy implementation c=a-b
+    template<typename T>
+    inline void subtract(const MatrixView<const T>& a,
+                         const MatrixView<const T>& b,
+                         const MatrixView<T>& c) {
+
+      for (size_t r=0;r<c.rows();++r) {
+        const T* aptr = a[r];
+        const T* bptr = b[r];
+        T* here = c[r];
+        for (size_t j=0;j<c.cols();++j) {
+          here[j] = aptr[j] - bptr[j];
+        }
       }
     }
 
@@ -145,7 +179,8 @@ namespace anpi
     // return regType();
     //}
     
-#ifdef __AVX512F__
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
     template<>
     inline __m512d __attribute__((__always_inline__))
     mm_add<double>(__m512d a,__m512d b) {
@@ -196,7 +231,11 @@ namespace anpi
     mm_add<int8_t>(__m512i a,__m512i b) {
       return _mm512_add_epi8(a,b);
     }
-#elif defined __AVX__
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
     template<>
     inline __m256d __attribute__((__always_inline__))
     mm_add<double>(__m256d a,__m256d b) {
@@ -247,7 +286,10 @@ namespace anpi
     mm_add<int8_t>(__m256i a,__m256i b) {
       return _mm256_add_epi8(a,b);
     }
-#elif  defined __SSE2__
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
     template<>
     inline __m128d __attribute__((__always_inline__))
     mm_add<double>(__m128d a,__m128d b) {
@@ -276,7 +318,7 @@ namespace anpi
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_add<std::int32_t>(__m128i a,__m128i b) {
-      return _mm_add_epi16(a,b);
+      return _mm_add_epi32(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
@@ -286,96 +328,20 @@ namespace anpi
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_add<std::int16_t>(__m128i a,__m128i b) {
-      return _mm_add_epi32(a,b);
+      return _mm_add_epi16(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_add<std::uint8_t>(__m128i a,__m128i b) {
-      return _mm_add_epi16(a,b);
+      return _mm_add_epi8(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_add<std::int8_t>(__m128i a,__m128i b) {
-      return _mm_add_epi32(a,b);
+      return _mm_add_epi8(a,b);
     }
 #endif
     
-    // On-copy implementation c=a+b
-    template<typename T,class Alloc,typename regType>
-    inline void addSIMD(const Matrix<T,Alloc>& a, 
-                        const Matrix<T,Alloc>& b,
-                        Matrix<T,Alloc>& c) {
-
-      // This method is instantiated with unaligned allocators.  We
-      // allow the instantiation although externally this is never
-      // called unaligned
-      static_assert(!extract_alignment<Alloc>::aligned ||
-        (extract_alignment<Alloc>::value >= sizeof(regType)),
-        "Insufficient alignment for the registers used");
-      
-      const size_t tentries = a.rows()*a.dcols();
-      c.allocate(a.rows(),a.cols());
-
-      regType* here        = reinterpret_cast<regType*>(c.data());
-      const size_t  blocks = ( tentries*sizeof(T) + (sizeof(regType)-1) )/
-        sizeof(regType);
-      regType *const end   = here + blocks;
-      const regType* aptr  = reinterpret_cast<const regType*>(a.data());
-      const regType* bptr  = reinterpret_cast<const regType*>(b.data());
-      
-      for (;here!=end;) {
-        *here++ = mm_add<T>(*aptr++,*bptr++);
-      }
-      
-    }
-       
-    // On-copy implementation c=a+b for SIMD-capable types
-    template<typename T,
-       class Alloc,
-       typename std::enable_if<is_simd_type<T>::value,int>::type=0>
-    inline void add(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
-
-      assert( (a.rows() == b.rows()) &&
-              (a.cols() == b.cols()) );
-
-
-      if (is_aligned_alloc<Alloc>::value) {        
-#ifdef __AVX512F__
-        addSIMD<T,Alloc,typename avx512_traits<T>::reg_type>(a,b,c);
-#elif  __AVX__
-        addSIMD<T,Alloc,typename avx_traits<T>::reg_type>(a,b,c);
-#elif  __SSE2__
-        addSIMD<T,Alloc,typename sse2_traits<T>::reg_type>(a,b,c);
-#else
-        ::anpi::fallback::add(a,b,c);
-#endif
-      } else { // allocator seems to be unaligned
-        ::anpi::fallback::add(a,b,c);
-      }
-    }
-
-    // Non-SIMD types such as complex
-    template<typename T,
-             class Alloc,
-             typename std::enable_if<!is_simd_type<T>::value,int>::type = 0>
-    inline void add(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
-      
-      ::anpi::fallback::add(a,b,c);
-    }
-
-    // In-place implementation a = a+b
-    template<typename T,class Alloc>
-    inline void add(Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b) {
-
-      add(a,b,a);
-    }
-
-
     /*
      --------------------------------------------------------------------------------------------
      * Subtraction
@@ -387,7 +353,63 @@ namespace anpi
 
 
 
-#ifdef  __AVX__
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
+    template<>
+    inline __m512d __attribute__((__always_inline__))
+    mm_sub<double>(__m512d a,__m512d b) {
+      return _mm512_sub_pd(a,b);
+    }
+    template<>
+    inline __m512 __attribute__((__always_inline__))
+    mm_sub<float>(__m512 a,__m512 b) {
+      return _mm512_sub_ps(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<uint64_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi64(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<int64_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi64(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<uint32_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi32(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<int32_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi32(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<uint16_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi16(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<int16_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi16(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<uint8_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi8(a,b);
+    }
+    template<>
+    inline __m512i __attribute__((__always_inline__))
+    mm_sub<int8_t>(__m512i a,__m512i b) {
+      return _mm512_sub_epi8(a,b);
+    }
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
     template<>
     inline __m256d __attribute__((__always_inline__))
     mm_sub<double>(__m256d a,__m256d b) {
@@ -438,7 +460,10 @@ namespace anpi
     mm_sub<int8_t>(__m256i a,__m256i b) {
       return _mm256_sub_epi8(a,b);
     }
-#elif  defined __SSE2__
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
     template<>
     inline __m128d __attribute__((__always_inline__))
     mm_sub<double>(__m128d a,__m128d b) {
@@ -467,7 +492,7 @@ namespace anpi
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_sub<std::int32_t>(__m128i a,__m128i b) {
-      return _mm_sub_epi16(a,b);
+      return _mm_sub_epi32(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
@@ -477,94 +502,164 @@ namespace anpi
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_sub<std::int16_t>(__m128i a,__m128i b) {
-      return _mm_sub_epi32(a,b);
+      return _mm_sub_epi16(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_sub<std::uint8_t>(__m128i a,__m128i b) {
-      return _mm_sub_epi16(a,b);
+      return _mm_sub_epi8(a,b);
     }
     template<>
     inline __m128i __attribute__((__always_inline__))
     mm_sub<std::int8_t>(__m128i a,__m128i b) {
-      return _mm_sub_epi32(a,b);
+      return _mm_sub_epi8(a,b);
     }
 #endif
 
-    // On-copy implementation c=a-b
-    template<typename T,class Alloc,typename regType>
-    inline void subSIMD(const Matrix<T,Alloc>& a, 
-                        const Matrix<T,Alloc>& b,
-                        Matrix<T,Alloc>& c) {
-
-      // This method is instantiated with unaligned allocators.  We
-      // allow the instantiation although externally this is never
-      // called unaligned
-      static_assert(!extract_alignment<Alloc>::aligned ||
-        (extract_alignment<Alloc>::value >= sizeof(regType)),
-        "Insufficient alignment for the registers used");
-      
-      const size_t tentries = a.rows()*a.dcols();
-      c.allocate(a.rows(),a.cols());
+  } // namespace simd
+} // namespace anpi
 
-      regType* here        = reinterpret_cast<regType*>(c.data());
-      const size_t  blocks = ( tentries*sizeof(T) + (sizeof(regType)-1) )/
-        sizeof(regType);
-      regType *const end   = here + blocks;
-      const regType* aptr  = reinterpret_cast<const regType*>(a.data());
-      const regType* bptr  = reinterpret_cast<const regType*>(b.data());
-      
-      for (;here!=end;) {
-        *here++ = mm_sub<T>(*aptr++,*bptr++);
-      }
+// The register kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixArithmeticSIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    /*
+     * Dispatchers to the best kernels available
+     */
+
+    // On-copy implementation c=a+b for SIMD-capable types
+    template<typename T,
+       class Alloc,
+       class Layout,
+       typename std::enable_if<is_simd_type<T>::value,int>::type=0>
+    inline void add(const Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b,
+                    Matrix<T,Alloc,Layout>& c) {
+
+      assert( (a.rows() == b.rows()) &&
+              (a.cols() == b.cols()) );
+
+
+      // Aligned and unaligned allocators have register kernels
+      ANPI_SIMD_DISPATCH(add,a,b,c);
+      ::anpi::fallback::add(a,b,c);
+    }
+
+    // Non-SIMD types such as complex
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<!is_simd_type<T>::value &&
+                                     !is_half_type<T>::value,
+                                     int>::type = 0>
+    inline void add(const Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b,
+                    Matrix<T,Alloc,Layout>& c) {
       
+      ::anpi::fallback::add(a,b,c);
+    }
+
+    // In-place implementation a = a+b (see MatrixHalf.hpp for the
+    // 16 bit storage types)
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<!is_half_type<T>::value,int>::type = 0>
+    inline void add(Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b) {
+
+      add(a,b,a);
     }
-       
+
+
+
     // On-copy implementation c=a-b for SIMD-capable types
     template<typename T,
        class Alloc,
+       class Layout,
        typename std::enable_if<is_simd_type<T>::value,int>::type=0>
-    inline void subtract(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
+    inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b,
+                    Matrix<T,Alloc,Layout>& c) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
 
 
-      if (is_aligned_alloc<Alloc>::value) {        
-#ifdef  __AVX__
-        subSIMD<T,Alloc,typename avx_traits<T>::reg_type>(a,b,c);
-#elif  __SSE2__
-        subSIMD<T,Alloc,typename sse2_traits<T>::reg_type>(a,b,c);
-#else
-        ::anpi::fallback::subtract(a,b,c);
-#endif
-      } else { // allocator seems to be unaligned
-        ::anpi::fallback::subtract(a,b,c);
-      }
+      // Aligned and unaligned allocators have register kernels
+      ANPI_SIMD_DISPATCH(subtract,a,b,c);
+      ::anpi::fallback::subtract(a,b,c);
     }
 
     // Non-SIMD types such as complex
     template<typename T,
              class Alloc,
-             typename std::enable_if<!is_simd_type<T>::value,int>::type = 0>
-    inline void subtract(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
+             class Layout,
+             typename std::enable_if<!is_simd_type<T>::value &&
+                                     !is_half_type<T>::value,
+                                     int>::type = 0>
+    inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b,
+                    Matrix<T,Alloc,Layout>& c) {
       
       ::anpi::fallback::subtract(a,b,c);
     }
 
-    // In-place implementation a = a-b
-    template<typename T,class Alloc>
-    inline void subtract(Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b) {
+    // In-place implementation a = a-b (see MatrixHalf.hpp for the
+    // 16 bit storage types)
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<!is_half_type<T>::value,int>::type = 0>
+    inline void subtract(Matrix<T,Alloc,Layout>& a,
+                    const Matrix<T,Alloc,Layout>& b) {
 
       subtract(a,b,a);
     }
 
-    
+
+    // Views: c=a+b for SIMD-capable types
+    template<typename T,
+             typename std::enable_if<is_simd_type<T>::value,int>::type=0>
+    inline void add(const MatrixView<const T>& a,
+                    const MatrixView<const T>& b,
+                    const MatrixView<T>& c) {
+      ANPI_SIMD_DISPATCH(add,a,b,c);
+      ::anpi::fallback::add(a,b,c);
+    }
+
+    // Views: c=a+b for non-SIMD types such as complex
+    template<typename T,
+             typename std::enable_if<!is_simd_type<T>::value,int>::type=0>
+    inline void add(const MatrixView<const T>& a,
+                    const MatrixView<const T>& b,
+                    const MatrixView<T>& c) {
+      ::anpi::fallback::add(a,b,c);
+    }
+
+    // Views: c=a-b for SIMD-capable types
+    template<typename T,
+             typename std::enable_if<is_simd_type<T>::value,int>::type=0>
+    inline void subtract(const MatrixView<const T>& a,
+                         const MatrixView<const T>& b,
+                         const MatrixView<T>& c) {
+      ANPI_SIMD_DISPATCH(subtract,a,b,c);
+      ::anpi::fallback::subtract(a,b,c);
+    }
+
+    // Views: c=a-b for non-SIMD types such as complex
+    template<typename T,
+             typename std::enable_if<!is_simd_type<T>::value,int>::type=0>
+    inline void subtract(const MatrixView<const T>& a,
+                         const MatrixView<const T>& b,
+                         const MatrixView<T>& c) {
+      ::anpi::fallback::subtract(a,b,c);
+    }
+
   } // namespace simd
 
 
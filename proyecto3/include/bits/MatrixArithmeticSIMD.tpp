@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2017
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+/*
+ * Register kernels of the element-wise arithmetic.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * Matrices of aligned allocators are processed as a whole with aligned
+ * registers, padding included.  All other memory (matrices of unaligned
+ * allocators, e.g. wrapping external buffers, and views) is processed
+ * with unaligned loads and stores, and the last n%lanes entries with
+ * masked ones where the instruction set has them: AVX-512 for all
+ * types, AVX2 for 32 and 64 bit types.
+ *
+ * Matrices with at least parallel::elementwiseThreshold() entries are
+ * split among the threads in chunks of whole cache lines.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      // Unaligned register at ptr: views start anywhere in a row
+      template<typename regType,typename T>
+      inline regType loadView(const T* ptr) {
+        regType r;
+        std::memcpy(&r,ptr,sizeof(regType));
+        return r;
+      }
+
+      // Unaligned store of the register r at ptr
+      template<typename regType,typename T>
+      inline void storeView(T* ptr,const regType r) {
+        std::memcpy(ptr,&r,sizeof(regType));
+      }
+
+      /*
+       * Masked loads and stores of the first n < lanes entries.  The
+       * other lanes are loaded as zero and never stored.
+       */
+#if ANPI_SIMD_WIDTH >= 64
+      // Mask with the lowest n bits set
+      inline __mmask64 tailMask(const size_t n) {
+        return (n >= 64) ? ~__mmask64(0) : ((__mmask64(1) << n) - 1);
+      }
+
+      inline __m512 loadTail(const float* p,const size_t n) {
+        return _mm512_maskz_loadu_ps(__mmask16(tailMask(n)),p);
+      }
+      inline __m512d loadTail(const double* p,const size_t n) {
+        return _mm512_maskz_loadu_pd(__mmask8(tailMask(n)),p);
+      }
+      template<typename T>
+      inline __m512i loadTail(const T* p,const size_t n) {
+        switch (sizeof(T)) {
+        case 1:  return _mm512_maskz_loadu_epi8(tailMask(n),p);
+        case 2:  return _mm512_maskz_loadu_epi16(__mmask32(tailMask(n)),p);
+        case 4:  return _mm512_maskz_loadu_epi32(__mmask16(tailMask(n)),p);
+        default: return _mm512_maskz_loadu_epi64(__mmask8(tailMask(n)),p);
+        }
+      }
+
+      inline void storeTail(float* p,const size_t n,const __m512 r) {
+        _mm512_mask_storeu_ps(p,__mmask16(tailMask(n)),r);
+      }
+      inline void storeTail(double* p,const size_t n,const __m512d r) {
+        _mm512_mask_storeu_pd(p,__mmask8(tailMask(n)),r);
+      }
+      template<typename T>
+      inline void storeTail(T* p,const size_t n,const __m512i r) {
+        switch (sizeof(T)) {
+        case 1:  _mm512_mask_storeu_epi8(p,tailMask(n),r); break;
+        case 2:  _mm512_mask_storeu_epi16(p,__mmask32(tailMask(n)),r); break;
+        case 4:  _mm512_mask_storeu_epi32(p,__mmask16(tailMask(n)),r); break;
+        default: _mm512_mask_storeu_epi64(p,__mmask8(tailMask(n)),r); break;
+        }
+      }
+
+      // All register types have masked tails
+      template<typename T>
+      struct has_masked_tail : std::true_type { };
+#elif ANPI_SIMD_WIDTH >= 32
+      // Lanes below n set, for 32 and 64 bit lanes
+      inline __m256i tailMask32(const size_t n) {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32(int(n)),
+                                  _mm256_setr_epi32(0,1,2,3,4,5,6,7));
+      }
+      inline __m256i tailMask64(const size_t n) {
+        return _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)(n)),
+                                  _mm256_setr_epi64x(0,1,2,3));
+      }
+
+      inline __m256 loadTail(const float* p,const size_t n) {
+        return _mm256_maskload_ps(p,tailMask32(n));
+      }
+      inline __m256d loadTail(const double* p,const size_t n) {
+        return _mm256_maskload_pd(p,tailMask64(n));
+      }
+      template<typename T>
+      inline __m256i loadTail(const T* p,const size_t n) {
+        return (sizeof(T) == 4)
+          ? _mm256_maskload_epi32((const int*)p,tailMask32(n))
+          : _mm256_maskload_epi64((const long long*)p,tailMask64(n));
+      }
+
+      inline void storeTail(float* p,const size_t n,const __m256 r) {
+        _mm256_maskstore_ps(p,tailMask32(n),r);
+      }
+      inline void storeTail(double* p,const size_t n,const __m256d r) {
+        _mm256_maskstore_pd(p,tailMask64(n),r);
+      }
+      template<typename T>
+      inline void storeTail(T* p,const size_t n,const __m256i r) {
+        if (sizeof(T) == 4) {
+          _mm256_maskstore_epi32((int*)p,tailMask32(n),r);
+        } else {
+          _mm256_maskstore_epi64((long long*)p,tailMask64(n),r);
+        }
+      }
+
+      // AVX2 masks only 32 and 64 bit lanes
+      template<typename T>
+      struct has_masked_tail
+        : std::integral_constant<bool,(sizeof(T) >= 4)> { };
+#else
+      // SSE2 has no masked loads
+      template<typename T>
+      struct has_masked_tail : std::false_type { };
+#endif
+
+      /*
+       * Element-wise binary operations on n contiguous entries with
+       * unaligned registers
+       */
+
+      // Operation c = a + b
+      struct add_op {
+        template<typename T,typename regType>
+        static regType reg(const regType a,const regType b) {
+          return mm_add<T>(a,b);
+        }
+        template<typename T>
+        static T scalar(const T a,const T b) {
+          return a + b;
+        }
+      };
+
+      // Operation c = a - b
+      struct sub_op {
+        template<typename T,typename regType>
+        static regType reg(const regType a,const regType b) {
+          return mm_sub<T>(a,b);
+        }
+        template<typename T>
+        static T scalar(const T a,const T b) {
+          return a - b;
+        }
+      };
+
+      // Last n < lanes entries with masked registers
+      template<class Op,typename T,typename regType>
+      inline void binaryTail(const T* a,const T* b,T* c,const size_t n,
+                             std::true_type) {
+        storeTail(c,n,Op::template reg<T,regType>(loadTail(a,n),
+                                                  loadTail(b,n)));
+      }
+
+      // Last n < lanes entries one by one
+      template<class Op,typename T,typename regType>
+      inline void binaryTail(const T* a,const T* b,T* c,const size_t n,
+                             std::false_type) {
+        for (size_t i=0;i<n;++i) {
+          c[i] = Op::scalar(a[i],b[i]);
+        }
+      }
+
+      // c[i] = a[i] op b[i] for i<n, where c may be a or b
+      template<class Op,typename T,typename regType>
+      inline void binaryUnaligned(const T* a,const T* b,T* c,
+                                  const size_t n) {
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          storeView(c+i,Op::template reg<T,regType>(loadView<regType>(a+i),
+                                                    loadView<regType>(b+i)));
+        }
+        if (i<n) {
+          binaryTail<Op,T,regType>(a+i,b+i,c+i,n-i,has_masked_tail<T>());
+        }
+      }
+
+      // c[i] = a[i] op b[i] with whole aligned registers covering the n
+      // entries, reaching into the padding of the allocation
+      template<class Op,typename T,typename regType>
+      inline void binaryAligned(const T* a,const T* b,T* c,const size_t n) {
+        regType* here        = reinterpret_cast<regType*>(c);
+        const size_t  blocks = ( n*sizeof(T) + (sizeof(regType)-1) )/
+          sizeof(regType);
+        regType *const end   = here + blocks;
+        const regType* aptr  = reinterpret_cast<const regType*>(a);
+        const regType* bptr  = reinterpret_cast<const regType*>(b);
+
+        for (;here!=end;) {
+          *here++ = Op::template reg<T,regType>(*aptr++,*bptr++);
+        }
+      }
+
+      // Chunk of an aligned buffer
+      template<class Op,typename T,typename regType>
+      inline void binaryRange(const T* a,const T* b,T* c,const size_t n,
+                              std::true_type /*aligned*/) {
+        binaryAligned<Op,T,regType>(a,b,c,n);
+      }
+
+      // Chunk of an unaligned buffer
+      template<class Op,typename T,typename regType>
+      inline void binaryRange(const T* a,const T* b,T* c,const size_t n,
+                              std::false_type /*aligned*/) {
+        binaryUnaligned<Op,T,regType>(a,b,c,n);
+      }
+
+      // c[i] = a[i] op b[i] for i<n, split among the threads in chunks of
+      // whole cache lines, which keep aligned buffers aligned
+      template<class Op,typename T,typename regType,class Aligned>
+      inline void binaryParallel(const T* a,const T* b,T* c,const size_t n) {
+        const int threads = ::anpi::parallel::elementwiseThreads(n);
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          ::anpi::parallel::chunkRange<T>(n,threads,t,begin,end);
+          binaryRange<Op,T,regType>(a+begin,b+begin,c+begin,end-begin,
+                                    Aligned());
+        }
+      }
+
+      /*
+       * Sum
+       */
+
+      // On-copy implementation c=a+b
+      template<typename T,class Alloc,class Layout,typename regType>
+      inline void addSIMD(const Matrix<T,Alloc,Layout>& a,
+                          const Matrix<T,Alloc,Layout>& b,
+                          Matrix<T,Alloc,Layout>& c) {
+
+        // Only called for aligned allocators; the unaligned ones use
+        // binaryUnaligned()
+        static_assert(!extract_alignment<Alloc>::aligned ||
+          (extract_alignment<Alloc>::value >= sizeof(regType)),
+          "Insufficient alignment for the registers used");
+
+        c.allocate(a.rows(),a.cols());
+        binaryParallel<add_op,T,regType,std::true_type>(
+          a.data(),b.data(),c.data(),a.lines()*a.dcols());
+      }
+
+      // c=a+b with the widest registers the allocator alignment permits
+      template<typename T,class Alloc,class Layout>
+      inline void add(const Matrix<T,Alloc,Layout>& a,
+                      const Matrix<T,Alloc,Layout>& b,
+                      Matrix<T,Alloc,Layout>& c,
+                      std::true_type /*aligned*/) {
+        addSIMD<T,Alloc,Layout,typename simd_reg<T,ANPI_SIMD_WIDTH,
+                  extract_alignment<Alloc>::value>::type>(a,b,c);
+      }
+
+      // c=a+b with unaligned registers and a masked tail
+      template<typename T,class Alloc,class Layout>
+      inline void add(const Matrix<T,Alloc,Layout>& a,
+                      const Matrix<T,Alloc,Layout>& b,
+                      Matrix<T,Alloc,Layout>& c,
+                      std::false_type /*aligned*/) {
+        c.allocate(a.rows(),a.cols());
+        binaryParallel<add_op,T,
+                       typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type,
+                       std::false_type>(
+          a.data(),b.data(),c.data(),a.lines()*a.dcols());
+      }
+
+      // c=a+b with the kernel suited to the allocator
+      template<typename T,class Alloc,class Layout>
+      inline void add(const Matrix<T,Alloc,Layout>& a,
+                      const Matrix<T,Alloc,Layout>& b,
+                      Matrix<T,Alloc,Layout>& c) {
+        typedef std::integral_constant<bool,is_aligned_alloc<Alloc>::value>
+          aligned;
+        add(a,b,c,aligned());
+      }
+
+      /*
+       * Subtraction
+       */
+
+      // On-copy implementation c=a-b
+      template<typename T,class Alloc,class Layout,typename regType>
+      inline void subSIMD(const Matrix<T,Alloc,Layout>& a,
+                          const Matrix<T,Alloc,Layout>& b,
+                          Matrix<T,Alloc,Layout>& c) {
+
+        // Only called for aligned allocators; the unaligned ones use
+        // binaryUnaligned()
+        static_assert(!extract_alignment<Alloc>::aligned ||
+          (extract_alignment<Alloc>::value >= sizeof(regType)),
+          "Insufficient alignment for the registers used");
+
+        c.allocate(a.rows(),a.cols());
+        binaryParallel<sub_op,T,regType,std::true_type>(
+          a.data(),b.data(),c.data(),a.lines()*a.dcols());
+      }
+
+      // c=a-b with the widest registers the allocator alignment permits
+      template<typename T,class Alloc,class Layout>
+      inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                           const Matrix<T,Alloc,Layout>& b,
+                           Matrix<T,Alloc,Layout>& c,
+                           std::true_type /*aligned*/) {
+        subSIMD<T,Alloc,Layout,typename simd_reg<T,ANPI_SIMD_WIDTH,
+                  extract_alignment<Alloc>::value>::type>(a,b,c);
+      }
+
+      // c=a-b with unaligned registers and a masked tail
+      template<typename T,class Alloc,class Layout>
+      inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                           const Matrix<T,Alloc,Layout>& b,
+                           Matrix<T,Alloc,Layout>& c,
+                           std::false_type /*aligned*/) {
+        c.allocate(a.rows(),a.cols());
+        binaryParallel<sub_op,T,
+                       typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type,
+                       std::false_type>(
+          a.data(),b.data(),c.data(),a.lines()*a.dcols());
+      }
+
+      // c=a-b with the kernel suited to the allocator
+      template<typename T,class Alloc,class Layout>
+      inline void subtract(const Matrix<T,Alloc,Layout>& a,
+                           const Matrix<T,Alloc,Layout>& b,
+                           Matrix<T,Alloc,Layout>& c) {
+        typedef std::integral_constant<bool,is_aligned_alloc<Alloc>::value>
+          aligned;
+        subtract(a,b,c,aligned());
+      }
+
+      /*
+       * Views
+       */
+
+      // Row-wise c=a+b for views
+      template<typename T,typename regType>
+      inline void addViewSIMD(const MatrixView<const T>& a,
+                              const MatrixView<const T>& b,
+                              const MatrixView<T>& c) {
+        for (size_t r=0;r<c.rows();++r) {
+          binaryUnaligned<add_op,T,regType>(a[r],b[r],c[r],c.cols());
+        }
+      }
+
+      // c=a+b for views with the widest registers
+      template<typename T>
+      inline void add(const MatrixView<const T>& a,
+                      const MatrixView<const T>& b,
+                      const MatrixView<T>& c) {
+        addViewSIMD<T,
+                    typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(a,b,c);
+      }
+
+      // Row-wise c=a-b for views
+      template<typename T,typename regType>
+      inline void subViewSIMD(const MatrixView<const T>& a,
+                              const MatrixView<const T>& b,
+                              const MatrixView<T>& c) {
+        for (size_t r=0;r<c.rows();++r) {
+          binaryUnaligned<sub_op,T,regType>(a[r],b[r],c[r],c.cols());
+        }
+      }
+
+      // c=a-b for views with the widest registers
+      template<typename T>
+      inline void subtract(const MatrixView<const T>& a,
+                           const MatrixView<const T>& b,
+                           const MatrixView<T>& c) {
+        subViewSIMD<T,
+                    typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(a,b,c);
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_BLAS1_HPP
+#define ANPI_MATRIX_BLAS1_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+#include "Intrinsics.hpp"
+#include "IntrinsicsM.hpp"
+#include "MatrixArithmetic.hpp"
+#include "MatrixMultiply.hpp"
+#include "CpuFeatures.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    /*
+     * Level-1 kernels
+     *
+     * Element-wise operations on n contiguous entries.  The matrices
+     * pass their whole buffer, row padding included, as add() and
+     * subtract() do; the vectors pass their data().  The output may be
+     * any of the inputs.
+     */
+
+    // x = alpha*x
+    template<typename T>
+    inline void scale(T* x,const size_t n,const T alpha) {
+      for (size_t i=0;i<n;++i) {
+        x[i] *= alpha;
+      }
+    }
+
+    // y = alpha*x + y
+    template<typename T>
+    inline void axpy(const T alpha,const T* x,T* y,const size_t n) {
+      for (size_t i=0;i<n;++i) {
+        y[i] += alpha*x[i];
+      }
+    }
+
+    // c = a.*b
+    template<typename T>
+    inline void hadamard(const T* a,const T* b,T* c,const size_t n) {
+      for (size_t i=0;i<n;++i) {
+        c[i] = a[i]*b[i];
+      }
+    }
+
+    // c = a./b
+    template<typename T>
+    inline void divide(const T* a,const T* b,T* c,const size_t n) {
+      for (size_t i=0;i<n;++i) {
+        c[i] = a[i]/b[i];
+      }
+    }
+
+    // d = a.*b + c
+    template<typename T>
+    inline void fmadd(const T* a,const T* b,const T* c,T* d,const size_t n) {
+      for (size_t i=0;i<n;++i) {
+        d[i] = a[i]*b[i] + c[i];
+      }
+    }
+
+  } // namespace fallback
+} // namespace anpi
+
+// The register kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixBlas1SIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    /*
+     * Dispatchers to the best kernels available.  Only float and double
+     * have register kernels: SSE and AVX lack most integer products and
+     * all integer divisions.  The 16 bit storage types have their own
+     * in MatrixHalf.hpp.
+     */
+
+    // x = alpha*x
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void scale(T* x,const size_t n,const T alpha) {
+      ANPI_SIMD_DISPATCH(scale,x,n,alpha);
+      ::anpi::fallback::scale(x,n,alpha);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void scale(T* x,const size_t n,const T alpha) {
+      ::anpi::fallback::scale(x,n,alpha);
+    }
+
+    // y = alpha*x + y
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void axpy(const T alpha,const T* x,T* y,const size_t n) {
+      ANPI_SIMD_DISPATCH(axpy,alpha,x,y,n);
+      ::anpi::fallback::axpy(alpha,x,y,n);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void axpy(const T alpha,const T* x,T* y,const size_t n) {
+      ::anpi::fallback::axpy(alpha,x,y,n);
+    }
+
+    // c = a.*b
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void hadamard(const T* a,const T* b,T* c,const size_t n) {
+      ANPI_SIMD_DISPATCH(hadamard,a,b,c,n);
+      ::anpi::fallback::hadamard(a,b,c,n);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void hadamard(const T* a,const T* b,T* c,const size_t n) {
+      ::anpi::fallback::hadamard(a,b,c,n);
+    }
+
+    // c = a./b
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void divide(const T* a,const T* b,T* c,const size_t n) {
+      ANPI_SIMD_DISPATCH(divide,a,b,c,n);
+      ::anpi::fallback::divide(a,b,c,n);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void divide(const T* a,const T* b,T* c,const size_t n) {
+      ::anpi::fallback::divide(a,b,c,n);
+    }
+
+    // d = a.*b + c
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void fmadd(const T* a,const T* b,const T* c,T* d,const size_t n) {
+      ANPI_SIMD_DISPATCH(fmadd,a,b,c,d,n);
+      ::anpi::fallback::fmadd(a,b,c,d,n);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void fmadd(const T* a,const T* b,const T* c,T* d,const size_t n) {
+      ::anpi::fallback::fmadd(a,b,c,d,n);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
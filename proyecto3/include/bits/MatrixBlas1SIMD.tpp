@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the level-1 operations.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * The kernels use unaligned loads and stores, since vectors and row
+ * ranges start anywhere; on aligned matrix buffers they are as fast as
+ * the aligned ones.  The last n%lanes entries are done one by one.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      // x = alpha*x
+      template<typename T>
+      inline void scale(T* x,const size_t n,const T alpha) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        const regType va = mm_set1<T,regType>(alpha);
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          mm_storeu<T,regType>(x+i,mm_mul<T>(va,mm_loadu<T,regType>(x+i)));
+        }
+        for (;i<n;++i) {
+          x[i] *= alpha;
+        }
+      }
+
+      // y = alpha*x + y
+      template<typename T>
+      inline void axpy(const T alpha,const T* x,T* y,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        const regType va = mm_set1<T,regType>(alpha);
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          mm_storeu<T,regType>(y+i,mm_fmadd<T>(va,
+                                               mm_loadu<T,regType>(x+i),
+                                               mm_loadu<T,regType>(y+i)));
+        }
+        for (;i<n;++i) {
+          y[i] += alpha*x[i];
+        }
+      }
+
+      // c = a.*b
+      template<typename T>
+      inline void hadamard(const T* a,const T* b,T* c,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          mm_storeu<T,regType>(c+i,mm_mul<T>(mm_loadu<T,regType>(a+i),
+                                             mm_loadu<T,regType>(b+i)));
+        }
+        for (;i<n;++i) {
+          c[i] = a[i]*b[i];
+        }
+      }
+
+      // c = a./b
+      template<typename T>
+      inline void divide(const T* a,const T* b,T* c,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          mm_storeu<T,regType>(c+i,mm_div<T>(mm_loadu<T,regType>(a+i),
+                                             mm_loadu<T,regType>(b+i)));
+        }
+        for (;i<n;++i) {
+          c[i] = a[i]/b[i];
+        }
+      }
+
+      // d = a.*b + c
+      template<typename T>
+      inline void fmadd(const T* a,const T* b,const T* c,T* d,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = (n/lanes)*lanes;
+
+        size_t i=0;
+        for (;i<nv;i+=lanes) {
+          mm_storeu<T,regType>(d+i,mm_fmadd<T>(mm_loadu<T,regType>(a+i),
+                                               mm_loadu<T,regType>(b+i),
+                                               mm_loadu<T,regType>(c+i)));
+        }
+        for (;i<n;++i) {
+          d[i] = a[i]*b[i] + c[i];
+        }
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_EXPRESSION_HPP
+#define ANPI_MATRIX_EXPRESSION_HPP
+
+#include <type_traits>
+
+#include "Intrinsics.hpp"
+#include "MatrixArithmetic.hpp"
+#include "Parallel.hpp"
+
+namespace anpi
+{
+  /**
+   * Lazy element-wise matrix expressions.
+   *
+   * The operators + and - on matrices do not compute anything, but
+   * build a light-weight tree of the operation.  Only when the tree is
+   * assigned to a matrix, all operations are evaluated in a single pass
+   * over memory, directly into the destination:
+   *
+   * \code
+   * anpi::Matrix<float> r = a + b - c + d; // one pass, no temporaries
+   * \endcode
+   *
+   * An expression only holds references to its operands, so it must
+   * be evaluated before they are destroyed.  Do not keep expressions
+   * in \c auto variables.
+   */
+  namespace expr {
+
+    /**
+     * Base of all element-wise expressions (CRTP)
+     */
+    template<class E>
+    class MatrixExpression {
+    public:
+      /// Access the concrete expression
+      inline const E& derived() const {
+        return static_cast<const E&>(*this);
+      }
+    };
+
+    /**
+     * Leaf of an expression, referring to an existing matrix
+     */
+    template<typename T,class Alloc,class Layout>
+    class Terminal : public MatrixExpression< Terminal<T,Alloc,Layout> > {
+      /// The referenced matrix
+      const Matrix<T,Alloc,Layout>& _m;
+    public:
+      typedef T value_type;
+      typedef typename Matrix<T,Alloc,Layout>::allocator_type allocator_type;
+      typedef Layout layout_type;
+
+      /// Refer to the given matrix
+      explicit Terminal(const Matrix<T,Alloc,Layout>& m) : _m(m) {}
+
+      inline size_t rows()  const { return _m.rows();  }
+      inline size_t cols()  const { return _m.cols();  }
+      inline size_t dcols() const { return _m.dcols(); }
+
+      /// Entry at position i of the buffer (padding included)
+      inline T at(const size_t i) const {
+        return _m.data()[i];
+      }
+
+      /// Buffer of the referenced matrix, for the register kernels
+      inline const T* data() const {
+        return _m.data();
+      }
+    };
+
+    /**
+     * Element-wise sum.
+     *
+     * The register forms of the operations are in
+     * bits/MatrixExpressionSIMD.tpp, compiled for each instruction set.
+     */
+    struct Plus {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a+b; }
+    };
+
+    /// Element-wise difference
+    struct Minus {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a-b; }
+    };
+
+    /**
+     * Element-wise binary operation Op between two expressions
+     *
+     * The operands are held by value: terminals are just references and
+     * inner nodes are small, so that no temporary node can dangle.
+     */
+    template<class L,class R,class Op>
+    class Binary : public MatrixExpression< Binary<L,R,Op> > {
+      const L _l;
+      const R _r;
+    public:
+      typedef typename L::value_type value_type;
+      typedef typename L::allocator_type allocator_type;
+      typedef typename L::layout_type layout_type;
+
+      static_assert(std::is_same<value_type,
+                                 typename R::value_type>::value,
+                    "Operands must have the same element type");
+      static_assert(std::is_same<allocator_type,
+                                 typename R::allocator_type>::value,
+                    "Operands must have the same memory layout");
+      static_assert(std::is_same<layout_type,
+                                 typename R::layout_type>::value,
+                    "Operands must have the same memory layout");
+
+      Binary(const L& l,const R& r) : _l(l),_r(r) {
+        assert( (l.rows() == r.rows()) && (l.cols() == r.cols()) );
+      }
+
+      inline size_t rows()  const { return _l.rows();  }
+      inline size_t cols()  const { return _l.cols();  }
+      inline size_t dcols() const { return _l.dcols(); }
+
+      /// Entry at position i of the buffer (padding included)
+      inline value_type at(const size_t i) const {
+        return Op::apply(_l.at(i),_r.at(i));
+      }
+
+      /// Left operand
+      inline const L& left()  const { return _l; }
+
+      /// Right operand
+      inline const R& right() const { return _r; }
+    };
+
+    /// @name Operators involving at least one expression
+    //@{
+    template<class E,typename T,class Alloc,class Layout>
+    inline Binary<E,Terminal<T,Alloc,Layout>,Plus>
+    operator+(const MatrixExpression<E>& a,const Matrix<T,Alloc,Layout>& b) {
+      typedef Terminal<T,Alloc,Layout> term;
+      return Binary<E,term,Plus>(a.derived(),term(b));
+    }
+
+    template<typename T,class Alloc,class Layout,class E>
+    inline Binary<Terminal<T,Alloc,Layout>,E,Plus>
+    operator+(const Matrix<T,Alloc,Layout>& a,const MatrixExpression<E>& b) {
+      typedef Terminal<T,Alloc,Layout> term;
+      return Binary<term,E,Plus>(term(a),b.derived());
+    }
+
+    template<class E1,class E2>
+    inline Binary<E1,E2,Plus>
+    operator+(const MatrixExpression<E1>& a,const MatrixExpression<E2>& b) {
+      return Binary<E1,E2,Plus>(a.derived(),b.derived());
+    }
+
+    template<class E,typename T,class Alloc,class Layout>
+    inline Binary<E,Terminal<T,Alloc,Layout>,Minus>
+    operator-(const MatrixExpression<E>& a,const Matrix<T,Alloc,Layout>& b) {
+      typedef Terminal<T,Alloc,Layout> term;
+      return Binary<E,term,Minus>(a.derived(),term(b));
+    }
+
+    template<typename T,class Alloc,class Layout,class E>
+    inline Binary<Terminal<T,Alloc,Layout>,E,Minus>
+    operator-(const Matrix<T,Alloc,Layout>& a,const MatrixExpression<E>& b) {
+      typedef Terminal<T,Alloc,Layout> term;
+      return Binary<term,E,Minus>(term(a),b.derived());
+    }
+
+    template<class E1,class E2>
+    inline Binary<E1,E2,Minus>
+    operator-(const MatrixExpression<E1>& a,const MatrixExpression<E2>& b) {
+      return Binary<E1,E2,Minus>(a.derived(),b.derived());
+    }
+    //@}
+
+  } // namespace expr
+
+  /// @name Operators between two matrices
+  //@{
+  template<typename T,class Alloc,class Layout>
+  inline expr::Binary<expr::Terminal<T,Alloc,Layout>,
+                      expr::Terminal<T,Alloc,Layout>,
+                      expr::Plus>
+  operator+(const Matrix<T,Alloc,Layout>& a,
+            const Matrix<T,Alloc,Layout>& b) {
+    typedef expr::Terminal<T,Alloc,Layout> term;
+    return expr::Binary<term,term,expr::Plus>(term(a),term(b));
+  }
+
+  template<typename T,class Alloc,class Layout>
+  inline expr::Binary<expr::Terminal<T,Alloc,Layout>,
+                      expr::Terminal<T,Alloc,Layout>,
+                      expr::Minus>
+  operator-(const Matrix<T,Alloc,Layout>& a,
+            const Matrix<T,Alloc,Layout>& b) {
+    typedef expr::Terminal<T,Alloc,Layout> term;
+    return expr::Binary<term,term,expr::Minus>(term(a),term(b));
+  }
+  //@}
+
+
+  namespace fallback {
+    /*
+     * Evaluation of expressions
+     */
+
+    // c = e, one entry after the other, split among the threads as
+    // fallback::binary()
+    template<typename T,class Alloc,class Layout,class E>
+    inline void evaluate(Matrix<T,Alloc,Layout>& c,
+                         const expr::MatrixExpression<E>& expression) {
+
+      static_assert(std::is_same<Layout,typename E::layout_type>::value,
+                    "Expressions need a matrix of the same layout");
+
+      const E& e = expression.derived();
+      c.allocate(e.rows(),e.cols());
+
+      const size_t tentries = c.lines()*c.dcols();
+      const int threads = parallel::elementwiseThreads(tentries);
+
+      if (c.dcols() == e.dcols()) { // same layout: just one linear pass
+        T* here = c.data();
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          parallel::chunkRange<T>(tentries,threads,t,begin,end);
+          for (size_t i=begin;i<end;++i) {
+            here[i] = e.at(i);
+          }
+        }
+      } else { // different padding: row by row
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (size_t r=0;r<c.lines();++r) {
+          T* here = c[r];
+          const size_t offset = r*e.dcols();
+          for (size_t j=0;j<c.lineLength();++j) {
+            here[j] = e.at(offset+j);
+          }
+        }
+      }
+    }
+  } // namespace fallback
+
+} // namespace anpi
+
+// The register kernels of the expressions, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixExpressionSIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd {
+    /*
+     * Evaluation of expressions
+     */
+
+    // c = e for SIMD-capable types
+    template<typename T,
+             class Alloc,
+             class Layout,
+             class E,
+             typename std::enable_if<is_simd_type<T>::value,int>::type=0>
+    inline void evaluate(Matrix<T,Alloc,Layout>& c,
+                         const expr::MatrixExpression<E>& e) {
+
+      // registers can only be used if c has exactly the same layout
+      if (std::is_same<typename Matrix<T,Alloc,Layout>::allocator_type,
+                       typename E::allocator_type>::value) {
+        ANPI_SIMD_DISPATCH(evaluate,c,e.derived());
+      }
+      ::anpi::fallback::evaluate(c,e);
+    }
+
+    // Non-SIMD types such as complex
+    template<typename T,
+             class Alloc,
+             class Layout,
+             class E,
+             typename std::enable_if<!is_simd_type<T>::value,int>::type=0>
+    inline void evaluate(Matrix<T,Alloc,Layout>& c,
+                         const expr::MatrixExpression<E>& e) {
+      ::anpi::fallback::evaluate(c,e);
+    }
+  } // namespace simd
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the element-wise expressions.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * The expression nodes (see MatrixExpression.hpp) are compiled with
+ * the baseline target options and only provide the scalar evaluation.
+ * Their register evaluation is written here as free functions walking
+ * the tree, so that the whole tree is inlined into the kernel of each
+ * instruction set.
+ *
+ * As for the arithmetic kernels, matrices of aligned allocators are
+ * evaluated with aligned registers, padding included, and all others
+ * with unaligned loads and stores and a masked tail.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      // Register form of the sum
+      template<typename T,typename regType>
+      inline regType exprApply(expr::Plus,const regType a,const regType b) {
+        return mm_add<T>(a,b);
+      }
+
+      // Register form of the difference
+      template<typename T,typename regType>
+      inline regType exprApply(expr::Minus,const regType a,const regType b) {
+        return mm_sub<T>(a,b);
+      }
+
+      // Aligned register of a matrix starting at entry i
+      template<typename regType,typename T,class Alloc,class Layout>
+      inline regType exprReg(const expr::Terminal<T,Alloc,Layout>& e,
+                             const size_t i,
+                             std::true_type /*aligned*/) {
+        return *reinterpret_cast<const regType*>(e.data()+i);
+      }
+
+      // Unaligned register of a matrix starting at entry i
+      template<typename regType,typename T,class Alloc,class Layout>
+      inline regType exprReg(const expr::Terminal<T,Alloc,Layout>& e,
+                             const size_t i,
+                             std::false_type /*aligned*/) {
+        return loadView<regType>(e.data()+i);
+      }
+
+      // Register of an operation starting at entry i
+      template<typename regType,class L,class R,class Op,class Aligned>
+      inline regType exprReg(const expr::Binary<L,R,Op>& e,
+                             const size_t i,
+                             Aligned aligned) {
+        return exprApply<typename L::value_type>(
+          Op(),
+          exprReg<regType>(e.left(),i,aligned),
+          exprReg<regType>(e.right(),i,aligned));
+      }
+
+      // Masked register of a matrix with the n < lanes entries at i
+      template<typename regType,typename T,class Alloc,class Layout>
+      inline regType exprTail(const expr::Terminal<T,Alloc,Layout>& e,
+                              const size_t i,
+                              const size_t n) {
+        return loadTail(e.data()+i,n);
+      }
+
+      // Masked register of an operation with the n < lanes entries at i
+      template<typename regType,class L,class R,class Op>
+      inline regType exprTail(const expr::Binary<L,R,Op>& e,
+                              const size_t i,
+                              const size_t n) {
+        return exprApply<typename L::value_type>(
+          Op(),
+          exprTail<regType>(e.left(),i,n),
+          exprTail<regType>(e.right(),i,n));
+      }
+
+      // Entries [begin,end) of c = e with whole aligned registers,
+      // reaching into the padding of the allocation
+      template<typename T,class E,typename regType>
+      inline void evaluateAligned(T* c,const E& e,
+                                  const size_t begin,const size_t end) {
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t blocks    = ( (end-begin)*sizeof(T) +
+                                   (sizeof(regType)-1) )/sizeof(regType);
+
+        regType* here = reinterpret_cast<regType*>(c+begin);
+        for (size_t b=0;b<blocks;++b) {
+          here[b] = exprReg<regType>(e,begin+b*lanes,std::true_type());
+        }
+      }
+
+      // Last n < lanes entries of c = e at i with masked registers
+      template<typename T,class E,typename regType>
+      inline void evaluateTail(T* c,const E& e,
+                               const size_t i,const size_t n,
+                               std::true_type) {
+        storeTail(c+i,n,exprTail<regType>(e,i,n));
+      }
+
+      // Last n < lanes entries of c = e at i one by one
+      template<typename T,class E,typename regType>
+      inline void evaluateTail(T* c,const E& e,
+                               const size_t i,const size_t n,
+                               std::false_type) {
+        for (size_t k=i;k<i+n;++k) {
+          c[k] = e.at(k);
+        }
+      }
+
+      // Entries [begin,end) of c = e with unaligned registers and a
+      // masked tail, as binaryUnaligned()
+      template<typename T,class E,typename regType>
+      inline void evaluateUnaligned(T* c,const E& e,
+                                    const size_t begin,const size_t end) {
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t nv = begin + ((end-begin)/lanes)*lanes;
+
+        size_t i=begin;
+        for (;i<nv;i+=lanes) {
+          storeView(c+i,exprReg<regType>(e,i,std::false_type()));
+        }
+        if (i<end) {
+          evaluateTail<T,E,regType>(c,e,i,end-i,has_masked_tail<T>());
+        }
+      }
+
+      // Entries [begin,end) of c = e for aligned allocators
+      template<typename T,class Alloc,class E>
+      inline void evaluateRange(T* c,const E& e,
+                                const size_t begin,const size_t end,
+                                std::true_type /*aligned*/) {
+        typedef typename simd_reg<T,ANPI_SIMD_WIDTH,
+          extract_alignment<Alloc>::value>::type regType;
+
+        static_assert(extract_alignment<Alloc>::value >= sizeof(regType),
+                      "Insufficient alignment for the registers used");
+
+        evaluateAligned<T,E,regType>(c,e,begin,end);
+      }
+
+      // Entries [begin,end) of c = e for unaligned allocators
+      template<typename T,class Alloc,class E>
+      inline void evaluateRange(T* c,const E& e,
+                                const size_t begin,const size_t end,
+                                std::false_type /*aligned*/) {
+        evaluateUnaligned<T,E,
+          typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(c,e,begin,end);
+      }
+
+      // c = e with the widest registers the allocator permits.  The
+      // expression has the same allocator, and thus padding, as c.
+      // Large matrices are split among the threads in chunks of whole
+      // cache lines, which keep aligned buffers aligned
+      template<typename T,class Alloc,class Layout,class E>
+      inline void evaluate(Matrix<T,Alloc,Layout>& c,const E& e) {
+        typedef std::integral_constant<bool,is_aligned_alloc<Alloc>::value>
+          aligned;
+
+        c.allocate(e.rows(),e.cols());
+
+        const size_t tentries = c.lines()*c.dcols();
+        const int threads = ::anpi::parallel::elementwiseThreads(tentries);
+        T* here = c.data();
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          ::anpi::parallel::chunkRange<T>(tentries,threads,t,begin,end);
+          evaluateRange<T,Alloc>(here,e,begin,end,aligned());
+        }
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_HALF_HPP
+#define ANPI_MATRIX_HALF_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "Half.hpp"
+#include "Intrinsics.hpp"
+#include "IntrinsicsM.hpp"
+#include "MatrixArithmetic.hpp"
+#include "MatrixBlas1.hpp"
+#include "MatrixReduce.hpp"
+#include "CpuFeatures.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    // y = x converted element-wise to the type of y
+    template<typename S,typename T>
+    inline void convert(const S* x,T* y,const size_t n) {
+      for (size_t i=0;i<n;++i) {
+        y[i] = T(x[i]);
+      }
+    }
+  } // namespace fallback
+} // namespace anpi
+
+// The register kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixHalfSIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    /*
+     * Dispatchers for the 16 bit storage types anpi::half and
+     * anpi::bfloat16.  The kernels compute in float registers, and the
+     * reductions return float.
+     */
+
+    // y = x converted element-wise to the type of y
+    template<typename S,typename T,
+             typename std::enable_if<!(is_half_type<S>::value &&
+                                       std::is_same<T,float>::value) &&
+                                     !(std::is_same<S,float>::value &&
+                                       is_half_type<T>::value),
+                                     int>::type=0>
+    inline void convert(const S* x,T* y,const size_t n) {
+      ::anpi::fallback::convert(x,y,n);
+    }
+
+    // Widen 16 bit entries to float
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void convert(const H* x,float* y,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::convert,x,y,n);
+      ::anpi::fallback::convert(x,y,n);
+    }
+
+    // Round float entries to 16 bits
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void convert(const float* x,H* y,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::convert,x,y,n);
+      ::anpi::fallback::convert(x,y,n);
+    }
+
+    // c = a + b on the whole buffers, padding included
+    template<typename H,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void add(const Matrix<H,Alloc,Layout>& a,
+                    const Matrix<H,Alloc,Layout>& b,
+                    Matrix<H,Alloc,Layout>& c) {
+
+      assert( (a.rows() == b.rows()) &&
+              (a.cols() == b.cols()) );
+
+      const size_t n = a.lines()*a.dcols();
+      ANPI_SIMD_DISPATCH(reduced::add,a.data(),b.data(),c.data(),n);
+      ::anpi::fallback::add(a,b,c);
+    }
+
+    // c = a - b on the whole buffers, padding included
+    template<typename H,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void subtract(const Matrix<H,Alloc,Layout>& a,
+                         const Matrix<H,Alloc,Layout>& b,
+                         Matrix<H,Alloc,Layout>& c) {
+
+      assert( (a.rows() == b.rows()) &&
+              (a.cols() == b.cols()) );
+
+      const size_t n = a.lines()*a.dcols();
+      ANPI_SIMD_DISPATCH(reduced::subtract,a.data(),b.data(),c.data(),n);
+      ::anpi::fallback::subtract(a,b,c);
+    }
+
+    // In-place a = a + b
+    template<typename H,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void add(Matrix<H,Alloc,Layout>& a,
+                    const Matrix<H,Alloc,Layout>& b) {
+      add(a,b,a);
+    }
+
+    // In-place a = a - b
+    template<typename H,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void subtract(Matrix<H,Alloc,Layout>& a,
+                         const Matrix<H,Alloc,Layout>& b) {
+      subtract(a,b,a);
+    }
+
+    // x = alpha*x
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void scale(H* x,const size_t n,const H alpha) {
+      ANPI_SIMD_DISPATCH(reduced::scale,x,n,alpha);
+      ::anpi::fallback::scale(x,n,alpha);
+    }
+
+    // y = alpha*x + y
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void axpy(const H alpha,const H* x,H* y,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::axpy,alpha,x,y,n);
+      ::anpi::fallback::axpy(alpha,x,y,n);
+    }
+
+    // c = a.*b
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void hadamard(const H* a,const H* b,H* c,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::hadamard,a,b,c,n);
+      ::anpi::fallback::hadamard(a,b,c,n);
+    }
+
+    // c = a./b
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void divide(const H* a,const H* b,H* c,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::divide,a,b,c,n);
+      ::anpi::fallback::divide(a,b,c,n);
+    }
+
+    // d = a.*b + c
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void fmadd(const H* a,const H* b,const H* c,H* d,const size_t n) {
+      ANPI_SIMD_DISPATCH(reduced::fmadd,a,b,c,d,n);
+      ::anpi::fallback::fmadd(a,b,c,d,n);
+    }
+
+    // result = sum of x[i]*y[i], accumulated in float
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void dot(const H* x,const H* y,const size_t n,float& result) {
+      ANPI_SIMD_DISPATCH(reduced::dot,x,y,n,result);
+      ::anpi::fallback::dot(x,y,n,result);
+    }
+
+    // result = sum of x[i], accumulated in float
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void sum(const H* x,const size_t n,float& result) {
+      ANPI_SIMD_DISPATCH(reduced::sum,x,n,result);
+      ::anpi::fallback::sum(x,n,result);
+    }
+
+    // result = sum of x[i]^2, accumulated in float
+    template<typename H,
+             typename std::enable_if<is_half_type<H>::value,int>::type=0>
+    inline void squaredNorm(const H* x,const size_t n,float& result) {
+      ANPI_SIMD_DISPATCH(reduced::squaredNorm,x,n,result);
+      ::anpi::fallback::squaredNorm(x,n,result);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels for the 16 bit storage types anpi::half and
+ * anpi::bfloat16.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * Each load widens one register worth of 16 bit entries to float, all
+ * operations are done on float registers, and each store rounds back
+ * to nearest even.  half uses the F16C conversions (part of AVX-512F);
+ * without them, as in SSE2-only builds, the conversion is done entry
+ * by entry.  bfloat16 is the upper half of a float, so that it needs
+ * only integer shifts.
+ *
+ * The kernels live in the nested namespace "reduced" (as in reduced
+ * precision), since their signatures would clash with the float and
+ * double kernels of the same names.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      namespace reduced
+      {
+#if ANPI_SIMD_WIDTH >= 64
+        typedef __m512 regType;
+#elif ANPI_SIMD_WIDTH >= 32
+        typedef __m256 regType;
+#else
+        typedef __m128 regType;
+#endif
+        /// Entries per register
+        constexpr size_t lanes = sizeof(regType)/sizeof(float);
+
+        /*
+         * half <-> float
+         */
+#if ANPI_SIMD_WIDTH >= 64
+        // The zero-masked forms avoid the undefined source registers of
+        // the unmasked AVX-512 intrinsics, which trip -Wuninitialized
+        // with some GCC versions
+        constexpr __mmask16 all = 0xffff;
+
+        inline regType load(const half* p) {
+          return _mm512_maskz_cvtph_ps(all,
+                   _mm256_loadu_si256((const __m256i*)p));
+        }
+        inline void store(half* p,const regType a) {
+          _mm256_storeu_si256((__m256i*)p,
+            _mm512_maskz_cvtps_ph(all,a,_MM_FROUND_TO_NEAREST_INT));
+        }
+#elif defined(__F16C__) && (ANPI_SIMD_WIDTH >= 32)
+        inline regType load(const half* p) {
+          return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+        }
+        inline void store(half* p,const regType a) {
+          _mm_storeu_si128((__m128i*)p,
+                           _mm256_cvtps_ph(a,_MM_FROUND_TO_NEAREST_INT));
+        }
+#elif defined(__F16C__)
+        inline regType load(const half* p) {
+          return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)p));
+        }
+        inline void store(half* p,const regType a) {
+          _mm_storel_epi64((__m128i*)p,
+                           _mm_cvtps_ph(a,_MM_FROUND_TO_NEAREST_INT));
+        }
+#else
+        inline regType load(const half* p) {
+          float t[lanes];
+          for (size_t k=0;k<lanes;++k) {
+            t[k] = p[k];
+          }
+          return mm_loadu<float,regType>(t);
+        }
+        inline void store(half* p,const regType a) {
+          float t[lanes];
+          mm_storeu<float,regType>(t,a);
+          for (size_t k=0;k<lanes;++k) {
+            p[k] = t[k];
+          }
+        }
+#endif
+
+        /*
+         * bfloat16 <-> float: the 16 bits are shifted into the upper half
+         * of each float lane and back, rounding to nearest even by adding
+         * 0x7fff plus the lowest kept bit.  NaNs are kept quiet NaNs.
+         */
+#if ANPI_SIMD_WIDTH >= 64
+        inline regType load(const bfloat16* p) {
+          const __m256i h = _mm256_loadu_si256((const __m256i*)p);
+          return _mm512_castsi512_ps(
+                   _mm512_maskz_slli_epi32(all,
+                     _mm512_maskz_cvtepu16_epi32(all,h),16));
+        }
+        inline void store(bfloat16* p,const regType a) {
+          const __m512i u   = _mm512_castps_si512(a);
+          const __m512i hi  = _mm512_maskz_srli_epi32(all,u,16);
+          const __m512i odd = _mm512_and_si512(hi,_mm512_set1_epi32(1));
+          __m512i r = _mm512_add_epi32(_mm512_add_epi32(u,odd),
+                                       _mm512_set1_epi32(0x7fff));
+          r = _mm512_maskz_srli_epi32(all,r,16);
+
+          const __mmask16 nan = _mm512_cmp_ps_mask(a,a,_CMP_UNORD_Q);
+          r = _mm512_mask_mov_epi32(r,nan,
+                _mm512_or_si512(hi,_mm512_set1_epi32(0x40)));
+          _mm256_storeu_si256((__m256i*)p,
+                              _mm512_maskz_cvtepi32_epi16(all,r));
+        }
+#elif ANPI_SIMD_WIDTH >= 32
+        inline regType load(const bfloat16* p) {
+          const __m128i h = _mm_loadu_si128((const __m128i*)p);
+          return _mm256_castsi256_ps(
+                   _mm256_slli_epi32(_mm256_cvtepu16_epi32(h),16));
+        }
+        inline void store(bfloat16* p,const regType a) {
+          const __m256i u   = _mm256_castps_si256(a);
+          const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u,16),
+                                               _mm256_set1_epi32(1));
+          __m256i r = _mm256_add_epi32(_mm256_add_epi32(u,odd),
+                                       _mm256_set1_epi32(0x7fff));
+          r = _mm256_srli_epi32(r,16);
+
+          const __m256i nan = _mm256_castps_si256(
+                                _mm256_cmp_ps(a,a,_CMP_UNORD_Q));
+          r = _mm256_blendv_epi8(r,
+                _mm256_or_si256(_mm256_srli_epi32(u,16),
+                                _mm256_set1_epi32(0x40)),
+                nan);
+
+          // The pack works on each 128 bit half: gather the two results
+          const __m256i packed = _mm256_permute4x64_epi64(
+                                   _mm256_packus_epi32(r,r),0x08);
+          _mm_storeu_si128((__m128i*)p,_mm256_castsi256_si128(packed));
+        }
+#else
+        inline regType load(const bfloat16* p) {
+          const __m128i h = _mm_loadl_epi64((const __m128i*)p);
+          return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(),h));
+        }
+        inline void store(bfloat16* p,const regType a) {
+          const __m128i u   = _mm_castps_si128(a);
+          const __m128i odd = _mm_and_si128(_mm_srli_epi32(u,16),
+                                            _mm_set1_epi32(1));
+          __m128i r = _mm_add_epi32(_mm_add_epi32(u,odd),
+                                    _mm_set1_epi32(0x7fff));
+          r = _mm_srli_epi32(r,16);
+
+          const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(a,a));
+          r = _mm_or_si128(_mm_andnot_si128(nan,r),
+                           _mm_and_si128(nan,
+                             _mm_or_si128(_mm_srli_epi32(u,16),
+                                          _mm_set1_epi32(0x40))));
+
+          // SSE2 only packs with signed saturation: sign extend first
+          r = _mm_srai_epi32(_mm_slli_epi32(r,16),16);
+          _mm_storel_epi64((__m128i*)p,_mm_packs_epi32(r,r));
+        }
+#endif
+
+        /*
+         * Element-wise kernels
+         */
+
+        // y = float(x)
+        template<typename H>
+        inline void convert(const H* x,float* y,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            mm_storeu<float,regType>(y+i,load(x+i));
+          }
+          for (;i<n;++i) {
+            y[i] = x[i];
+          }
+        }
+
+        // y = x rounded to H
+        template<typename H>
+        inline void convert(const float* x,H* y,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(y+i,mm_loadu<float,regType>(x+i));
+          }
+          for (;i<n;++i) {
+            y[i] = x[i];
+          }
+        }
+
+        // c = a + b
+        template<typename H>
+        inline void add(const H* a,const H* b,H* c,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(c+i,mm_add<float>(load(a+i),load(b+i)));
+          }
+          for (;i<n;++i) {
+            c[i] = a[i] + b[i];
+          }
+        }
+
+        // c = a - b
+        template<typename H>
+        inline void subtract(const H* a,const H* b,H* c,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(c+i,mm_sub<float>(load(a+i),load(b+i)));
+          }
+          for (;i<n;++i) {
+            c[i] = a[i] - b[i];
+          }
+        }
+
+        // x = alpha*x
+        template<typename H>
+        inline void scale(H* x,const size_t n,const H alpha) {
+          const regType va = mm_set1<float,regType>(alpha);
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(x+i,mm_mul<float>(va,load(x+i)));
+          }
+          for (;i<n;++i) {
+            x[i] *= alpha;
+          }
+        }
+
+        // y = alpha*x + y
+        template<typename H>
+        inline void axpy(const H alpha,const H* x,H* y,const size_t n) {
+          const regType va = mm_set1<float,regType>(alpha);
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(y+i,mm_fmadd<float>(va,load(x+i),load(y+i)));
+          }
+          for (;i<n;++i) {
+            y[i] += alpha*x[i];
+          }
+        }
+
+        // c = a.*b
+        template<typename H>
+        inline void hadamard(const H* a,const H* b,H* c,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(c+i,mm_mul<float>(load(a+i),load(b+i)));
+          }
+          for (;i<n;++i) {
+            c[i] = a[i]*b[i];
+          }
+        }
+
+        // c = a./b
+        template<typename H>
+        inline void divide(const H* a,const H* b,H* c,const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(c+i,mm_div<float>(load(a+i),load(b+i)));
+          }
+          for (;i<n;++i) {
+            c[i] = a[i]/b[i];
+          }
+        }
+
+        // d = a.*b + c
+        template<typename H>
+        inline void fmadd(const H* a,const H* b,const H* c,H* d,
+                          const size_t n) {
+          size_t i=0;
+          for (;i+lanes<=n;i+=lanes) {
+            store(d+i,mm_fmadd<float>(load(a+i),load(b+i),load(c+i)));
+          }
+          for (;i<n;++i) {
+            d[i] = a[i]*b[i] + c[i];
+          }
+        }
+
+        /*
+         * Reductions, accumulated in float with two register accumulators
+         * and split among threads as in MatrixReduceSIMD.tpp
+         */
+
+        // Sum of x[i]*y[i] on one range
+        template<typename H>
+        inline float dotBlock(const H* x,const H* y,const size_t n) {
+          regType s0 = mm_set1<float,regType>(0.f);
+          regType s1 = s0;
+          size_t i=0;
+          for (;i+2*lanes<=n;i+=2*lanes) {
+            s0 = mm_fmadd<float>(load(x+i),load(y+i),s0);
+            s1 = mm_fmadd<float>(load(x+i+lanes),load(y+i+lanes),s1);
+          }
+          for (;i+lanes<=n;i+=lanes) {
+            s0 = mm_fmadd<float>(load(x+i),load(y+i),s0);
+          }
+
+          float r = mm_hsum<float>(mm_add<float>(s0,s1));
+          for (;i<n;++i) {
+            r += x[i]*y[i];
+          }
+          return r;
+        }
+
+        // Sum of x[i] on one range
+        template<typename H>
+        inline float sumBlock(const H* x,const size_t n) {
+          regType s0 = mm_set1<float,regType>(0.f);
+          regType s1 = s0;
+          size_t i=0;
+          for (;i+2*lanes<=n;i+=2*lanes) {
+            s0 = mm_add<float>(s0,load(x+i));
+            s1 = mm_add<float>(s1,load(x+i+lanes));
+          }
+          for (;i+lanes<=n;i+=lanes) {
+            s0 = mm_add<float>(s0,load(x+i));
+          }
+
+          float r = mm_hsum<float>(mm_add<float>(s0,s1));
+          for (;i<n;++i) {
+            r += x[i];
+          }
+          return r;
+        }
+
+        // result = sum of x[i]*y[i]
+        template<typename H>
+        inline void dot(const H* x,const H* y,const size_t n,float& result) {
+          const int threads = reduceThreads(n);
+          if (threads == 1) {
+            result = dotBlock(x,y,n);
+            return;
+          }
+
+          std::vector<float> part(threads);
+#pragma omp parallel for num_threads(threads) schedule(static)
+          for (int t=0;t<threads;++t) {
+            size_t begin,end;
+            reduceRange(n,threads,t,begin,end);
+            part[t] = dotBlock(x+begin,y+begin,end-begin);
+          }
+          result = ::anpi::simd::ANPI_SIMD_TARGET::sumBlock(part.data(),
+                                                           part.size());
+        }
+
+        // result = sum of x[i]
+        template<typename H>
+        inline void sum(const H* x,const size_t n,float& result) {
+          const int threads = reduceThreads(n);
+          if (threads == 1) {
+            result = sumBlock(x,n);
+            return;
+          }
+
+          std::vector<float> part(threads);
+#pragma omp parallel for num_threads(threads) schedule(static)
+          for (int t=0;t<threads;++t) {
+            size_t begin,end;
+            reduceRange(n,threads,t,begin,end);
+            part[t] = sumBlock(x+begin,end-begin);
+          }
+          result = ::anpi::simd::ANPI_SIMD_TARGET::sumBlock(part.data(),
+                                                           part.size());
+        }
+
+        // result = sum of x[i]^2
+        template<typename H>
+        inline void squaredNorm(const H* x,const size_t n,float& result) {
+          dot(x,x,n,result);
+        }
+
+      } // namespace reduced
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_MULTIPLY_HPP
+#define ANPI_MATRIX_MULTIPLY_HPP
+
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+
+#include "Intrinsics.hpp"
+#include "IntrinsicsM.hpp"
+#include "MatrixArithmetic.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    /*
+     * Matrix product
+     */
+
+    // c = alpha*a*b + beta*c on views
+    //
+    // The loops are ordered i-k-j so that both b and c are traversed
+    // row-wise.  The view c must not overlap a or b.
+    template<typename T>
+    inline void gemm(const MatrixView<const T>& a,
+                     const MatrixView<const T>& b,
+                     const MatrixView<T>& c,
+                     const T alpha,
+                     const T beta) {
+
+      assert( (a.cols() == b.rows()) &&
+              (a.rows() == c.rows()) && (b.cols() == c.cols()) );
+
+      const size_t n = c.cols();
+
+      for (size_t i=0;i<c.rows();++i) {
+        T* crow = c[i];
+        if (beta == T(0)) {
+          for (size_t j=0;j<n;++j) {
+            crow[j] = T(0);
+          }
+        } else if (beta != T(1)) {
+          for (size_t j=0;j<n;++j) {
+            crow[j] *= beta;
+          }
+        }
+
+        const T* arow = a[i];
+        for (size_t k=0;k<a.cols();++k) {
+          const T aik = alpha*arow[k];
+          const T* bptr = b[k];
+          for (size_t j=0;j<n;++j) {
+            crow[j] += aik * bptr[j];
+          }
+        }
+      }
+    }
+
+    // In-copy implementation c=a*b
+    template<typename T,class Alloc>
+    inline void multiply(const Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b,
+                         Matrix<T,Alloc>& c) {
+
+      assert( a.cols() == b.rows() );
+      assert( (&c != &a) && (&c != &b) );
+
+      c.allocate(a.rows(),b.cols());
+      gemm<T>(a.view(),b.view(),c.view(),T(1),T(0));
+    }
+
+    /*
+     * Matrix-vector product
+     */
+
+    // y = alpha*a*x + beta*y, where x has a.cols() and y a.rows()
+    // entries.  If beta is zero, y is not read.
+    template<typename T,class Alloc>
+    inline void gemv(const Matrix<T,Alloc>& a,
+                     const T* x,
+                     T* y,
+                     const T alpha,
+                     const T beta) {
+
+      for (size_t i=0;i<a.rows();++i) {
+        const T* row = a[i];
+        T sum = T(0);
+        for (size_t j=0;j<a.cols();++j) {
+          sum += row[j]*x[j];
+        }
+        y[i] = (beta == T(0)) ? alpha*sum : alpha*sum + beta*y[i];
+      }
+    }
+  } // namespace fallback
+
+
+  namespace simd
+  {
+    /*
+     * Matrix product
+     *
+     * The product follows the usual GotoBLAS/BLIS structure: B is
+     * packed into a KC x NC panel that stays in the L3 cache, A is
+     * packed into a MC x KC block that stays in L2, and a register
+     * tiled micro-kernel computes MR x NR tiles of C, streaming
+     * through slivers of both packed panels held in L1.
+     *
+     * Large products are split into tiles of C computed by an OpenMP
+     * thread team (see anpi::parallel for the thresholds).
+     */
+
+    /// Only float and double are handled by the packed kernel
+    template<typename T>
+    struct is_gemm_type {
+      static constexpr bool value =
+        std::is_same<T,double>::value || std::is_same<T,float>::value;
+    };
+
+    /**
+     * Block sizes of the packed multiplication for the element type T
+     * computed with registers of type regType.
+     */
+    template<typename T,typename regType>
+    struct gemm_blocking {
+      /// Number of elements of type T in one register
+      static constexpr size_t lanes = sizeof(regType)/sizeof(T);
+      /// Rows of the micro-tile (one broadcast per row)
+      static constexpr size_t MR = 6;
+      /// Columns of the micro-tile (two registers per row)
+      static constexpr size_t NR = 2*lanes;
+      /// Depth of the packed panels (A and B slivers fit in L1)
+      static constexpr size_t KC = 256;
+      /// Rows of the packed block of A (fits in L2)
+      static constexpr size_t MC = 16*MR;
+      /// Columns of the packed panel of B (fits in L3)
+      static constexpr size_t NC = 2048;
+    };
+
+    // Definitions of the block sizes, which std::min takes by reference
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::lanes;
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::MR;
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::NR;
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::KC;
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::MC;
+    template<typename T,typename regType>
+    constexpr size_t gemm_blocking<T,regType>::NC;
+
+    /// Products with less multiply-adds than this use the fallback
+    static const size_t GemmMinOps = 16*16*16;
+
+  } // namespace simd
+} // namespace anpi
+
+// The packed kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixMultiplySIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    // c = alpha*a*b + beta*c on views of float and double
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void gemm(const MatrixView<const T>& a,
+                     const MatrixView<const T>& b,
+                     const MatrixView<T>& c,
+                     const T alpha,
+                     const T beta) {
+
+      if (c.rows()*c.cols()*a.cols() >= GemmMinOps) {
+        ANPI_SIMD_DISPATCH(gemm,a,b,c,alpha,beta);
+      }
+      ::anpi::fallback::gemm(a,b,c,alpha,beta);
+    }
+
+    // Types without a packed kernel, such as complex or integers
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type=0>
+    inline void gemm(const MatrixView<const T>& a,
+                     const MatrixView<const T>& b,
+                     const MatrixView<T>& c,
+                     const T alpha,
+                     const T beta) {
+
+      ::anpi::fallback::gemm(a,b,c,alpha,beta);
+    }
+
+    // On-copy implementation c=a*b
+    template<typename T,class Alloc>
+    inline void multiply(const Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b,
+                         Matrix<T,Alloc>& c) {
+
+      assert( a.cols() == b.rows() );
+      assert( (&c != &a) && (&c != &b) );
+
+      c.allocate(a.rows(),b.cols());
+      gemm<T>(a.view(),b.view(),c.view(),T(1),T(0));
+    }
+
+
+    /*
+     * Matrix-vector product
+     */
+
+    // y = alpha*a*x + beta*y for float and double
+    template<typename T,
+             class Alloc,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void gemv(const Matrix<T,Alloc>& a,
+                     const T* x,
+                     T* y,
+                     const T alpha,
+                     const T beta) {
+      ANPI_SIMD_DISPATCH(gemv,a,x,y,alpha,beta);
+      ::anpi::fallback::gemv(a,x,y,alpha,beta);
+    }
+
+    // Types without SIMD support
+    template<typename T,
+             class Alloc,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type = 0>
+    inline void gemv(const Matrix<T,Alloc>& a,
+                     const T* x,
+                     T* y,
+                     const T alpha,
+                     const T beta) {
+
+      ::anpi::fallback::gemv(a,x,y,alpha,beta);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
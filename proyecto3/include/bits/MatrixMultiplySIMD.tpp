@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the matrix product and the matrix-vector product.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      /*
+       * Matrix product
+       */
+
+      /**
+       * Pack the mc x kc block of a starting at (ic,pc), scaled by
+       * alpha, into slivers of MR rows, each one stored column after
+       * column.  Rows beyond the matrix are filled with zeros.
+       */
+      template<typename T,typename regType>
+      inline void gemmPackA(const MatrixView<const T>& a,
+                            const size_t ic,const size_t pc,
+                            const size_t mc,const size_t kc,
+                            const T alpha,
+                            T* dst) {
+        constexpr size_t MR = gemm_blocking<T,regType>::MR;
+
+        for (size_t s=0;s<mc;s+=MR, dst+=MR*kc) {
+          for (size_t i=0;i<MR;++i) {
+            T* ptr = dst+i;
+            if (s+i < mc) {
+              const T* src = a[ic+s+i]+pc;
+              for (size_t p=0;p<kc;++p,ptr+=MR) {
+                *ptr = alpha*src[p];
+              }
+            } else {
+              for (size_t p=0;p<kc;++p,ptr+=MR) {
+                *ptr = T(0);
+              }
+            }
+          }
+        }
+      }
+
+      /**
+       * Pack the kc x nc panel of b starting at (pc,jc) into slivers of
+       * NR columns, each one stored row after row.  Columns beyond the
+       * matrix are filled with zeros.
+       */
+      template<typename T,typename regType>
+      inline void gemmPackB(const MatrixView<const T>& b,
+                            const size_t pc,const size_t jc,
+                            const size_t kc,const size_t nc,
+                            T* dst) {
+        constexpr size_t NR = gemm_blocking<T,regType>::NR;
+
+        for (size_t t=0;t<nc;t+=NR) {
+          const size_t nr = std::min(NR,nc-t);
+          for (size_t p=0;p<kc;++p,dst+=NR) {
+            const T* src = b[pc+p]+jc+t;
+            size_t j=0;
+            for (;j<nr;++j) {
+              dst[j] = src[j];
+            }
+            for (;j<NR;++j) {
+              dst[j] = T(0);
+            }
+          }
+        }
+      }
+
+      /**
+       * Micro-kernel computing the MR x NR tile ap*bp, where ap and bp
+       * are slivers of depth kc of the packed panels.
+       *
+       * The tile is written into c, with ldc entries between rows, or
+       * added to its content if accumulate is true.  Only mr rows and nr
+       * columns are written, for the borders of the matrix.
+       */
+      template<typename T,typename regType>
+      inline void gemmKernel(const size_t kc,
+                             const T* ap,
+                             const T* bp,
+                             T* c,
+                             const size_t ldc,
+                             const size_t mr,
+                             const size_t nr,
+                             const bool accumulate) {
+        typedef gemm_blocking<T,regType> blk;
+        constexpr size_t MR    = blk::MR;
+        constexpr size_t NR    = blk::NR;
+        constexpr size_t lanes = blk::lanes;
+
+        regType c0[MR];
+        regType c1[MR];
+        for (size_t i=0;i<MR;++i) {
+          c0[i] = c1[i] = mm_set1<T,regType>(T(0));
+        }
+
+        const regType* bptr = reinterpret_cast<const regType*>(bp);
+        for (size_t p=0;p<kc;++p,ap+=MR,bptr+=2) {
+          const regType b0 = bptr[0];
+          const regType b1 = bptr[1];
+          for (size_t i=0;i<MR;++i) {
+            const regType ai = mm_set1<T,regType>(ap[i]);
+            c0[i] = mm_fmadd<T>(ai,b0,c0[i]);
+            c1[i] = mm_fmadd<T>(ai,b1,c1[i]);
+          }
+        }
+
+        if ((mr==MR) && (nr==NR)) { // full tile: straight into c
+          for (size_t i=0;i<MR;++i,c+=ldc) {
+            if (accumulate) {
+              c0[i] = mm_add<T>(c0[i],mm_loadu<T,regType>(c));
+              c1[i] = mm_add<T>(c1[i],mm_loadu<T,regType>(c+lanes));
+            }
+            mm_storeu<T,regType>(c,c0[i]);
+            mm_storeu<T,regType>(c+lanes,c1[i]);
+          }
+        } else { // border tile: go through a temporary
+          alignas(sizeof(regType)) T tmp[MR*NR];
+          regType* tptr = reinterpret_cast<regType*>(tmp);
+          for (size_t i=0;i<MR;++i) {
+            *tptr++ = c0[i];
+            *tptr++ = c1[i];
+          }
+          for (size_t i=0;i<mr;++i,c+=ldc) {
+            const T* row = tmp+i*NR;
+            for (size_t j=0;j<nr;++j) {
+              c[j] = accumulate ? c[j]+row[j] : row[j];
+            }
+          }
+        }
+      }
+
+      // c = alpha*a*b + beta*c on views
+      //
+      // For each packed panel of B the matrix C is split into tiles of
+      // at most MC rows, which are distributed among the threads.  Each
+      // thread packs its own blocks of A, but consecutive tiles of one
+      // thread share the same rows, so that A is rarely packed twice.
+      template<typename T,typename regType>
+      inline void gemmSIMD(const MatrixView<const T>& a,
+                           const MatrixView<const T>& b,
+                           const MatrixView<T>& c,
+                           const T alpha,
+                           const T beta) {
+        typedef gemm_blocking<T,regType> blk;
+        typedef std::vector<T,aligned_allocator<T,sizeof(regType)> > buffer;
+        constexpr size_t MR = blk::MR;
+        constexpr size_t NR = blk::NR;
+
+        const size_t m = c.rows();
+        const size_t n = c.cols();
+        const size_t k = a.cols();
+
+        // c = beta*c beforehand, unless the kernels overwrite c (beta=0)
+        // or just accumulate on it (beta=1)
+        const bool noProduct = (k==0) || (alpha==T(0));
+        if ((beta != T(1)) && ((beta != T(0)) || noProduct)) {
+          for (size_t i=0;i<m;++i) {
+            T* crow = c[i];
+            for (size_t j=0;j<n;++j) {
+              crow[j] = (beta == T(0)) ? T(0) : beta*crow[j];
+            }
+          }
+        }
+        if (noProduct) {
+          return;
+        }
+        const bool accumulate = (beta != T(0));
+
+        const int threads = (m*n*k >= parallel::gemmThreshold())
+                          ? parallel::numThreads() : 1;
+
+        // packed panels, just as large as this product requires
+        const size_t kcMax = std::min(blk::KC,k);
+        const size_t mcMax = std::min(blk::MC,m);
+        const size_t ncMax = std::min(blk::NC,n);
+        buffer bpack(((ncMax+NR-1)/NR)*NR*kcMax);
+
+        // tiles of C: enough of them to keep all threads busy
+        const size_t rowTiles = (m+blk::MC-1)/blk::MC;
+        const size_t colTiles =
+          std::min((ncMax+NR-1)/NR,
+                   std::max(size_t(1),(2*size_t(threads)+rowTiles-1)/rowTiles));
+        const size_t tileCols = (((ncMax+colTiles-1)/colTiles+NR-1)/NR)*NR;
+
+        const size_t ldc = c.dcols();
+
+#pragma omp parallel num_threads(threads) if(threads>1)
+        {
+          buffer apack(((mcMax+MR-1)/MR)*MR*kcMax);
+
+          for (size_t jc=0;jc<n;jc+=blk::NC) {
+            const size_t nc = std::min(blk::NC,n-jc);
+            const size_t slivers = (nc+NR-1)/NR;
+            const size_t tiles = rowTiles*((nc+tileCols-1)/tileCols);
+
+            for (size_t pc=0;pc<k;pc+=blk::KC) {
+              const size_t kc = std::min(blk::KC,k-pc);
+
+#pragma omp for schedule(static)
+              for (size_t t=0;t<slivers;++t) {
+                gemmPackB<T,regType>(b,pc,jc+t*NR,kc,
+                                           std::min(NR,nc-t*NR),
+                                           bpack.data()+t*NR*kc);
+              }
+
+              size_t packedRow = m; // no block of A packed yet
+#pragma omp for schedule(static)
+              for (size_t tile=0;tile<tiles;++tile) {
+                const size_t ic = (tile/((nc+tileCols-1)/tileCols))*blk::MC;
+                const size_t jt = (tile%((nc+tileCols-1)/tileCols))*tileCols;
+                const size_t mc = std::min(blk::MC,m-ic);
+                const size_t tc = std::min(tileCols,nc-jt);
+
+                if (packedRow != ic) {
+                  gemmPackA<T,regType>(a,ic,pc,mc,kc,alpha,apack.data());
+                  packedRow = ic;
+                }
+
+                for (size_t jr=jt;jr<jt+tc;jr+=NR) {
+                  const size_t nr = std::min(NR,jt+tc-jr);
+                  for (size_t ir=0;ir<mc;ir+=MR) {
+                    gemmKernel<T,regType>(kc,
+                                          apack.data()+ir*kc,
+                                          bpack.data()+jr*kc,
+                                          c[ic+ir]+jc+jr,ldc,
+                                          std::min(MR,mc-ir),nr,
+                                          accumulate || (pc!=0));
+                  }
+                }
+              } // implicit barrier: bpack is reused afterwards
+            }
+          }
+        }
+      }
+
+      // c = alpha*a*b + beta*c with the widest registers available
+      template<typename T>
+      inline void gemm(const MatrixView<const T>& a,
+                       const MatrixView<const T>& b,
+                       const MatrixView<T>& c,
+                       const T alpha,
+                       const T beta) {
+        gemmSIMD<T,
+                 typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(a,b,c,
+                                                                    alpha,
+                                                                    beta);
+      }
+
+      /*
+       * Matrix-vector product
+       */
+
+      // y = alpha*a*x + beta*y with one SIMD dot product per row
+      //
+      // Two accumulators hide the latency of the fused multiply-add.  If
+      // the allocator aligns each row, the rows of a are read with
+      // aligned loads.  Large matrices are split by rows among threads.
+      template<typename T,class Alloc,typename regType>
+      inline void gemvSIMD(const Matrix<T,Alloc>& a,
+                           const T* x,
+                           T* y,
+                           const T alpha,
+                           const T beta) {
+
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        constexpr bool alignedRows =
+          is_aligned_alloc<Alloc>::value &&
+          extract_alignment<Alloc>::row_aligned &&
+          (extract_alignment<Alloc>::value >= sizeof(regType));
+
+        const size_t m  = a.rows();
+        const size_t n  = a.cols();
+        const size_t nv = (n/(2*lanes))*(2*lanes);
+
+        const int threads = (m*n >= parallel::gemvThreshold())
+                          ? parallel::numThreads() : 1;
+        (void)threads; // only read by OpenMP
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (size_t i=0;i<m;++i) {
+          const T* row = a[i];
+          regType s0 = mm_set1<T,regType>(T(0));
+          regType s1 = s0;
+
+          size_t j=0;
+          if (alignedRows) {
+            const regType* rptr = reinterpret_cast<const regType*>(row);
+            for (;j<nv;j+=2*lanes,rptr+=2) {
+              s0 = mm_fmadd<T>(rptr[0],mm_loadu<T,regType>(x+j),s0);
+              s1 = mm_fmadd<T>(rptr[1],mm_loadu<T,regType>(x+j+lanes),s1);
+            }
+          } else {
+            for (;j<nv;j+=2*lanes) {
+              s0 = mm_fmadd<T>(mm_loadu<T,regType>(row+j),
+                               mm_loadu<T,regType>(x+j),s0);
+              s1 = mm_fmadd<T>(mm_loadu<T,regType>(row+j+lanes),
+                               mm_loadu<T,regType>(x+j+lanes),s1);
+            }
+          }
+
+          T sum = mm_hsum<T,regType>(mm_add<T>(s0,s1));
+          for (;j<n;++j) {
+            sum += row[j]*x[j];
+          }
+          y[i] = (beta == T(0)) ? alpha*sum : alpha*sum + beta*y[i];
+        }
+      }
+
+      // y = alpha*a*x + beta*y with the widest registers available
+      template<typename T,class Alloc>
+      inline void gemv(const Matrix<T,Alloc>& a,
+                       const T* x,
+                       T* y,
+                       const T alpha,
+                       const T beta) {
+        gemvSIMD<T,Alloc,
+                 typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(a,x,y,
+                                                                    alpha,
+                                                                    beta);
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_REDUCE_HPP
+#define ANPI_MATRIX_REDUCE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Intrinsics.hpp"
+#include "IntrinsicsM.hpp"
+#include "MatrixArithmetic.hpp"
+#include "MatrixMultiply.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    /*
+     * Reductions
+     *
+     * All reductions work on n entries; only iamax() accepts a stride,
+     * for the search along the columns of a matrix.  The results are
+     * returned in the last argument, so that the kernels can be called
+     * through ANPI_SIMD_DISPATCH.
+     *
+     * Four independent accumulators are kept, so that the additions of
+     * consecutive entries do not wait for each other.  They have the
+     * accumulator_type of the entries, i.e. float for the 16 bit
+     * storage types.
+     */
+
+    // |x|^2 of a real entry, squared in the accumulator type
+    template<typename T>
+    inline typename accumulator_type<T>::type abs2(const T x) {
+      const typename accumulator_type<T>::type a(x);
+      return a*a;
+    }
+
+    // |x|^2 of a complex entry
+    template<typename T>
+    inline T abs2(const std::complex<T>& x) {
+      return std::norm(x);
+    }
+
+    // result = sum of x[i]*y[i]
+    template<typename T>
+    inline void dot(const T* x,const T* y,const size_t n,
+                    typename accumulator_type<T>::type& result) {
+      typedef typename accumulator_type<T>::type A;
+      A s0(0),s1(0),s2(0),s3(0);
+      size_t i=0;
+      for (;i+4<=n;i+=4) {
+        s0 += x[i  ]*y[i  ];
+        s1 += x[i+1]*y[i+1];
+        s2 += x[i+2]*y[i+2];
+        s3 += x[i+3]*y[i+3];
+      }
+      for (;i<n;++i) {
+        s0 += x[i]*y[i];
+      }
+      result = (s0+s1) + (s2+s3);
+    }
+
+    // result = sum of x[i]
+    template<typename T>
+    inline void sum(const T* x,const size_t n,
+                    typename accumulator_type<T>::type& result) {
+      typedef typename accumulator_type<T>::type A;
+      A s0(0),s1(0),s2(0),s3(0);
+      size_t i=0;
+      for (;i+4<=n;i+=4) {
+        s0 += x[i  ];
+        s1 += x[i+1];
+        s2 += x[i+2];
+        s3 += x[i+3];
+      }
+      for (;i<n;++i) {
+        s0 += x[i];
+      }
+      result = (s0+s1) + (s2+s3);
+    }
+
+    // result = sum of |x[i]|^2
+    template<typename T>
+    inline void squaredNorm(const T* x,const size_t n,
+                            typename norm_type<T>::type& result) {
+      typedef typename norm_type<T>::type R;
+      R s0(0),s1(0),s2(0),s3(0);
+      size_t i=0;
+      for (;i+4<=n;i+=4) {
+        s0 += abs2(x[i  ]);
+        s1 += abs2(x[i+1]);
+        s2 += abs2(x[i+2]);
+        s3 += abs2(x[i+3]);
+      }
+      for (;i<n;++i) {
+        s0 += abs2(x[i]);
+      }
+      result = (s0+s1) + (s2+s3);
+    }
+
+    // index = first i with the largest |x[i*stride]|, or zero if n==0
+    template<typename T>
+    inline void iamax(const T* x,const size_t n,const size_t stride,
+                      size_t& index) {
+      typedef typename norm_type<T>::type R;
+      index = 0;
+      if (n==0) {
+        return;
+      }
+
+      // Each chain keeps its first maximum; ties are broken by index
+      R m[4];
+      size_t idx[4];
+      for (int k=0;k<4;++k) {
+        m[k] = std::abs(x[0]);
+        idx[k] = 0;
+      }
+
+      size_t i=1;
+      for (;i+4<=n;i+=4) {
+        for (size_t k=0;k<4;++k) {
+          const R a = std::abs(x[(i+k)*stride]);
+          if (a > m[k]) {
+            m[k] = a;
+            idx[k] = i+k;
+          }
+        }
+      }
+      for (;i<n;++i) {
+        const R a = std::abs(x[i*stride]);
+        if (a > m[0]) {
+          m[0] = a;
+          idx[0] = i;
+        }
+      }
+
+      R best = m[0];
+      index = idx[0];
+      for (int k=1;k<4;++k) {
+        if ((m[k] > best) || ((m[k] == best) && (idx[k] < index))) {
+          best = m[k];
+          index = idx[k];
+        }
+      }
+    }
+
+  } // namespace fallback
+
+
+  namespace simd
+  {
+    /**
+     * Threads for a reduction of n entries: large inputs are split into
+     * one contiguous range per thread, and the partial results combined.
+     */
+    inline int reduceThreads(const size_t n) {
+      return (n >= parallel::reduceThreshold()) ? parallel::numThreads() : 1;
+    }
+
+    /// Range [begin,end) of the n entries reduced by thread t
+    inline void reduceRange(const size_t n,const int threads,const int t,
+                            size_t& begin,size_t& end) {
+      // Multiples of 64 entries keep the ranges on whole cache lines
+      const size_t chunk = ((n/size_t(threads) + 63)/64)*64;
+      begin = std::min(n,size_t(t)*chunk);
+      end   = (t+1 == threads) ? n : std::min(n,begin+chunk);
+    }
+  } // namespace simd
+} // namespace anpi
+
+// The register kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixReduceSIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    /*
+     * Dispatchers to the best kernels available, for float and double
+     */
+
+    // result = sum of x[i]*y[i]
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void dot(const T* x,const T* y,const size_t n,T& result) {
+      ANPI_SIMD_DISPATCH(dot,x,y,n,result);
+      ::anpi::fallback::dot(x,y,n,result);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void dot(const T* x,const T* y,const size_t n,T& result) {
+      ::anpi::fallback::dot(x,y,n,result);
+    }
+
+    // result = sum of x[i]
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void sum(const T* x,const size_t n,T& result) {
+      ANPI_SIMD_DISPATCH(sum,x,n,result);
+      ::anpi::fallback::sum(x,n,result);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void sum(const T* x,const size_t n,T& result) {
+      ::anpi::fallback::sum(x,n,result);
+    }
+
+    // result = sum of |x[i]|^2
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void squaredNorm(const T* x,const size_t n,T& result) {
+      ANPI_SIMD_DISPATCH(squaredNorm,x,n,result);
+      ::anpi::fallback::squaredNorm(x,n,result);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value &&
+                                     !is_half_type<T>::value,int>::type=0>
+    inline void squaredNorm(const T* x,const size_t n,
+                            typename norm_type<T>::type& result) {
+      ::anpi::fallback::squaredNorm(x,n,result);
+    }
+
+    // index = first i with the largest |x[i*stride]|.  Only contiguous
+    // entries have register kernels: strided ones would need a gather,
+    // which costs as much as the scalar loads.
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void iamax(const T* x,const size_t n,const size_t stride,
+                      size_t& index) {
+      if (stride == 1) {
+        ANPI_SIMD_DISPATCH(iamax,x,n,index);
+      }
+      ::anpi::fallback::iamax(x,n,stride,index);
+    }
+
+    // Types without register kernels
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type=0>
+    inline void iamax(const T* x,const size_t n,const size_t stride,
+                      size_t& index) {
+      ::anpi::fallback::iamax(x,n,stride,index);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the reductions.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * The *Block kernels reduce one contiguous range with four register
+ * accumulators; the others split large inputs into one range per
+ * thread (see reduceThreads()) and combine the partial results.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      /*
+       * Magnitudes and comparisons, which have no generic wrappers
+       */
+#if ANPI_SIMD_WIDTH >= 64
+      inline __m512  absReg(const __m512  a) { return _mm512_abs_ps(a); }
+      inline __m512d absReg(const __m512d a) { return _mm512_abs_pd(a); }
+
+      // The masked forms avoid the undefined source register of
+      // _mm512_max_*, which trips -Wuninitialized with some GCC versions
+      inline __m512  maxReg(const __m512  a,const __m512  b) {
+        return _mm512_mask_max_ps(a,__mmask16(0xffff),a,b);
+      }
+      inline __m512d maxReg(const __m512d a,const __m512d b) {
+        return _mm512_mask_max_pd(a,__mmask8(0xff),a,b);
+      }
+
+      // Bit i is set if lane i of a and b are equal
+      inline unsigned eqMask(const __m512 a,const __m512 b) {
+        return _mm512_cmp_ps_mask(a,b,_CMP_EQ_OQ);
+      }
+      inline unsigned eqMask(const __m512d a,const __m512d b) {
+        return _mm512_cmp_pd_mask(a,b,_CMP_EQ_OQ);
+      }
+#elif ANPI_SIMD_WIDTH >= 32
+      inline __m256  absReg(const __m256  a) {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.0f),a);
+      }
+      inline __m256d absReg(const __m256d a) {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0),a);
+      }
+
+      inline __m256  maxReg(const __m256  a,const __m256  b) {
+        return _mm256_max_ps(a,b);
+      }
+      inline __m256d maxReg(const __m256d a,const __m256d b) {
+        return _mm256_max_pd(a,b);
+      }
+
+      inline unsigned eqMask(const __m256 a,const __m256 b) {
+        return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a,b,_CMP_EQ_OQ)));
+      }
+      inline unsigned eqMask(const __m256d a,const __m256d b) {
+        return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a,b,_CMP_EQ_OQ)));
+      }
+#else
+      inline __m128  absReg(const __m128  a) {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f),a);
+      }
+      inline __m128d absReg(const __m128d a) {
+        return _mm_andnot_pd(_mm_set1_pd(-0.0),a);
+      }
+
+      inline __m128  maxReg(const __m128  a,const __m128  b) {
+        return _mm_max_ps(a,b);
+      }
+      inline __m128d maxReg(const __m128d a,const __m128d b) {
+        return _mm_max_pd(a,b);
+      }
+
+      inline unsigned eqMask(const __m128 a,const __m128 b) {
+        return unsigned(_mm_movemask_ps(_mm_cmpeq_ps(a,b)));
+      }
+      inline unsigned eqMask(const __m128d a,const __m128d b) {
+        return unsigned(_mm_movemask_pd(_mm_cmpeq_pd(a,b)));
+      }
+#endif
+
+      // Largest lane of a register
+      template<typename T,typename regType>
+      inline T maxLane(const regType a) {
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        T t[lanes];
+        std::memcpy(t,&a,sizeof(regType));
+        T m = t[0];
+        for (size_t k=1;k<lanes;++k) {
+          m = std::max(m,t[k]);
+        }
+        return m;
+      }
+
+      /*
+       * Serial kernels on one range
+       */
+
+      // Sum of x[i]*y[i]
+      template<typename T>
+      inline T dotBlock(const T* x,const T* y,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t n4 = (n/(4*lanes))*(4*lanes);
+        const size_t n1 = (n/lanes)*lanes;
+
+        regType s0 = mm_set1<T,regType>(T(0));
+        regType s1 = s0, s2 = s0, s3 = s0;
+        size_t i=0;
+        for (;i<n4;i+=4*lanes) {
+          s0 = mm_fmadd<T>(mm_loadu<T,regType>(x+i),
+                           mm_loadu<T,regType>(y+i),s0);
+          s1 = mm_fmadd<T>(mm_loadu<T,regType>(x+i+lanes),
+                           mm_loadu<T,regType>(y+i+lanes),s1);
+          s2 = mm_fmadd<T>(mm_loadu<T,regType>(x+i+2*lanes),
+                           mm_loadu<T,regType>(y+i+2*lanes),s2);
+          s3 = mm_fmadd<T>(mm_loadu<T,regType>(x+i+3*lanes),
+                           mm_loadu<T,regType>(y+i+3*lanes),s3);
+        }
+        for (;i<n1;i+=lanes) {
+          s0 = mm_fmadd<T>(mm_loadu<T,regType>(x+i),
+                           mm_loadu<T,regType>(y+i),s0);
+        }
+
+        T r = mm_hsum<T>(mm_add<T>(mm_add<T>(s0,s1),mm_add<T>(s2,s3)));
+        for (;i<n;++i) {
+          r += x[i]*y[i];
+        }
+        return r;
+      }
+
+      // Sum of x[i]
+      template<typename T>
+      inline T sumBlock(const T* x,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t n4 = (n/(4*lanes))*(4*lanes);
+        const size_t n1 = (n/lanes)*lanes;
+
+        regType s0 = mm_set1<T,regType>(T(0));
+        regType s1 = s0, s2 = s0, s3 = s0;
+        size_t i=0;
+        for (;i<n4;i+=4*lanes) {
+          s0 = mm_add<T>(s0,mm_loadu<T,regType>(x+i));
+          s1 = mm_add<T>(s1,mm_loadu<T,regType>(x+i+lanes));
+          s2 = mm_add<T>(s2,mm_loadu<T,regType>(x+i+2*lanes));
+          s3 = mm_add<T>(s3,mm_loadu<T,regType>(x+i+3*lanes));
+        }
+        for (;i<n1;i+=lanes) {
+          s0 = mm_add<T>(s0,mm_loadu<T,regType>(x+i));
+        }
+
+        T r = mm_hsum<T>(mm_add<T>(mm_add<T>(s0,s1),mm_add<T>(s2,s3)));
+        for (;i<n;++i) {
+          r += x[i];
+        }
+        return r;
+      }
+
+      // First index with the largest |x[i]| in two passes: the largest
+      // magnitude with four accumulators, and then the first entry with
+      // that magnitude, usually found long before the end.
+      template<typename T>
+      inline size_t iamaxBlock(const T* x,const size_t n) {
+        typedef typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type regType;
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+        const size_t n4 = (n/(4*lanes))*(4*lanes);
+        const size_t n1 = (n/lanes)*lanes;
+
+        regType m0 = mm_set1<T,regType>(T(0));
+        regType m1 = m0, m2 = m0, m3 = m0;
+        size_t i=0;
+        for (;i<n4;i+=4*lanes) {
+          m0 = maxReg(m0,absReg(mm_loadu<T,regType>(x+i)));
+          m1 = maxReg(m1,absReg(mm_loadu<T,regType>(x+i+lanes)));
+          m2 = maxReg(m2,absReg(mm_loadu<T,regType>(x+i+2*lanes)));
+          m3 = maxReg(m3,absReg(mm_loadu<T,regType>(x+i+3*lanes)));
+        }
+        for (;i<n1;i+=lanes) {
+          m0 = maxReg(m0,absReg(mm_loadu<T,regType>(x+i)));
+        }
+
+        T m = maxLane<T>(maxReg(maxReg(m0,m1),maxReg(m2,m3)));
+        for (;i<n;++i) {
+          m = std::max(m,std::abs(x[i]));
+        }
+
+        const regType vm = mm_set1<T,regType>(m);
+        for (i=0;i<n1;i+=lanes) {
+          const unsigned mask = eqMask(absReg(mm_loadu<T,regType>(x+i)),vm);
+          if (mask != 0) {
+            return i + size_t(__builtin_ctz(mask));
+          }
+        }
+        for (;i<n;++i) {
+          if (std::abs(x[i]) == m) {
+            return i;
+          }
+        }
+
+        // Only reached with NaNs
+        size_t index;
+        ::anpi::fallback::iamax(x,n,1,index);
+        return index;
+      }
+
+      /*
+       * Kernels called by the dispatchers
+       */
+
+      // result = sum of x[i]*y[i]
+      template<typename T>
+      inline void dot(const T* x,const T* y,const size_t n,T& result) {
+        const int threads = reduceThreads(n);
+        if (threads == 1) {
+          result = dotBlock(x,y,n);
+          return;
+        }
+
+        std::vector<T> part(threads);
+#pragma omp parallel for num_threads(threads) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          reduceRange(n,threads,t,begin,end);
+          part[t] = dotBlock(x+begin,y+begin,end-begin);
+        }
+        result = sumBlock(part.data(),part.size());
+      }
+
+      // result = sum of x[i]
+      template<typename T>
+      inline void sum(const T* x,const size_t n,T& result) {
+        const int threads = reduceThreads(n);
+        if (threads == 1) {
+          result = sumBlock(x,n);
+          return;
+        }
+
+        std::vector<T> part(threads);
+#pragma omp parallel for num_threads(threads) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          reduceRange(n,threads,t,begin,end);
+          part[t] = sumBlock(x+begin,end-begin);
+        }
+        result = sumBlock(part.data(),part.size());
+      }
+
+      // result = sum of x[i]^2
+      template<typename T>
+      inline void squaredNorm(const T* x,const size_t n,T& result) {
+        dot(x,x,n,result);
+      }
+
+      // index = first i with the largest |x[i]|
+      template<typename T>
+      inline void iamax(const T* x,const size_t n,size_t& index) {
+        const int threads = reduceThreads(n);
+        if ((threads == 1) || (n == 0)) {
+          index = (n == 0) ? 0 : iamaxBlock(x,n);
+          return;
+        }
+
+        std::vector<size_t> part(threads,0);
+#pragma omp parallel for num_threads(threads) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          reduceRange(n,threads,t,begin,end);
+          part[t] = (end > begin) ? begin + iamaxBlock(x+begin,end-begin)
+                                  : begin;
+        }
+
+        // The ranges are in order: the first of equal maxima is kept
+        index = part[0];
+        for (int t=1;t<threads;++t) {
+          if ((part[t] < n) && (std::abs(x[part[t]]) > std::abs(x[index]))) {
+            index = part[t];
+          }
+        }
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
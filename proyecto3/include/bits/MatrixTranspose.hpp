@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_MATRIX_TRANSPOSE_HPP
+#define ANPI_MATRIX_TRANSPOSE_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "Intrinsics.hpp"
+#include "MatrixArithmetic.hpp"
+#include "MatrixMultiply.hpp"
+#include "CpuFeatures.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    /*
+     * Transposition
+     *
+     * Both the in-place and the out-of-place transpositions split the
+     * blocks recursively along their largest side, until both sides
+     * have at most TransposeLeaf elements.  Those leaf blocks fit in L1
+     * whatever the cache sizes are (the recursion is cache-oblivious),
+     * and are transposed by the kernels of a Leaf class, such as
+     * transpose_leaf below or the SIMD ones in MatrixTransposeSIMD.tpp.
+     */
+
+    /// Largest side of the blocks passed to the leaf kernels
+    static const size_t TransposeLeaf = 32;
+
+    /// The blocks are split at multiples of this, so that the SIMD
+    /// tiles of the leaf kernels are never cut
+    static const size_t TransposeTile = 8;
+
+    /// Split point of a block side with n > TransposeLeaf elements
+    inline size_t transposeSplit(const size_t n) {
+      return ((n/2 + TransposeTile - 1)/TransposeTile)*TransposeTile;
+    }
+
+    /**
+     * Scalar leaf kernels.
+     *
+     * The blocks are given by a pointer to their first element and the
+     * stride between their rows.
+     */
+    template<typename T>
+    struct transpose_leaf {
+      /// dst (cols x rows) = transposed src (rows x cols)
+      static void copy(const T* src,const size_t ss,
+                       T* dst,const size_t ds,
+                       const size_t rows,const size_t cols) {
+        for (size_t r=0;r<rows;++r) {
+          const T* sptr = src + r*ss;
+          T* dptr = dst + r;
+          for (size_t c=0;c<cols;++c,dptr+=ds) {
+            *dptr = sptr[c];
+          }
+        }
+      }
+
+      /// Exchange the block a (rows x cols) with the transposed block b
+      static void swap(T* a,T* b,const size_t s,
+                       const size_t rows,const size_t cols) {
+        for (size_t r=0;r<rows;++r) {
+          T* aptr = a + r*s;
+          T* bptr = b + r;
+          for (size_t c=0;c<cols;++c,bptr+=s) {
+            std::swap(aptr[c],*bptr);
+          }
+        }
+      }
+
+      /// Transpose the square block a (n x n) in place
+      static void square(T* a,const size_t s,const size_t n) {
+        for (size_t r=1;r<n;++r) {
+          swap(a+r*s,a+r,s,1,r);
+        }
+      }
+    };
+
+    /// dst (cols x rows) = transposed src (rows x cols)
+    template<typename T,class Leaf>
+    void transposeCopy(const T* src,const size_t ss,
+                       T* dst,const size_t ds,
+                       const size_t rows,const size_t cols) {
+      if ((rows <= TransposeLeaf) && (cols <= TransposeLeaf)) {
+        Leaf::copy(src,ss,dst,ds,rows,cols);
+      } else if (rows >= cols) {
+        const size_t h = transposeSplit(rows);
+        transposeCopy<T,Leaf>(src,ss,dst,ds,h,cols);
+        transposeCopy<T,Leaf>(src+h*ss,ss,dst+h,ds,rows-h,cols);
+      } else {
+        const size_t h = transposeSplit(cols);
+        transposeCopy<T,Leaf>(src,ss,dst,ds,rows,h);
+        transposeCopy<T,Leaf>(src+h,ss,dst+h*ds,ds,rows,cols-h);
+      }
+    }
+
+    /// Exchange the block a (rows x cols) with the transposed block b
+    template<typename T,class Leaf>
+    void transposeSwap(T* a,T* b,const size_t s,
+                       const size_t rows,const size_t cols) {
+      if ((rows <= TransposeLeaf) && (cols <= TransposeLeaf)) {
+        Leaf::swap(a,b,s,rows,cols);
+      } else if (rows >= cols) {
+        const size_t h = transposeSplit(rows);
+        transposeSwap<T,Leaf>(a,b,s,h,cols);
+        transposeSwap<T,Leaf>(a+h*s,b+h,s,rows-h,cols);
+      } else {
+        const size_t h = transposeSplit(cols);
+        transposeSwap<T,Leaf>(a,b,s,rows,h);
+        transposeSwap<T,Leaf>(a+h,b+h*s,s,rows,cols-h);
+      }
+    }
+
+    /// Transpose the square block a (n x n) in place
+    template<typename T,class Leaf>
+    void transposeSquare(T* a,const size_t s,const size_t n) {
+      if (n <= TransposeLeaf) {
+        Leaf::square(a,s,n);
+      } else {
+        // Both diagonal blocks in place, then exchange the other two
+        const size_t h = transposeSplit(n);
+        transposeSquare<T,Leaf>(a,s,h);
+        transposeSquare<T,Leaf>(a+h*s+h,s,n-h);
+        transposeSwap<T,Leaf>(a+h*s,a+h,s,n-h,h);
+      }
+    }
+
+    // In-place transposition of the square matrix a
+    template<typename T,class Alloc,class Layout>
+    inline void transpose(Matrix<T,Alloc,Layout>& a) {
+      assert( a.rows() == a.cols() );
+      transposeSquare<T,transpose_leaf<T> >(a.data(),a.dcols(),a.rows());
+    }
+
+    // On-copy transposition b = a^T
+    template<typename T,class Alloc,class Layout>
+    inline void transpose(const Matrix<T,Alloc,Layout>& a,
+                          Matrix<T,Alloc,Layout>& b) {
+      assert( &a != &b );
+      b.allocate(a.cols(),a.rows());
+      transposeCopy<T,transpose_leaf<T> >(a.data(),a.dcols(),
+                                          b.data(),b.dcols(),
+                                          a.lines(),a.lineLength());
+    }
+
+  } // namespace fallback
+} // namespace anpi
+
+// The tile kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/MatrixTransposeSIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    // In-place transposition of the square matrix a
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void transpose(Matrix<T,Alloc,Layout>& a) {
+      ANPI_SIMD_DISPATCH(transpose,a);
+      ::anpi::fallback::transpose(a);
+    }
+
+    // Types without tile kernels
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type=0>
+    inline void transpose(Matrix<T,Alloc,Layout>& a) {
+      ::anpi::fallback::transpose(a);
+    }
+
+    // On-copy transposition b = a^T
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void transpose(const Matrix<T,Alloc,Layout>& a,
+                          Matrix<T,Alloc,Layout>& b) {
+      ANPI_SIMD_DISPATCH(transpose,a,b);
+      ::anpi::fallback::transpose(a,b);
+    }
+
+    // Types without tile kernels
+    template<typename T,
+             class Alloc,
+             class Layout,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type=0>
+    inline void transpose(const Matrix<T,Alloc,Layout>& a,
+                          Matrix<T,Alloc,Layout>& b) {
+      ::anpi::fallback::transpose(a,b);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the transposition.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+      /**
+       * Transposition of one N x N tile held in registers.
+       *
+       * copy() loads the whole tile before storing anything, so that
+       * src and dst may be the same tile.  Unaligned loads and stores
+       * are used, since the tiles of the recursion start anywhere in a
+       * row.
+       */
+      template<typename T>
+      struct transpose_tile;
+
+#if ANPI_SIMD_WIDTH >= 32
+      // With AVX-512 the 256 bit tiles are used as well: 8x8 floats
+      // already fill the 16 registers of the shuffles
+
+      template<>
+      struct transpose_tile<float> {
+        static constexpr size_t N = 8;
+
+        static inline void copy(const float* src,const size_t ss,
+                                float* dst,const size_t ds) {
+          const __m256 r0 = _mm256_loadu_ps(src);
+          const __m256 r1 = _mm256_loadu_ps(src+  ss);
+          const __m256 r2 = _mm256_loadu_ps(src+2*ss);
+          const __m256 r3 = _mm256_loadu_ps(src+3*ss);
+          const __m256 r4 = _mm256_loadu_ps(src+4*ss);
+          const __m256 r5 = _mm256_loadu_ps(src+5*ss);
+          const __m256 r6 = _mm256_loadu_ps(src+6*ss);
+          const __m256 r7 = _mm256_loadu_ps(src+7*ss);
+
+          // Interleave pairs of rows
+          const __m256 t0 = _mm256_unpacklo_ps(r0,r1);
+          const __m256 t1 = _mm256_unpackhi_ps(r0,r1);
+          const __m256 t2 = _mm256_unpacklo_ps(r2,r3);
+          const __m256 t3 = _mm256_unpackhi_ps(r2,r3);
+          const __m256 t4 = _mm256_unpacklo_ps(r4,r5);
+          const __m256 t5 = _mm256_unpackhi_ps(r4,r5);
+          const __m256 t6 = _mm256_unpacklo_ps(r6,r7);
+          const __m256 t7 = _mm256_unpackhi_ps(r6,r7);
+
+          // 4x4 transposes within each 128 bit lane
+          const __m256 u0 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+          const __m256 u1 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+          const __m256 u2 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+          const __m256 u3 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+          const __m256 u4 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(1,0,1,0));
+          const __m256 u5 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(3,2,3,2));
+          const __m256 u6 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(1,0,1,0));
+          const __m256 u7 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(3,2,3,2));
+
+          // Exchange the off-diagonal 128 bit lanes
+          _mm256_storeu_ps(dst,     _mm256_permute2f128_ps(u0,u4,0x20));
+          _mm256_storeu_ps(dst+  ds,_mm256_permute2f128_ps(u1,u5,0x20));
+          _mm256_storeu_ps(dst+2*ds,_mm256_permute2f128_ps(u2,u6,0x20));
+          _mm256_storeu_ps(dst+3*ds,_mm256_permute2f128_ps(u3,u7,0x20));
+          _mm256_storeu_ps(dst+4*ds,_mm256_permute2f128_ps(u0,u4,0x31));
+          _mm256_storeu_ps(dst+5*ds,_mm256_permute2f128_ps(u1,u5,0x31));
+          _mm256_storeu_ps(dst+6*ds,_mm256_permute2f128_ps(u2,u6,0x31));
+          _mm256_storeu_ps(dst+7*ds,_mm256_permute2f128_ps(u3,u7,0x31));
+        }
+      };
+
+      template<>
+      struct transpose_tile<double> {
+        static constexpr size_t N = 4;
+
+        static inline void copy(const double* src,const size_t ss,
+                                double* dst,const size_t ds) {
+          const __m256d r0 = _mm256_loadu_pd(src);
+          const __m256d r1 = _mm256_loadu_pd(src+  ss);
+          const __m256d r2 = _mm256_loadu_pd(src+2*ss);
+          const __m256d r3 = _mm256_loadu_pd(src+3*ss);
+
+          const __m256d t0 = _mm256_unpacklo_pd(r0,r1);
+          const __m256d t1 = _mm256_unpackhi_pd(r0,r1);
+          const __m256d t2 = _mm256_unpacklo_pd(r2,r3);
+          const __m256d t3 = _mm256_unpackhi_pd(r2,r3);
+
+          _mm256_storeu_pd(dst,     _mm256_permute2f128_pd(t0,t2,0x20));
+          _mm256_storeu_pd(dst+  ds,_mm256_permute2f128_pd(t1,t3,0x20));
+          _mm256_storeu_pd(dst+2*ds,_mm256_permute2f128_pd(t0,t2,0x31));
+          _mm256_storeu_pd(dst+3*ds,_mm256_permute2f128_pd(t1,t3,0x31));
+        }
+      };
+#else
+      template<>
+      struct transpose_tile<float> {
+        static constexpr size_t N = 4;
+
+        static inline void copy(const float* src,const size_t ss,
+                                float* dst,const size_t ds) {
+          __m128 r0 = _mm_loadu_ps(src);
+          __m128 r1 = _mm_loadu_ps(src+  ss);
+          __m128 r2 = _mm_loadu_ps(src+2*ss);
+          __m128 r3 = _mm_loadu_ps(src+3*ss);
+
+          _MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+
+          _mm_storeu_ps(dst,     r0);
+          _mm_storeu_ps(dst+  ds,r1);
+          _mm_storeu_ps(dst+2*ds,r2);
+          _mm_storeu_ps(dst+3*ds,r3);
+        }
+      };
+
+      template<>
+      struct transpose_tile<double> {
+        static constexpr size_t N = 4;
+
+        // Four 2x2 transposes, the off-diagonal ones exchanged
+        static inline void copy(const double* src,const size_t ss,
+                                double* dst,const size_t ds) {
+          const __m128d a0 = _mm_loadu_pd(src);
+          const __m128d b0 = _mm_loadu_pd(src+2);
+          const __m128d a1 = _mm_loadu_pd(src+  ss);
+          const __m128d b1 = _mm_loadu_pd(src+  ss+2);
+          const __m128d a2 = _mm_loadu_pd(src+2*ss);
+          const __m128d b2 = _mm_loadu_pd(src+2*ss+2);
+          const __m128d a3 = _mm_loadu_pd(src+3*ss);
+          const __m128d b3 = _mm_loadu_pd(src+3*ss+2);
+
+          _mm_storeu_pd(dst,       _mm_unpacklo_pd(a0,a1));
+          _mm_storeu_pd(dst+2,     _mm_unpacklo_pd(a2,a3));
+          _mm_storeu_pd(dst+  ds,  _mm_unpackhi_pd(a0,a1));
+          _mm_storeu_pd(dst+  ds+2,_mm_unpackhi_pd(a2,a3));
+          _mm_storeu_pd(dst+2*ds,  _mm_unpacklo_pd(b0,b1));
+          _mm_storeu_pd(dst+2*ds+2,_mm_unpacklo_pd(b2,b3));
+          _mm_storeu_pd(dst+3*ds,  _mm_unpackhi_pd(b0,b1));
+          _mm_storeu_pd(dst+3*ds+2,_mm_unpackhi_pd(b2,b3));
+        }
+      };
+#endif
+
+      /**
+       * Leaf kernels of the recursive transposition (see
+       * anpi::fallback::transposeCopy) made of register tiles.  The
+       * strips at the end of the blocks not covered by whole tiles are
+       * left to the scalar kernels.
+       */
+      template<typename T>
+      struct transpose_leaf {
+        typedef transpose_tile<T> tile;
+        typedef ::anpi::fallback::transpose_leaf<T> scalar;
+        static constexpr size_t N = tile::N;
+
+        /// dst (cols x rows) = transposed src (rows x cols)
+        static void copy(const T* src,const size_t ss,
+                         T* dst,const size_t ds,
+                         const size_t rows,const size_t cols) {
+          const size_t R = rows - rows%N;
+          const size_t C = cols - cols%N;
+
+          // The stores go down the columns of dst, where the hardware
+          // prefetcher does not help: fetch the lines of the block first
+          for (size_t c=0;c<cols;++c) {
+            for (size_t r=0;r<rows;r+=64/sizeof(T)) {
+              _mm_prefetch(reinterpret_cast<const char*>(dst+c*ds+r),
+                           _MM_HINT_T0);
+            }
+          }
+
+          for (size_t c=0;c<C;c+=N) {
+            for (size_t r=0;r<R;r+=N) {
+              tile::copy(src+r*ss+c,ss,dst+c*ds+r,ds);
+            }
+          }
+
+          if (C<cols) {
+            scalar::copy(src+C,ss,dst+C*ds,ds,rows,cols-C);
+          }
+          if (R<rows) {
+            scalar::copy(src+R*ss,ss,dst+R,ds,rows-R,C);
+          }
+        }
+
+        /// Exchange the tile at a with the transposed tile at b
+        static inline void swapTile(T* a,T* b,const size_t s) {
+          T buf[N*N];
+          tile::copy(a,s,buf,N);
+          tile::copy(b,s,a,s);
+          for (size_t i=0;i<N;++i) {
+            std::memcpy(b+i*s,buf+i*N,N*sizeof(T));
+          }
+        }
+
+        /// Exchange the block a (rows x cols) with the transposed block b
+        static void swap(T* a,T* b,const size_t s,
+                         const size_t rows,const size_t cols) {
+          const size_t R = rows - rows%N;
+          const size_t C = cols - cols%N;
+
+          for (size_t r=0;r<R;r+=N) {
+            for (size_t c=0;c<C;c+=N) {
+              swapTile(a+r*s+c,b+c*s+r,s);
+            }
+          }
+
+          if (C<cols) {
+            scalar::swap(a+C,b+C*s,s,rows,cols-C);
+          }
+          if (R<rows) {
+            scalar::swap(a+R*s,b+R,s,rows-R,C);
+          }
+        }
+
+        /// Transpose the square block a (n x n) in place
+        static void square(T* a,const size_t s,const size_t n) {
+          const size_t M = n - n%N;
+
+          for (size_t r=0;r<M;r+=N) {
+            for (size_t c=0;c<r;c+=N) {
+              swapTile(a+r*s+c,a+c*s+r,s);
+            }
+            tile::copy(a+r*s+r,s,a+r*s+r,s);
+          }
+
+          if (M<n) {
+            scalar::square(a+M*s+M,s,n-M);
+            scalar::swap(a+M*s,a+M,s,n-M,M);
+          }
+        }
+      };
+
+      // In-place transposition of the square matrix a
+      template<typename T,class Alloc,class Layout>
+      inline void transpose(Matrix<T,Alloc,Layout>& a) {
+        assert( a.rows() == a.cols() );
+        ::anpi::fallback::transposeSquare<T,transpose_leaf<T> >
+          (a.data(),a.dcols(),a.rows());
+      }
+
+      // On-copy transposition b = a^T
+      template<typename T,class Alloc,class Layout>
+      inline void transpose(const Matrix<T,Alloc,Layout>& a,
+                            Matrix<T,Alloc,Layout>& b) {
+        assert( &a != &b );
+        b.allocate(a.cols(),a.rows());
+        ::anpi::fallback::transposeCopy<T,transpose_leaf<T> >
+          (a.data(),a.dcols(),b.data(),b.dcols(),
+           a.lines(),a.lineLength());
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
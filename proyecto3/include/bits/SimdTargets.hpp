@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Compile the SIMD kernels in the file named by ANPI_SIMD_KERNELS once
+ * for each instruction set available (see Intrinsics.hpp).
+ *
+ * Each copy lands in its own namespace, anpi::simd::sse2,
+ * anpi::simd::avx2 or anpi::simd::avx512, compiled with the target
+ * options of that instruction set.  Inside the kernels file,
+ * ANPI_SIMD_TARGET names the namespace and ANPI_SIMD_WIDTH gives the
+ * size in bytes of the widest registers allowed.  The kernels are
+ * then called through ANPI_SIMD_DISPATCH (see CpuFeatures.hpp).
+ *
+ * This file has no include guards on purpose: it is included once for
+ * each kernels file.
+ */
+
+#ifndef ANPI_SIMD_KERNELS
+#  error "ANPI_SIMD_KERNELS must name the file with the kernels"
+#endif
+
+#ifdef ANPI_SIMD_HAS_SSE2
+#  define ANPI_SIMD_TARGET sse2
+#  define ANPI_SIMD_WIDTH  16
+#  include ANPI_SIMD_KERNELS
+#  undef  ANPI_SIMD_WIDTH
+#  undef  ANPI_SIMD_TARGET
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX2
+ANPI_SIMD_BEGIN_AVX2
+#  define ANPI_SIMD_TARGET avx2
+#  define ANPI_SIMD_WIDTH  32
+#  include ANPI_SIMD_KERNELS
+#  undef  ANPI_SIMD_WIDTH
+#  undef  ANPI_SIMD_TARGET
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_HAS_AVX512
+ANPI_SIMD_BEGIN_AVX512
+#  define ANPI_SIMD_TARGET avx512
+#  define ANPI_SIMD_WIDTH  64
+#  include ANPI_SIMD_KERNELS
+#  undef  ANPI_SIMD_WIDTH
+#  undef  ANPI_SIMD_TARGET
+ANPI_SIMD_END
+#endif
+
+#undef ANPI_SIMD_KERNELS
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+#ifndef ANPI_SPARSE_MULTIPLY_HPP
+#define ANPI_SPARSE_MULTIPLY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "Intrinsics.hpp"
+#include "IntrinsicsM.hpp"
+#include "MatrixArithmetic.hpp"
+#include "MatrixMultiply.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
+
+namespace anpi
+{
+  namespace fallback {
+    /*
+     * Sparse matrix-vector kernels
+     *
+     * Both work on the compressed arrays of anpi::SparseMatrix: lines+1
+     * offsets, and one index and one value per non-zero.  The lines are
+     * the rows of a CSR matrix and the columns of a CSC one.
+     *
+     * csrmv() computes one dot product per line (gather), which is the
+     * product of a CSR matrix or the transposed product of a CSC one.
+     * cscmv() adds each line scaled by an entry of x (scatter), which
+     * is the product of a CSC matrix or the transposed product of a
+     * CSR one.  If beta is zero, y is not read.
+     */
+
+    // y[l] = alpha*(line l).x + beta*y[l] for all lines
+    template<typename T>
+    inline void csrmv(const size_t lines,
+                      const size_t* offsets,
+                      const std::uint32_t* indices,
+                      const T* values,
+                      const T* x,
+                      T* y,
+                      const T alpha,
+                      const T beta) {
+
+      const int threads = (offsets[lines] >= parallel::spmvThreshold())
+                        ? parallel::numThreads() : 1;
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+      for (int t=0;t<threads;++t) {
+        size_t begin,end;
+        parallel::balancedRange(offsets,lines,threads,t,begin,end);
+
+        for (size_t l=begin;l<end;++l) {
+          T sum = T(0);
+          for (size_t k=offsets[l];k<offsets[l+1];++k) {
+            sum += values[k]*x[indices[k]];
+          }
+          y[l] = (beta == T(0)) ? alpha*sum : alpha*sum + beta*y[l];
+        }
+      }
+    }
+
+    // y = alpha*sum of (line l)*x[l] + beta*y, where y has n entries
+    //
+    // Different lines write into the same entries of y.  Each thread
+    // accumulates its lines into a private window, which covers only
+    // the entries of y touched by those lines: for the band matrices
+    // of the stencils, about n/threads entries plus twice the band.
+    // Then each thread sums the overlapping parts of all windows into
+    // its own disjoint range of y.
+    template<typename T>
+    inline void cscmv(const size_t lines,
+                      const size_t n,
+                      const size_t* offsets,
+                      const std::uint32_t* indices,
+                      const T* values,
+                      const T* x,
+                      T* y,
+                      const T alpha,
+                      const T beta) {
+
+      const int threads = (offsets[lines] >= parallel::spmvThreshold())
+                        ? parallel::numThreads() : 1;
+
+      if (threads == 1) {
+        for (size_t i=0;i<n;++i) {
+          y[i] = (beta == T(0)) ? T(0) : beta*y[i];
+        }
+        for (size_t l=0;l<lines;++l) {
+          const T ax = alpha*x[l];
+          for (size_t k=offsets[l];k<offsets[l+1];++k) {
+            y[indices[k]] += values[k]*ax;
+          }
+        }
+        return;
+      }
+
+      // Entries [first[t],last[t]) of y touched by thread t, and start
+      // of its window in part
+      std::vector<size_t> first(threads),last(threads),start(threads+1);
+      std::unique_ptr<T[]> part;
+
+#pragma omp parallel num_threads(threads)
+      {
+#pragma omp for schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          parallel::balancedRange(offsets,lines,threads,t,begin,end);
+
+          // the indices are sorted within each line
+          size_t lo=n,hi=0;
+          for (size_t l=begin;l<end;++l) {
+            if (offsets[l] < offsets[l+1]) {
+              lo = std::min(lo,size_t(indices[offsets[l]]));
+              hi = std::max(hi,size_t(indices[offsets[l+1]-1])+1);
+            }
+          }
+          first[t] = std::min(lo,hi);
+          last[t]  = hi;
+        } // implicit barrier: all windows known
+
+#pragma omp single
+        {
+          start[0] = 0;
+          for (int t=0;t<threads;++t) {
+            start[t+1] = start[t] + (last[t]-first[t]);
+          }
+          part.reset(new T[start[threads]]);
+        } // implicit barrier: part allocated
+
+#pragma omp for schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          parallel::balancedRange(offsets,lines,threads,t,begin,end);
+
+          T* py = part.get() + start[t] - first[t];
+          std::fill(py+first[t],py+last[t],T(0));
+          for (size_t l=begin;l<end;++l) {
+            const T ax = alpha*x[l];
+            for (size_t k=offsets[l];k<offsets[l+1];++k) {
+              py[indices[k]] += values[k]*ax;
+            }
+          }
+        } // implicit barrier: all windows complete
+
+#pragma omp for schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          parallel::chunkRange<T>(n,threads,t,begin,end);
+
+          for (size_t i=begin;i<end;++i) {
+            y[i] = (beta == T(0)) ? T(0) : beta*y[i];
+          }
+          for (int u=0;u<threads;++u) {
+            const size_t from = std::max(begin,first[u]);
+            const size_t to   = std::min(end,last[u]);
+            const T* py = part.get() + start[u] - first[u];
+            for (size_t i=from;i<to;++i) {
+              y[i] += py[i];
+            }
+          }
+        }
+      }
+    }
+
+  } // namespace fallback
+} // namespace anpi
+
+// The register kernels, once for each instruction set
+#define ANPI_SIMD_KERNELS "bits/SparseMultiplySIMD.tpp"
+#include "SimdTargets.hpp"
+
+namespace anpi
+{
+  namespace simd
+  {
+    // Gathering product with gathered registers for float and double
+    template<typename T,
+             typename std::enable_if<is_gemm_type<T>::value,int>::type=0>
+    inline void csrmv(const size_t lines,
+                      const size_t* offsets,
+                      const std::uint32_t* indices,
+                      const T* values,
+                      const T* x,
+                      T* y,
+                      const T alpha,
+                      const T beta) {
+      ANPI_SIMD_DISPATCH(csrmv,lines,offsets,indices,values,x,y,alpha,beta);
+      ::anpi::fallback::csrmv(lines,offsets,indices,values,x,y,alpha,beta);
+    }
+
+    // Gathering product for all other types
+    template<typename T,
+             typename std::enable_if<!is_gemm_type<T>::value,int>::type=0>
+    inline void csrmv(const size_t lines,
+                      const size_t* offsets,
+                      const std::uint32_t* indices,
+                      const T* values,
+                      const T* x,
+                      T* y,
+                      const T alpha,
+                      const T beta) {
+      ::anpi::fallback::csrmv(lines,offsets,indices,values,x,y,alpha,beta);
+    }
+
+    // Scattering product.  Only AVX-512 has scattered stores, and with
+    // the few non-zeros per line of the stencil matrices they gain
+    // nothing over scalar ones, so all types use the fallback.
+    template<typename T>
+    inline void cscmv(const size_t lines,
+                      const size_t n,
+                      const size_t* offsets,
+                      const std::uint32_t* indices,
+                      const T* values,
+                      const T* x,
+                      T* y,
+                      const T alpha,
+                      const T beta) {
+      ::anpi::fallback::cscmv(lines,n,offsets,indices,values,x,y,alpha,beta);
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the sparse matrix-vector product.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ *
+ * The values of each line are loaded as one register, and the entries
+ * of x they multiply are collected with the gather instructions of
+ * AVX2 and AVX-512, indexed by the 32 bit indices of the line.  SSE2
+ * has no gather, so the register is assembled from scalar loads.
+ */
+
+namespace anpi
+{
+  namespace simd
+  {
+    namespace ANPI_SIMD_TARGET
+    {
+#if ANPI_SIMD_WIDTH >= 64
+      // The masked forms avoid the undefined source registers of the
+      // unmasked gathers, which trip -Wuninitialized with some GCC
+      inline __m512d gather(const double* x,const std::uint32_t* idx) {
+        return _mm512_mask_i32gather_pd(_mm512_setzero_pd(),__mmask8(0xff),
+                 _mm256_loadu_si256((const __m256i*)idx),x,8);
+      }
+      inline __m512 gather(const float* x,const std::uint32_t* idx) {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(),
+                 __mmask16(0xffff),_mm512_loadu_si512(idx),x,4);
+      }
+#elif ANPI_SIMD_WIDTH >= 32
+      inline __m256d gather(const double* x,const std::uint32_t* idx) {
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(),x,
+                 _mm_loadu_si128((const __m128i*)idx),
+                 _mm256_castsi256_pd(_mm256_set1_epi64x(-1)),8);
+      }
+      inline __m256 gather(const float* x,const std::uint32_t* idx) {
+        return _mm256_mask_i32gather_ps(_mm256_setzero_ps(),x,
+                 _mm256_loadu_si256((const __m256i*)idx),
+                 _mm256_castsi256_ps(_mm256_set1_epi32(-1)),4);
+      }
+#else
+      inline __m128d gather(const double* x,const std::uint32_t* idx) {
+        return _mm_set_pd(x[idx[1]],x[idx[0]]);
+      }
+      inline __m128 gather(const float* x,const std::uint32_t* idx) {
+        return _mm_set_ps(x[idx[3]],x[idx[2]],x[idx[1]],x[idx[0]]);
+      }
+#endif
+
+      // y[l] = alpha*(line l).x + beta*y[l] with one register per
+      // lanes non-zeros.  The lines are split among the threads with
+      // about the same number of non-zeros each.
+      template<typename T,typename regType>
+      inline void csrmvSIMD(const size_t lines,
+                            const size_t* offsets,
+                            const std::uint32_t* indices,
+                            const T* values,
+                            const T* x,
+                            T* y,
+                            const T alpha,
+                            const T beta) {
+
+        constexpr size_t lanes = sizeof(regType)/sizeof(T);
+
+        const int threads = (offsets[lines] >= parallel::spmvThreshold())
+                          ? parallel::numThreads() : 1;
+
+#pragma omp parallel for num_threads(threads) if(threads>1) schedule(static)
+        for (int t=0;t<threads;++t) {
+          size_t begin,end;
+          parallel::balancedRange(offsets,lines,threads,t,begin,end);
+
+          for (size_t l=begin;l<end;++l) {
+            const size_t last = offsets[l+1];
+            size_t k = offsets[l];
+
+            regType s = mm_set1<T,regType>(T(0));
+            for (;k+lanes<=last;k+=lanes) {
+              s = mm_fmadd<T>(mm_loadu<T,regType>(values+k),
+                              gather(x,indices+k),s);
+            }
+
+            T sum = mm_hsum<T,regType>(s);
+            for (;k<last;++k) {
+              sum += values[k]*x[indices[k]];
+            }
+            y[l] = (beta == T(0)) ? alpha*sum : alpha*sum + beta*y[l];
+          }
+        }
+      }
+
+      // Gathering product with the widest registers available
+      template<typename T>
+      inline void csrmv(const size_t lines,
+                        const size_t* offsets,
+                        const std::uint32_t* indices,
+                        const T* values,
+                        const T* x,
+                        T* y,
+                        const T alpha,
+                        const T beta) {
+        csrmvSIMD<T,typename simd_traits<T,ANPI_SIMD_WIDTH>::reg_type>(
+          lines,offsets,indices,values,x,y,alpha,beta);
+      }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
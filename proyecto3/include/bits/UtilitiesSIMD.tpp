@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ */
+
+/*
+ * Register kernels of the matrix utilities.
+ *
+ * Compiled once for each instruction set through SimdTargets.hpp, so
+ * that it has no include guards.
+ */
+
+namespace anpi {
+  namespace simd {
+    namespace ANPI_SIMD_TARGET {
+
+    /**
+      * @brief Used to swap the rows of any matrix using simd instructions.
+      *
+      * @tparam T template value
+      * @tparam regType template value of the register.
+      * @param LU Matrix to we want to swap his rows.
+      * @param r1 size of row 1.
+      * @param r2 size of row 2.
+      */
+    template<typename T,typename regType,class Alloc>
+    void swapRowsSIMD(Matrix<T,Alloc>& LU,size_t r1,size_t r2){
+
+      unsigned long int regSize = sizeof(regType);
+
+      //temporary element
+      regType element;
+      regType* r1ptr = reinterpret_cast<regType*>(LU[r1]);
+      regType* r2ptr = reinterpret_cast<regType*>(LU[r2]);
+
+
+      ///total size in bytes of a row
+      long unsigned int colsXsize = (long unsigned int) (LU.cols()) * (long unsigned int)(sizeof(T));
+
+      for(unsigned long int i = 0; i < colsXsize; i+=regSize ){
+        //swaping the current element block at index i, between the rows.
+        element = *r1ptr;
+        *r1ptr++ = *r2ptr;
+        *r2ptr++ = element;
+      }
+
+    }
+
+    /**
+      * @brief Swap two rows with the widest registers the row alignment
+      * permits.
+      */
+    template<typename T,class Alloc>
+    inline void swapRows(Matrix<T,Alloc>& LU,size_t r1,size_t r2){
+      typedef typename Matrix<T,Alloc>::allocator_type alloc;
+      swapRowsSIMD<T,typename simd_reg<T,ANPI_SIMD_WIDTH,
+                     extract_alignment<alloc>::value>::type>(LU,r1,r2);
+    }
+
+    } // namespace ANPI_SIMD_TARGET
+  } // namespace simd
+} // namespace anpi
@@ -21,6 +21,7 @@
 #include <iostream>
 
 #include <AnpiConfig.hpp>
+#include <CpuFeatures.hpp>
 #include <Exception.hpp>
 #include <fstream>
 
@@ -132,6 +133,9 @@ int main(int argc, const char *argv[]) {
 		po::variables_map vm;
 		po::store(po::parse_command_line(argc, argv, desc), vm);
 		po::notify(vm);
+
+		// Informa cuales nucleos SIMD se usaran
+		anpi::cpu::report(std::cout);
     
     //Creacion de archivo para guardar las flags
     std::ofstream flags;
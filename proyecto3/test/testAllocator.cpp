@@ -10,6 +10,14 @@
 
 #include <boost/test/unit_test.hpp>
 #include <Allocator.hpp>
+#include <Matrix.hpp>
+#include <MappedMatrix.hpp>
+#include <Solver.hpp>
+
+#include "testParallel.hpp"
+#include "testRandom.hpp"
+
+#include <cstdio>
 
 #define COMMA ,
 
@@ -69,7 +77,221 @@ BOOST_AUTO_TEST_CASE( Checks ) {
     BOOST_CHECK(ext::row_aligned == true );
   }
 
+  {
+    typedef anpi::extract_alignment<anpi::arena_allocator<float,32> > ext;
+    BOOST_CHECK(ext::value==32);
+    BOOST_CHECK(ext::aligned == true );
+    BOOST_CHECK(ext::row_aligned == true );
+    val = anpi::is_aligned_alloc<anpi::arena_allocator<float,32> >::value;
+    BOOST_CHECK(val);
+  }
   
 }
 
+BOOST_AUTO_TEST_CASE( Arena ) {
+  typedef anpi::arena_allocator<float,32> alloc_type;
+  typedef anpi::Matrix<float,alloc_type> matrix_type;
+
+  anpi::Arena arena(1024);
+
+  // The first run grows the arena, the next ones must reuse it
+  float* first = nullptr;
+  size_t capacity = 0;
+  for (int run=0;run<3;++run) {
+    anpi::ScopedArena scope(arena);
+
+    matrix_type a(5,7,1.f);
+    matrix_type b(5,7,2.f);
+    BOOST_CHECK( reinterpret_cast<size_t>(a.data()) % 32 == 0 );
+    BOOST_CHECK( a.dcols() % 8 == 0 );
+    BOOST_CHECK( arena.owns(a.data()) );
+
+    {
+      // Nested scope: released at its end
+      anpi::ScopedArena inner(arena);
+      matrix_type big(100,100);
+      BOOST_CHECK( arena.owns(big.data()) );
+    }
+    
+    matrix_type c = a + b;
+    BOOST_CHECK( c(4,6) == 3.f );
+
+    if (run==1) {
+      first = a.data();
+    } else if (run==2) {
+      BOOST_CHECK( a.data() == first );
+      BOOST_CHECK( arena.capacity() == capacity );
+      BOOST_CHECK( arena.chunks() == 1u );
+    }
+    capacity = arena.capacity();
+  }
+
+  // The last block can be released and reused right away
+  {
+    anpi::ScopedArena scope(arena);
+    alloc_type alloc;
+    float* p = alloc.allocate(10);
+    alloc.deallocate(p,10);
+    float* q = alloc.allocate(10);
+    BOOST_CHECK( p == q );
+    alloc.deallocate(q,10);
+  }
+  
+  // Outside of any scope the heap is used
+  {
+    matrix_type h(3,3,0.f);
+    BOOST_CHECK( !arena.owns(h.data()) );
+    BOOST_CHECK( reinterpret_cast<size_t>(h.data()) % 32 == 0 );
+  }
+
+  // Rewinding to empty gives back more than the retained bytes
+  anpi::Arena small(1024,4096);
+  {
+    anpi::ScopedArena scope(small);
+    matrix_type big(100,100);
+    BOOST_CHECK( small.capacity() > 4096 );
+  }
+  BOOST_CHECK( small.capacity() == 0 );
+
+  // Unused chunks can be trimmed while others are in use
+  {
+    anpi::ScopedArena scope(small);
+    matrix_type a(5,7,1.f);
+    {
+      anpi::ScopedArena inner(small);
+      matrix_type b(20,20);
+    }
+    BOOST_CHECK( small.chunks() == 2u );
+    small.shrink_to(0);
+    BOOST_CHECK( small.chunks() == 1u );
+    BOOST_CHECK( small.owns(a.data()) );
+    BOOST_CHECK( a(4,6) == 1.f );
+  }
+  BOOST_CHECK( small.capacity() == 1024 );
+  small.shrink_to(0);
+  BOOST_CHECK( small.capacity() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( SolverMemory ) {
+  // solveLU takes its LU matrix from the arena of the thread: the next
+  // solves reuse it, unless it exceeds the retained bytes
+  anpi::Arena& arena = anpi::Arena::local();
+  const size_t limit = arena.retainLimit();
+  arena.release();
+
+  const size_t n = 128;
+  const anpi::Matrix<double> A = anpi::test::randomMatrix<double>(n,n);
+  const std::vector<double> b(n,1.0);
+  std::vector<double> x;
+
+  anpi::solveLU(A,x,b);
+  const size_t capacity = arena.capacity();
+  BOOST_CHECK( capacity >= n*n*sizeof(double) );
+
+  anpi::solveLU(A,x,b);
+  BOOST_CHECK( arena.capacity() == capacity );
+  BOOST_CHECK( arena.chunks() == 1u );
+
+  arena.retainLimit(capacity/2);
+  anpi::solveLU(A,x,b);
+  BOOST_CHECK( arena.capacity() == 0 );
+  BOOST_CHECK( x.size() == n );
+  arena.retainLimit(limit);
+}
+
+BOOST_AUTO_TEST_CASE( HugePages ) {
+  typedef anpi::huge_page_allocator<float,32> alloc_type;
+  typedef anpi::Matrix<float,alloc_type> matrix_type;
+
+  {
+    typedef anpi::extract_alignment<alloc_type> ext;
+    BOOST_CHECK(ext::value==32);
+    BOOST_CHECK(ext::row_aligned == true );
+    BOOST_CHECK(anpi::is_aligned_alloc<alloc_type>::value);
+  }
+
+  // Small blocks come from the heap
+  {
+    matrix_type a(3,5,1.f);
+    BOOST_CHECK( reinterpret_cast<size_t>(a.data()) % 32 == 0 );
+    BOOST_CHECK( a(2,4) == 1.f );
+  }
+
+  // Fill a large matrix in parallel, with and without the explicit pool
+  anpi::test::ParallelSettings settings;
+  anpi::parallel::firstTouchThreshold() = 1024;
+
+  for (int exp=0;exp<2;++exp) {
+    anpi::hugepages::explicitPages() = (exp==1);
+
+    matrix_type a(1000,1100,2.f);
+#ifdef __linux__
+    BOOST_CHECK( reinterpret_cast<size_t>(a.data()) %
+                 anpi::hugepages::PageSize == 0 );
+#endif
+    BOOST_CHECK( a(0,0) == 2.f );
+    BOOST_CHECK( a(999,1099) == 2.f );
+
+    a(500,7) = 3.f;
+    matrix_type b(a);
+    BOOST_CHECK( b == a );
+
+    anpi::Matrix<float> c(1000,1100,anpi::DoNotInitialize);
+    c.fill(b);
+    BOOST_CHECK( c(500,7) == 3.f );
+    BOOST_CHECK( c(999,1099) == 2.f );
+  }
+
+  anpi::hugepages::explicitPages() = false;
+}
+
+BOOST_AUTO_TEST_CASE( MappedFile ) {
+  typedef anpi::mapped_matrix<float>::type matrix_type;
+  const std::string name = "anpi_test_mapped.bin";
+
+  {
+    matrix_type a = anpi::mapped::createFile<float>(name,5,7);
+    BOOST_CHECK( a.rows() == 5 && a.cols() == 7 );
+    BOOST_CHECK( reinterpret_cast<size_t>(a.data()) % 64 == 0 );
+    BOOST_CHECK( a(4,6) == 0.f );
+    a.fill(1.f);
+    a(2,3) = 5.f;
+
+    // Copies are not mapped
+    matrix_type b(a);
+    b(2,3) = 0.f;
+    anpi::mapped::flush(a);
+  }
+
+  {
+    matrix_type a = anpi::mapped::openFile<float>(name,
+                                                  anpi::mapped::ReadWrite);
+    BOOST_CHECK( a.rows() == 5 && a.cols() == 7 );
+    BOOST_CHECK( a(2,3) == 5.f );
+    BOOST_CHECK( a(4,6) == 1.f );
+    a(0,0) = 2.f;
+
+    // Mapped matrices are ordinary matrices for the rest of the code
+    anpi::Matrix<float> c = a + a;
+    BOOST_CHECK( c(2,3) == 10.f );
+  }
+
+  {
+    matrix_type a = anpi::mapped::openFile<float>(name);
+    BOOST_CHECK( a(0,0) == 2.f );
+    a(0,0) = 3.f;  // private copy of the page
+  }
+
+  {
+    const matrix_type a = anpi::mapped::openFile<float>(name);
+    BOOST_CHECK( a(0,0) == 2.f );
+  }
+
+  BOOST_CHECK_THROW( anpi::mapped::openFile<double>(name),anpi::Exception );
+  BOOST_CHECK_THROW( anpi::mapped::openFile<float>("does_not_exist.bin"),
+                     anpi::Exception );
+
+  std::remove(name.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
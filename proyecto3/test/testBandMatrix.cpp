@@ -0,0 +1,209 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Unit tests for the band matrices
+ */
+
+#include "BandMatrix.hpp"
+#include "Spline.h"
+
+// Explicit instantiation of all methods of BandMatrix
+template class anpi::BandMatrix<double>;
+template class anpi::BandMatrix<float>;
+
+BOOST_AUTO_TEST_SUITE( Band )
+
+/**
+ * Diagonally dominant n x n band matrix with small integer entries,
+ * symmetric if lower == upper
+ */
+template<typename T>
+anpi::BandMatrix<T> dominant(const size_t n,
+                             const size_t lower,
+                             const size_t upper) {
+  anpi::BandMatrix<T> a(n,lower,upper);
+  for (size_t i=0;i<n;++i) {
+    for (size_t j=a.firstCol(i);j<=a.lastCol(i);++j) {
+      a(i,j) = (i==j) ? T(2*(lower+upper)+1)
+                      : T(-int((i+j)%3)) - T(1);
+    }
+  }
+  return a;
+}
+
+/// Largest absolute difference
+template<typename T>
+T maxError(const std::vector<T>& x,const std::vector<T>& y) {
+  T e(0);
+  for (size_t i=0;i<x.size();++i) {
+    e = std::max(e,std::abs(x[i]-y[i]));
+  }
+  return e;
+}
+
+BOOST_AUTO_TEST_CASE( Storage ) {
+  anpi::BandMatrix<double> a(5,1,2);
+  BOOST_CHECK( a.rows() == 5 && a.cols() == 5 );
+  BOOST_CHECK( a.width() == 4 );
+  BOOST_CHECK( a.inBand(2,1) && a.inBand(2,4) );
+  BOOST_CHECK( !a.inBand(2,0) && !a.inBand(0,3) );
+  BOOST_CHECK( a.firstCol(0) == 0 && a.lastCol(0) == 2 );
+  BOOST_CHECK( a.firstCol(4) == 3 && a.lastCol(4) == 4 );
+
+  for (size_t i=0;i<5;++i) {
+    for (size_t j=a.firstCol(i);j<=a.lastCol(i);++j) {
+      a(i,j) = double(10*i+j);
+    }
+  }
+
+  // Each row is contiguous
+  BOOST_CHECK( &a[2][1]+1 == &a[2][2] );
+  BOOST_CHECK( &a[2][4]+1 == &a[3][2] );
+
+  const anpi::BandMatrix<double>& ca = a;
+  const anpi::Matrix<double> d = a.toDense();
+  for (size_t i=0;i<5;++i) {
+    for (size_t j=0;j<5;++j) {
+      BOOST_CHECK( d(i,j) == (a.inBand(i,j) ? double(10*i+j) : 0.0) );
+      BOOST_CHECK( ca(i,j) == d(i,j) );
+    }
+  }
+
+  // Product against the dense one
+  std::vector<double> x = {1,-2,3,-4,5},y,z;
+  anpi::gemv(a,x,y);
+  anpi::gemv(d,x,z);
+  BOOST_CHECK( y == z );
+  BOOST_CHECK_THROW( anpi::gemv(a,std::vector<double>(4),y),
+                     anpi::Exception );
+}
+
+template<typename T>
+void testLU(const size_t n,const size_t lower,const size_t upper) {
+  const anpi::BandMatrix<T> a = dominant<T>(n,lower,upper);
+
+  std::vector<T> x(n),b,s;
+  for (size_t i=0;i<n;++i) {
+    x[i] = T(int(i%5)-2);
+  }
+  anpi::gemv(a,x,b);
+
+  anpi::BandMatrix<T> lu;
+  anpi::luBand(a,lu);
+  anpi::solveLUBand(lu,s,b);
+
+  const T eps = std::is_same<T,float>::value ? T(1e-4) : T(1e-10);
+  BOOST_CHECK( maxError(s,x) < eps );
+
+  // L*U reproduces a
+  const anpi::Matrix<T> dlu = lu.toDense();
+  for (size_t i=0;i<n;++i) {
+    for (size_t j=0;j<n;++j) {
+      T sum(0);
+      for (size_t k=0;k<=std::min(i,j);++k) {
+        sum += ((k==i) ? T(1) : dlu(i,k)) * dlu(k,j);
+      }
+      BOOST_CHECK( std::abs(sum - a(i,j)) < eps );
+    }
+  }
+
+  // In place, with x and b being the same vector
+  anpi::BandMatrix<T> c(a);
+  anpi::luBand(c,c);
+  anpi::solveLUBand(c,b,b);
+  BOOST_CHECK( maxError(b,x) < eps );
+}
+
+template<typename T>
+void testCholesky(const size_t n,const size_t band) {
+  const anpi::BandMatrix<T> a = dominant<T>(n,band,band);
+
+  std::vector<T> x(n),b,s;
+  for (size_t i=0;i<n;++i) {
+    x[i] = T(int(i%5)-2);
+  }
+  anpi::gemv(a,x,b);
+
+  anpi::BandMatrix<T> l;
+  anpi::choleskyBand(a,l);
+  BOOST_CHECK( l.lower() == band && l.upper() == 0 );
+  anpi::solveCholeskyBand(l,s,b);
+
+  const T eps = std::is_same<T,float>::value ? T(1e-4) : T(1e-10);
+  BOOST_CHECK( maxError(s,x) < eps );
+
+  // L*L^T reproduces a
+  const anpi::BandMatrix<T>& cl = l;
+  for (size_t i=0;i<n;++i) {
+    for (size_t j=0;j<n;++j) {
+      T sum(0);
+      for (size_t k=0;k<=std::min(i,j);++k) {
+        sum += cl(i,k)*cl(j,k);
+      }
+      BOOST_CHECK( std::abs(sum - a(i,j)) < eps );
+    }
+  }
+
+  anpi::BandMatrix<T> c(a);
+  anpi::choleskyBand(c,c);
+  anpi::solveCholeskyBand(c,b,b);
+  BOOST_CHECK( maxError(b,x) < eps );
+}
+
+BOOST_AUTO_TEST_CASE( LU ) {
+  // Tridiagonal, asymmetric and wide enough for the SIMD kernels
+  testLU<double>(17,1,1);
+  testLU<double>(23,2,5);
+  testLU<double>(40,11,13);
+  testLU<float>(17,1,1);
+  testLU<float>(40,12,9);
+
+  anpi::BandMatrix<double> z(3,1,1);
+  anpi::BandMatrix<double> lu;
+  BOOST_CHECK_THROW( anpi::luBand(z,lu), anpi::Exception );
+
+  lu = dominant<double>(3,1,1);
+  std::vector<double> x;
+  BOOST_CHECK_THROW( anpi::solveLUBand(lu,x,std::vector<double>(2)),
+                     anpi::Exception );
+}
+
+BOOST_AUTO_TEST_CASE( Cholesky ) {
+  testCholesky<double>(17,1);
+  testCholesky<double>(40,12);
+  testCholesky<float>(17,1);
+  testCholesky<float>(40,10);
+
+  anpi::BandMatrix<double> a(3,1,1,-1.0);
+  anpi::BandMatrix<double> l;
+  BOOST_CHECK_THROW( anpi::choleskyBand(a,l), anpi::Exception );
+}
+
+BOOST_AUTO_TEST_CASE( Spline ) {
+  // A cubic spline through the points of a straight line is the line
+  std::vector<float> x,y;
+  for (int i=0;i<10;++i) {
+    x.push_back(float(i*i)/4.f);
+    y.push_back(2.f*x.back() + 1.f);
+  }
+
+  tk::spline s;
+  s.set_boundary(tk::spline::second_deriv,0.f,tk::spline::second_deriv,0.f);
+  s.set_points(x,y);
+  for (float t=0.f;t<20.f;t+=0.7f) {
+    BOOST_CHECK( std::abs(s(t) - (2.f*t + 1.f)) < 1e-3f );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
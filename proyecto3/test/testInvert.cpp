@@ -14,6 +14,7 @@
 #include "LUCrout.hpp"
 #include "LUDoolittle.hpp"
 #include "Solver.hpp"
+#include "testRandom.hpp"
 
 #include <iostream>
 #include <exception>
@@ -23,6 +24,7 @@
 #include <functional>
 
 #include <cmath>
+#include <vector>
 
 namespace anpi {
     namespace test {
@@ -61,6 +63,27 @@ namespace anpi {
         }
 
 
+        /**
+         * The former inversion, decomposing A again for each column of
+         * the identity: O(n^4)
+         */
+        template<typename T>
+        void invertByColumns(const Matrix<T>& A,Matrix<T>& Ai) {
+            const size_t size = A.cols();
+            std::vector<T> I_j(size,T(0));
+            std::vector<T> AiT_j(size,T(0));
+            Ai.allocate(size,size);
+
+            for (size_t i=0;i<size;++i) {
+                I_j[i] = T(1);
+                solveLU(A,AiT_j,I_j);
+                for (size_t j=0;j<size;++j) {
+                    Ai[j][i] = AiT_j[j];
+                }
+                I_j[i] = T(0);
+            }
+        }
+
     } // test
 }  // anpi
 
@@ -79,5 +102,46 @@ BOOST_AUTO_TEST_SUITE( inverter )
 
     }
 
+    /// A Ai is the identity
+    BOOST_AUTO_TEST_CASE(identity)
+    {
+        const size_t n = 150;
+        const anpi::Matrix<double> A = anpi::test::randomMatrix<double>(n,n);
+        anpi::Matrix<double> Ai;
+        anpi::invert(A,Ai);
+
+        const anpi::Matrix<double> I = A*Ai;
+        for (size_t i=0;i<n;++i) {
+            for (size_t j=0;j<n;++j) {
+                BOOST_CHECK(std::abs(I(i,j) - ((i==j) ? 1.0 : 0.0)) < 1e-9);
+            }
+        }
+
+        anpi::Matrix<double> R = {{1,2,3},{4,5,6}};
+        BOOST_CHECK_THROW(anpi::invert(R,Ai),anpi::Exception);
+    }
+
+    /**
+     * The single decomposition gives the same inverse as one
+     * decomposition per column (see benchmarkLU.cpp for the times)
+     */
+    BOOST_AUTO_TEST_CASE(singleDecomposition)
+    {
+        for (const size_t n : {16,32,64,128}) {
+            const anpi::Matrix<double> A =
+              anpi::test::randomMatrix<double>(n,n);
+            anpi::Matrix<double> Ai,Aic;
+
+            anpi::invert(A,Ai);
+            anpi::test::invertByColumns(A,Aic);
+
+            for (size_t i=0;i<n;++i) {
+                for (size_t j=0;j<n;++j) {
+                    BOOST_CHECK(std::abs(Ai(i,j) - Aic(i,j)) < 1e-9);
+                }
+            }
+        }
+    }
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,8 +13,12 @@
 #include "LUCrout.hpp"
 #include "LUDoolittle.hpp"
 #include "LU.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
 
 #include "Solver.hpp"
+#include "testParallel.hpp"
+#include "testRandom.hpp"
 
 #include <iostream>
 #include <exception>
@@ -122,6 +126,42 @@ namespace anpi {
     }//luTest
 
 
+  /**
+   * Compare the blocked decomposition decomp with the unblocked one on
+   * a n x n matrix
+   */
+  template<typename T>
+  void blockedTest(const std::function<void(const Matrix<T>&,
+                                            Matrix<T>&,
+                                            std::vector<size_t>&)>& decomp,
+                   const size_t n) {
+    const Matrix<T> A = randomMatrix<T>(n,n);
+
+    Matrix<T> LU,LUref;
+    std::vector<size_t> p,pref;
+    decomp(A,LU,p);
+    anpi::luDoolittle<T>(A,LUref,pref);
+
+    BOOST_CHECK(p==pref);
+
+    const T eps = std::is_same<T,float>::value ? T(1e-3) : T(1e-10);
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<n;++j) {
+        BOOST_CHECK(std::abs(LU(i,j)-LUref(i,j)) < eps);
+      }
+    }
+
+    // L*U reproduces the permuted rows of A
+    Matrix<T> L,U;
+    anpi::unpack(LU,L,U);
+    const Matrix<T> Ar = L*U;
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<n;++j) {
+        BOOST_CHECK(std::abs(Ar(i,j)-A(p[i],j)) < eps);
+      }
+    }
+  }
+
   template<typename T>
   void substitutionTest( const std::function<void( anpi::Matrix<T>& ,
                                               std::vector <T>& ,
@@ -252,6 +292,59 @@ BOOST_AUTO_TEST_CASE(lu) {
   
 }
 
+BOOST_AUTO_TEST_CASE(luBlocked) {
+  const anpi::cpu::Isa best = anpi::cpu::isa();
+
+  for (int i=anpi::cpu::Fallback;i<=best;++i) {
+    anpi::cpu::select(anpi::cpu::Isa(i));
+    for (const size_t n : {1,5,63,64,65,150}) {
+      anpi::test::blockedTest<float>(anpi::luBlocked<float>,n);
+      anpi::test::blockedTest<double>(anpi::luBlocked<double>,n);
+    }
+  }
+
+  anpi::cpu::select(best);
+
+  // Singular matrix, with a zero pivot past the first panel
+  anpi::Matrix<double> A(100,100,0.0);
+  for (size_t i=0;i<100;++i) {
+    A(i,i) = 1.0;
+  }
+  A(80,80) = 0.0;
+  A(80,79) = 1.0;
+  anpi::Matrix<double> LU;
+  std::vector<size_t> p;
+  BOOST_CHECK_THROW(anpi::luBlocked<double>(A,LU,p),anpi::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(luTiled) {
+  anpi::test::ParallelSettings settings;
+
+  for (size_t threads=1;threads<=3;threads+=2) {
+    anpi::parallel::threads() = threads;
+    for (const size_t n : {1,5,127,128,129,300}) {
+      anpi::test::blockedTest<float>(anpi::luTiled<float>,n);
+      anpi::test::blockedTest<double>(anpi::luTiled<double>,n);
+    }
+  }
+
+  // anpi::lu() switches to the tiled variant
+  anpi::parallel::luThreshold() = 0;
+  anpi::test::luTest<double>(anpi::lu<double>,anpi::unpack<double>);
+  anpi::test::blockedTest<double>(anpi::lu<double>,260);
+
+  // Singular matrix, with a zero pivot in the third tile
+  anpi::Matrix<double> A(300,300,0.0);
+  for (size_t i=0;i<300;++i) {
+    A(i,i) = 1.0;
+  }
+  A(280,280) = 0.0;
+  A(280,279) = 1.0;
+  anpi::Matrix<double> LU;
+  std::vector<size_t> p;
+  BOOST_CHECK_THROW(anpi::luTiled<double>(A,LU,p),anpi::Exception);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -0,0 +1,220 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Unit tests for the reusable LU factorization
+ */
+
+#include "LUFactorization.hpp"
+#include "Solver.hpp"
+#include "Parallel.hpp"
+#include "testParallel.hpp"
+#include "testRandom.hpp"
+
+// Explicit instantiation of all methods of LUFactorization
+template class anpi::LUFactorization<double>;
+template class anpi::LUFactorization<float>;
+template class anpi::LUFactorization<std::complex<double> >;
+
+BOOST_AUTO_TEST_SUITE( LUFactorization )
+
+/// Largest absolute entry of a*x - b
+template<typename T>
+double residual(const anpi::Matrix<T>& a,
+                const std::vector<T>& x,
+                const std::vector<T>& b) {
+  double e = 0.0;
+  for (size_t i=0;i<a.rows();++i) {
+    T sum(0);
+    for (size_t j=0;j<a.cols();++j) {
+      sum += a(i,j)*x[j];
+    }
+    e = std::max(e,double(std::abs(sum-b[i])));
+  }
+  return e;
+}
+
+template<typename T>
+void testSolve(const size_t n,const size_t m,const double eps) {
+  const anpi::Matrix<T> a = anpi::test::randomMatrix<T>(n,n,1u);
+  const anpi::Matrix<T> B = anpi::test::randomMatrix<T>(n,m,2u);
+
+  const anpi::LUFactorization<T> f(a);
+  BOOST_CHECK( f.rows() == n && !f.empty() );
+  BOOST_CHECK( f.permutation().size() == n );
+
+  // Each column alone
+  anpi::Matrix<T> X1(n,m);
+  for (size_t c=0;c<m;++c) {
+    std::vector<T> b(n);
+    for (size_t i=0;i<n;++i) {
+      b[i] = B(i,c);
+    }
+
+    const std::vector<T> x = f.solve(b);
+    BOOST_CHECK( residual(a,x,b) < eps );
+
+    std::vector<T> y = b;
+    f.solveInPlace(y);
+    BOOST_CHECK( y == x );
+
+    for (size_t i=0;i<n;++i) {
+      X1(i,c) = x[i];
+    }
+  }
+
+  // All columns at once
+  const anpi::Matrix<T> X = f.solve(B);
+  BOOST_CHECK( X.rows() == n && X.cols() == m );
+  for (size_t i=0;i<n;++i) {
+    for (size_t c=0;c<m;++c) {
+      BOOST_CHECK( std::abs(X(i,c) - X1(i,c)) < eps );
+    }
+  }
+
+  anpi::Matrix<T> Y = B;
+  f.solveInPlace(Y);
+  BOOST_CHECK( Y == X );
+
+  BOOST_CHECK_THROW( f.solve(std::vector<T>(n+1)), anpi::Exception );
+  BOOST_CHECK_THROW( f.solve(anpi::Matrix<T>(n+1,m)), anpi::Exception );
+}
+
+BOOST_AUTO_TEST_CASE( Solve ) {
+  testSolve<double>(1,1,1e-12);
+  testSolve<double>(7,3,1e-12);
+  testSolve<double>(150,17,1e-10);
+  testSolve<float>(40,9,1e-3);
+  testSolve<std::complex<double> >(20,4,1e-12);
+
+  // The same solution as solveLU()
+  const anpi::Matrix<double> a = { { 2, 1 ,0 },{-1, 7, 4 },{ 0, 2, -3 } };
+  const std::vector<double> b = { 4, 25, -5 };
+  std::vector<double> x;
+  anpi::solveLU(a,x,b);
+  BOOST_CHECK( anpi::LUFactorization<double>(a).solve(b) == x );
+
+  // Refactoring replaces the old decomposition
+  anpi::LUFactorization<double> f;
+  BOOST_CHECK( f.empty() );
+  f.factor(anpi::test::randomMatrix<double>(5,5,3u));
+  f.factor(a);
+  BOOST_CHECK( f.rows() == 3 );
+  BOOST_CHECK( f.solve(b) == x );
+
+  const anpi::Matrix<double> r = {{1,2,3},{4,5,6}};
+  BOOST_CHECK_THROW( f.factor(r), anpi::Exception );
+}
+
+/// The packed solves against unpack() and the substitutions
+template<typename T>
+void testPacked(const size_t n,const size_t m,const double eps) {
+  const anpi::Matrix<T> a = anpi::test::randomMatrix<T>(n,n,6u);
+  const anpi::Matrix<T> B = anpi::test::randomMatrix<T>(n,m,7u);
+
+  anpi::Matrix<T> LU;
+  std::vector<size_t> p;
+  anpi::lu(a,LU,p);
+
+  anpi::Matrix<T> L,U;
+  anpi::unpack(LU,L,U);
+
+  anpi::Matrix<T> X;
+  anpi::solvePackedLU(LU,p,X,B);
+  BOOST_CHECK( X.rows() == n && X.cols() == m );
+
+  for (size_t c=0;c<m;++c) {
+    std::vector<T> b(n),pb(n),y(n),x;
+    for (size_t i=0;i<n;++i) {
+      b[i] = B(i,c);
+    }
+    for (size_t i=0;i<n;++i) {
+      pb[i] = b[p[i]];
+    }
+    anpi::forwardSubs<T>(L,y,pb);
+    anpi::backwardSubs<T>(U,x,y);
+
+    std::vector<T> s;
+    anpi::solvePackedLU(LU,p,s,b);
+    anpi::solvePackedLU(LU,p,b,b);
+    BOOST_CHECK( b == s );
+
+    for (size_t i=0;i<n;++i) {
+      BOOST_CHECK( std::abs(s[i]-x[i]) < eps );
+      BOOST_CHECK( std::abs(X(i,c)-x[i]) < eps );
+    }
+  }
+
+  // In place, and into an X of the right size, without new buffers
+  anpi::Matrix<T> Y = B;
+  const T* const ydata = Y.data();
+  anpi::solvePackedLU(LU,p,Y,Y);
+  BOOST_CHECK( Y == X );
+  BOOST_CHECK( Y.data() == ydata );
+
+  const T* const xdata = X.data();
+  anpi::solvePackedLU(LU,p,X,B);
+  BOOST_CHECK( X.data() == xdata );
+  BOOST_CHECK( X == Y );
+
+  std::vector<T> wrong(n+1),x;
+  BOOST_CHECK_THROW( anpi::solvePackedLU(LU,p,x,wrong), anpi::Exception );
+}
+
+BOOST_AUTO_TEST_CASE( Packed ) {
+  // Sizes around the blocks of the triangular solves
+  testPacked<double>(1,1,1e-12);
+  testPacked<double>(64,5,1e-10);
+  testPacked<double>(150,70,1e-10);
+  testPacked<float>(130,9,1e-3);
+
+  // One chunk of columns per thread
+  anpi::test::ParallelSettings settings;
+  anpi::parallel::threads()       = 3;
+  anpi::parallel::gemmThreshold() = 0;
+
+  testPacked<double>(150,70,1e-10);
+  testPacked<double>(70,2,1e-10);
+}
+
+BOOST_AUTO_TEST_CASE( Concurrent ) {
+  const size_t n=64,m=32;
+  const anpi::Matrix<double> a = anpi::test::randomMatrix<double>(n,n,4u);
+  const anpi::Matrix<double> B = anpi::test::randomMatrix<double>(n,m,5u);
+  const anpi::LUFactorization<double> f(a);
+  const anpi::Matrix<double> X = f.solve(B);
+
+  // One right-hand side per thread, all with the same factorization
+  std::vector<int> ok(m,0);
+#pragma omp parallel for num_threads(4) schedule(dynamic)
+  for (size_t c=0;c<m;++c) {
+    std::vector<double> b(n);
+    for (size_t i=0;i<n;++i) {
+      b[i] = B(i,c);
+    }
+    f.solveInPlace(b);
+
+    bool same = true;
+    for (size_t i=0;i<n;++i) {
+      same = same && (std::abs(b[i]-X(i,c)) < 1e-12);
+    }
+    ok[c] = same ? 1 : 0;
+  }
+
+  for (size_t c=0;c<m;++c) {
+    BOOST_CHECK( ok[c] == 1 );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
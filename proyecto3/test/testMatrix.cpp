@@ -12,14 +12,21 @@
 #include <exception>
 #include <cstdlib>
 #include <complex>
+#include <cstdio>
+#include <string>
 
 /**
  * Unit tests for the matrix class
  */
 
 #include "Matrix.hpp"
+#include "FixedMatrix.hpp"
 #include "Allocator.hpp"
 #include "bits/MatrixArithmetic.hpp"
+#include "CpuFeatures.hpp"
+
+#include "testParallel.hpp"
+#include "testRandom.hpp"
 
 // Explicit instantiation of all methods of Matrix
 
@@ -67,6 +74,16 @@ typedef anpi::Matrix<double  ,aralloc> ardmatrix;
 typedef anpi::Matrix<float   ,aralloc> arfmatrix;
 typedef anpi::Matrix<int     ,aralloc> arimatrix;
 
+// column-major layout
+template class anpi::Matrix<dcomplex,aralloc,anpi::ColMajor>;
+template class anpi::Matrix<double  ,alloc  ,anpi::ColMajor>;
+template class anpi::Matrix<float   ,aralloc,anpi::ColMajor>;
+template class anpi::Matrix<int     ,aalloc ,anpi::ColMajor>;
+
+// 16 bit storage
+template class anpi::Matrix<anpi::half    ,aralloc>;
+template class anpi::Matrix<anpi::bfloat16,aralloc>;
+
 #if 1
 # define dispatchTest(func) \
   func<cmatrix>();          \
@@ -331,10 +348,1013 @@ void testSimd() {
     anpi::aimpl::subtract(a,M{ {7,8,9},{10,11,12} },c);
     BOOST_CHECK( c==r );
   }
+
+  // Sizes not multiple of any register width, and blocks of a larger
+  // matrix whose surrounding entries must remain untouched
+  typedef typename M::value_type T;
+  const size_t sizes[][2] = { {1,1}, {3,5}, {7,9}, {17,33} };
+  for (const auto& s : sizes) {
+    M a = anpi::test::patternMatrix<T,typename M::allocator_type>(s[0],s[1]);
+    M b(s[0],s[1],anpi::DoNotInitialize);
+    for (size_t i=0;i<b.rows();++i) {
+      for (size_t j=0;j<b.cols();++j) {
+        b(i,j) = T(int((i+2*j)%5));
+      }
+    }
+
+    M c,d(a);
+    anpi::aimpl::add(a,b,c);
+    anpi::aimpl::subtract(d,b,d);
+
+    M big(s[0]+2,s[1]+2,T(7));
+    anpi::add(a.view(),b.view(),big.view().block(1,1,s[0],s[1]));
+
+    for (size_t i=0;i<big.rows();++i) {
+      for (size_t j=0;j<big.cols();++j) {
+        const bool in = (i>0) && (j>0) && (i<=s[0]) && (j<=s[1]);
+        BOOST_CHECK( big(i,j) == (in ? T(a(i-1,j-1)+b(i-1,j-1)) : T(7)) );
+      }
+    }
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        BOOST_CHECK( c(i,j) == T(a(i,j)+b(i,j)) );
+        BOOST_CHECK( d(i,j) == T(a(i,j)-b(i,j)) );
+      }
+    }
+  }
 }
 
+// Unpadded buffers of every register type, with all tail lengths
+template<typename T>
+void testMaskedTail() {
+  typedef anpi::Matrix<T,std::allocator<T> > M;
+
+  for (size_t n=1;n<=67;++n) {
+    M a(2,n,anpi::DoNotInitialize);
+    M b(2,n,anpi::DoNotInitialize);
+    for (size_t j=0;j<n;++j) {
+      a(0,j) = T(j%100);
+      a(1,j) = T(j%7);
+      b(0,j) = T(j%5);
+      b(1,j) = T(j%3);
+    }
+
+    M c,d;
+    anpi::aimpl::add(a,b,c);
+    anpi::aimpl::subtract(a,b,d);
+    bool ok=true;
+    for (size_t i=0;i<2;++i) {
+      for (size_t j=0;j<n;++j) {
+        ok = ok && (c(i,j) == T(a(i,j)+b(i,j)))
+                && (d(i,j) == T(a(i,j)-b(i,j)));
+      }
+    }
+    BOOST_CHECK_MESSAGE( ok, "wrong result with " << n << " columns" );
+
+    // The expressions use the same unaligned registers and tails
+    const M e = a + b;
+    const M f = a - b;
+    const M g = a + b - b;
+    BOOST_CHECK_MESSAGE( (e == c) && (f == d) && (g == a),
+                         "wrong expression with " << n << " columns" );
+  }
+}
+
+# define maskedTailTest()          \
+  testMaskedTail<std::int8_t>();   \
+  testMaskedTail<std::uint16_t>(); \
+  testMaskedTail<std::int32_t>();  \
+  testMaskedTail<std::uint64_t>(); \
+  testMaskedTail<float>();         \
+  testMaskedTail<double>();
+
 BOOST_AUTO_TEST_CASE(Simd) {
   dispatchTest(testSimd);
+  maskedTailTest();
+}
+
+template<class M>
+void testParallelArithmetic() {
+  typedef typename M::value_type T;
+
+  anpi::test::ParallelSettings settings;
+  anpi::parallel::threads()              = 3;
+  anpi::parallel::elementwiseThreshold() = 0;
+
+  // Chunks end inside rows and inside registers
+  const size_t sizes[][2] = { {1,1}, {2,5}, {7,19}, {37,53} };
+  for (const auto& s : sizes) {
+    M a(s[0],s[1],anpi::DoNotInitialize);
+    M b(s[0],s[1],anpi::DoNotInitialize);
+    for (size_t i=0;i<s[0];++i) {
+      for (size_t j=0;j<s[1];++j) {
+        a(i,j) = T(int((i*13+j*7)%23)-11);
+        b(i,j) = T(int((i*5+j)%9)-4);
+      }
+    }
+
+    M c,d;
+    anpi::aimpl::add(a,b,c);
+    anpi::aimpl::subtract(a,b,d);
+    M e(a),f(a);
+    anpi::aimpl::add(e,b);
+    anpi::aimpl::subtract(f,b);
+
+    // Expressions are split among the threads as well
+    const M g = a + b;
+    const M h = a - b + a - a;
+
+    bool ok=true;
+    for (size_t i=0;i<s[0];++i) {
+      for (size_t j=0;j<s[1];++j) {
+        ok = ok && (c(i,j) == T(a(i,j)+b(i,j))) && (e(i,j) == c(i,j))
+                && (d(i,j) == T(a(i,j)-b(i,j))) && (f(i,j) == d(i,j))
+                && (g(i,j) == c(i,j)) && (h(i,j) == d(i,j));
+      }
+    }
+    BOOST_CHECK_MESSAGE( ok, "wrong result with " << s[0] << "x" << s[1] );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ParallelArithmetic) {
+  dispatchTest(testParallelArithmetic);
+}
+
+template<class M>
+void testExpression() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6} };
+    M b = { {7,8,9},{10,11,12} };
+    M c = { {2,2,2},{ 3, 3, 3} };
+    M d = { {1,0,1},{ 0, 1, 0} };
+
+    // a + b - c + d, evaluated in one pass
+    M r = { {7,8,11},{11,14,15} };
+
+    M e = a + b - c + d;
+    BOOST_CHECK( e==r );
+
+    M f;
+    f = (a + b) - (c - d);
+    BOOST_CHECK( f==r );
+
+    f = a + (b - (c - d));
+    BOOST_CHECK( f==r );
+
+    // the destination may appear in the expression
+    f = a;
+    f = f + b - c + d;
+    BOOST_CHECK( f==r );
+
+    f = a;
+    f += b - c + d;
+    BOOST_CHECK( f==r );
+
+    f = r;
+    f -= b - c + d;
+    BOOST_CHECK( f==a );
+  }
+
+  // Sizes not multiple of any register width
+  const size_t sizes[][2] = { {1,1}, {3,17}, {31,33}, {64,65} };
+
+  for (const auto& s : sizes) {
+    M a(s[0],s[1],anpi::DoNotInitialize);
+    M b(s[0],s[1],anpi::DoNotInitialize);
+    M c(s[0],s[1],anpi::DoNotInitialize);
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        a(i,j) = T(int(i*3+j));
+        b(i,j) = T(int(i+j*5)%13);
+        c(i,j) = T(int(i*j)%7);
+      }
+    }
+
+    M e = a - b + c - a;
+
+    M r(a);
+    r -= b;
+    r += c;
+    r -= a;
+    BOOST_CHECK( e==r );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Expression) {
+  dispatchTest(testExpression);
+}
+
+template<class M>
+void testMultiplication() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6} };
+    M b = { {7,8},{9,10},{11,12} };
+    M r = { {58,64},{139,154} };
+
+    M c=a*b;
+    BOOST_CHECK( c==r );
+  }
+
+  // Sizes crossing the register tile and the cache blocks of the kernel
+  const size_t sizes[][3] = { {1,1,1}, {7,13,5}, {37,50,61},
+                              {97,300,130}, {301,257,33} };
+
+  for (const auto& s : sizes) {
+    // small integers keep every partial sum exact
+    M a = anpi::test::patternMatrix<T,typename M::allocator_type>(s[0],s[1]);
+    M b(s[1],s[2],anpi::DoNotInitialize);
+    for (size_t i=0;i<b.rows();++i) {
+      for (size_t j=0;j<b.cols();++j) {
+        b(i,j) = T(int((i*5+j*11)%7)-3);
+      }
+    }
+
+    M r(a.rows(),b.cols(),T(0));
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<b.cols();++j) {
+        for (size_t k=0;k<a.cols();++k) {
+          r(i,j) += a(i,k)*b(k,j);
+        }
+      }
+    }
+
+    M c=a*b;
+    BOOST_CHECK( c==r );
+
+    M f;
+    anpi::fallback::multiply(a,b,f);
+    BOOST_CHECK( f==r );
+  }
+
+  {
+    M a(2,3);
+    M b(2,3);
+    BOOST_CHECK_THROW( a*b, anpi::Exception );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Multiplication) {
+  dispatchTest(testMultiplication);
+}
+
+template<typename T>
+void testParallelMultiplication() {
+  // force the thread team even for these small products
+  anpi::test::ParallelSettings settings;
+  anpi::parallel::threads()       = 3;
+  anpi::parallel::gemmThreshold() = 0;
+
+  const anpi::Matrix<T> a = anpi::test::patternMatrix<T>(203,171);
+  anpi::Matrix<T> b(171,389,anpi::DoNotInitialize);
+  for (size_t i=0;i<b.rows();++i) {
+    for (size_t j=0;j<b.cols();++j) {
+      b(i,j) = T(int((i*5+j*11)%7)-3);
+    }
+  }
+
+  anpi::Matrix<T> r;
+  anpi::fallback::multiply(a,b,r);
+
+  anpi::Matrix<T> c=a*b;
+  BOOST_CHECK( c==r );
+}
+
+template<class M>
+void testGemv() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6} };
+    std::vector<T> x = {1,-1,2};
+    std::vector<T> r = {5,11};
+
+    BOOST_CHECK( a*x == r );
+
+    std::vector<T> y;
+    anpi::gemv(a,x,y);
+    BOOST_CHECK( y == r );
+
+    // y = 2*a*x - y
+    anpi::gemv(a,x,y,T(2),T(-1));
+    BOOST_CHECK( y == r );
+
+    std::vector<T> z(3);
+    BOOST_CHECK_THROW( anpi::gemv(a,x,z,T(1),T(1)), anpi::Exception );
+    BOOST_CHECK_THROW( anpi::gemv(a,r,z), anpi::Exception );
+  }
+
+  // Row lengths crossing the register blocks, serial and parallel
+  anpi::test::ParallelSettings settings;
+  const size_t oldThreshold = anpi::parallel::gemvThreshold();
+  const size_t sizes[][2] = { {1,1}, {9,37}, {64,64}, {131,517} };
+
+  for (size_t threads=1;threads<=3;threads+=2) {
+    anpi::parallel::threads()       = threads;
+    anpi::parallel::gemvThreshold() = (threads>1) ? 0 : oldThreshold;
+
+    for (const auto& s : sizes) {
+      const M a =
+        anpi::test::patternMatrix<T,typename M::allocator_type>(s[0],s[1]);
+      std::vector<T> x(s[1]);
+      for (size_t j=0;j<a.cols();++j) {
+        x[j] = T(int(j%5)-2);
+      }
+
+      std::vector<T> r(a.rows(),T(0));
+      for (size_t i=0;i<a.rows();++i) {
+        for (size_t j=0;j<a.cols();++j) {
+          r[i] += a(i,j)*x[j];
+        }
+      }
+
+      std::vector<T> y(a.rows(),T(1));
+      anpi::gemv(a,x,y,T(1),T(0));
+      BOOST_CHECK( y == r );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Gemv) {
+  dispatchTest(testGemv);
+}
+
+template<class M>
+void testBlas1() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2},{3,4} };
+    M b = { {2,1},{4,2} };
+    M c = { {1,1},{1,1} };
+    M r;
+
+    anpi::hadamard(a,b,r);
+    BOOST_CHECK( r == M({ {2,2},{12,8} }) );
+    anpi::fmadd(a,b,c,r);
+    BOOST_CHECK( r == M({ {3,3},{13,9} }) );
+    anpi::divide(r,c,r);
+    BOOST_CHECK( r == M({ {3,3},{13,9} }) );
+    anpi::axpy(T(2),a,r);
+    BOOST_CHECK( r == M({ {5,7},{19,17} }) );
+    anpi::scale(r,T(-1));
+    BOOST_CHECK( r == M({ {-5,-7},{-19,-17} }) );
+
+    M d(3,2);
+    BOOST_CHECK_THROW( anpi::hadamard(a,d,r), anpi::Exception );
+    BOOST_CHECK_THROW( anpi::axpy(T(1),a,d), anpi::Exception );
+    BOOST_CHECK_THROW( anpi::fmadd(a,b,d,r), anpi::Exception );
+  }
+
+  // Sizes not multiple of any register width, matrices and vectors
+  const size_t sizes[][2] = { {1,1}, {3,5}, {17,33}, {64,64} };
+
+  for (const auto& s : sizes) {
+    M a = anpi::test::patternMatrix<T,typename M::allocator_type>(s[0],s[1]);
+    M b(s[0],s[1],anpi::DoNotInitialize);
+    M c(s[0],s[1],anpi::DoNotInitialize);
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        a(i,j) *= T(4);
+        b(i,j) = T(1 << ((i+j)%3));
+        c(i,j) = T(int((i+2*j)%5)-2);
+      }
+    }
+
+    M y(c), h, q, f;
+    anpi::axpy(T(3),a,y);
+    anpi::hadamard(a,b,h);
+    anpi::divide(a,b,q);
+    anpi::fmadd(a,b,c,f);
+
+    bool ok = true;
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        ok = ok && (y(i,j) == T(3)*a(i,j) + c(i,j));
+        ok = ok && (h(i,j) == a(i,j)*b(i,j));
+        ok = ok && (q(i,j) == a(i,j)/b(i,j));
+        ok = ok && (f(i,j) == a(i,j)*b(i,j) + c(i,j));
+      }
+    }
+    BOOST_CHECK( ok );
+
+    std::vector<T> va(a.data(),a.data()+a.cols());
+    std::vector<T> vb(b.data(),b.data()+b.cols());
+    std::vector<T> vc(c.data(),c.data()+c.cols());
+    std::vector<T> vy(vc), vh, vq, vf;
+    anpi::axpy(T(3),va,vy);
+    anpi::hadamard(va,vb,vh);
+    anpi::divide(va,vb,vq);
+    anpi::fmadd(va,vb,vc,vf);
+    anpi::scale(vc,T(2));
+
+    ok = true;
+    for (size_t j=0;j<a.cols();++j) {
+      ok = ok && (vy[j] == y(0,j)) && (vh[j] == h(0,j)) &&
+                 (vq[j] == q(0,j)) && (vf[j] == f(0,j)) &&
+                 (vc[j] == T(2)*c(0,j));
+    }
+    BOOST_CHECK( ok );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Blas1) {
+  dispatchTest(testBlas1);
+}
+
+template<class M>
+void testReduce() {
+  typedef typename M::value_type T;
+  typedef typename anpi::norm_type<T>::type R;
+
+  {
+    std::vector<T> x = {1,-7,3,7};
+    std::vector<T> y = {2,1,0,-1};
+    BOOST_CHECK( anpi::dot(x,y) == T(-12) );
+    BOOST_CHECK( anpi::sum(x) == T(4) );
+    BOOST_CHECK( anpi::squaredNorm(x) == R(108) );
+    BOOST_CHECK( anpi::iamax(x) == 1 );   // first of equal magnitudes
+    BOOST_CHECK( anpi::iamax(std::vector<T>()) == 0 );
+    BOOST_CHECK_THROW( anpi::dot(x,std::vector<T>(3)), anpi::Exception );
+
+    M a = { {1,2,3},{4,-5,6} };
+    BOOST_CHECK( anpi::sum(a) == T(11) );
+    BOOST_CHECK( anpi::squaredNorm(a) == R(91) );
+  }
+
+  // Lengths crossing the register blocks, serial and parallel
+  anpi::test::ParallelSettings settings;
+  const size_t oldThreshold = anpi::parallel::reduceThreshold();
+  const size_t sizes[] = { 1, 7, 33, 130, 1031 };
+
+  for (size_t threads=1;threads<=3;threads+=2) {
+    anpi::parallel::threads()         = threads;
+    anpi::parallel::reduceThreshold() = (threads>1) ? 0 : oldThreshold;
+
+    for (const size_t n : sizes) {
+      std::vector<T> x(n),y(n);
+      for (size_t i=0;i<n;++i) {
+        x[i] = T(int((i*7)%11)-5);
+        y[i] = T(int(i%3)-1);
+      }
+      // The largest magnitude appears twice, near the end
+      x[n-1] = T(-9);
+      if (n > 2) {
+        x[n-3] = T(9);
+      }
+
+      T d(0),s(0);
+      R q(0);
+      for (size_t i=0;i<n;++i) {
+        d += x[i]*y[i];
+        s += x[i];
+        q += std::abs(x[i])*std::abs(x[i]);
+      }
+
+      BOOST_CHECK( anpi::dot(x,y) == d );
+      BOOST_CHECK( anpi::sum(x) == s );
+      BOOST_CHECK( anpi::squaredNorm(x) == q );
+      BOOST_CHECK( anpi::iamax(x) == ((n > 2) ? n-3 : n-1) );
+
+      // The same entries as a matrix with padded rows
+      M a(1,n,x.data());
+      BOOST_CHECK( anpi::sum(a) == s );
+      BOOST_CHECK( anpi::squaredNorm(a) == q );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Reduce) {
+  dispatchTest(testReduce);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelMultiplication) {
+  testParallelMultiplication<float>();
+  testParallelMultiplication<double>();
+}
+
+template<class M>
+void testTranspose() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6} };
+    M r = { {1,4},{2,5},{3,6} };
+
+    M b;
+    a.transposed(b);
+    BOOST_CHECK( b==r );
+
+    a.transpose();
+    BOOST_CHECK( a==r );
+  }
+
+  // Sizes crossing the register tiles and the recursion leaves
+  const size_t sizes[][2] = { {1,1}, {3,3}, {8,8}, {13,13}, {33,33},
+                              {77,77}, {130,130}, {5,9}, {37,70},
+                              {100,41}, {257,129} };
+
+  for (const auto& s : sizes) {
+    M a(s[0],s[1],anpi::DoNotInitialize);
+    M r(s[1],s[0],anpi::DoNotInitialize);
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        a(i,j) = r(j,i) = T(int(i*1000+j));
+      }
+    }
+
+    M b;
+    a.transposed(b);
+    BOOST_CHECK( b==r );
+
+    a.transpose();
+    BOOST_CHECK( a==r );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Transpose) {
+  dispatchTest(testTranspose);
+}
+
+template<class M>
+void testViews() {
+  typedef typename M::value_type T;
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6},{7,8,9} };
+    const M& ca = a;
+
+    typename M::const_view_type v = ca.block(1,1,2,2);
+    BOOST_CHECK( v.rows()==2 && v.cols()==2 && v.dcols()==a.dcols() );
+    BOOST_CHECK( v(0,0)==T(5) && v(1,1)==T(9) );
+    BOOST_CHECK( v[1] == &a(2,1) );
+
+    M b(v);
+    M r = { {5,6},{8,9} };
+    BOOST_CHECK( b==r );
+
+    BOOST_CHECK( M(a.rowRange(2,1))==M({ {7,8,9} }) );
+    BOOST_CHECK( M(a.colRange(0,1))==M({ {1},{4},{7} }) );
+    BOOST_CHECK( M(a.view().block(0,1,3,2).rowRange(1,2).colRange(1,1))
+                 == M({ {6},{9} }) );
+
+    // writes through the view go into the matrix
+    a.block(0,0,2,2).fill(T(0));
+    M z = { {0,0,3},{0,0,6},{7,8,9} };
+    BOOST_CHECK( a==z );
+
+    a.block(0,0,2,2).assign(b.view());
+    M w = { {5,6,3},{8,9,6},{7,8,9} };
+    BOOST_CHECK( a==w );
+
+    BOOST_CHECK_THROW( a.block(0,0,1,2).assign(b.view()), anpi::Exception );
+  }
+
+  // Sizes crossing the registers, on blocks with odd offsets
+  const size_t sizes[][3] = { {1,1,1}, {7,13,5}, {37,50,61}, {97,130,33} };
+
+  for (const auto& s : sizes) {
+    M a =
+      anpi::test::patternMatrix<T,typename M::allocator_type>(s[0]+3,s[1]+5);
+    M b(s[1]+1,s[2]+7,anpi::DoNotInitialize);
+    M c(s[0]+2,s[2]+3,T(1));
+    for (size_t i=0;i<b.rows();++i) {
+      for (size_t j=0;j<b.cols();++j) {
+        b(i,j) = T(int((i*5+j*11)%7)-3);
+      }
+    }
+
+    auto av = a.block(3,5,s[0],s[1]);
+    auto bv = b.block(1,7,s[1],s[2]);
+    auto cv = c.block(2,3,s[0],s[2]);
+
+    // c = 2*a*b - c, leaving the rest of c untouched
+    M r(cv);
+    for (size_t i=0;i<r.rows();++i) {
+      for (size_t j=0;j<r.cols();++j) {
+        T sum = T(0);
+        for (size_t k=0;k<s[1];++k) {
+          sum += av(i,k)*bv(k,j);
+        }
+        r(i,j) = T(2)*sum - r(i,j);
+      }
+    }
+
+    anpi::gemm(av,bv,cv,T(2),T(-1));
+    BOOST_CHECK( M(cv)==r );
+    BOOST_CHECK( c(0,0)==T(1) && c(1,2)==T(1) );
+
+    // c = a*b through a matrix and views of whole matrices
+    M ab(s[0],s[1],anpi::DoNotInitialize);
+    ab.view().assign(av);
+    M p = ab*M(bv);
+    anpi::gemm(av,bv,cv);
+    BOOST_CHECK( M(cv)==p );
+
+    BOOST_CHECK_THROW( anpi::gemm(a.block(0,0,s[0],s[1]+1),bv,cv),
+                       anpi::Exception );
+
+    // element-wise operations on blocks of the same size
+    auto a1 = a.block(0,0,s[0],s[1]);
+    auto a2 = a.block(3,5,s[0],s[1]);
+    M e(a1);
+    M f(a2);
+    M sum = e+f;
+    M dif = e-f;
+
+    M g(s[0],s[1],T(0));
+    anpi::add(a1,a2,g.view());
+    BOOST_CHECK( g==sum );
+    anpi::subtract(a1,a2,g.view());
+    BOOST_CHECK( g==dif );
+
+    BOOST_CHECK_THROW( anpi::add(a1,a.block(0,0,s[0],s[1]+1),g.view()),
+                       anpi::Exception );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Views) {
+  dispatchTest(testViews);
+}
+
+template<class M>
+void testSaveLoad() {
+  typedef typename M::value_type T;
+  const std::string name = "anpi_test_matrix.bin";
+
+  M a = { {1,2,3,4,5},{6,7,8,9,10},{11,12,13,14,15} };
+  a.save(name);
+
+  M b;
+  b.load(name);
+  BOOST_CHECK( a==b );
+
+  { // other row padding
+    anpi::Matrix<T,anpi::aligned_row_allocator<T,64> > c;
+    c.load(name);
+    BOOST_CHECK( c.rows() == 3 );
+    BOOST_CHECK( c.cols() == 5 );
+    BOOST_CHECK( c(2,3) == T(14) );
+    BOOST_CHECK( c(1,4) == T(10) );
+  }
+
+  { // other type
+    anpi::Matrix<short> s;
+    BOOST_CHECK_THROW( s.load(name),anpi::Exception );
+  }
+
+  { // empty matrix
+    M e;
+    e.save(name);
+    b.load(name);
+    BOOST_CHECK( b.empty() );
+  }
+  
+  BOOST_CHECK_THROW( b.load("does_not_exist.bin"),anpi::Exception );
+  std::remove(name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(SaveLoad) {
+  dispatchTest(testSaveLoad);
+}
+
+template<class M>
+void testLayout() {
+  typedef typename M::value_type T;
+  typedef anpi::Matrix<T,typename M::allocator_type,anpi::ColMajor> C;
+
+  M a = { {1,2,3,4,5},{6,7,8,9,10},{11,12,13,14,15} };
+  C c = { {1,2,3,4,5},{6,7,8,9,10},{11,12,13,14,15} };
+
+  { // storage
+    BOOST_CHECK( c.rows() == 3 && c.cols() == 5 );
+    BOOST_CHECK( c.lines() == 5 && c.lineLength() == 3 );
+    BOOST_CHECK( c.dcols() >= 3 );
+    BOOST_CHECK( c(1,2) == T(8) );
+    BOOST_CHECK( c[2][1] == T(8) ); // column 2, row 1
+    BOOST_CHECK( c.column(3) == a.column(3) );
+  }
+
+  { // conversions in both directions
+    M r(c);
+    BOOST_CHECK( r == a );
+    C b(a);
+    BOOST_CHECK( b == c );
+    b.fill(T(0));
+    b = a;
+    BOOST_CHECK( b == c );
+    C v(a.block(1,1,2,3));
+    BOOST_CHECK( v.rows() == 2 && v(1,2) == T(14) );
+  }
+
+  { // views
+    auto t = c.view().transpose();
+    BOOST_CHECK( t.rows() == 5 && t.cols() == 3 );
+    BOOST_CHECK( t(2,1) == c(1,2) );
+    auto blk = c.block(1,2,2,3);
+    BOOST_CHECK( blk(0,0) == T(8) && blk(1,2) == T(15) );
+    blk.fill(T(0));
+    BOOST_CHECK( c(2,4) == T(0) && c(2,1) == T(12) );
+    c.block(1,2,2,3).assign(a.block(1,2,2,3));
+    BOOST_CHECK( M(c) == a );
+  }
+
+  { // element-wise operations and reductions
+    C s = c + c - c;
+    BOOST_CHECK( s == c );
+    s += c;
+    anpi::scale(s,T(2));
+    anpi::axpy(T(-4),c,s);
+    BOOST_CHECK( anpi::sum(s) == T(0) );
+    BOOST_CHECK( anpi::sum(c) == anpi::sum(a) );
+    BOOST_CHECK( anpi::squaredNorm(c) == anpi::squaredNorm(a) );
+  }
+
+  { // transposition and products
+    C ct;
+    c.transposed(ct);
+    BOOST_CHECK( ct.rows() == 5 && ct(4,2) == T(15) );
+
+    M at;
+    a.transposed(at);
+    BOOST_CHECK( M(c*ct) == a*at );
+    BOOST_CHECK( M(ct*c) == at*a );
+
+    std::vector<T> x = {T(1),T(0),T(2),T(1),T(-1)};
+    BOOST_CHECK( c*x == a*x );
+
+    std::vector<T> y(3,T(1));
+    anpi::gemv(c,x,y,T(2),T(1));
+    std::vector<T> z(3,T(1));
+    anpi::gemv(a,x,z,T(2),T(1));
+    BOOST_CHECK( y == z );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Layout) {
+  dispatchTest(testLayout);
+}
+
+template<typename H>
+void testHalf() {
+  typedef anpi::Matrix<H,aralloc> M;
+  typedef anpi::Matrix<float,aralloc> FM;
+
+  // Spacing of the representable values just above 1
+  const float eps = std::is_same<H,anpi::half>::value ? std::ldexp(1.f,-10)
+                                                      : std::ldexp(1.f,-7);
+
+  { // Scalar conversions round to nearest even
+    BOOST_CHECK( float(H(1.5f)) == 1.5f );
+    BOOST_CHECK( float(H(-3.f)) == -3.f );
+    BOOST_CHECK( float(H(1.f + eps/2)) == 1.f );
+    BOOST_CHECK( float(H(1.f + 3*eps/2)) == 1.f + 2*eps );
+    BOOST_CHECK( float(H(1.f + 0.6f*eps)) == 1.f + eps );
+    BOOST_CHECK( std::isnan(float(H(std::nanf("")))) );
+    BOOST_CHECK( std::isinf(float(H(std::numeric_limits<float>::infinity()))));
+    if (std::is_same<H,anpi::half>::value) {
+      BOOST_CHECK( std::isinf(float(H(65520.f))) );
+      BOOST_CHECK( float(H(65504.f)) == 65504.f );
+      BOOST_CHECK( float(H(1.0e-7f)) == std::ldexp(1.f,-23) ); // subnormal
+    }
+  }
+
+  { // Register conversions match the scalar ones
+    const size_t n = 77;
+    std::vector<float> x(n),y(n);
+    std::vector<H> h(n);
+    for (size_t i=0;i<n;++i) {
+      x[i] = (1.f + float(i%7)*eps/4) * std::ldexp(1.f,int(i%9)-4);
+      x[i] = (i%2) ? -x[i] : x[i];
+    }
+    x[5] = std::nanf("");
+    x[40] = 1.0e30f;
+
+    anpi::aimpl::convert(x.data(),h.data(),n);
+    anpi::aimpl::convert(h.data(),y.data(),n);
+    for (size_t i=0;i<n;++i) {
+      BOOST_CHECK( h[i].bits() == H(x[i]).bits() );
+      BOOST_CHECK( (y[i] == float(H(x[i]))) || std::isnan(y[i]) );
+    }
+    BOOST_CHECK( std::isnan(y[5]) );
+  }
+
+  { // Element-wise operations computed in float
+    const size_t sizes[][2] = { {1,1}, {3,5}, {17,33} };
+    for (const auto& s : sizes) {
+      const FM fa = anpi::test::patternMatrix<float>(s[0],s[1]);
+      FM fb(s[0],s[1],anpi::DoNotInitialize);
+      FM fc(s[0],s[1],anpi::DoNotInitialize);
+      for (size_t i=0;i<fa.rows();++i) {
+        for (size_t j=0;j<fa.cols();++j) {
+          fb(i,j) = float(1 << ((i+j)%3));
+          fc(i,j) = float(int((i+2*j)%5)-2);
+        }
+      }
+
+      M a,b,c,r;
+      anpi::convert(fa,a);
+      anpi::convert(fb,b);
+      anpi::convert(fc,c);
+      FM back;
+      anpi::convert(a,back);
+      BOOST_CHECK( back == fa );
+
+      FM fr;
+      anpi::convert(M(a+b),fr);
+      BOOST_CHECK( fr == FM(fa+fb) );
+      r = a;
+      r -= b;
+      anpi::convert(r,fr);
+      BOOST_CHECK( fr == FM(fa-fb) );
+
+      anpi::fmadd(a,b,c,r);
+      anpi::divide(r,b,r);
+      anpi::axpy(H(2.f),c,r);
+      anpi::scale(r,H(-0.5f));
+      anpi::hadamard(r,b,r);
+
+      FM e;
+      anpi::fmadd(fa,fb,fc,e);
+      anpi::divide(e,fb,e);
+      anpi::axpy(2.f,fc,e);
+      anpi::scale(e,-0.5f);
+      anpi::hadamard(e,fb,e);
+      anpi::convert(r,fr);
+      BOOST_CHECK( fr == e );
+    }
+  }
+
+  { // Reductions accumulate in float: in 16 bits, 2048+1 rounds to 2048
+    static_assert(std::is_same<decltype(anpi::sum(std::vector<H>())),
+                               float>::value,
+                  "Reductions of 16 bit entries must return float");
+
+    std::vector<H> ones(4099,H(1.f));
+    std::vector<H> twos(4099,H(2.f));
+    BOOST_CHECK( anpi::sum(ones) == 4099.f );
+    BOOST_CHECK( anpi::dot(ones,twos) == 8198.f );
+    BOOST_CHECK( anpi::squaredNorm(twos) == 16396.f );
+
+    M a(67,67,H(1.f));
+    BOOST_CHECK( anpi::sum(a) == 4489.f );
+    BOOST_CHECK( anpi::squaredNorm(a) == 4489.f );
+  }
+
+  { // Files keep the 16 bit type: the other one has the same size
+    typedef typename std::conditional<std::is_same<H,anpi::half>::value,
+                                      anpi::bfloat16,
+                                      anpi::half>::type O;
+    const std::string name = "anpi_test_half.bin";
+
+    M a(3,5,anpi::DoNotInitialize);
+    for (size_t i=0;i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        a(i,j) = H(float(int(i*5+j)-7)/4.f);
+      }
+    }
+    a.save(name);
+
+    M b;
+    b.load(name);
+    bool same = (b.rows() == a.rows()) && (b.cols() == a.cols());
+    for (size_t i=0;same && i<a.rows();++i) {
+      for (size_t j=0;j<a.cols();++j) {
+        same = same && (b(i,j).bits() == a(i,j).bits());
+      }
+    }
+    BOOST_CHECK( same );
+
+    anpi::Matrix<O,aralloc> o;
+    BOOST_CHECK_THROW( o.load(name),anpi::Exception );
+    anpi::Matrix<std::int16_t> s;
+    BOOST_CHECK_THROW( s.load(name),anpi::Exception );
+
+    std::remove(name.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Half) {
+  testHalf<anpi::half>();
+  testHalf<anpi::bfloat16>();
+}
+
+BOOST_AUTO_TEST_CASE(FixedMatrix) {
+  typedef anpi::FixedMatrix<double,3,3> F33;
+
+  static_assert(F33::rows()==3 && F33::cols()==3 && F33::entries()==9,
+                "Sizes must be constant expressions");
+  static_assert(sizeof(F33)==9*sizeof(double),"No storage overhead");
+
+  F33 a = { {2,1,1},{4,-6,0},{-2,7,2} };
+  F33 z;
+  BOOST_CHECK( z == F33(0.0) );
+  BOOST_CHECK( a(1,1) == -6.0 );
+  BOOST_CHECK( a[2][1] == 7.0 );
+
+  BOOST_CHECK( (a + a) == 2.0*a );
+  BOOST_CHECK( (a - a) == z );
+  BOOST_CHECK( -a == a*(-1.0) );
+
+  { // product with a non-square matrix and a vector
+    anpi::FixedMatrix<double,3,2> b = { {1,0},{0,1},{1,1} };
+    anpi::FixedMatrix<double,3,2> c = a*b;
+    anpi::FixedMatrix<double,3,2> e = { {3,2},{4,-6},{0,9} };
+    BOOST_CHECK( c == e );
+
+    std::array<double,3> x = {{1,2,3}};
+    std::array<double,3> y = a*x;
+    BOOST_CHECK( y[0] == 7.0 && y[1] == -8.0 && y[2] == 18.0 );
+  }
+
+  { // interoperation with the dynamic matrix
+    anpi::Matrix<double> m(a.view());
+    BOOST_CHECK( m.rows() == 3 && m.cols() == 3 );
+    BOOST_CHECK( m(2,1) == 7.0 );
+
+    F33 b(m);
+    BOOST_CHECK( a == b );
+
+    anpi::Matrix<double> n(4,4,0.0);
+    n.fill(a);
+    BOOST_CHECK( n(2,2) == 2.0 && n(3,3) == 0.0 );
+
+    F33 c;
+    c.fill(anpi::Matrix<double>(2,2,5.0));
+    BOOST_CHECK( c(1,1) == 5.0 && c(2,2) == 0.0 );
+
+    BOOST_CHECK_THROW( F33 d(n),anpi::Exception );
+  }
+
+  { // LU with pivoting and solve
+    F33 LU;
+    std::array<size_t,3> p;
+    anpi::fixed::lu(a,LU,p);
+
+    F33 L,U;
+    for (size_t i=0;i<3;++i) {
+      L(i,i) = 1.0;
+      for (size_t j=0;j<3;++j) {
+        (j<i ? L(i,j) : U(i,j)) = LU(i,j);
+      }
+    }
+    F33 PA;
+    for (size_t i=0;i<3;++i) {
+      for (size_t j=0;j<3;++j) {
+        PA(i,j) = a(p[i],j);
+      }
+    }
+    F33 LxU = L*U;
+    for (size_t i=0;i<9;++i) {
+      BOOST_CHECK_CLOSE( LxU.data()[i],PA.data()[i],1.0e-10 );
+    }
+
+    std::array<double,3> x;
+    std::array<double,3> b = {{5,-2,9}};
+    anpi::fixed::solveLU(a,x,b);
+    BOOST_CHECK_CLOSE( x[0],1.0,1.0e-10 );
+    BOOST_CHECK_CLOSE( x[1],1.0,1.0e-10 );
+    BOOST_CHECK_CLOSE( x[2],2.0,1.0e-10 );
+
+    // In place, with a permutation other than the identity
+    BOOST_CHECK( p[0] != 0 );
+    std::array<double,3> v = b;
+    anpi::fixed::solveLU(LU,p,v,v);
+    BOOST_CHECK( v == x );
+
+    F33 s = { {1,2,3},{2,4,6},{1,1,1} };
+    BOOST_CHECK_THROW( anpi::fixed::lu(s,LU,p),anpi::Exception );
+  }
+}
+
+// Run the SIMD tests with each instruction set the CPU supports
+BOOST_AUTO_TEST_CASE(Dispatch) {
+  const anpi::cpu::Isa best = anpi::cpu::isa();
+
+  for (int i=anpi::cpu::Fallback;i<=best;++i) {
+    BOOST_CHECK( anpi::cpu::select(anpi::cpu::Isa(i)) == i );
+    BOOST_TEST_MESSAGE("Kernels: " << anpi::cpu::name(anpi::cpu::isa()));
+
+    dispatchTest(testSimd);
+    maskedTailTest();
+    dispatchTest(testParallelArithmetic);
+    dispatchTest(testExpression);
+    dispatchTest(testMultiplication);
+    dispatchTest(testGemv);
+    dispatchTest(testBlas1);
+    dispatchTest(testReduce);
+    dispatchTest(testTranspose);
+    dispatchTest(testViews);
+    dispatchTest(testLayout);
+    testHalf<anpi::half>();
+    testHalf<anpi::bfloat16>();
+  }
+
+  anpi::cpu::select(best);
+  BOOST_CHECK( anpi::cpu::isa() == best );
 }
   
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+#ifndef ANPI_TEST_PARALLEL_HPP
+#define ANPI_TEST_PARALLEL_HPP
+
+#include <cstddef>
+
+#include "Parallel.hpp"
+
+namespace anpi {
+  namespace test {
+
+    /**
+     * Restore the number of threads and all thresholds of
+     * anpi::parallel when the scope ends, even if a check throws, so
+     * that the tests can change them freely.
+     *
+     * @code
+     * anpi::test::ParallelSettings settings;
+     * anpi::parallel::threads()       = 3;
+     * anpi::parallel::gemmThreshold() = 0;
+     * @endcode
+     */
+    class ParallelSettings {
+      size_t _threads;
+      size_t _gemm;
+      size_t _gemv;
+      size_t _reduce;
+      size_t _elementwise;
+      size_t _firstTouch;
+      size_t _spmv;
+      size_t _lu;
+
+    public:
+      ParallelSettings()
+        : _threads(parallel::threads()),
+          _gemm(parallel::gemmThreshold()),
+          _gemv(parallel::gemvThreshold()),
+          _reduce(parallel::reduceThreshold()),
+          _elementwise(parallel::elementwiseThreshold()),
+          _firstTouch(parallel::firstTouchThreshold()),
+          _spmv(parallel::spmvThreshold()),
+          _lu(parallel::luThreshold()) {}
+
+      ParallelSettings(const ParallelSettings&) = delete;
+      ParallelSettings& operator=(const ParallelSettings&) = delete;
+
+      ~ParallelSettings() {
+        parallel::threads()              = _threads;
+        parallel::gemmThreshold()        = _gemm;
+        parallel::gemvThreshold()        = _gemv;
+        parallel::reduceThreshold()      = _reduce;
+        parallel::elementwiseThreshold() = _elementwise;
+        parallel::firstTouchThreshold()  = _firstTouch;
+        parallel::spmvThreshold()        = _spmv;
+        parallel::luThreshold()          = _lu;
+      }
+    };
+
+  } // test
+} // anpi
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+#ifndef ANPI_TEST_RANDOM_HPP
+#define ANPI_TEST_RANDOM_HPP
+
+#include <cstddef>
+
+#include "Matrix.hpp"
+
+namespace anpi {
+  namespace test {
+
+    /**
+     * rows x cols matrix with pseudo-random entries in [-1,1), the same
+     * for the same seed on every platform.  Unlike periodic patterns,
+     * square ones are regular, as the decompositions need.
+     */
+    template<typename T>
+    Matrix<T> randomMatrix(const size_t rows,
+                           const size_t cols,
+                           unsigned int seed = 12345u) {
+      Matrix<T> a(rows,cols);
+      for (size_t i=0;i<rows;++i) {
+        for (size_t j=0;j<cols;++j) {
+          seed = 1103515245u*seed + 12345u;
+          a(i,j) = T(int((seed >> 16) % 2048u) - 1024)/T(1024);
+        }
+      }
+      return a;
+    }
+
+    /**
+     * rows x cols matrix of small integers in [-4,4] repeating with
+     * period 9, so that sums and products of moderate length are exact
+     * in every value type.
+     */
+    template<typename T,
+             class Alloc = typename Matrix<T>::allocator_type>
+    Matrix<T,Alloc> patternMatrix(const size_t rows,const size_t cols) {
+      Matrix<T,Alloc> a(rows,cols,DoNotInitialize);
+      for (size_t i=0;i<rows;++i) {
+        for (size_t j=0;j<cols;++j) {
+          a(i,j) = T(int((i*7+j*3)%9)-4);
+        }
+      }
+      return a;
+    }
+
+  } // test
+} // anpi
+
+#endif
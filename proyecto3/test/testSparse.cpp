@@ -0,0 +1,220 @@
+/**
+ * Copyright (C) 2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <complex>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Unit tests for the sparse matrices
+ */
+
+#include "SparseMatrix.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
+
+#include "testParallel.hpp"
+
+// Explicit instantiation of all methods of SparseMatrix
+typedef std::complex<double> dcomplex;
+
+template class anpi::SparseMatrix<double>;
+template class anpi::SparseMatrix<float>;
+template class anpi::SparseMatrix<int>;
+template class anpi::SparseMatrix<dcomplex>;
+template class anpi::SparseMatrix<double,anpi::ColMajor>;
+template class anpi::SparseMatrix<float ,anpi::ColMajor>;
+
+template class anpi::SparseBuilder<double>;
+
+BOOST_AUTO_TEST_SUITE( Sparse )
+
+/**
+ * Five-point stencil of a gx x gy grid, as the thermal plate, plus one
+ * row and one column coupling many unknowns, which are long enough for
+ * the register kernels.  All values are small integers, so that the
+ * products are exact in any summation order.
+ */
+template<typename T>
+anpi::SparseBuilder<T> stencil(const size_t gx,const size_t gy) {
+  const size_t n = gx*gy;
+  anpi::SparseBuilder<T> b(n,n);
+  for (size_t i=0;i<gy;++i) {
+    for (size_t j=0;j<gx;++j) {
+      const size_t r = i*gx+j;
+      if (i>0)    b.add(r,r-gx,T(-1));
+      if (j>0)    b.add(r,r-1 ,T(-1));
+      b.add(r,r,T(4));
+      if (j+1<gx) b.add(r,r+1 ,T(-1));
+      if (i+1<gy) b.add(r,r+gx,T(-1));
+    }
+  }
+  for (size_t k=0;k<n;k+=3) {
+    b.add(n/2,k,T(int(k%5)-2));
+    b.add(k,n/3,T(int(k%3)+1));
+  }
+  return b;
+}
+
+BOOST_AUTO_TEST_CASE( Builder ) {
+  // Triplets out of order, with a repeated position
+  anpi::SparseBuilder<double> b(3,4);
+  b.add(2,3, 5.0);
+  b.add(0,1, 1.0);
+  b.add(2,0, 4.0);
+  b.add(0,1, 2.0);
+  b.add(1,2,-1.0);
+  BOOST_CHECK( b.size() == 5 );
+  BOOST_CHECK_THROW( b.add(3,0,1.0), anpi::Exception );
+  BOOST_CHECK_THROW( b.add(0,4,1.0), anpi::Exception );
+
+  const anpi::Matrix<double> dense = { { 0, 3, 0, 0},
+                                       { 0, 0,-1, 0},
+                                       { 4, 0, 0, 5} };
+
+  anpi::SparseMatrix<double> a = b.build();
+  BOOST_CHECK( a.rows() == 3 && a.cols() == 4 );
+  BOOST_CHECK( a.nonZeros() == 4 );
+  BOOST_CHECK( a.offsets()[0] == 0 && a.offsets()[1] == 1 &&
+               a.offsets()[2] == 2 && a.offsets()[3] == 4 );
+  BOOST_CHECK( a.indices()[2] == 0 && a.indices()[3] == 3 );
+  BOOST_CHECK( a.toDense() == dense );
+
+  anpi::SparseMatrix<double,anpi::ColMajor> c = b.build<anpi::ColMajor>();
+  BOOST_CHECK( c.lines() == 4 && c.nonZeros() == 4 );
+  BOOST_CHECK( c.toDense() == dense );
+
+  for (size_t i=0;i<3;++i) {
+    for (size_t j=0;j<4;++j) {
+      BOOST_CHECK( a(i,j) == dense(i,j) );
+      BOOST_CHECK( c(i,j) == dense(i,j) );
+    }
+  }
+
+  // Conversions between the formats and from dense matrices
+  typedef anpi::SparseMatrix<double,anpi::ColMajor> csc;
+  BOOST_CHECK( anpi::SparseMatrix<double>(c).toDense() == dense );
+  BOOST_CHECK( csc(a).toDense() == dense );
+  BOOST_CHECK( anpi::SparseMatrix<double>(dense).nonZeros() == 4 );
+  BOOST_CHECK( csc(dense).toDense() == dense );
+
+  typedef anpi::Matrix<double,std::allocator<double>,anpi::ColMajor> cmatrix;
+  cmatrix cdense;
+  a.toDense(cdense);
+  BOOST_CHECK( anpi::SparseMatrix<double>(cdense).toDense() == dense );
+
+  // The transpose shares the arrays
+  csc t = a.transpose();
+  BOOST_CHECK( t.rows() == 4 && t.cols() == 3 );
+  for (size_t i=0;i<3;++i) {
+    for (size_t j=0;j<4;++j) {
+      BOOST_CHECK( t(j,i) == dense(i,j) );
+    }
+  }
+
+  // Inconsistent arrays
+  BOOST_CHECK_THROW( anpi::SparseMatrix<double>(2,2,{0,1},{0},{1.0}),
+                     anpi::Exception );
+  BOOST_CHECK_THROW( anpi::SparseMatrix<double>(2,2,{0,2,2},{1,0},{1.,1.}),
+                     anpi::Exception );
+  BOOST_CHECK_THROW( anpi::SparseMatrix<double>(2,2,{0,1,1},{2},{1.0}),
+                     anpi::Exception );
+  BOOST_CHECK_NO_THROW( anpi::SparseMatrix<double>(2,2,{0,2,2},{0,1},
+                                                   {1.,1.}) );
+}
+
+template<typename T,class Layout>
+void testProducts() {
+  const size_t gx=7,gy=9,n=gx*gy;
+
+  const anpi::SparseMatrix<T,Layout> a = stencil<T>(gx,gy).template
+                                           build<Layout>();
+  const anpi::Matrix<T> dense = a.toDense();
+
+  std::vector<T> x(n);
+  for (size_t i=0;i<n;++i) {
+    x[i] = T(int(i%7)-3);
+  }
+
+  // Reference products
+  std::vector<T> ax(n,T(0)),atx(n,T(0));
+  for (size_t i=0;i<n;++i) {
+    for (size_t j=0;j<n;++j) {
+      ax[i]  += dense(i,j)*x[j];
+      atx[j] += dense(i,j)*x[i];
+    }
+  }
+
+  std::vector<T> y;
+  anpi::gemv(a,x,y);
+  BOOST_CHECK( y == ax );
+  BOOST_CHECK( a*x == ax );
+
+  anpi::gemvTransposed(a,x,y);
+  BOOST_CHECK( y == atx );
+
+  // y = 2*a*x - y
+  std::vector<T> z(n,T(1)),ref(n);
+  for (size_t i=0;i<n;++i) {
+    ref[i] = T(2)*ax[i] - T(1);
+  }
+  anpi::gemv(a,x,z,T(2),T(-1));
+  BOOST_CHECK( z == ref );
+
+  z.assign(n,T(1));
+  for (size_t i=0;i<n;++i) {
+    ref[i] = T(2)*atx[i] - T(1);
+  }
+  anpi::gemvTransposed(a,x,z,T(2),T(-1));
+  BOOST_CHECK( z == ref );
+
+  std::vector<T> wrong(n-1);
+  BOOST_CHECK_THROW( anpi::gemv(a,wrong,y), anpi::Exception );
+  BOOST_CHECK_THROW( anpi::gemv(a,x,wrong,T(1),T(1)), anpi::Exception );
+  BOOST_CHECK_THROW( anpi::gemvTransposed(a,wrong,y), anpi::Exception );
+}
+
+template<typename T>
+void testAllProducts() {
+  anpi::test::ParallelSettings settings;
+  const size_t oldThreshold = anpi::parallel::spmvThreshold();
+
+  // With five threads, the windows of the scattering products are
+  // about as wide as the band of the stencil, and overlap
+  for (size_t threads=1;threads<=5;threads+=2) {
+    anpi::parallel::threads()       = threads;
+    anpi::parallel::spmvThreshold() = (threads>1) ? 0 : oldThreshold;
+
+    testProducts<T,anpi::RowMajor>();
+    testProducts<T,anpi::ColMajor>();
+  }
+}
+
+BOOST_AUTO_TEST_CASE( Products ) {
+  testAllProducts<double>();
+  testAllProducts<float>();
+  testAllProducts<int>();
+  testAllProducts<dcomplex>();
+}
+
+BOOST_AUTO_TEST_CASE( Dispatch ) {
+  const anpi::cpu::Isa best = anpi::cpu::isa();
+
+  for (int i=anpi::cpu::Fallback;i<=best;++i) {
+    anpi::cpu::select(anpi::cpu::Isa(i));
+    BOOST_TEST_MESSAGE("Kernels: " << anpi::cpu::name(anpi::cpu::isa()));
+
+    testAllProducts<double>();
+    testAllProducts<float>();
+  }
+
+  anpi::cpu::select(best);
+}
+
+BOOST_AUTO_TEST_SUITE_END()